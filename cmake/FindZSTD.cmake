@@ -0,0 +1,16 @@
+# find Zstandard includes and library
+#
+# ZSTD_FOUND
+# ZSTD_LIBRARY
+# ZSTD_INCLUDE_DIR
+
+FIND_LIBRARY(ZSTD_LIBRARY NAMES zstd)
+FIND_PATH(ZSTD_INCLUDE_DIR NAMES zstd.h)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(ZSTD
+    REQUIRED_VARS ZSTD_INCLUDE_DIR ZSTD_LIBRARY)
+set(ZSTD_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR})
+set(ZSTD_LIBRARIES ${ZSTD_LIBRARY})
+
+mark_as_advanced(ZSTD_LIBRARIES ZSTD_INCLUDE_DIRS)
@@ -217,7 +217,11 @@ opt_set(void *opts, const struct opt_def *def, const char **val)
 		if (def->len == sizeof(uint64_t)) {
 			store_u64(opt, uval);
 		} else if (def->len == sizeof(uint32_t)) {
-			store_u32(opt, uval);
+			/*
+			 * Don't wrap a value which doesn't fit, for
+			 * the range check of the option to reject it.
+			 */
+			store_u32(opt, MIN(uval, UINT32_MAX));
 		} else {
 			mp_unreachable();
 		}
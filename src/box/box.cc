@@ -205,19 +205,13 @@ box_is_ro(void)
 }
 
 static void
-recover_row(struct recovery *r, void *param, struct xrow_header *row)
+recover_request(struct recovery *r, void *param, struct request *request)
 {
 	struct recover_row_ctx *ctx = (struct recover_row_ctx *) param;
 	assert(r == ::recovery);
-	assert(row->bodycnt == 1); /* always 1 for read */
 	(void) r;
 
-	struct request request;
-	request_create(&request, row->type);
-	request_decode(&request, (const char *) row->body[0].iov_base,
-		row->body[0].iov_len);
-	request.header = row;
-	process_rw(&request, NULL);
+	process_rw(request, NULL);
 	/**
 	 * Yield once in a while, but not too often,
 	 * mostly to allow signal handling to take place.
@@ -226,6 +220,19 @@ recover_row(struct recovery *r, void *param, struct xrow_header *row)
 		fiber_sleep(0);
 }
 
+static void
+recover_row(struct recovery *r, void *param, struct xrow_header *row)
+{
+	assert(row->bodycnt == 1); /* always 1 for read */
+
+	struct request request;
+	request_create(&request, row->type);
+	request_decode(&request, (const char *) row->body[0].iov_base,
+		row->body[0].iov_len);
+	request.header = row;
+	recover_request(r, param, &request);
+}
+
 /* {{{ configuration bindings */
 
 static void
@@ -274,6 +281,50 @@ box_check_wal_mode(const char *mode_name)
 	return (enum wal_mode) mode;
 }
 
+static enum xlog_codec
+box_check_snap_compression(const char *codec_name)
+{
+	assert(codec_name != NULL); /* checked in Lua */
+	int codec = strindex(xlog_codec_STRS, codec_name, XLOG_CODEC_MAX);
+	if (codec == XLOG_CODEC_MAX)
+		tnt_raise(ClientError, ER_CFG, "snap_compression", codec_name);
+	if (! xlog_codec_is_supported((enum xlog_codec) codec)) {
+		tnt_raise(ClientError, ER_CFG, "snap_compression",
+			  "the codec is not supported by this build");
+	}
+	return (enum xlog_codec) codec;
+}
+
+static int
+box_check_snap_delta_max(int snap_delta_max)
+{
+	if (snap_delta_max < 0) {
+		tnt_raise(ClientError, ER_CFG, "snap_delta_max",
+			  "the value must not be less than zero");
+	}
+	return snap_delta_max;
+}
+
+static double
+box_check_snap_io_rate_burst(double burst)
+{
+	if (burst <= 0) {
+		tnt_raise(ClientError, ER_CFG, "snap_io_rate_burst",
+			  "the value must be greater than zero");
+	}
+	return burst;
+}
+
+static int
+box_check_snap_threads(int snap_threads)
+{
+	if (snap_threads < 1 || snap_threads > XLOG_PARTS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "snap_threads",
+			  "specified value is out of bounds");
+	}
+	return snap_threads;
+}
+
 static void
 box_check_readahead(int readahead)
 {
@@ -296,6 +347,43 @@ box_check_rows_per_wal(int64_t rows_per_wal)
 	return rows_per_wal;
 }
 
+static int64_t
+box_check_wal_max_size(int64_t max_size)
+{
+	if (max_size < 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_max_size",
+			  "the value must not be negative");
+	}
+	return max_size;
+}
+
+static int64_t
+box_check_wal_prealloc_size(int64_t prealloc_size)
+{
+	if (prealloc_size < 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_prealloc_size",
+			  "the value must not be negative");
+	}
+	return prealloc_size;
+}
+
+static void
+box_check_wal_commit(double delay, int64_t max_rows, int64_t max_bytes)
+{
+	if (delay < 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_commit_delay",
+			  "the value must not be negative");
+	}
+	if (max_rows <= 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_commit_max_rows",
+			  "the value must be greater than zero");
+	}
+	if (max_bytes <= 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_commit_max_bytes",
+			  "the value must be greater than zero");
+	}
+}
+
 void
 box_check_config()
 {
@@ -306,6 +394,15 @@ box_check_config()
 	box_check_readahead(cfg_geti("readahead"));
 	box_check_rows_per_wal(cfg_geti64("rows_per_wal"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
+	box_check_wal_max_size(cfg_geti64("wal_max_size"));
+	box_check_wal_prealloc_size(cfg_geti64("wal_prealloc_size"));
+	box_check_snap_compression(cfg_gets("snap_compression"));
+	box_check_snap_threads(cfg_geti("snap_threads"));
+	box_check_snap_io_rate_burst(cfg_getd("snap_io_rate_burst"));
+	box_check_snap_delta_max(cfg_geti("snap_delta_max"));
+	box_check_wal_commit(cfg_getd("wal_commit_delay"),
+			     cfg_geti64("wal_commit_max_rows"),
+			     cfg_geti64("wal_commit_max_bytes"));
 	box_check_slab_alloc_minimal(cfg_geti64("slab_alloc_minimal"));
 }
 
@@ -423,6 +520,16 @@ box_set_wal_mode(void)
 		recovery_update_mode(recovery, mode);
 }
 
+extern "C" void
+box_set_wal_commit(void)
+{
+	double delay = cfg_getd("wal_commit_delay");
+	int64_t max_rows = cfg_geti64("wal_commit_max_rows");
+	int64_t max_bytes = cfg_geti64("wal_commit_max_bytes");
+	box_check_wal_commit(delay, max_rows, max_bytes);
+	wal_writer_set_group_commit(recovery, delay, max_rows, max_bytes);
+}
+
 extern "C" void
 box_set_log_level(void)
 {
@@ -441,6 +548,42 @@ box_set_snap_io_rate_limit(void)
 	recovery_update_io_rate_limit(recovery, cfg_getd("snap_io_rate_limit"));
 }
 
+extern "C" void
+box_set_snap_io_rate_burst(void)
+{
+	double burst =
+		box_check_snap_io_rate_burst(cfg_getd("snap_io_rate_burst"));
+	recovery_update_io_rate_burst(recovery, burst);
+}
+
+extern "C" void
+box_set_snap_compression(void)
+{
+	recovery->snap_dir.codec =
+		box_check_snap_compression(cfg_gets("snap_compression"));
+}
+
+extern "C" void
+box_set_snap_index_image(void)
+{
+	recovery->snap_index_image = cfg_geti("snap_index_image");
+}
+
+extern "C" void
+box_set_snap_delta_max(void)
+{
+	recovery->snap_delta_max =
+		box_check_snap_delta_max(cfg_geti("snap_delta_max"));
+}
+
+extern "C" void
+box_set_snap_threads(void)
+{
+	int snap_threads = box_check_snap_threads(cfg_geti("snap_threads"));
+	/* A single thread writes a single file. */
+	recovery->snap_dir.part_count = snap_threads > 1 ? snap_threads : 0;
+}
+
 extern "C" void
 box_set_too_long_threshold(void)
 {
@@ -1025,7 +1168,8 @@ box_init(void)
 			     cfg_geti64("rows_per_wal"));
 	recovery = recovery_new(cfg_gets("snap_dir"),
 				cfg_gets("wal_dir"),
-				recover_row, &recover_row_ctx);
+				recover_row, recover_request,
+				&recover_row_ctx);
 	recovery_setup_panic(recovery,
 			     cfg_geti("panic_on_snap_error"),
 			     cfg_geti("panic_on_wal_error"));
@@ -1081,7 +1225,12 @@ box_init(void)
 
 	int64_t rows_per_wal = box_check_rows_per_wal(cfg_geti64("rows_per_wal"));
 	enum wal_mode wal_mode = box_check_wal_mode(cfg_gets("wal_mode"));
-	recovery_finalize(recovery, wal_mode, rows_per_wal);
+	int64_t wal_max_size =
+		box_check_wal_max_size(cfg_geti64("wal_max_size"));
+	int64_t wal_prealloc_size =
+		box_check_wal_prealloc_size(cfg_geti64("wal_prealloc_size"));
+	recovery_finalize(recovery, wal_mode, rows_per_wal, wal_max_size,
+			  wal_prealloc_size, cfg_geti("wal_direct_io"));
 
 	engine_end_recovery();
 
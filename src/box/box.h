@@ -68,7 +68,7 @@ box_is_ro(void);
 /** True if snapshot is in progress. */
 extern bool snapshot_in_progress;
 /** Incremented with each next snapshot. */
-extern uint32_t snapshot_version;
+extern uint16_t snapshot_version;
 
 /**
  * Iterate over all spaces and save them to the
@@ -106,9 +106,15 @@ box_check_config();
 void box_set_listen(void);
 void box_set_replication_source(void);
 void box_set_wal_mode(void);
+void box_set_wal_commit(void);
 void box_set_log_level(void);
 void box_set_io_collect_interval(void);
 void box_set_snap_io_rate_limit(void);
+void box_set_snap_io_rate_burst(void);
+void box_set_snap_compression(void);
+void box_set_snap_index_image(void);
+void box_set_snap_delta_max(void);
+void box_set_snap_threads(void);
 void box_set_too_long_threshold(void);
 void box_set_readahead(void);
 void box_set_panic_on_wal_error(void);
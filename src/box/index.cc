@@ -38,6 +38,7 @@
 #include "request.h"
 #include "txn.h"
 #include "rmean.h"
+#include "scoped_guard.h"
 
 const char *iterator_type_strs[] = {
 	/* [ITER_EQ]  = */ "EQ",
@@ -52,6 +53,7 @@ const char *iterator_type_strs[] = {
 	/* [ITER_BITS_ALL_NOT_SET] = */ "BITS_ALL_NOT_SET",
 	/* [ITER_OVERLAPS] = */ "OVERLAPS",
 	/* [ITER_NEIGHBOR] = */ "NEIGHBOR",
+	/* [ITER_PREFIX] = */ "PREFIX",
 };
 
 static_assert(sizeof(iterator_type_strs) / sizeof(const char *) ==
@@ -59,6 +61,29 @@ static_assert(sizeof(iterator_type_strs) / sizeof(const char *) ==
 
 /* {{{ Utilities. **********************************************/
 
+void
+index_ref_found(struct tuple **result, uint32_t count)
+{
+	uint32_t i = 0;
+	auto guard = make_scoped_guard([&] {
+		index_unref_found(result, i);
+	});
+	for (; i < count; i++) {
+		if (result[i] != NULL)
+			tuple_ref(result[i]);
+	}
+	guard.is_active = false;
+}
+
+void
+index_unref_found(struct tuple **result, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		if (result[i] != NULL)
+			tuple_unref(result[i]);
+	}
+}
+
 UnsupportedIndexFeature::UnsupportedIndexFeature(const char *file,
 	unsigned line, const Index *index, const char *what)
 	: ClientError(file, line, ER_UNKNOWN)
@@ -95,11 +120,12 @@ key_validate(struct key_def *key_def, enum iterator_type type, const char *key,
 	if (part_count == 0) {
 		/*
 		 * Zero key parts are allowed:
-		 * - for TREE index, all iterator types,
+		 * - for TREE and ART index, all iterator types,
 		 * - ITER_ALL iterator type, all index types
 		 * - ITER_GT iterator in HASH index (legacy)
 		 */
-		if (key_def->type == TREE || type == ITER_ALL ||
+		if (key_def->type == TREE || key_def->type == ART ||
+		    type == ITER_ALL ||
 		    (key_def->type == HASH && type == ITER_GT))
 			return;
 		/* Fall through. */
@@ -134,8 +160,9 @@ key_validate(struct key_def *key_def, enum iterator_type type, const char *key,
 			tnt_raise(ClientError, ER_KEY_PART_COUNT,
 				  key_def->part_count, part_count);
 
-		/* Partial keys are allowed only for TREE index type. */
-		if (key_def->type != TREE && part_count < key_def->part_count) {
+		/* Partial keys are allowed only for TREE and ART. */
+		if (key_def->type != TREE && key_def->type != ART &&
+		    part_count < key_def->part_count) {
 			tnt_raise(ClientError, ER_EXACT_MATCH,
 				  key_def->part_count, part_count);
 		}
@@ -215,6 +242,23 @@ Index::findByKey(const char *key, uint32_t part_count) const
 	return NULL;
 }
 
+void
+Index::findByKeys(const char **keys, uint32_t part_count, uint32_t count,
+		  struct tuple **result) const
+{
+	uint32_t found = 0;
+	auto guard = make_scoped_guard([&] {
+		index_unref_found(result, found);
+	});
+	for (; found < count; found++) {
+		struct tuple *tuple = findByKey(keys[found], part_count);
+		if (tuple != NULL)
+			tuple_ref(tuple);
+		result[found] = tuple;
+	}
+	guard.is_active = false;
+}
+
 struct tuple *
 Index::findByTuple(struct tuple *tuple) const
 {
@@ -251,6 +295,22 @@ Index::initIterator(struct iterator *ptr, enum iterator_type type,
 	tnt_raise(UnsupportedIndexFeature, this, "requested iterator type");
 }
 
+uint32_t
+Index::skipIterator(struct iterator *iterator, uint32_t count) const
+{
+	uint32_t skipped = 0;
+	while (skipped < count && iterator->next(iterator) != NULL)
+		skipped++;
+	return skipped;
+}
+
+void
+Index::limitIterator(struct iterator *iterator, uint32_t limit) const
+{
+	(void) iterator;
+	(void) limit;
+}
+
 /**
  * Create a read view for iterator so further index modifications
  * will not affect the iterator iteration.
@@ -358,6 +418,49 @@ box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	}
 }
 
+int
+box_index_get_multi(uint32_t space_id, uint32_t index_id, const char *keys,
+		    const char *keys_end, box_tuple_t **result)
+{
+	mp_tuple_assert(keys, keys_end);
+	assert(result != NULL);
+	struct region *gc = &fiber()->gc;
+	size_t used = region_used(gc);
+	try {
+		struct space *space;
+		Index *index = check_index(space_id, index_id, &space);
+		if (!index->key_def->opts.is_unique)
+			tnt_raise(ClientError, ER_MORE_THAN_ONE_TUPLE);
+		uint32_t count = mp_decode_array(&keys);
+		const char **key_parts = (const char **)
+			region_alloc_xc(gc, count * sizeof(char *));
+		uint32_t part_count = index->key_def->part_count;
+		for (uint32_t i = 0; i < count; i++) {
+			if (mp_typeof(*keys) != MP_ARRAY) {
+				tnt_raise(ClientError, ER_ILLEGAL_PARAMS,
+					  "keys must be arrays");
+			}
+			const char *key = keys;
+			primary_key_validate(index->key_def, key,
+					     mp_decode_array(&key));
+			key_parts[i] = key;
+			mp_next(&keys);
+		}
+		/* Start transaction in the engine. */
+		struct txn *txn = txn_begin_ro_stmt(space);
+		index->findByKeys(key_parts, part_count, count, result);
+		/* Count statistics */
+		rmean_collect(rmean_box, IPROTO_GET_MULTI, count);
+		txn_commit_ro_stmt(txn);
+		region_truncate(gc, used);
+		return 0;
+	}  catch (Exception *) {
+		txn_rollback_stmt();
+		region_truncate(gc, used);
+		return -1;
+	}
+}
+
 int
 box_index_min(uint32_t space_id, uint32_t index_id, const char *key,
 	      const char *key_end, box_tuple_t **result)
@@ -367,7 +470,8 @@ box_index_min(uint32_t space_id, uint32_t index_id, const char *key,
 	try {
 		struct space *space;
 		Index *index = check_index(space_id, index_id, &space);
-		if (index->key_def->type != TREE) {
+		if (index->key_def->type != TREE &&
+		    index->key_def->type != ART) {
 			/* Show nice error messages in Lua */
 			tnt_raise(UnsupportedIndexFeature, index, "min()");
 		}
@@ -394,7 +498,8 @@ box_index_max(uint32_t space_id, uint32_t index_id, const char *key,
 	try {
 		struct space *space;
 		Index *index = check_index(space_id, index_id, &space);
-		if (index->key_def->type != TREE) {
+		if (index->key_def->type != TREE &&
+		    index->key_def->type != ART) {
 			/* Show nice error messages in Lua */
 			tnt_raise(UnsupportedIndexFeature, index, "max()");
 		}
@@ -78,7 +78,8 @@ enum iterator_type {
 	ITER_BITS_ALL_NOT_SET =  9, /* all bits are not set                */
 	ITER_OVERLAPS         = 10, /* key overlaps x                      */
 	ITER_NEIGHBOR         = 11, /* typles in distance ascending order from specified point */
-	iterator_type_MAX     = ITER_NEIGHBOR + 1
+	ITER_PREFIX           = 12, /* key starts with x                   */
+	iterator_type_MAX     = ITER_PREFIX + 1
 };
 
 /**
@@ -180,6 +181,29 @@ int
 box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	      const char *key_end, box_tuple_t **result);
 
+/**
+ * Get tuples from index by several keys at once.
+ *
+ * Lookups of a batch are interleaved, so this is faster than
+ * calling box_index_get() for each key.
+ *
+ * \param space_id space identifier
+ * \param index_id index identifier
+ * \param keys encoded MsgPack Array of keys, each in MsgPack
+ * Array format ([[part1, part2, ...], [part1, part2, ...], ...]).
+ * \param keys_end the end of encoded \a keys
+ * \param[out] result an array with room for a tuple per key,
+ * filled with the tuple found by each key or NULL. Found tuples
+ * are referenced, call box_tuple_unref() for each when done.
+ * \retval -1 on error (check box_error_last())
+ * \retval 0 on success
+ * \pre keys != NULL
+ * \sa \code box.space[space_id].index[index_id]:get_many(keys) \endcode
+ */
+int
+box_index_get_multi(uint32_t space_id, uint32_t index_id, const char *keys,
+		    const char *keys_end, box_tuple_t **result);
+
 /**
  * Return a first (minimal) tuple matched the provided key.
  *
@@ -332,6 +356,14 @@ public:
 			     uint32_t part_count) const;
 	virtual struct tuple *findByKey(const char *key, uint32_t part_count) const;
 	virtual struct tuple *findByTuple(struct tuple *tuple) const;
+	/**
+	 * Find tuples by several full keys: result[i] is set to
+	 * the tuple matching keys[i] or NULL. Found tuples are
+	 * referenced, so that the lookup may yield. On error
+	 * none of them are.
+	 */
+	virtual void findByKeys(const char **keys, uint32_t part_count,
+				uint32_t count, struct tuple **result) const;
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
 				      enum dup_replace_mode mode);
@@ -345,6 +377,24 @@ public:
 	virtual void initIterator(struct iterator *iterator,
 				  enum iterator_type type,
 				  const char *key, uint32_t part_count) const = 0;
+	/**
+	 * Advance an initialized iterator by up to count tuples,
+	 * e.g. to apply the offset of a select. Returns the number
+	 * of tuples skipped, less than count only if the iterator
+	 * is exhausted. The default calls next() count times.
+	 */
+	virtual uint32_t skipIterator(struct iterator *iterator,
+				      uint32_t count) const;
+
+	/**
+	 * Tell an initialized iterator that at most limit tuples
+	 * will be fetched from it, e.g. the offset plus the limit
+	 * of a select, so that it can cut the search short. The
+	 * iterator may return NULL after limit tuples. The default
+	 * does nothing.
+	 */
+	virtual void limitIterator(struct iterator *iterator,
+				   uint32_t limit) const;
 
 	/**
 	 * Create a read view for iterator so further index modifications
@@ -368,6 +418,17 @@ public:
 				const Index *index, const char *what);
 };
 
+/**
+ * Reference the tuples found by Index::findByKeys(), skipping
+ * NULLs. Either all of them end up referenced or none.
+ */
+void
+index_ref_found(struct tuple **result, uint32_t count);
+
+/** Drop references taken by index_ref_found(). */
+void
+index_unref_found(struct tuple **result, uint32_t count);
+
 struct IteratorGuard
 {
 	struct iterator *it;
@@ -54,6 +54,7 @@
 #include "iproto_constants.h"
 #include "authentication.h"
 #include "rmean.h"
+#include "index.h" /* box_index_get_multi() */
 
 /* {{{ iproto_msg - declaration */
 
@@ -468,7 +469,7 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		 * in->rpos.
 		 */
 		if (msg->header.type >= IPROTO_SELECT &&
-		    msg->header.type <= IPROTO_UPSERT) {
+		    msg->header.type <= IPROTO_GET_MULTI) {
 			/* Pre-parse request before putting it into the queue */
 			if (msg->header.bodycnt == 0) {
 				tnt_raise(ClientError, ER_INVALID_MSGPACK,
@@ -687,6 +688,39 @@ tx_process_msg(struct cmsg *m)
 			}
 			break;
 		}
+		case IPROTO_GET_MULTI:
+		{
+			struct request *req = &msg->request;
+			const char *keys = req->key;
+			uint32_t count = mp_decode_array(&keys);
+			struct tuple **result = (struct tuple **)
+				region_alloc_xc(&fiber()->gc,
+						count * sizeof(*result));
+			if (box_index_get_multi(req->space_id, req->index_id,
+						req->key, req->key_end,
+						result) != 0)
+				diag_raise();
+			auto result_guard = make_scoped_guard([=] {
+				index_unref_found(result, count);
+			});
+			struct obuf_svp svp;
+			if (iproto_prepare_select(out, &svp) != 0)
+				diag_raise();
+			for (uint32_t i = 0; i < count; i++) {
+				if (result[i] != NULL) {
+					if (tuple_to_obuf(result[i], out) != 0) {
+						obuf_rollback_to_svp(out, &svp);
+						diag_raise();
+					}
+					continue;
+				}
+				char nil[1];
+				mp_encode_nil(nil);
+				obuf_dup_xc(out, nil, sizeof(nil));
+			}
+			iproto_reply_select(out, &svp, msg->header.sync, count);
+			break;
+		}
 		case IPROTO_INSERT:
 		case IPROTO_REPLACE:
 		case IPROTO_UPDATE:
@@ -101,10 +101,11 @@ const char *iproto_type_strs[] =
 	"AUTH",
 	"EVAL",
 	"UPSERT",
+	"GET_MULTI",
 };
 
 #define bit(c) (1ULL<<IPROTO_##c)
-const uint64_t iproto_body_key_map[IPROTO_UPSERT + 1] = {
+const uint64_t iproto_body_key_map[IPROTO_GET_MULTI + 1] = {
 	0,                                                     /* unused */
 	bit(SPACE_ID) | bit(LIMIT) | bit(KEY),                 /* SELECT */
 	bit(SPACE_ID) | bit(TUPLE),                            /* INSERT */
@@ -115,6 +116,7 @@ const uint64_t iproto_body_key_map[IPROTO_UPSERT + 1] = {
 	bit(USER_NAME)| bit(TUPLE),                            /* AUTH */
 	bit(EXPR)     | bit(TUPLE),                            /* EVAL */
 	bit(SPACE_ID) | bit(OPS) | bit(TUPLE),                 /* UPSERT */
+	bit(SPACE_ID) | bit(KEY),                              /* GET_MULTI */
 };
 #undef bit
 
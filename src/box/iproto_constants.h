@@ -129,12 +129,19 @@ enum iproto_type {
 	IPROTO_AUTH = 7,
 	IPROTO_EVAL = 8,
 	IPROTO_UPSERT = 9,
-	IPROTO_TYPE_STAT_MAX = IPROTO_UPSERT + 1,
+	/* A batch of point lookups in one unique index */
+	IPROTO_GET_MULTI = 10,
+	IPROTO_TYPE_STAT_MAX = IPROTO_GET_MULTI + 1,
 	/* admin command codes */
 	IPROTO_PING = 64,
 	IPROTO_JOIN = 65,
 	IPROTO_SUBSCRIBE = 66,
 	IPROTO_TYPE_ADMIN_MAX = IPROTO_SUBSCRIBE + 1,
+	/*
+	 * The order of tuples in a secondary index, saved in a
+	 * snapshot. Never sent over the network.
+	 */
+	IPROTO_INDEX_IMAGE = 96,
 	/* command failed = (IPROTO_TYPE_ERROR | ER_XXX from errcode.h) */
 	IPROTO_TYPE_ERROR = 1 << 15
 };
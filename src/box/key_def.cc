@@ -51,7 +51,7 @@ const char *mp_type_strs[] = {
 	/* .MP_EXT    = */ "extension",
 };
 
-const char *index_type_strs[] = { "HASH", "TREE", "BITSET", "RTREE" };
+const char *index_type_strs[] = { "HASH", "TREE", "BITSET", "RTREE", "ART" };
 
 const char *rtree_index_distance_type_strs[] = { "EUCLID", "MANHATTAN" };
 
@@ -69,13 +69,15 @@ const struct key_opts key_opts_default = {
 	/* .unique       = */ true,
 	/* .dimension    = */ 2,
 	/* .distancebuf  = */ { '\0' },
-	/* .distance     = */ RTREE_INDEX_DISTANCE_TYPE_EUCLID
+	/* .distance     = */ RTREE_INDEX_DISTANCE_TYPE_EUCLID,
+	/* .hint         = */ true
 };
 
 const struct opt_def key_opts_reg[] = {
 	OPT_DEF("unique", MP_BOOL, struct key_opts, is_unique),
 	OPT_DEF("dimension", MP_UINT, struct key_opts, dimension),
 	OPT_DEF("distance", MP_STR, struct key_opts, distancebuf),
+	OPT_DEF("hint", MP_BOOL, struct key_opts, hint),
 	{ NULL, MP_NIL, 0, 0 }
 };
 
@@ -106,6 +108,8 @@ key_def_set_cmp(struct key_def *def)
 {
 	def->tuple_compare = tuple_compare_create(def);
 	def->tuple_compare_with_key = tuple_compare_with_key_create(def);
+	def->tuple_hash = tuple_hash_create(def);
+	def->key_hash = key_hash_create(def);
 }
 
 struct key_def *
@@ -290,10 +294,13 @@ key_def_set_part(struct key_def *def, uint32_t part_no,
 
 const struct space_opts space_opts_default = {
 	/* .temporary = */ false,
+	/* .field_map_count = */ 0,
 };
 
 const struct opt_def space_opts_reg[] = {
 	OPT_DEF("temporary", MP_BOOL, struct space_opts, temporary),
+	OPT_DEF("field_map_count", MP_UINT, struct space_opts,
+		field_map_count),
 	{ NULL, MP_NIL, 0, 0 }
 };
 
@@ -319,6 +326,11 @@ space_def_check(struct space_def *def, uint32_t namelen, uint32_t engine_namelen
 	}
 	identifier_check(def->engine_name);
 
+	if (def->opts.field_map_count > BOX_FIELD_MAP_MAX) {
+		tnt_raise(ClientError, errcode,
+			  def->name,
+			  "field_map_count is too big");
+	}
 	if (def->opts.temporary) {
 		Engine *engine = engine_find(def->engine_name);
 		if (! engine_can_be_temporary(engine->flags))
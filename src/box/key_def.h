@@ -40,6 +40,7 @@
 #include <wchar.h>
 #include <wctype.h>
 #include "tuple_compare.h"
+#include "tuple_hash.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -61,7 +62,9 @@ enum {
 	/** Yet another arbitrary limit which simply needs to
 	 * exist.
 	 */
-	BOX_INDEX_PART_MAX = UINT8_MAX
+	BOX_INDEX_PART_MAX = UINT8_MAX,
+	/** Biggest space_opts::field_map_count */
+	BOX_FIELD_MAP_MAX = 1024
 };
 
 /*
@@ -116,6 +119,7 @@ enum index_type {
 	TREE,     /* TREE Index */
 	BITSET,   /* BITSET Index */
 	RTREE,    /* R-Tree Index */
+	ART,      /* Adaptive Radix Tree Index */
 	index_type_MAX,
 };
 
@@ -149,7 +153,7 @@ struct key_part {
 /** Index options */
 struct key_opts {
 	/**
-	 * Is this index unique or not - relevant to HASH/TREE
+	 * Is this index unique or not - relevant to HASH/TREE/ART
 	 * index
 	 */
 	bool is_unique;
@@ -162,6 +166,11 @@ struct key_opts {
 	 */
 	char distancebuf[16];
 	enum rtree_index_distance_type distance;
+	/**
+	 * Keep a hint of the first key part next to each
+	 * tuple in a TREE index to skip most tuple comparisons.
+	 */
+	bool hint;
 };
 
 extern const struct key_opts key_opts_default;
@@ -176,6 +185,8 @@ key_opts_cmp(const struct key_opts *o1, const struct key_opts *o2)
 		return o1->dimension < o2->dimension ? -1 : 1;
 	if (o1->distance != o2->distance)
 		return o1->distance < o2->distance ? -1 : 1;
+	if (o1->hint != o2->hint)
+		return o1->hint < o2->hint ? -1 : 1;
 	return 0;
 }
 
@@ -195,6 +206,9 @@ struct key_def {
 	/** comparators */
 	tuple_compare_t tuple_compare;
 	tuple_compare_with_key_t tuple_compare_with_key;
+	/** hash functions */
+	tuple_hash_t tuple_hash;
+	key_hash_t key_hash;
 	/** The size of the 'parts' array. */
 	uint32_t part_count;
 	/** Description of parts of a multipart index. */
@@ -291,6 +305,12 @@ struct space_opts {
 	 * - changes are not part of a snapshot
 	 */
 	bool temporary;
+	/**
+	 * Keep offsets of this many first fields of a tuple,
+	 * indexed or not, for O(1) access to them. Costs 4
+	 * bytes per field in each tuple.
+	 */
+	uint32_t field_map_count;
 };
 
 extern const struct space_opts space_opts_default;
@@ -388,7 +408,7 @@ key_part_cmp(const struct key_part *parts1, uint32_t part_count1,
 /**
  * One key definition is greater than the other if it's id is
  * greater, it's name is greater,  it's index type is greater
- * (HASH < TREE < BITSET) or its key part array is greater.
+ * (HASH < TREE < BITSET < RTREE < ART) or its key part array is greater.
  */
 int
 key_def_cmp(const struct key_def *key1, const struct key_def *key2);
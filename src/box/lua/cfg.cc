@@ -75,6 +75,17 @@ lbox_cfg_set_wal_mode(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_wal_commit(struct lua_State *L)
+{
+	try {
+		box_set_wal_commit();
+	} catch (Exception *) {
+		lbox_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_listen(struct lua_State *L)
 {
@@ -152,6 +163,61 @@ lbox_cfg_set_snap_io_rate_limit(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_snap_io_rate_burst(struct lua_State *L)
+{
+	try {
+		box_set_snap_io_rate_burst();
+	} catch (Exception *) {
+		lbox_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_snap_compression(struct lua_State *L)
+{
+	try {
+		box_set_snap_compression();
+	} catch (Exception *) {
+		lbox_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_snap_index_image(struct lua_State *L)
+{
+	try {
+		box_set_snap_index_image();
+	} catch (Exception *) {
+		lbox_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_snap_delta_max(struct lua_State *L)
+{
+	try {
+		box_set_snap_delta_max();
+	} catch (Exception *) {
+		lbox_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_snap_threads(struct lua_State *L)
+{
+	try {
+		box_set_snap_threads();
+	} catch (Exception *) {
+		lbox_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_panic_on_wal_error(struct lua_State *L)
 {
@@ -181,6 +247,7 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_check", lbox_cfg_check},
 		{"cfg_load", lbox_cfg_load},
 		{"cfg_set_wal_mode", lbox_cfg_set_wal_mode},
+		{"cfg_set_wal_commit", lbox_cfg_set_wal_commit},
 		{"cfg_set_listen", lbox_cfg_set_listen},
 		{"cfg_set_replication_source", lbox_cfg_set_replication_source},
 		{"cfg_set_log_level", lbox_cfg_set_log_level},
@@ -188,6 +255,11 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_io_collect_interval", lbox_cfg_set_io_collect_interval},
 		{"cfg_set_too_long_threshold", lbox_cfg_set_too_long_threshold},
 		{"cfg_set_snap_io_rate_limit", lbox_cfg_set_snap_io_rate_limit},
+		{"cfg_set_snap_io_rate_burst", lbox_cfg_set_snap_io_rate_burst},
+		{"cfg_set_snap_compression", lbox_cfg_set_snap_compression},
+		{"cfg_set_snap_index_image", lbox_cfg_set_snap_index_image},
+		{"cfg_set_snap_delta_max", lbox_cfg_set_snap_delta_max},
+		{"cfg_set_snap_threads", lbox_cfg_set_snap_threads},
 		{"cfg_set_panic_on_wal_error", lbox_cfg_set_panic_on_wal_error},
 		{"cfg_set_read_only", lbox_cfg_set_read_only},
 		{NULL, NULL}
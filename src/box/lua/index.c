@@ -33,6 +33,7 @@
 #include "lua/utils.h"
 #include "box/box.h"
 #include "box/index.h"
+#include "box/tuple.h" /* box_tuple_unref() */
 #include "box/lua/tuple.h"
 #include "box/lua/misc.h" /* lbox_encode_tuple_on_gc() */
 
@@ -169,6 +170,69 @@ lbox_index_get(lua_State *L)
 	return lbox_pushtupleornil(L, tuple);
 }
 
+/** Tuples found by index.get_many(), see lbox_index_push_found(). */
+struct lbox_found_ctx {
+	struct tuple **result;
+	uint32_t count;
+	/** A registry reference to the table of the tuples. */
+	int table_ref;
+};
+
+/**
+ * Make a table of the tuples found by index.get_many(), with
+ * nil for a missing key. Run with lua_cpcall(), so that the
+ * caller drops the references to the tuples even if pushing
+ * one of them fails.
+ */
+static int
+lbox_index_push_found(lua_State *L)
+{
+	struct lbox_found_ctx *ctx = (struct lbox_found_ctx *)
+		lua_touserdata(L, 1);
+	lua_createtable(L, ctx->count, 0);
+	for (uint32_t i = 0; i < ctx->count; i++) {
+		if (ctx->result[i] == NULL)
+			continue;
+		lbox_pushtuple(L, ctx->result[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+	ctx->table_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	return 0;
+}
+
+static int
+lbox_index_get_many(lua_State *L)
+{
+	if (lua_gettop(L) != 3 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
+	    !lua_istable(L, 3))
+		return luaL_error(L, "Usage index.get_many(space_id, index_id, "
+				  "keys)");
+
+	uint32_t space_id = lua_tointeger(L, 1);
+	uint32_t index_id = lua_tointeger(L, 2);
+	size_t keys_len;
+	const char *keys = lbox_encode_tuple_on_gc(L, 3, &keys_len);
+	const char *data = keys;
+	uint32_t count = mp_decode_array(&data);
+
+	struct tuple **result = (struct tuple **)
+		lua_newuserdata(L, count * sizeof(*result));
+	if (box_index_get_multi(space_id, index_id, keys, keys + keys_len,
+				result) != 0)
+		return lbox_error(L);
+	struct lbox_found_ctx ctx = { result, count, LUA_NOREF };
+	int rc = lua_cpcall(L, lbox_index_push_found, &ctx);
+	for (uint32_t i = 0; i < count; i++) {
+		if (result[i] != NULL)
+			box_tuple_unref(result[i]);
+	}
+	if (rc != 0)
+		return lua_error(L);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, ctx.table_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, ctx.table_ref);
+	return 1;
+}
+
 static int
 lbox_index_min(lua_State *L)
 {
@@ -313,6 +377,7 @@ box_lua_index_init(struct lua_State *L)
 		{"delete",  lbox_index_delete},
 		{"random", lbox_index_random},
 		{"get",  lbox_index_get},
+		{"get_many", lbox_index_get_many},
 		{"min", lbox_index_min},
 		{"max", lbox_index_max},
 		{"count", lbox_index_count},
@@ -39,6 +39,7 @@
 
 #include "box/applier.h"
 #include "box/recovery.h"
+#include "box/wal.h"
 #include "box/cluster.h"
 #include "main.h"
 #include "box/box.h"
@@ -158,6 +159,97 @@ lbox_info_cluster(struct lua_State *L)
 	return 1;
 }
 
+/**
+ * Push a batch size histogram as an array, up to the last
+ * non-empty bucket: element i counts batches of
+ * [2^(i-1), 2^i) rows or bytes.
+ */
+static void
+lbox_info_push_hist(struct lua_State *L, const int64_t *hist)
+{
+	int size = WAL_STAT_HIST_SIZE;
+	while (size > 0 && hist[size - 1] == 0)
+		size--;
+	lua_createtable(L, size, 0);
+	for (int i = 0; i < size; i++) {
+		luaL_pushint64(L, hist[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+}
+
+static int
+lbox_info_wal(struct lua_State *L)
+{
+	struct wal_stat stat;
+	if (wal_writer_stat(recovery, &stat) != 0)
+		memset(&stat, 0, sizeof(stat));
+	/* Avoid division by zero before the first batch. */
+	double batch_count = stat.batch_count > 0 ? stat.batch_count : 1;
+
+	lua_createtable(L, 0, 18);
+	lua_pushliteral(L, "durable_lsn");
+	luaL_pushint64(L, wal_durable_lsn(recovery));
+	lua_settable(L, -3);
+	lua_pushliteral(L, "rows");
+	luaL_pushint64(L, stat.rows);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "bytes");
+	luaL_pushint64(L, stat.bytes);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "batch_count");
+	luaL_pushint64(L, stat.batch_count);
+	lua_settable(L, -3);
+	/* Average group commit batch size and wait time */
+	lua_pushliteral(L, "batch_rows");
+	lua_pushnumber(L, stat.rows / batch_count);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "batch_bytes");
+	lua_pushnumber(L, stat.bytes / batch_count);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "batch_wait");
+	lua_pushnumber(L, stat.wait_time / batch_count);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "batch_rows_hist");
+	lbox_info_push_hist(L, stat.batch_rows_hist);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "batch_bytes_hist");
+	lbox_info_push_hist(L, stat.batch_bytes_hist);
+	lua_settable(L, -3);
+	/* Average and maximal write and sync latency */
+	lua_pushliteral(L, "write_time");
+	lua_pushnumber(L, stat.write_count > 0 ?
+		       stat.write_time / stat.write_count : 0);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "write_max");
+	lua_pushnumber(L, stat.write_max);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "sync_count");
+	luaL_pushint64(L, stat.sync_count);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "sync_time");
+	lua_pushnumber(L, stat.sync_count > 0 ?
+		       stat.sync_time / stat.sync_count : 0);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "sync_max");
+	lua_pushnumber(L, stat.sync_max);
+	lua_settable(L, -3);
+	/* Average and maximal depth of the WAL queue */
+	lua_pushliteral(L, "queue_len");
+	lua_pushnumber(L, stat.requests / batch_count);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "queue_max");
+	luaL_pushint64(L, stat.queue_max);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "rollback_count");
+	luaL_pushint64(L, stat.rollback_count);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "rotate_count");
+	luaL_pushint64(L, stat.rotate_count);
+	lua_settable(L, -3);
+
+	return 1;
+}
+
 static const struct luaL_reg
 lbox_info_dynamic_meta [] =
 {
@@ -168,6 +260,7 @@ lbox_info_dynamic_meta [] =
 	{"uptime", lbox_info_uptime},
 	{"pid", lbox_info_pid},
 	{"cluster", lbox_info_cluster},
+	{"wal", lbox_info_wal},
 	{NULL, NULL}
 };
 
@@ -38,6 +38,9 @@
 
 #include "box/box.h"
 #include "box/txn.h"
+#include "box/recovery.h"
+#include "box/wal.h"
+#include "fiber.h"
 
 #include "box/lua/error.h"
 #include "box/lua/tuple.h"
@@ -100,6 +103,26 @@ static const struct luaL_reg boxlib[] = {
 	{NULL, NULL}
 };
 
+/**
+ * Wait until all rows of this server up to the given LSN are
+ * written to the WAL. Returns false on timeout.
+ */
+static int
+lbox_wal_wait_lsn(struct lua_State *L)
+{
+	if (lua_gettop(L) < 1 || ! lua_isnumber(L, 1))
+		luaL_error(L, "Usage: box.wal.wait_lsn(lsn[, timeout])");
+	int64_t lsn = luaL_toint64(L, 1);
+	double timeout = luaL_optnumber(L, 2, TIMEOUT_INFINITY);
+	lua_pushboolean(L, wal_wait_lsn(recovery, lsn, timeout) == 0);
+	return 1;
+}
+
+static const struct luaL_reg wallib[] = {
+	{"wait_lsn", lbox_wal_wait_lsn},
+	{NULL, NULL}
+};
+
 #include "say.h"
 
 void
@@ -108,6 +131,8 @@ box_lua_init(struct lua_State *L)
 	/* Use luaL_register() to set _G.box */
 	luaL_register(L, "box", boxlib);
 	lua_pop(L, 1);
+	luaL_register_module(L, "box.wal", wallib);
+	lua_pop(L, 1);
 
 	box_lua_error_init(L);
 	box_lua_tuple_init(L);
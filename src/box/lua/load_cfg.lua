@@ -32,9 +32,20 @@ local default_cfg = {
     io_collect_interval = nil,
     readahead           = 16320,
     snap_io_rate_limit  = nil, -- no limit
+    snap_io_rate_burst  = 1,
+    snap_compression    = "none",
+    snap_index_image    = false,
+    snap_delta_max      = 0,
+    snap_threads        = 1,
     too_long_threshold  = 0.5,
     wal_mode            = "write",
+    wal_commit_delay    = 0, -- no group commit
+    wal_commit_max_rows = 1000,
+    wal_commit_max_bytes= 1048576,
     rows_per_wal        = 500000,
+    wal_max_size        = 0,
+    wal_prealloc_size   = 0, -- no preallocation
+    wal_direct_io       = false,
     wal_dir_rescan_delay= 2,
     panic_on_snap_error = true,
     panic_on_wal_error  = true,
@@ -80,9 +91,20 @@ local template_cfg = {
     io_collect_interval = 'number',
     readahead           = 'number',
     snap_io_rate_limit  = 'number',
+    snap_io_rate_burst  = 'number',
+    snap_compression    = 'string',
+    snap_index_image    = 'boolean',
+    snap_delta_max      = 'number',
+    snap_threads        = 'number',
     too_long_threshold  = 'number',
     wal_mode            = 'string',
+    wal_commit_delay    = 'number',
+    wal_commit_max_rows = 'number',
+    wal_commit_max_bytes= 'number',
     rows_per_wal        = 'number',
+    wal_max_size        = 'number',
+    wal_prealloc_size   = 'number',
+    wal_direct_io       = 'boolean',
     wal_dir_rescan_delay= 'number',
     panic_on_snap_error = 'boolean',
     panic_on_wal_error  = 'boolean',
@@ -113,6 +135,9 @@ local modify_cfg = {
 -- dynamically settable options
 local dynamic_cfg = {
     wal_mode                = private.cfg_set_wal_mode,
+    wal_commit_delay        = private.cfg_set_wal_commit,
+    wal_commit_max_rows     = private.cfg_set_wal_commit,
+    wal_commit_max_bytes    = private.cfg_set_wal_commit,
     listen                  = private.cfg_set_listen,
     replication_source      = private.cfg_set_replication_source,
     log_level               = private.cfg_set_log_level,
@@ -120,6 +145,11 @@ local dynamic_cfg = {
     readahead               = private.cfg_set_readahead,
     too_long_threshold      = private.cfg_set_too_long_threshold,
     snap_io_rate_limit      = private.cfg_set_snap_io_rate_limit,
+    snap_io_rate_burst      = private.cfg_set_snap_io_rate_burst,
+    snap_compression        = private.cfg_set_snap_compression,
+    snap_index_image        = private.cfg_set_snap_index_image,
+    snap_delta_max          = private.cfg_set_snap_delta_max,
+    snap_threads            = private.cfg_set_snap_threads,
     panic_on_wal_error      = private.cfg_set_panic_on_wal_error,
     read_only               = private.cfg_set_read_only,
     -- snapshot_daemon
@@ -398,6 +398,36 @@ netbox_encode_upsert(lua_State *L)
 	return 0;
 }
 
+static int
+netbox_encode_get_multi(lua_State *L)
+{
+	if (lua_gettop(L) < 6)
+		return luaL_error(L, "Usage: netbox.encode_get_multi(ibuf, sync, "
+		       "schema_id, space_id, index_id, keys)");
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_GET_MULTI);
+
+	luamp_encode_map(cfg, &stream, 3);
+
+	/* encode space_id */
+	uint32_t space_id = lua_tointeger(L, 4);
+	luamp_encode_uint(cfg, &stream, IPROTO_SPACE_ID);
+	luamp_encode_uint(cfg, &stream, space_id);
+
+	/* encode index_id */
+	uint32_t index_id = lua_tointeger(L, 5);
+	luamp_encode_uint(cfg, &stream, IPROTO_INDEX_ID);
+	luamp_encode_uint(cfg, &stream, index_id);
+
+	/* encode keys */
+	luamp_encode_uint(cfg, &stream, IPROTO_KEY);
+	luamp_encode_tuple(L, cfg, &stream, 6);
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
 int
 luaopen_net_box(struct lua_State *L)
 {
@@ -411,6 +441,7 @@ luaopen_net_box(struct lua_State *L)
 		{ "encode_delete",  netbox_encode_delete },
 		{ "encode_update",  netbox_encode_update },
 		{ "encode_upsert",  netbox_encode_upsert },
+		{ "encode_get_multi", netbox_encode_get_multi },
 		{ "encode_auth",    netbox_encode_auth },
 		{ NULL, NULL}
 	};
@@ -22,6 +22,7 @@ local CALL              = 6
 local AUTH              = 7
 local EVAL              = 8
 local UPSERT            = 9
+local GET_MULTI         = 10
 local PING              = 64
 local ERROR_TYPE        = 65536
 
@@ -118,6 +119,7 @@ local requests = {
     [DELETE] = internal.encode_delete;
     [UPDATE]  = internal.encode_update;
     [UPSERT]  = internal.encode_upsert;
+    [GET_MULTI] = internal.encode_get_multi;
     [SELECT]  = function(wbuf, sync, schema_id, spaceno, indexno, key, opts)
         if opts == nil then
             opts = {}
@@ -200,6 +202,11 @@ local function space_metatable(self)
                     return res[1]
                 end
                 box.error(box.error.MORE_THAN_ONE_TUPLE)
+            end,
+
+            get_many = function(space, keys)
+                check_if_space(space)
+                return self:_get_many(space.id, 0, keys)
             end
         }
     }
@@ -233,6 +240,11 @@ local function index_metatable(self)
                 box.error(box.error.MORE_THAN_ONE_TUPLE)
             end,
 
+            get_many = function(idx, keys)
+                check_if_index(idx)
+                return self:_get_many(idx.space.id, idx.id, keys)
+            end,
+
             min = function(idx, key)
                 check_if_index(idx)
                 local res = self:_select(idx.space.id, idx.id, key,
@@ -962,8 +974,11 @@ local remote_methods = {
         if response.body[DATA] ~= nil and reqtype ~= EVAL then
             if rawget(box, 'tuple') ~= nil then
                 for i, v in pairs(response.body[DATA]) do
-                    response.body[DATA][i] =
-                        box.tuple.new(response.body[DATA][i])
+                    -- GET_MULTI replies with nil for a missing key
+                    if v ~= nil then
+                        response.body[DATA][i] =
+                            box.tuple.new(response.body[DATA][i])
+                    end
                 end
             end
             -- disable YAML flow output (useful for admin console)
@@ -1011,6 +1026,31 @@ local remote_methods = {
         return res.body[DATA]
     end,
 
+    _get_many = function(self, spaceno, indexno, keys)
+        if type(keys) ~= 'table' then
+            box.error(box.error.ILLEGAL_PARAMS,
+                      "Usage: index:get_many({key1, key2, ...})")
+        end
+        local request_keys = {}
+        for i, key in ipairs(keys) do
+            local is_tuple = rawget(box, 'tuple') ~= nil and box.tuple.is(key)
+            if type(key) ~= 'table' and not is_tuple then
+                key = { key }
+            end
+            request_keys[i] = key
+        end
+        local res = self:_request(GET_MULTI, true, spaceno, indexno,
+                                  request_keys)
+        -- the same as box.index:get_many(): no value for a missing key
+        local ret = {}
+        for i, tuple in pairs(res.body[DATA]) do
+            if tuple ~= nil then
+                ret[i] = tuple
+            end
+        end
+        return ret
+    end,
+
     _insert = function(self, spaceno, tuple)
         local res = self:_request(INSERT, true, spaceno, tuple)
         return one_tuple(res.body[DATA])
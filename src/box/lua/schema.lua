@@ -43,6 +43,10 @@ ffi.cdef[[
     box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
                   const char *key_end, box_tuple_t **result);
     int
+    box_index_get_multi(uint32_t space_id, uint32_t index_id,
+                        const char *keys, const char *keys_end,
+                        box_tuple_t **result);
+    int
     box_index_min(uint32_t space_id, uint32_t index_id, const char *key,
                   const char *key_end, box_tuple_t **result);
     int
@@ -399,6 +403,7 @@ box.schema.index.create = function(space_id, name, options)
         if_not_exists = 'boolean',
         dimension = 'number',
         distance = 'string',
+        hint = 'boolean',
     }
     check_param_table(options, options_template, true)
     local options_defaults = {
@@ -446,7 +451,8 @@ box.schema.index.create = function(space_id, name, options)
         table.insert(parts, {options.parts[i], options.parts[i + 1]})
     end
     local key_opts = { dimension = options.dimension,
-        unique = options.unique, distance = options.distance }
+        unique = options.unique, distance = options.distance,
+        hint = options.hint }
     for k, v in pairs(options) do
         if options_template[k] == nil then
             key_opts[k] = v
@@ -495,6 +501,7 @@ box.schema.index.alter = function(space_id, index_id, options)
         unique = 'boolean',
         dimension = 'number',
         distance = 'string',
+        hint = 'boolean',
     }
     check_param_table(options, options_template)
 
@@ -564,6 +571,9 @@ box.schema.index.alter = function(space_id, index_id, options)
     if options.distance ~= nil then
         key_opts.distance = options.distance
     end
+    if options.hint ~= nil then
+        key_opts.hint = options.hint
+    end
     if options.parts ~= nil then
         check_index_parts(options.parts)
         options.parts = update_index_parts(options.parts)
@@ -810,6 +820,42 @@ function box.schema.space.bless(space)
         return internal.get(index.space_id, index.id, key)
     end
 
+    -- get_many returns a table with the tuple found by keys[i]
+    -- at [i], or nothing there if the key is not found
+    local function keify_many(keys)
+        if type(keys) ~= 'table' then
+            box.error(box.error.ILLEGAL_PARAMS,
+                      "Usage: index:get_many({key1, key2, ...})")
+        end
+        local ret = {}
+        for i, key in ipairs(keys) do
+            ret[i] = keify(key)
+        end
+        return ret
+    end
+    index_mt.get_many_ffi = function(index, keys)
+        keys = keify_many(keys)
+        local pkeys, pkeys_end = tuple_encode(keys)
+        local ptuples = ffi.new('box_tuple_t *[?]', #keys)
+        if builtin.box_index_get_multi(index.space_id, index.id,
+                                       pkeys, pkeys_end, ptuples) ~= 0 then
+            return box.error() -- error
+        end
+        local ret = {}
+        for i = 1, #keys do
+            local tuple = ptuples[i - 1]
+            if tuple ~= nil then
+                ret[i] = tuple_bless(tuple)
+                builtin.box_tuple_unref(tuple)
+            end
+        end
+        return ret
+    end
+    index_mt.get_many_luac = function(index, keys)
+        keys = keify_many(keys)
+        return internal.get_many(index.space_id, index.id, keys)
+    end
+
     local function check_select_opts(opts, key_is_nil)
         local offset = 0
         local limit = 4294967295
@@ -882,7 +928,8 @@ function box.schema.space.bless(space)
 
     -- true if reading operations may yield
     local read_yields = space.engine == 'sophia'
-    local read_ops = {'select', 'get', 'min', 'max', 'count', 'random', 'pairs'}
+    local read_ops = {'select', 'get', 'get_many', 'min', 'max', 'count',
+                      'random', 'pairs'}
     for _, op in ipairs(read_ops) do
         if read_yields then
             -- use Lua/C implmenetation
@@ -914,6 +961,10 @@ function box.schema.space.bless(space)
         check_index(space, 0)
         return space.index[0]:get(key)
     end
+    space_mt.get_many = function(space, keys)
+        check_index(space, 0)
+        return space.index[0]:get_many(keys)
+    end
     space_mt.select = function(space, key, opts)
         check_index(space, 0)
         return space.index[0]:select(key, opts)
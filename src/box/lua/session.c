@@ -135,6 +135,22 @@ lbox_session_su(struct lua_State *L)
 	return lua_gettop(L) - 1;
 }
 
+/**
+ * Get or set the async commit mode of the current session.
+ * In this mode a commit returns as soon as the transaction
+ * is queued to the WAL, without waiting for it to be written.
+ * Use box.wal.wait_lsn() to wait for the write.
+ */
+static int
+lbox_session_async_commit(struct lua_State *L)
+{
+	struct session *session = current_session();
+	if (lua_gettop(L) >= 1)
+		session->async_commit = lua_toboolean(L, 1);
+	lua_pushboolean(L, session->async_commit);
+	return 1;
+}
+
 /**
  * Check whether or not a session exists.
  */
@@ -281,6 +297,7 @@ box_lua_session_init(struct lua_State *L)
 		{"fd", lbox_session_fd},
 		{"exists", lbox_session_exists},
 		{"peer", lbox_session_peer},
+		{"async_commit", lbox_session_async_commit},
 		{"on_connect", lbox_session_on_connect},
 		{"on_disconnect", lbox_session_on_disconnect},
 		{"on_auth", lbox_session_on_auth},
@@ -41,6 +41,7 @@
 
 extern struct small_alloc memtx_alloc;
 extern struct mempool memtx_index_extent_pool;
+extern size_t tuple_delayed_free_size;
 
 static int
 small_stats_noop_cb(const struct mempool_stats *stats, void *cb_ctx)
@@ -192,6 +193,14 @@ lbox_slab_info(struct lua_State *L)
 	lua_pushstring(L, ratio_buf);
 	lua_settable(L, -3);
 
+	/*
+	 * Tuples deleted during a snapshot, but still kept
+	 * for it: the overhead of a running snapshot.
+	 */
+	lua_pushstring(L, "delayed_free_size");
+	luaL_pushuint64(L, tuple_delayed_free_size);
+	lua_settable(L, -3);
+
 	return 1;
 }
 
@@ -76,6 +76,26 @@ do
         end
     end
 
+    -- the snapshot which an incremental snapshot is a delta of,
+    -- see snap_delta_max, or nil if the snapshot is full
+    local function snap_base(snap)
+        local fh = fio.open(snap, {'O_RDONLY'})
+        if fh == nil then
+            return nil
+        end
+        local data = fh:read(4096)
+        fh:close()
+        -- the text header ends with an empty line
+        local header = data and (string.match(data, '^(.-)\n\n') or data)
+        local base = header and
+                     string.match(header .. '\n', '\nBase: (%d+)\n')
+        if base == nil then
+            return nil
+        end
+        return fio.pathjoin(fio.dirname(snap),
+                            sprintf('%020d.snap', tonumber(base)))
+    end
+
     -- check filesystem and current time
     local function process(self)
         local snaps = fio.glob(fio.pathjoin(box.cfg.snap_dir, '*.snap'))
@@ -109,15 +129,38 @@ do
             return
         end
 
+        -- keep the snapshots which the kept ones are deltas of
+        local needed = {}
+        for i = math.max(#snaps - self.snapshot_count, 0) + 1, #snaps do
+            local snap = snaps[i]
+            while snap ~= nil and not needed[snap] do
+                needed[snap] = true
+                snap = snap_base(snap)
+            end
+        end
+
         while #snaps > self.snapshot_count do
             local rm = snaps[1]
             table.remove(snaps, 1)
 
-            log.info("removing old snapshot %s", rm)
-            if not fio.unlink(rm) then
-                log.error("error while removing %s: %s",
-                          rm, errno.strerror())
-                return
+            if needed[rm] then
+                log.debug("keeping snapshot %s, newer ones depend on it", rm)
+            else
+                log.info("removing old snapshot %s", rm)
+                if not fio.unlink(rm) then
+                    log.error("error while removing %s: %s",
+                              rm, errno.strerror())
+                    return
+                end
+                -- parts of a multi-part snapshot, see snap_threads
+                local parts = fio.glob(rm .. '.[0-9]*') or {}
+                for _, part in pairs(parts) do
+                    if not fio.unlink(part) then
+                        log.error("error while removing %s: %s",
+                                  part, errno.strerror())
+                        return
+                    end
+                end
             end
         end
 
@@ -165,7 +165,8 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 		lua_pushnumber(L, key_def->iid);
 		lua_newtable(L);		/* space.index[k] */
 
-		if (key_def->type == HASH || key_def->type == TREE) {
+		if (key_def->type == HASH || key_def->type == TREE ||
+		    key_def->type == ART) {
 			lua_pushboolean(L, key_def->opts.is_unique);
 			lua_setfield(L, -2, "unique");
 		} else if (key_def->type == RTREE) {
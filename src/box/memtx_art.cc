@@ -0,0 +1,364 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_art.h"
+#include "tuple.h"
+#include "space.h"
+#include "schema.h" /* space_cache_find() */
+#include "memtx_engine.h"
+#include "fiber.h"
+
+/* {{{ Utilities. *************************************************/
+
+/*
+ * A normalized key is the concatenation of the key parts:
+ * - NUM is stored as 8 bytes, big-endian;
+ * - STRING is stored with each zero byte followed by 0xff and
+ *   ends with two zero bytes, so that a string goes before any
+ *   longer one starting with it;
+ * - the key of a tuple in a non-unique index ends with the tuple
+ *   address, which tells apart tuples with equal key parts the
+ *   way tree_index_compare() does.
+ * So memcmp() orders normalized keys the way TREE orders tuples,
+ * and no key of a tuple is a prefix of another one, as the tree
+ * requires. The last string part of an ITER_PREFIX key is left
+ * unterminated.
+ */
+
+static uint32_t
+art_field_size(const char *field, enum field_type type, bool is_prefix)
+{
+	if (type == NUM)
+		return sizeof(uint64_t);
+	assert(type == STRING);
+	uint32_t len;
+	const char *str = mp_decode_str(&field, &len);
+	uint32_t size = is_prefix ? len : len + 2;
+	for (uint32_t i = 0; i < len; i++)
+		size += str[i] == '\0';
+	return size;
+}
+
+static char *
+art_field_encode(char *out, const char *field, enum field_type type,
+		 bool is_prefix)
+{
+	if (type == NUM)
+		return mp_store_u64(out, mp_decode_uint(&field));
+	uint32_t len;
+	const char *str = mp_decode_str(&field, &len);
+	for (uint32_t i = 0; i < len; i++) {
+		*out++ = str[i];
+		if (str[i] == '\0')
+			*out++ = (char) 0xff;
+	}
+	if (!is_prefix) {
+		*out++ = '\0';
+		*out++ = '\0';
+	}
+	return out;
+}
+
+static uint32_t
+art_tuple_key_size(struct tuple *tuple, struct key_def *key_def)
+{
+	uint32_t size = key_def->opts.is_unique ? 0 : sizeof(uint64_t);
+	for (uint32_t i = 0; i < key_def->part_count; i++) {
+		const char *field = tuple_field(tuple,
+						key_def->parts[i].fieldno);
+		size += art_field_size(field, key_def->parts[i].type, false);
+	}
+	return size;
+}
+
+static char *
+art_tuple_key_encode(char *out, struct tuple *tuple, struct key_def *key_def)
+{
+	for (uint32_t i = 0; i < key_def->part_count; i++) {
+		const char *field = tuple_field(tuple,
+						key_def->parts[i].fieldno);
+		out = art_field_encode(out, field, key_def->parts[i].type,
+				       false);
+	}
+	if (!key_def->opts.is_unique)
+		out = mp_store_u64(out, (uintptr_t) tuple);
+	return out;
+}
+
+/** Grow a key buffer to fit size bytes. */
+static void
+art_key_reserve(char **buf, uint32_t *capacity, uint32_t size)
+{
+	if (size <= *capacity && *buf != NULL)
+		return;
+	uint32_t new_capacity = MAX(*capacity * 2, 64u);
+	while (new_capacity < size)
+		new_capacity *= 2;
+	char *new_buf = (char *) realloc(*buf, new_capacity);
+	if (new_buf == NULL) {
+		tnt_raise(OutOfMemory, new_capacity, "realloc",
+			  "MemtxArt key");
+	}
+	*buf = new_buf;
+	*capacity = new_capacity;
+}
+
+/** Get the key of a tuple for the tree, see art_key_f. */
+static const char *
+memtx_art_key(void *record, void *arg, uint32_t *key_size)
+{
+	MemtxArt *index = (MemtxArt *) arg;
+	return index->tupleKey((struct tuple *) record, key_size);
+}
+
+/* }}} */
+
+/* {{{ MemtxArt Iterators ****************************************/
+
+struct art_index_iterator {
+	struct iterator base; /* Must be the first member. */
+	struct art_iterator art_it;
+};
+
+static void
+art_index_iterator_free(struct iterator *iterator)
+{
+	assert(iterator->free == art_index_iterator_free);
+	struct art_index_iterator *it = (struct art_index_iterator *) iterator;
+	art_iterator_destroy(&it->art_it);
+	free(it);
+}
+
+static struct tuple *
+art_index_iterator_next(struct iterator *iterator)
+{
+	assert(iterator->free == art_index_iterator_free);
+	struct art_index_iterator *it = (struct art_index_iterator *) iterator;
+	void *record;
+	if (art_iterator_next(&it->art_it, &record) != 0) {
+		tnt_raise(OutOfMemory, it->art_it.key_capacity, "realloc",
+			  "MemtxArt iterator");
+	}
+	return (struct tuple *) record;
+}
+
+/* }}} */
+
+/* {{{ MemtxArt  **********************************************************/
+
+MemtxArt::MemtxArt(struct key_def *key_def_arg)
+	: MemtxIndex(key_def_arg), m_tuple_key(NULL), m_tuple_key_capacity(0),
+	  m_search_key(NULL), m_search_key_capacity(0)
+{
+	memtx_index_arena_init();
+	art_init(&m_tree, MEMTX_EXTENT_SIZE, memtx_index_extent_alloc,
+		 memtx_index_extent_free, memtx_art_key, this);
+}
+
+MemtxArt::~MemtxArt()
+{
+	art_destroy(&m_tree);
+	free(m_tuple_key);
+	free(m_search_key);
+}
+
+const char *
+MemtxArt::tupleKey(struct tuple *tuple, uint32_t *key_size) const
+{
+	char *end = art_tuple_key_encode(m_tuple_key, tuple, key_def);
+	*key_size = end - m_tuple_key;
+	assert(*key_size <= m_tuple_key_capacity);
+	return m_tuple_key;
+}
+
+uint32_t
+MemtxArt::encodeKey(const char *key, uint32_t part_count,
+		    bool is_prefix) const
+{
+	uint32_t size = 0;
+	const char *field = key;
+	for (uint32_t i = 0; i < part_count; i++) {
+		size += art_field_size(field, key_def->parts[i].type,
+				       is_prefix && i == part_count - 1);
+		mp_next(&field);
+	}
+	art_key_reserve(&m_search_key, &m_search_key_capacity, size);
+	char *out = m_search_key;
+	for (uint32_t i = 0; i < part_count; i++) {
+		out = art_field_encode(out, key, key_def->parts[i].type,
+				       is_prefix && i == part_count - 1);
+		mp_next(&key);
+	}
+	assert(out == m_search_key + size);
+	return size;
+}
+
+size_t
+MemtxArt::size() const
+{
+	return art_size(&m_tree);
+}
+
+size_t
+MemtxArt::bsize() const
+{
+	return art_mem_used(&m_tree);
+}
+
+struct tuple *
+MemtxArt::findByKey(const char *key, uint32_t part_count) const
+{
+	assert(key_def->opts.is_unique && part_count == key_def->part_count);
+	uint32_t size = encodeKey(key, part_count, false);
+	return (struct tuple *) art_find(&m_tree, m_search_key, size);
+}
+
+struct tuple *
+MemtxArt::replace(struct tuple *old_tuple, struct tuple *new_tuple,
+		  enum dup_replace_mode mode)
+{
+	uint32_t errcode;
+	/*
+	 * The tree asks for the keys of tuples while the key of
+	 * the new tuple is in m_search_key, so both buffers must
+	 * fit it. Grow them before the tree is changed.
+	 */
+	uint32_t new_size = 0, old_size = 0;
+	if (new_tuple) {
+		new_size = art_tuple_key_size(new_tuple, key_def);
+		art_key_reserve(&m_tuple_key, &m_tuple_key_capacity, new_size);
+	}
+	if (old_tuple)
+		old_size = art_tuple_key_size(old_tuple, key_def);
+	art_key_reserve(&m_search_key, &m_search_key_capacity,
+			MAX(new_size, old_size));
+
+	if (new_tuple) {
+		art_tuple_key_encode(m_search_key, new_tuple, key_def);
+		void *dup = NULL;
+		/* Try to optimistically replace the new_tuple. */
+		if (art_insert(&m_tree, m_search_key, new_size, new_tuple,
+			       &dup) != 0) {
+			tnt_raise(OutOfMemory, MEMTX_EXTENT_SIZE,
+				  "MemtxArt", "replace");
+		}
+
+		struct tuple *dup_tuple = (struct tuple *) dup;
+		errcode = replace_check_dup(old_tuple, dup_tuple, mode);
+
+		if (errcode) {
+			/* Putting dup_tuple back never allocates. */
+			if (dup_tuple)
+				art_insert(&m_tree, m_search_key, new_size,
+					   dup_tuple, &dup);
+			else
+				art_delete(&m_tree, m_search_key, new_size);
+			struct space *sp = space_cache_find(key_def->space_id);
+			tnt_raise(ClientError, errcode, index_name(this),
+				  space_name(sp));
+		}
+		if (dup_tuple)
+			return dup_tuple;
+	}
+	if (old_tuple) {
+		art_tuple_key_encode(m_search_key, old_tuple, key_def);
+		art_delete(&m_tree, m_search_key, old_size);
+	}
+	return old_tuple;
+}
+
+struct iterator *
+MemtxArt::allocIterator() const
+{
+	struct art_index_iterator *it = (struct art_index_iterator *)
+			calloc(1, sizeof(*it));
+	if (it == NULL) {
+		tnt_raise(OutOfMemory, sizeof(struct art_index_iterator),
+			  "MemtxArt", "iterator");
+	}
+	it->base.free = art_index_iterator_free;
+	art_iterator_init(&it->art_it);
+	return (struct iterator *) it;
+}
+
+void
+MemtxArt::initIterator(struct iterator *iterator, enum iterator_type type,
+		       const char *key, uint32_t part_count) const
+{
+	assert(part_count == 0 || key != NULL);
+	assert(iterator->free == art_index_iterator_free);
+	struct art_index_iterator *it = (struct art_index_iterator *) iterator;
+
+	/*
+	 * A tuple matches a partial key if its normalized key
+	 * starts with the normalized key parts, so equality is a
+	 * prefix search, and an empty key matches all tuples.
+	 */
+	enum art_iterator_type art_type;
+	bool is_prefix = false;
+	switch (type) {
+	case ITER_EQ:
+		art_type = ART_ITER_PREFIX;
+		break;
+	case ITER_REQ:
+		art_type = ART_ITER_RPREFIX;
+		break;
+	case ITER_PREFIX:
+		art_type = ART_ITER_PREFIX;
+		is_prefix = true;
+		break;
+	case ITER_ALL:
+		art_type = ART_ITER_GE;
+		part_count = 0;
+		break;
+	case ITER_GE:
+		art_type = ART_ITER_GE;
+		break;
+	case ITER_GT:
+		art_type = part_count > 0 ? ART_ITER_GT : ART_ITER_GE;
+		break;
+	case ITER_LE:
+		art_type = ART_ITER_LE;
+		break;
+	case ITER_LT:
+		art_type = part_count > 0 ? ART_ITER_LT : ART_ITER_LE;
+		break;
+	default:
+		return Index::initIterator(iterator, type, key, part_count);
+	}
+	uint32_t size = encodeKey(key, part_count, is_prefix);
+	if (art_iterator_start(&it->art_it, &m_tree, art_type, m_search_key,
+			       size) != 0) {
+		tnt_raise(OutOfMemory, size, "realloc", "MemtxArt iterator");
+	}
+	it->base.next = art_index_iterator_next;
+}
+
+/* }}} */
@@ -0,0 +1,82 @@
+#ifndef TARANTOOL_BOX_MEMTX_ART_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_ART_H_INCLUDED
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_index.h"
+
+#include <salad/art.h>
+
+/**
+ * An adaptive radix tree over normalized keys: the key parts of
+ * a tuple encoded so that memcmp() orders them the way the TREE
+ * does, see memtx_art.cc. Besides the TREE iterators it supports
+ * ITER_PREFIX, which selects tuples whose last key part starts
+ * with the last part of the search key.
+ */
+class MemtxArt: public MemtxIndex
+{
+public:
+	MemtxArt(struct key_def *key_def);
+	~MemtxArt();
+
+	virtual size_t size() const;
+	virtual struct tuple *findByKey(const char *key, uint32_t part_count) const;
+	virtual struct tuple *replace(struct tuple *old_tuple,
+				      struct tuple *new_tuple,
+				      enum dup_replace_mode mode);
+
+	virtual size_t bsize() const;
+	virtual struct iterator *allocIterator() const;
+	virtual void initIterator(struct iterator *iterator,
+				  enum iterator_type type,
+				  const char *key, uint32_t part_count) const;
+
+	/** The normalized key of a tuple, valid until the next call. */
+	const char *tupleKey(struct tuple *tuple, uint32_t *key_size) const;
+
+protected:
+	/** Encode a search key to m_search_key. */
+	uint32_t encodeKey(const char *key, uint32_t part_count,
+			   bool is_prefix) const;
+
+	struct art m_tree;
+	/**
+	 * The normalized key of the last tuple asked by the tree.
+	 * The buffer only grows and fits the key of any tuple in
+	 * the index, so the tree never has to handle an error.
+	 */
+	char *m_tuple_key;
+	uint32_t m_tuple_key_capacity;
+	mutable char *m_search_key;
+	mutable uint32_t m_search_key_capacity;
+};
+
+#endif /* TARANTOOL_BOX_MEMTX_ART_H_INCLUDED */
@@ -367,6 +367,25 @@ MemtxBitset::initIterator(struct iterator *iterator, enum iterator_type type,
 			rc = bitset_index_expr_any_set(&expr, bitset_key,
 						       bitset_key_size);
 			break;
+		case ITER_LT:
+		case ITER_LE:
+		case ITER_GT:
+		case ITER_GE:
+			/* Only integers are ordered as bit strings */
+			if (key_def->parts[0].type != NUM) {
+				return Index::initIterator(iterator, type, key,
+							   part_count);
+			}
+			if (type == ITER_LT || type == ITER_LE) {
+				rc = bitset_index_expr_less(&expr, bitset_key,
+							    bitset_key_size,
+							    type == ITER_LE);
+			} else {
+				rc = bitset_index_expr_greater(&expr, bitset_key,
+							       bitset_key_size,
+							       type == ITER_GE);
+			}
+			break;
 		default:
 			return Index::initIterator(iterator, type, key,
 						   part_count);
@@ -36,6 +36,7 @@
 #include "memtx_tree.h"
 #include "memtx_rtree.h"
 #include "memtx_bitset.h"
+#include "memtx_art.h"
 #include "space.h"
 #include <msgpuck.h>
 #include "small/rlist.h"
@@ -44,6 +45,7 @@
 #include "iproto_constants.h"
 #include "xrow.h"
 #include "recovery.h"
+#include "snap_reader.h"
 #include "relay.h"
 #include "schema.h"
 #include "port.h"
@@ -52,6 +54,8 @@
 #include "coeio.h"
 #include "errinj.h"
 #include "scoped_guard.h"
+#include "tt_pthread.h"
+#include "clock.h"
 
 /** For all memory used by all indexes.
  * If you decide to use memtx_index_arena or
@@ -101,9 +105,17 @@ memtx_replace_no_keys(struct txn * /* txn */, struct space *space,
 	(void) index;
 }
 
+/**
+ * The number of checkpoints started since the server start,
+ * plus one. A change of a space is stamped with it, to find
+ * the spaces changed since the last checkpoint, see
+ * snap_delta_max.
+ */
+static uint32_t memtx_checkpoint_gen = 1;
+
 struct MemtxSpace: public Handler {
 	MemtxSpace(Engine *e)
-		: Handler(e)
+		: Handler(e), checkpoint_gen(0)
 	{
 		replace = memtx_replace_no_keys;
 	}
@@ -130,6 +142,11 @@ struct MemtxSpace: public Handler {
 		      uint32_t offset, uint32_t limit,
 		      const char *key, const char * /* key_end */,
 		      struct port *port);
+	/**
+	 * memtx_checkpoint_gen at the last change of the space,
+	 * 0 if it hasn't changed since the server start.
+	 */
+	uint32_t checkpoint_gen;
 	virtual void onAlter(Handler *old);
 public:
 	/**
@@ -366,6 +383,7 @@ MemtxSpace::onAlter(Handler *old)
 {
 	MemtxSpace *handler = (MemtxSpace *) old;
 	replace = handler->replace;
+	checkpoint_gen = handler->checkpoint_gen;
 }
 
 void
@@ -389,13 +407,12 @@ MemtxSpace::executeSelect(struct txn *, struct space *space,
 
 	struct iterator *it = index->position();
 	index->initIterator(it, type, key, part_count);
+	index->limitIterator(it, offset + limit >= offset ?
+			     offset + limit : UINT32_MAX);
+	index->skipIterator(it, offset);
 
 	struct tuple *tuple;
 	while ((tuple = it->next(it)) != NULL) {
-		if (offset > 0) {
-			offset--;
-			continue;
-		}
 		if (limit == found++)
 			break;
 		port_add_tuple(port, tuple);
@@ -465,6 +482,8 @@ memtx_replace_primary_key(struct txn *txn, struct space *space,
 	if (new_tuple)
 		tuple_ref(new_tuple);
 	memtx_txn_add_undo(txn, old_tuple, new_tuple);
+	((struct MemtxSpace *) space->handler)->checkpoint_gen =
+		memtx_checkpoint_gen;
 }
 
 static void
@@ -508,6 +527,8 @@ memtx_replace_all_keys(struct txn *txn, struct space *space,
 	if (new_tuple)
 		tuple_ref(new_tuple);
 	memtx_txn_add_undo(txn, old_tuple, new_tuple);
+	((struct MemtxSpace *) space->handler)->checkpoint_gen =
+		memtx_checkpoint_gen;
 }
 
 static void
@@ -545,8 +566,8 @@ memtx_build_secondary_keys(struct space *space, void *param)
 				 space_name(space));
 		}
 
-		for (uint32_t j = 1; j < space->index_count; j++)
-			index_build((MemtxIndex *) space->index[j], pk);
+		index_build_parallel((MemtxIndex **) space->index + 1,
+				     space->index_count - 1, pk);
 
 		if (n_tuples > 0) {
 			say_info("Space '%s': done", space_name(space));
@@ -558,20 +579,439 @@ memtx_build_secondary_keys(struct space *space, void *param)
 MemtxEngine::MemtxEngine()
 	:Engine("memtx"),
 	m_checkpoint(0),
-	m_state(MEMTX_INITIALIZED)
+	m_state(MEMTX_INITIALIZED),
+	m_last_checkpoint(-1),
+	m_delta_count(0),
+	m_last_checkpoint_gen(memtx_checkpoint_gen),
+	m_full_checkpoint_version(snapshot_version)
 {
 	flags = ENGINE_CAN_BE_TEMPORARY;
 }
 
+/**
+ * The order of tuples in a secondary TREE index, read from
+ * the snapshot: a position of each tuple in the primary key.
+ * See snap_index_image.
+ */
+struct memtx_index_image {
+	uint32_t space_id;
+	uint32_t index_id;
+	uint32_t *pos;
+	uint32_t size;
+	uint32_t capacity;
+	/** Set if a chunk of the image is missing. */
+	bool is_broken;
+	struct rlist link;
+};
+
+/** Images read from the snapshot at start. */
+static RLIST_HEAD(memtx_index_images);
+
+static struct memtx_index_image *
+memtx_index_image_find(uint32_t space_id, uint32_t index_id)
+{
+	struct memtx_index_image *image;
+	rlist_foreach_entry(image, &memtx_index_images, link) {
+		if (image->space_id == space_id && image->index_id == index_id)
+			return image;
+	}
+	return NULL;
+}
+
+static void
+memtx_index_images_free()
+{
+	struct memtx_index_image *image, *tmp;
+	rlist_foreach_entry_safe(image, &memtx_index_images, link, tmp) {
+		free(image->pos);
+		free(image);
+	}
+	rlist_create(&memtx_index_images);
+}
+
+/**
+ * Add a chunk of an index image to the images read so far.
+ * Chunks of an image follow each other, see
+ * checkpoint_write_image().
+ */
+static void
+memtx_recover_index_image(struct recovery * /* r */, void * /* param */,
+			  struct xrow_header *row)
+{
+	assert(row->bodycnt == 1); /* always 1 for read */
+	const char *data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	const char *tmp = data;
+	if (mp_check(&tmp, end) != 0 || mp_typeof(*data) != MP_MAP)
+		tnt_raise(ClientError, ER_INVALID_MSGPACK, "index image");
+
+	uint32_t space_id = UINT32_MAX, index_id = UINT32_MAX;
+	uint32_t offset = UINT32_MAX, len = 0;
+	const char *pos = NULL;
+	uint32_t map_size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*data) != MP_UINT) {
+			mp_next(&data);
+			mp_next(&data);
+			continue;
+		}
+		uint64_t key = mp_decode_uint(&data);
+		enum mp_type type = mp_typeof(*data);
+		if (key == IPROTO_DATA && type == MP_BIN) {
+			pos = mp_decode_bin(&data, &len);
+			continue;
+		}
+		if (type != MP_UINT) {
+			mp_next(&data);
+			continue;
+		}
+		uint64_t value = mp_decode_uint(&data);
+		if (key == IPROTO_SPACE_ID)
+			space_id = value;
+		else if (key == IPROTO_INDEX_ID)
+			index_id = value;
+		else if (key == IPROTO_OFFSET)
+			offset = value;
+	}
+	if (space_id == UINT32_MAX || index_id == UINT32_MAX ||
+	    offset == UINT32_MAX || pos == NULL ||
+	    len % sizeof(uint32_t) != 0) {
+		tnt_raise(ClientError, ER_INVALID_MSGPACK, "index image");
+	}
+
+	struct memtx_index_image *image = NULL;
+	if (! rlist_empty(&memtx_index_images)) {
+		/* Most likely the image of the previous row. */
+		image = rlist_last_entry(&memtx_index_images,
+					 struct memtx_index_image, link);
+		if (image->space_id != space_id || image->index_id != index_id)
+			image = memtx_index_image_find(space_id, index_id);
+	}
+	if (image == NULL) {
+		image = (struct memtx_index_image *) calloc(1, sizeof(*image));
+		if (image == NULL) {
+			tnt_raise(OutOfMemory, sizeof(*image), "calloc",
+				  "struct memtx_index_image");
+		}
+		image->space_id = space_id;
+		image->index_id = index_id;
+		rlist_add_tail_entry(&memtx_index_images, image, link);
+	}
+	if (image->is_broken)
+		return;
+	if (offset != image->size) {
+		say_warn("index image of space %u index %u is incomplete, "
+			 "the index will be rebuilt", space_id, index_id);
+		image->is_broken = true;
+		return;
+	}
+	uint32_t count = len / sizeof(uint32_t);
+	if (image->size + count > image->capacity) {
+		uint32_t capacity = MAX(image->capacity * 2, 1024u);
+		while (capacity < image->size + count)
+			capacity *= 2;
+		uint32_t *buf = (uint32_t *)
+			realloc(image->pos, capacity * sizeof(uint32_t));
+		if (buf == NULL) {
+			tnt_raise(OutOfMemory, capacity * sizeof(uint32_t),
+				  "realloc", "index image");
+		}
+		image->pos = buf;
+		image->capacity = capacity;
+	}
+	for (uint32_t i = 0; i < count; i++)
+		image->pos[image->size++] = mp_load_u32(&pos);
+}
+
+/**
+ * Check that the image is a permutation of the primary key
+ * positions, so that a damaged image can't put a tuple into
+ * an index twice.
+ */
+static bool
+memtx_index_image_is_valid(struct memtx_index_image *image,
+			   uint32_t n_tuples, uint8_t *bitmap)
+{
+	if (image == NULL || image->is_broken || image->size != n_tuples)
+		return false;
+	memset(bitmap, 0, n_tuples / CHAR_BIT + 1);
+	for (uint32_t i = 0; i < n_tuples; i++) {
+		uint32_t pos = image->pos[i];
+		if (pos >= n_tuples ||
+		    (bitmap[pos / CHAR_BIT] & (1 << (pos % CHAR_BIT))) != 0)
+			return false;
+		bitmap[pos / CHAR_BIT] |= 1 << (pos % CHAR_BIT);
+	}
+	return true;
+}
+
+/**
+ * Build secondary keys of a space from the images saved in
+ * the snapshot, right after the primary key is built. Tuples
+ * are passed to a TREE in the saved order, so the sort in
+ * endBuild() only makes a linear pass to check the order.
+ * Other secondary keys of the space are built the usual way,
+ * with index_build_parallel(), and the space has all keys
+ * enabled for the rest of recovery.
+ *
+ * If a TREE secondary key of the space has no valid image,
+ * the space is left alone and built after recovery, as usual.
+ */
+static void
+memtx_load_index_images(struct space *space, void *param)
+{
+	struct MemtxSpace *handler = (struct MemtxSpace *) space->handler;
+	if (handler->engine != param || space_index(space, 0) == NULL ||
+	    handler->replace == memtx_replace_all_keys ||
+	    space->index_id_max == 0 ||
+	    space->index[0]->key_def->type != TREE)
+		return;
+
+	MemtxIndex *pk = (MemtxIndex *) space->index[0];
+	uint32_t n_tuples = pk->size();
+	struct memtx_index_image *images[BOX_INDEX_MAX];
+	uint8_t *bitmap = (uint8_t *) malloc(n_tuples / CHAR_BIT + 1);
+	if (bitmap == NULL) {
+		tnt_raise(OutOfMemory, n_tuples / CHAR_BIT + 1, "malloc",
+			  "index image bitmap");
+	}
+	bool is_valid = true;
+	for (uint32_t j = 1; j < space->index_count && is_valid; j++) {
+		struct key_def *key_def = space->index[j]->key_def;
+		images[j] = NULL;
+		if (key_def->type != TREE)
+			continue;
+		images[j] = memtx_index_image_find(key_def->space_id,
+						   key_def->iid);
+		is_valid = memtx_index_image_is_valid(images[j], n_tuples,
+						      bitmap);
+	}
+	free(bitmap);
+	if (! is_valid)
+		return;
+
+	struct tuple **tuples = (struct tuple **)
+		malloc((n_tuples + 1) * sizeof(struct tuple *));
+	if (tuples == NULL) {
+		tnt_raise(OutOfMemory, (n_tuples + 1) * sizeof(struct tuple *),
+			  "malloc", "tuples");
+	}
+	auto tuples_guard = make_scoped_guard([=] { free(tuples); });
+	struct iterator *it = pk->position();
+	pk->initIterator(it, ITER_ALL, NULL, 0);
+	struct tuple *tuple;
+	uint32_t count = 0;
+	while (count < n_tuples && (tuple = it->next(it)))
+		tuples[count++] = tuple;
+	assert(count == n_tuples);
+
+	if (n_tuples > 0) {
+		say_info("Loading secondary indexes of space '%s' "
+			 "from the snapshot...", space_name(space));
+	}
+	/* Keys without an image are built the usual way. */
+	MemtxIndex *rest[BOX_INDEX_MAX];
+	uint32_t rest_count = 0;
+	for (uint32_t j = 1; j < space->index_count; j++) {
+		MemtxIndex *index = (MemtxIndex *) space->index[j];
+		if (images[j] == NULL) {
+			rest[rest_count++] = index;
+			continue;
+		}
+		index->beginBuild();
+		index->reserve(n_tuples);
+		for (uint32_t i = 0; i < n_tuples; i++)
+			index->buildNext(tuples[images[j]->pos[i]]);
+		index->endBuild();
+	}
+	index_build_parallel(rest, rest_count, pk);
+	handler->replace = memtx_replace_all_keys;
+}
+
+/**
+ * Send a file of a snapshot to a replica, skipping the rows
+ * of the filter. Rows of each file are numbered from 1,
+ * renumber them to continue the rows already sent, as the
+ * replica expects.
+ */
+static void
+relay_snap_file(struct recovery *r, struct xlog *snap,
+		const struct snap_filter *filter)
+{
+	struct xlog_cursor i;
+	xlog_cursor_open(&i, snap);
+	auto guard = make_scoped_guard([&]{
+		xlog_cursor_close(&i);
+	});
+	struct xrow_header row;
+	while (xlog_cursor_next_xc(&i, &row) == 0) {
+		if (snap_filter_skips(filter, &row))
+			continue;
+		row.lsn = vclock_get(&r->vclock, row.server_id) + 1;
+		r->apply_row(r, r->apply_row_param, &row);
+	}
+	/* See recover_xlog(). */
+	if (snap->is_inprogress == false && i.eof_read == false)
+		panic("snapshot `%s' has no EOF marker", snap->filename);
+}
+
+/**
+ * Read the rest of a multi-part snapshot, see snap_threads.
+ * The first file has the system spaces, so it's read before
+ * the parts, which are read all at once. A relay sends the
+ * parts one by one.
+ */
+static void
+recover_snap_parts(struct recovery *r, struct xlog *snap, int64_t signature,
+		   apply_row_f apply_image, const struct snap_filter *filter)
+{
+	uint32_t part_count = snap->part_count;
+	struct xlog **parts = (struct xlog **)
+		calloc(part_count, sizeof(*parts));
+	if (parts == NULL) {
+		tnt_raise(OutOfMemory, part_count * sizeof(*parts),
+			  "calloc", "snapshot parts");
+	}
+	auto parts_guard = make_scoped_guard([=]{
+		for (uint32_t i = 0; i < part_count; i++) {
+			if (parts[i] != NULL)
+				xlog_close(parts[i]);
+		}
+		free(parts);
+	});
+	for (uint32_t i = 0; i < part_count; i++) {
+		parts[i] = xlog_open_part(&r->snap_dir, signature, i + 1);
+		if (parts[i] == NULL)
+			diag_raise();
+		say_info("recovering from `%s'", parts[i]->filename);
+	}
+	if (r->apply_request != NULL) {
+		snap_reader_recover(r, parts, part_count, apply_image, NULL,
+				    filter);
+		return;
+	}
+	for (uint32_t i = 0; i < part_count; i++)
+		relay_snap_file(r, parts[i], filter);
+}
+
+/**
+ * A snapshot and the snapshots it is a delta of, if it's
+ * incremental, see snap_delta_max. The full snapshot goes
+ * first. Each file skips the spaces saved again in the files
+ * after it.
+ */
+struct snap_chain {
+	struct xlog **snaps;
+	struct snap_filter *filters;
+	uint32_t count;
+	/** Space ids of the filters. */
+	uint32_t *space_ids;
+};
+
+static void
+snap_chain_destroy(struct snap_chain *chain)
+{
+	for (uint32_t i = 0; i < chain->count; i++)
+		xlog_close(chain->snaps[i]);
+	free(chain->snaps);
+	free(chain->filters);
+	free(chain->space_ids);
+}
+
+static int
+snap_space_id_cmp(const void *a, const void *b)
+{
+	uint32_t id_a = *(const uint32_t *) a;
+	uint32_t id_b = *(const uint32_t *) b;
+	return id_a < id_b ? -1 : id_a > id_b;
+}
+
+/**
+ * Open a snapshot and the snapshots it is a delta of.
+ * The chain must be destroyed with snap_chain_destroy(),
+ * even on error.
+ */
+static void
+snap_chain_open(struct snap_chain *chain, struct xdir *dir,
+		int64_t signature)
+{
+	memset(chain, 0, sizeof(*chain));
+	/* Open the files from the newest to the full snapshot. */
+	uint32_t capacity = 0;
+	for (;;) {
+		if (chain->count == capacity) {
+			capacity = MAX(capacity * 2, 4u);
+			struct xlog **snaps = (struct xlog **)
+				realloc(chain->snaps,
+					capacity * sizeof(*snaps));
+			if (snaps == NULL) {
+				tnt_raise(OutOfMemory,
+					  capacity * sizeof(*snaps),
+					  "realloc", "snapshot chain");
+			}
+			chain->snaps = snaps;
+		}
+		struct xlog *snap = xlog_open_xc(dir, signature);
+		chain->snaps[chain->count++] = snap;
+		if (snap->delta == NULL)
+			break;
+		/* The header check makes sure the chain ends. */
+		signature = snap->delta->base;
+	}
+	/* The full snapshot first. */
+	for (uint32_t i = 0; i < chain->count / 2; i++) {
+		struct xlog *tmp = chain->snaps[i];
+		chain->snaps[i] = chain->snaps[chain->count - 1 - i];
+		chain->snaps[chain->count - 1 - i] = tmp;
+	}
+	/*
+	 * The filter of a file is the spaces of all files after
+	 * it. The filters are stored one after another, from
+	 * the last file: each next one is the previous one plus
+	 * the spaces of a file.
+	 */
+	size_t size = 0, count = 0;
+	for (uint32_t i = chain->count - 1; i > 0; i--) {
+		count += chain->snaps[i]->delta->space_count;
+		size += count;
+	}
+	chain->filters = (struct snap_filter *)
+		calloc(chain->count, sizeof(*chain->filters));
+	chain->space_ids = (uint32_t *) malloc(size * sizeof(uint32_t) + 1);
+	if (chain->filters == NULL || chain->space_ids == NULL) {
+		tnt_raise(OutOfMemory, size * sizeof(uint32_t),
+			  "malloc", "snapshot chain");
+	}
+	uint32_t *ids = chain->space_ids;
+	count = 0;
+	for (uint32_t i = chain->count - 1; i > 0; i--) {
+		struct xlog_delta *delta = chain->snaps[i]->delta;
+		uint32_t *prev = ids;
+		ids += count;
+		memcpy(ids, prev, count * sizeof(uint32_t));
+		memcpy(ids + count, delta->space_ids,
+		       delta->space_count * sizeof(uint32_t));
+		count += delta->space_count;
+		qsort(ids, count, sizeof(uint32_t), snap_space_id_cmp);
+		chain->filters[i - 1].space_ids = ids;
+		chain->filters[i - 1].space_count = count;
+	}
+}
+
 /**
  * Read a snapshot and call apply_row for every snapshot row.
  * Panic in case of error.
  *
  * @pre there is an existing snapshot. Otherwise
  * recovery_bootstrap() should be used instead.
+ *
+ * Index image rows are passed to apply_image, if it's set.
+ *
+ * @return the number of incremental snapshots read after
+ * the full one.
  */
-void
-recover_snap(struct recovery *r)
+static uint32_t
+recover_snap(struct recovery *r, apply_row_f apply_image)
 {
 	/* There's no current_wal during initial recover. */
 	assert(r->current_wal == NULL);
@@ -590,16 +1030,37 @@ recover_snap(struct recovery *r)
 		tnt_raise(ClientError, ER_MISSING_SNAPSHOT);
 	int64_t signature = vclock_sum(res);
 
-	struct xlog *snap = xlog_open_xc(&r->snap_dir, signature);
-	auto guard = make_scoped_guard([=]{ xlog_close(snap); });
+	struct snap_chain chain;
+	auto guard = make_scoped_guard([&]{ snap_chain_destroy(&chain); });
+	snap_chain_open(&chain, &r->snap_dir, signature);
 	/* Save server UUID */
-	r->server_uuid = snap->server_uuid;
+	r->server_uuid = chain.snaps[chain.count - 1]->server_uuid;
 
 	/* Add a surrogate server id for snapshot rows */
 	vclock_add_server(&r->vclock, 0);
 
-	say_info("recovering from `%s'", snap->filename);
-	recover_xlog(r, snap);
+	for (uint32_t i = 0; i < chain.count; i++) {
+		struct xlog *snap = chain.snaps[i];
+		const struct snap_filter *filter = &chain.filters[i];
+		say_info("recovering from `%s'", snap->filename);
+		/*
+		 * Read and decode the snapshot in a separate
+		 * thread when recovering locally. A relay only
+		 * sends the rows, so there is nothing to offload.
+		 */
+		if (r->apply_request != NULL)
+			snap_reader_recover(r, &snap, 1, apply_image, NULL,
+					    filter);
+		else if (chain.count == 1)
+			recover_xlog(r, snap);
+		else
+			relay_snap_file(r, snap, filter);
+		if (snap->part_count > 0) {
+			recover_snap_parts(r, snap, vclock_sum(&snap->vclock),
+					   apply_image, filter);
+		}
+	}
+	return chain.count - 1;
 }
 
 /** Called at start to tell memtx to recover to a given LSN. */
@@ -621,13 +1082,31 @@ MemtxEngine::recoverToCheckpoint(int64_t /* lsn */)
 		   MEMTX_READING_SNAPSHOT : MEMTX_OK);
 
 	/* Process existing snapshot */
-	recover_snap(r);
+	m_delta_count = recover_snap(r, m_state == MEMTX_READING_SNAPSHOT ?
+				     memtx_recover_index_image : NULL);
 	/* Replace server vclock using the data from snapshot */
 	vclock_copy(&r->vclock, vclockset_last(&r->snap_dir.index));
+	/*
+	 * Changes made from now on, by the WAL, go to the next
+	 * snapshot, unlike the system spaces loaded above.
+	 */
+	m_last_checkpoint = vclock_sum(&r->vclock);
+	m_last_checkpoint_gen = ++memtx_checkpoint_gen;
+	/*
+	 * Rows skipped in a disaster recovery make the data
+	 * differ from the snapshot, the next one must be full.
+	 */
+	if (! r->snap_dir.panic_if_error)
+		m_last_checkpoint = -1;
 
 	if (m_state == MEMTX_READING_SNAPSHOT) {
 		/* End of the fast path: loaded the primary key. */
 		space_foreach(memtx_end_build_primary_key, this);
+		/* Secondary keys saved in the snapshot, if any. */
+		auto images_guard = make_scoped_guard([] {
+			memtx_index_images_free();
+		});
+		space_foreach(memtx_load_index_images, this);
 
 		if (r->wal_dir.panic_if_error) {
 			/*
@@ -734,6 +1213,8 @@ MemtxEngine::createIndex(struct key_def *key_def)
 		return new MemtxRTree(key_def);
 	case BITSET:
 		return new MemtxBitset(key_def);
+	case ART:
+		return new MemtxArt(key_def);
 	default:
 		assert(false);
 		return NULL;
@@ -793,6 +1274,18 @@ MemtxEngine::keydefCheck(struct space *space, struct key_def *key_def)
 				  "BITSET can not be unique");
 		}
 		break;
+	case ART:
+		/*
+		 * A snapshot needs a read view of the primary
+		 * key, which ART doesn't have.
+		 */
+		if (key_def->iid == 0) {
+			tnt_raise(ClientError, ER_MODIFY_INDEX,
+				  key_def->name,
+				  space_name(space),
+				  "ART index can not be primary");
+		}
+		break;
 	default:
 		tnt_raise(ClientError, ER_INDEX_TYPE,
 			  key_def->name,
@@ -819,10 +1312,14 @@ MemtxEngine::keydefCheck(struct space *space, struct key_def *key_def)
 			}
 			break;
 		case NUMBER:
-			tnt_raise(ClientError, ER_MODIFY_INDEX,
-				  key_def->name,
-				  space_name(space),
-				  "NUMBER field type is not supported");
+			/* Only TREE can order numbers of mixed types. */
+			if (key_def->type != TREE) {
+				tnt_raise(ClientError, ER_MODIFY_INDEX,
+					  key_def->name,
+					  space_name(space),
+					  "NUMBER field type is not supported");
+			}
+			break;
 		default:
 			assert(false);
 			break;
@@ -891,6 +1388,11 @@ MemtxEngine::rollbackStatement(struct txn_stmt *stmt)
 		Index *index = space->index[i];
 		index->replace(stmt->new_tuple, stmt->old_tuple, DUP_INSERT);
 	}
+	/*
+	 * A snapshot started after the statement may have written
+	 * it, so the next delta must have the space.
+	 */
+	handler->checkpoint_gen = memtx_checkpoint_gen;
 	if (stmt->new_tuple)
 		tuple_unref(stmt->new_tuple);
 
@@ -925,16 +1427,88 @@ MemtxEngine::beginJoin()
 	m_state = MEMTX_OK;
 }
 
+enum {
+	/**
+	 * A snapshot writer accounts its writes in the rate
+	 * limit in portions of this size, to not take the lock
+	 * of the limit on each row.
+	 */
+	CHECKPOINT_THROTTLE_QUANTUM = 64 * 1024
+};
+
+/**
+ * The rate limit of snapshot writes, see snap_io_rate_limit.
+ * A token bucket: it gains a token per byte at the rate and
+ * holds up to snap_io_rate_burst tokens. A writer takes a
+ * token per written byte, going into debt if there are not
+ * enough of them, and sleeps until the debt is paid off.
+ * This spreads the writes evenly over time, rather than
+ * writing at full speed for a part of each second and
+ * stalling for the rest of it. The threads writing the parts
+ * of a snapshot share one bucket.
+ */
+struct checkpoint_throttle {
+	pthread_mutex_t mutex;
+	/** Bytes per second, UINT64_MAX if there is no limit. */
+	uint64_t rate;
+	/** The capacity of the bucket, bytes. */
+	double burst;
+	/** Bytes which can be written now, negative if in debt. */
+	double tokens;
+	/** clock_monotonic() at the last update of the bucket. */
+	double last;
+};
+
+static void
+checkpoint_throttle_create(struct checkpoint_throttle *throttle,
+			   uint64_t rate, uint64_t burst)
+{
+	tt_pthread_mutex_init(&throttle->mutex, NULL);
+	throttle->rate = rate;
+	throttle->burst = burst;
+	throttle->tokens = burst;
+	throttle->last = clock_monotonic();
+}
+
 static void
-checkpoint_write_row(struct xlog *l, struct xrow_header *row,
-		     uint64_t snap_io_rate_limit)
+checkpoint_throttle_destroy(struct checkpoint_throttle *throttle)
 {
-	static uint64_t bytes;
-	ev_tstamp elapsed;
-	static ev_tstamp last = 0;
-	ev_loop *loop = loop();
+	tt_pthread_mutex_destroy(&throttle->mutex);
+}
 
-	row->tm = last;
+/** Take tokens for written bytes, sleep if there is a debt. */
+static void
+checkpoint_throttle_write(struct checkpoint_throttle *throttle,
+			  uint64_t bytes)
+{
+	if (throttle->rate == UINT64_MAX)
+		return;
+	tt_pthread_mutex_lock(&throttle->mutex);
+	double now = clock_monotonic();
+	throttle->tokens = MIN(throttle->burst, throttle->tokens +
+			       (now - throttle->last) * throttle->rate);
+	throttle->last = now;
+	throttle->tokens -= bytes;
+	double delay = 0;
+	if (throttle->tokens < 0)
+		delay = -throttle->tokens / throttle->rate;
+	tt_pthread_mutex_unlock(&throttle->mutex);
+	if (delay > 0)
+		usleep(delay * 1000000);
+}
+
+/**
+ * Bytes not accounted in the rate limit yet. Parts of a
+ * snapshot are written by several threads, each thread resets
+ * the counter when it starts writing.
+ */
+static __thread uint64_t checkpoint_unthrottled;
+
+static void
+checkpoint_write_row(struct xlog *l, struct xrow_header *row,
+		     struct checkpoint_throttle *throttle)
+{
+	row->tm = ev_now(loop());
 	row->server_id = 0;
 	/**
 	 * Rows in snapshot are numbered from 1 to %rows.
@@ -946,65 +1520,25 @@ checkpoint_write_row(struct xlog *l, struct xrow_header *row,
 	row->lsn = ++l->rows;
 	row->sync = 0; /* don't write sync to wal */
 
-	struct iovec iov[XROW_IOVMAX];
-	int iovcnt = xlog_encode_row(row, iov);
-
-	/* TODO: use writev here */
-	for (int i = 0; i < iovcnt; i++) {
-		if (fwrite(iov[i].iov_base, iov[i].iov_len, 1, l->f) != 1) {
-			say_syserror("Can't write row (%zu bytes)",
-				     iov[i].iov_len);
-			tnt_raise(SystemError, "fwrite");
-		}
-		bytes += iov[i].iov_len;
-	}
+	ssize_t written = xlog_write_row(l, row);
+	if (written < 0)
+		tnt_raise(SystemError, "fwrite");
+	checkpoint_unthrottled += written;
 
 	if (l->rows % 100000 == 0)
 		say_crit("%.1fM rows written", l->rows / 1000000.);
 
 	fiber_gc();
 
-	if (snap_io_rate_limit != UINT64_MAX) {
-		if (last == 0) {
-			/*
-			 * Remember the time of first
-			 * write to disk.
-			 */
-			ev_now_update(loop);
-			last = ev_now(loop);
-		}
-		/**
-		 * If io rate limit is set, flush the
-		 * filesystem cache, otherwise the limit is
-		 * not really enforced.
-		 */
-		if (bytes > snap_io_rate_limit)
-			fdatasync(fileno(l->f));
-	}
-	while (bytes > snap_io_rate_limit) {
-		ev_now_update(loop);
-		/*
-		 * How much time have passed since
-		 * last write?
-		 */
-		elapsed = ev_now(loop) - last;
-		/*
-		 * If last write was in less than
-		 * a second, sleep until the
-		 * second is reached.
-		 */
-		if (elapsed < 1)
-			usleep(((1 - elapsed) * 1000000));
-
-		ev_now_update(loop);
-		last = ev_now(loop);
-		bytes -= snap_io_rate_limit;
+	if (checkpoint_unthrottled >= CHECKPOINT_THROTTLE_QUANTUM) {
+		checkpoint_throttle_write(throttle, checkpoint_unthrottled);
+		checkpoint_unthrottled = 0;
 	}
 }
 
 static void
 checkpoint_write_tuple(struct xlog *l, uint32_t n, struct tuple *tuple,
-		       uint64_t snap_io_rate_limit)
+		       struct checkpoint_throttle *throttle)
 {
 	struct request_replace_body body;
 	body.m_body = 0x82; /* map of two elements. */
@@ -1021,16 +1555,38 @@ checkpoint_write_tuple(struct xlog *l, uint32_t n, struct tuple *tuple,
 	row.body[0].iov_base = &body;
 	row.body[0].iov_len = sizeof(body);
 	row.body[1].iov_base = tuple->data;
-	row.body[1].iov_len = tuple->bsize;
-	checkpoint_write_row(l, &row, snap_io_rate_limit);
+	row.body[1].iov_len = tuple_bsize(tuple);
+	checkpoint_write_row(l, &row, throttle);
 }
 
+/** A secondary index to save an image of, see snap_index_image. */
+struct checkpoint_image {
+	Index *index;
+	struct iterator *iterator;
+	struct rlist link;
+};
+
 struct checkpoint_entry {
 	struct space *space;
 	struct iterator *iterator;
+	/** Images to write after the tuples of the space. */
+	struct rlist images;
+	/** The file of the snapshot the space is written to. */
+	uint32_t part;
 	struct rlist link;
 };
 
+/** A part of a multi-part snapshot and its writer thread. */
+struct checkpoint_part {
+	struct checkpoint *ckpt;
+	/** The part number, from 1, see xlog_create_part(). */
+	uint32_t id;
+	/** The number of tuples in the spaces of the part. */
+	uint64_t weight;
+	struct cord cord;
+	bool is_started;
+};
+
 struct checkpoint {
 	/**
 	 * List of MemTX spaces to snapshot, with consistent
@@ -1039,7 +1595,25 @@ struct checkpoint {
 	struct rlist entries;
 	/** The signature of the snapshot file (lsn sum) */
 	int64_t lsn;
-	uint64_t snap_io_rate_limit;
+	/** The write rate limit, shared by all parts. */
+	struct checkpoint_throttle throttle;
+	/** The tuple version of the snapshot, see tuple_snapshot_pass(). */
+	uint16_t version;
+	/** Write secondary TREE index images. */
+	bool snap_index_image;
+	/**
+	 * Set if the snapshot is incremental, with only the
+	 * spaces changed since base_gen, see snap_delta_max.
+	 */
+	bool is_delta;
+	uint32_t base_gen;
+	/** memtx_checkpoint_gen after the start of the snapshot. */
+	uint32_t gen;
+	/** The header of an incremental snapshot. */
+	struct xlog_delta delta;
+	/** Parts of the snapshot, see snap_threads. */
+	struct checkpoint_part *parts;
+	uint32_t part_count;
 	struct cord cord;
 	bool waiting_for_snap_thread;
 	struct vclock vclock;
@@ -1056,7 +1630,80 @@ checkpoint_init(struct checkpoint *ckpt, struct recovery *recovery,
 	vclock_copy(&ckpt->vclock, &recovery->vclock);
 	xdir_create(&ckpt->dir, recovery->snap_dir.dirname, SNAP,
 		    &recovery->server_uuid);
-	ckpt->snap_io_rate_limit = recovery->snap_io_rate_limit;
+	ckpt->dir.codec = recovery->snap_dir.codec;
+	ckpt->dir.part_count = recovery->snap_dir.part_count;
+	ckpt->part_count = recovery->snap_dir.part_count;
+	ckpt->parts = NULL;
+	checkpoint_throttle_create(&ckpt->throttle,
+				   recovery->snap_io_rate_limit,
+				   recovery->snap_io_rate_burst);
+	ckpt->snap_index_image = recovery->snap_index_image;
+	ckpt->is_delta = false;
+	ckpt->base_gen = 0;
+	ckpt->gen = 0;
+	ckpt->version = 0;
+	memset(&ckpt->delta, 0, sizeof(ckpt->delta));
+}
+
+/** Check if a space has changed since the base snapshot. */
+static bool
+checkpoint_space_is_changed(struct checkpoint *ckpt, struct space *sp)
+{
+	struct MemtxSpace *handler = (struct MemtxSpace *) sp->handler;
+	return handler->checkpoint_gen >= ckpt->base_gen;
+}
+
+/**
+ * An incremental snapshot has only user spaces, read after the
+ * system spaces of the full one. So any change of the schema,
+ * which also covers creating, dropping and truncating spaces,
+ * makes the next snapshot full.
+ */
+static void
+checkpoint_check_system_space(struct space *sp, void *data)
+{
+	struct checkpoint *ckpt = (struct checkpoint *) data;
+	if (space_is_memtx(sp) && space_is_system(sp) &&
+	    checkpoint_space_is_changed(ckpt, sp))
+		ckpt->is_delta = false;
+}
+
+/**
+ * Make the snapshot incremental, if it's allowed and possible:
+ * write only the spaces changed since the last snapshot and
+ * refer to it in the header.
+ */
+static void
+checkpoint_plan_delta(struct checkpoint *ckpt, int64_t base,
+		      uint32_t base_gen)
+{
+	ckpt->is_delta = true;
+	ckpt->base_gen = base_gen;
+	space_foreach(checkpoint_check_system_space, ckpt);
+	if (! ckpt->is_delta)
+		return;
+	ckpt->delta.base = base;
+}
+
+/** List the spaces of an incremental snapshot in its header. */
+static void
+checkpoint_set_delta_spaces(struct checkpoint *ckpt)
+{
+	if (! ckpt->is_delta)
+		return;
+	uint32_t count = 0;
+	struct checkpoint_entry *entry;
+	rlist_foreach_entry(entry, &ckpt->entries, link)
+		count++;
+	uint32_t *space_ids = (uint32_t *)
+		region_alloc_xc(&fiber()->gc, count * sizeof(uint32_t) + 1);
+	count = 0;
+	rlist_foreach_entry(entry, &ckpt->entries, link)
+		space_ids[count++] = space_id(entry->space);
+	qsort(space_ids, count, sizeof(uint32_t), snap_space_id_cmp);
+	ckpt->delta.space_ids = space_ids;
+	ckpt->delta.space_count = count;
+	ckpt->dir.delta = &ckpt->delta;
 }
 
 static void
@@ -1067,8 +1714,15 @@ checkpoint_destroy(struct checkpoint *ckpt)
 		Index *pk = space_index(entry->space, 0);
 		pk->destroyReadViewForIterator(entry->iterator);
 		entry->iterator->free(entry->iterator);
+		struct checkpoint_image *image;
+		rlist_foreach_entry(image, &entry->images, link) {
+			image->index->destroyReadViewForIterator(
+				image->iterator);
+			image->iterator->free(image->iterator);
+		}
 	}
 	ckpt->entries = RLIST_HEAD_INITIALIZER(ckpt->entries);
+	checkpoint_throttle_destroy(&ckpt->throttle);
 	xdir_destroy(&ckpt->dir);
 }
 
@@ -1084,21 +1738,289 @@ checkpoint_add_space(struct space *sp, void *data)
 	if (!pk)
 		return;
 	struct checkpoint *ckpt = (struct checkpoint *)data;
+	if (ckpt->is_delta && ! checkpoint_space_is_changed(ckpt, sp))
+		return;
 	struct checkpoint_entry *entry;
 	entry = region_alloc_object_xc(&fiber()->gc, struct checkpoint_entry);
 	rlist_add_tail_entry(&ckpt->entries, entry, link);
 
 	entry->space = sp;
+	entry->part = 0;
+	rlist_create(&entry->images);
 	entry->iterator = pk->allocIterator();
 
 	pk->initIterator(entry->iterator, ITER_ALL, NULL, 0);
 	pk->createReadViewForIterator(entry->iterator);
+
+	/*
+	 * Image positions refer to the order of tuples in the
+	 * snapshot, which is the order of the primary key only
+	 * if it's a TREE.
+	 */
+	if (! ckpt->snap_index_image || pk->key_def->type != TREE)
+		return;
+	for (uint32_t i = 1; i < sp->index_count; i++) {
+		Index *index = sp->index[i];
+		if (index->key_def->type != TREE)
+			continue;
+		struct checkpoint_image *image =
+			region_alloc_object_xc(&fiber()->gc,
+					       struct checkpoint_image);
+		image->index = index;
+		image->iterator = index->allocIterator();
+		rlist_add_tail_entry(&entry->images, image, link);
+		index->initIterator(image->iterator, ITER_ALL, NULL, 0);
+		index->createReadViewForIterator(image->iterator);
+	}
 };
 
+enum {
+	/** Positions in a single index image row. */
+	CHECKPOINT_IMAGE_CHUNK = 16384
+};
+
+/** A tuple and its position in the snapshot order. */
+struct checkpoint_tuple_pos {
+	struct tuple *tuple;
+	uint32_t pos;
+};
+
+static int
+checkpoint_tuple_pos_cmp(const void *a, const void *b)
+{
+	struct tuple *ta = ((const struct checkpoint_tuple_pos *) a)->tuple;
+	struct tuple *tb = ((const struct checkpoint_tuple_pos *) b)->tuple;
+	return ta < tb ? -1 : ta > tb;
+}
+
+/**
+ * Write the order of tuples in a secondary index as positions
+ * of the tuples among the rows of the space just written to
+ * the snapshot. The image is split into chunks of
+ * CHECKPOINT_IMAGE_CHUNK positions, each chunk is a row:
+ * { space_id, index_id, offset of the chunk, bin of positions }.
+ *
+ * @param map the tuples of the space, sorted by address
+ */
+static void
+checkpoint_write_image(struct xlog *l, struct checkpoint_image *image,
+		       struct checkpoint_tuple_pos *map, uint32_t n_tuples,
+		       struct checkpoint_throttle *throttle)
+{
+	struct key_def *key_def = image->index->key_def;
+	uint32_t *pos = (uint32_t *) malloc(n_tuples * sizeof(uint32_t) + 1);
+	if (pos == NULL) {
+		tnt_raise(OutOfMemory, n_tuples * sizeof(uint32_t),
+			  "malloc", "index image");
+	}
+	auto pos_guard = make_scoped_guard([=] { free(pos); });
+	struct iterator *it = image->iterator;
+	struct checkpoint_tuple_pos key;
+	uint32_t count = 0;
+	while (count < n_tuples && (key.tuple = it->next(it)) != NULL) {
+		struct checkpoint_tuple_pos *found =
+			(struct checkpoint_tuple_pos *)
+			bsearch(&key, map, n_tuples, sizeof(*map),
+				checkpoint_tuple_pos_cmp);
+		if (found == NULL)
+			break;
+		pos[count++] = found->pos;
+	}
+	/* Must not happen: the read views are consistent. */
+	if (count != n_tuples || it->next(it) != NULL) {
+		say_error("index '%s' of space %u doesn't match "
+			  "the primary key, its image is skipped",
+			  key_def->name, key_def->space_id);
+		return;
+	}
+
+	char *body = (char *) malloc(CHECKPOINT_IMAGE_CHUNK *
+				     sizeof(uint32_t) + 32);
+	if (body == NULL) {
+		tnt_raise(OutOfMemory, CHECKPOINT_IMAGE_CHUNK *
+			  sizeof(uint32_t) + 32, "malloc", "index image");
+	}
+	auto body_guard = make_scoped_guard([=] { free(body); });
+	for (uint32_t offset = 0; offset < n_tuples;
+	     offset += CHECKPOINT_IMAGE_CHUNK) {
+		uint32_t chunk = MIN((uint32_t) CHECKPOINT_IMAGE_CHUNK,
+				     n_tuples - offset);
+		char *data = body;
+		data = mp_encode_map(data, 4);
+		data = mp_encode_uint(data, IPROTO_SPACE_ID);
+		data = mp_encode_uint(data, key_def->space_id);
+		data = mp_encode_uint(data, IPROTO_INDEX_ID);
+		data = mp_encode_uint(data, key_def->iid);
+		data = mp_encode_uint(data, IPROTO_OFFSET);
+		data = mp_encode_uint(data, offset);
+		data = mp_encode_uint(data, IPROTO_DATA);
+		data = mp_encode_binl(data, chunk * sizeof(uint32_t));
+		for (uint32_t i = 0; i < chunk; i++)
+			data = mp_store_u32(data, pos[offset + i]);
+
+		struct xrow_header row;
+		memset(&row, 0, sizeof(struct xrow_header));
+		row.type = IPROTO_INDEX_IMAGE;
+		row.bodycnt = 1;
+		row.body[0].iov_base = body;
+		row.body[0].iov_len = data - body;
+		checkpoint_write_row(l, &row, throttle);
+	}
+}
+
+/**
+ * Write the tuples of a space and then the images of its
+ * secondary keys, if they are requested.
+ */
+static void
+checkpoint_write_space(struct xlog *l, struct checkpoint *ckpt,
+		       struct checkpoint_entry *entry)
+{
+	struct checkpoint_throttle *throttle = &ckpt->throttle;
+	struct checkpoint_tuple_pos *map = NULL;
+	uint32_t n_tuples = 0, capacity = 0;
+	auto map_guard = make_scoped_guard([&] { free(map); });
+	bool need_map = ! rlist_empty(&entry->images);
+
+	struct tuple *tuple;
+	struct iterator *it = entry->iterator;
+	for (tuple = it->next(it); tuple; tuple = it->next(it)) {
+		checkpoint_write_tuple(l, space_id(entry->space),
+				       tuple, throttle);
+		/*
+		 * The tuple is copied to the file buffer, let it
+		 * go if it's deleted. Images only look up tuple
+		 * pointers.
+		 */
+		tuple_snapshot_pass(tuple, ckpt->version);
+		if (! need_map)
+			continue;
+		if (n_tuples == capacity) {
+			capacity = MAX(capacity * 2, 1024u);
+			struct checkpoint_tuple_pos *new_map =
+				(struct checkpoint_tuple_pos *)
+				realloc(map, capacity * sizeof(*map));
+			if (new_map == NULL) {
+				tnt_raise(OutOfMemory,
+					  capacity * sizeof(*map),
+					  "realloc", "index image");
+			}
+			map = new_map;
+		}
+		map[n_tuples].tuple = tuple;
+		map[n_tuples].pos = n_tuples;
+		n_tuples++;
+	}
+	if (! need_map)
+		return;
+	qsort(map, n_tuples, sizeof(*map), checkpoint_tuple_pos_cmp);
+	struct checkpoint_image *image;
+	rlist_foreach_entry(image, &entry->images, link) {
+		checkpoint_write_image(l, image, map, n_tuples, throttle);
+	}
+}
+
+static int
+checkpoint_entry_weight_cmp(const void *a, const void *b)
+{
+	struct checkpoint_entry *ea = *(struct checkpoint_entry **) a;
+	struct checkpoint_entry *eb = *(struct checkpoint_entry **) b;
+	uint32_t wa = space_index(ea->space, 0)->size();
+	uint32_t wb = space_index(eb->space, 0)->size();
+	/* Bigger spaces first. */
+	return wa < wb ? 1 : wa > wb ? -1 : 0;
+}
+
+/**
+ * Spread user spaces over the parts of the snapshot, so that
+ * the parts have about the same number of tuples: each space,
+ * bigger first, goes to the lightest part so far. System
+ * spaces stay in the first file, to be recovered before the
+ * parts.
+ */
+static void
+checkpoint_assign_parts(struct checkpoint *ckpt)
+{
+	if (ckpt->part_count == 0)
+		return;
+	struct region *gc = &fiber()->gc;
+	ckpt->parts = (struct checkpoint_part *)
+		region_alloc_xc(gc, ckpt->part_count * sizeof(*ckpt->parts));
+	memset(ckpt->parts, 0, ckpt->part_count * sizeof(*ckpt->parts));
+	for (uint32_t i = 0; i < ckpt->part_count; i++) {
+		ckpt->parts[i].ckpt = ckpt;
+		ckpt->parts[i].id = i + 1;
+	}
+
+	uint32_t count = 0;
+	struct checkpoint_entry *entry;
+	rlist_foreach_entry(entry, &ckpt->entries, link)
+		count++;
+	struct checkpoint_entry **entries = (struct checkpoint_entry **)
+		region_alloc_xc(gc, count * sizeof(*entries) + 1);
+	count = 0;
+	rlist_foreach_entry(entry, &ckpt->entries, link) {
+		if (! space_is_system(entry->space))
+			entries[count++] = entry;
+	}
+	qsort(entries, count, sizeof(*entries), checkpoint_entry_weight_cmp);
+	for (uint32_t i = 0; i < count; i++) {
+		struct checkpoint_part *part = &ckpt->parts[0];
+		for (uint32_t j = 1; j < ckpt->part_count; j++) {
+			if (ckpt->parts[j].weight < part->weight)
+				part = &ckpt->parts[j];
+		}
+		part->weight += space_index(entries[i]->space, 0)->size();
+		entries[i]->part = part->id;
+	}
+}
+
+/** Write the spaces of a part to a snapshot file. */
+static void
+checkpoint_write_file(struct xlog *l, struct checkpoint *ckpt, uint32_t part)
+{
+	struct checkpoint_entry *entry;
+	rlist_foreach_entry(entry, &ckpt->entries, link) {
+		if (entry->part == part)
+			checkpoint_write_space(l, ckpt, entry);
+	}
+}
+
+static void
+checkpoint_write_part(struct checkpoint_part *part)
+{
+	struct checkpoint *ckpt = part->ckpt;
+	struct xlog *l = xlog_create_part(&ckpt->dir, &ckpt->vclock,
+					  part->id);
+	if (l == NULL)
+		tnt_raise(SystemError, "xlog_open");
+
+	auto guard = make_scoped_guard([=]{ xlog_close(l); });
+
+	say_info("saving snapshot part `%s'", l->filename);
+	checkpoint_write_file(l, ckpt, part->id);
+	/* The last block of rows must be on disk before the rename. */
+	if (xlog_flush(l) != 0)
+		tnt_raise(SystemError, "fwrite");
+	guard.is_active = false;
+	if (xlog_close(l) != 0)
+		tnt_raise(SystemError, "fclose");
+}
+
+static int
+checkpoint_part_f(va_list ap)
+{
+	struct checkpoint_part *part = va_arg(ap, struct checkpoint_part *);
+	checkpoint_unthrottled = 0;
+	checkpoint_write_part(part);
+	return 0;
+}
+
 int
 checkpoint_f(va_list ap)
 {
 	struct checkpoint *ckpt = va_arg(ap, struct checkpoint *);
+	checkpoint_unthrottled = 0;
 
 	struct xlog *snap = xlog_create(&ckpt->dir, &ckpt->vclock);
 
@@ -1107,16 +2029,60 @@ checkpoint_f(va_list ap)
 
 	auto guard = make_scoped_guard([=]{ xlog_close(snap); });
 
-	say_info("saving snapshot `%s'", snap->filename);
-	struct checkpoint_entry *entry;
-	rlist_foreach_entry(entry, &ckpt->entries, link) {
-		struct tuple *tuple;
-		struct iterator *it = entry->iterator;
-		for (tuple = it->next(it); tuple; tuple = it->next(it)) {
-			checkpoint_write_tuple(snap, space_id(entry->space),
-					       tuple, ckpt->snap_io_rate_limit);
+	if (ckpt->is_delta) {
+		say_info("saving incremental snapshot `%s', %u changed "
+			 "spaces", snap->filename,
+			 (unsigned) ckpt->delta.space_count);
+	} else {
+		say_info("saving snapshot `%s'", snap->filename);
+	}
+	/*
+	 * Write the parts in their own threads, once the first
+	 * file, which makes sure the snapshot doesn't exist
+	 * yet, is created.
+	 */
+	for (uint32_t i = 0; i < ckpt->part_count; i++) {
+		struct checkpoint_part *part = &ckpt->parts[i];
+		if (cord_costart(&part->cord, "snapshot_part",
+				 checkpoint_part_f, part) != 0) {
+			/* Write this part in this thread. */
+			diag_clear(diag_get());
+			continue;
 		}
+		part->is_started = true;
 	}
+	/*
+	 * Wait for all parts, even if something fails: the
+	 * threads use the read views of the checkpoint.
+	 */
+	struct diag error;
+	diag_create(&error);
+	try {
+		checkpoint_write_file(snap, ckpt, 0);
+		if (xlog_flush(snap) != 0)
+			tnt_raise(SystemError, "fwrite");
+		for (uint32_t i = 0; i < ckpt->part_count; i++) {
+			if (! ckpt->parts[i].is_started)
+				checkpoint_write_part(&ckpt->parts[i]);
+		}
+	} catch (Exception *e) {
+		diag_move(diag_get(), &error);
+	}
+	for (uint32_t i = 0; i < ckpt->part_count; i++) {
+		if (! ckpt->parts[i].is_started)
+			continue;
+		cord_cojoin(&ckpt->parts[i].cord);
+		if (! diag_is_empty(diag_get()) && diag_is_empty(&error))
+			diag_move(diag_get(), &error);
+		diag_clear(diag_get());
+	}
+	if (! diag_is_empty(&error)) {
+		diag_move(&error, diag_get());
+		diag_raise();
+	}
+	guard.is_active = false;
+	if (xlog_close(snap) != 0)
+		tnt_raise(SystemError, "fclose");
 	say_info("done");
 	return 0;
 }
@@ -1129,16 +2095,31 @@ MemtxEngine::beginCheckpoint(int64_t lsn)
 	m_checkpoint = region_alloc_object_xc(&fiber()->gc, struct checkpoint);
 
 	checkpoint_init(m_checkpoint, ::recovery, lsn);
+	/*
+	 * An incremental snapshot doesn't pass the tuples of
+	 * unchanged spaces, so once in a while it must be full.
+	 */
+	uint16_t versions = snapshot_version + 1 - m_full_checkpoint_version;
+	if (m_last_checkpoint >= 0 &&
+	    m_delta_count < ::recovery->snap_delta_max &&
+	    versions < TUPLE_VERSION_STALE) {
+		checkpoint_plan_delta(m_checkpoint, m_last_checkpoint,
+				      m_last_checkpoint_gen);
+	}
 	space_foreach(checkpoint_add_space, m_checkpoint);
+	checkpoint_set_delta_spaces(m_checkpoint);
+	checkpoint_assign_parts(m_checkpoint);
+	/* Changes made from now on go to the next snapshot. */
+	m_checkpoint->gen = ++memtx_checkpoint_gen;
+
+	/* increment snapshot version; set tuple deletion to delayed mode */
+	m_checkpoint->version = tuple_begin_snapshot();
 
 	if (cord_costart(&m_checkpoint->cord, "snapshot",
 			 checkpoint_f, m_checkpoint)) {
 		return -1;
 	}
 	m_checkpoint->waiting_for_snap_thread = true;
-
-	/* increment snapshot version; set tuple deletion to delayed mode */
-	tuple_begin_snapshot();
 	return 0;
 }
 
@@ -1175,14 +2156,26 @@ MemtxEngine::commitCheckpoint()
 	tuple_end_snapshot();
 
 	struct xdir *dir = &m_checkpoint->dir;
-	/* rename snapshot on completion */
-	char to[PATH_MAX];
-	snprintf(to, sizeof(to), "%s",
-		 format_filename(dir, m_checkpoint->lsn, NONE));
-	char *from = format_filename(dir, m_checkpoint->lsn, INPROGRESS);
-	int rc = coeio_rename(from, to);
-	if (rc != 0)
-		panic("can't rename .snap.inprogress");
+	/*
+	 * rename snapshot on completion, the first file last:
+	 * a snapshot exists only if all its parts do
+	 */
+	for (uint32_t part = m_checkpoint->part_count + 1; part-- > 0; ) {
+		char to[PATH_MAX];
+		snprintf(to, sizeof(to), "%s",
+			 format_part_filename(dir, m_checkpoint->lsn, part,
+					      NONE));
+		char *from = format_part_filename(dir, m_checkpoint->lsn,
+						  part, INPROGRESS);
+		int rc = coeio_rename(from, to);
+		if (rc != 0)
+			panic("can't rename .snap.inprogress");
+	}
+	m_last_checkpoint = m_checkpoint->lsn;
+	m_delta_count = m_checkpoint->is_delta ? m_delta_count + 1 : 0;
+	if (! m_checkpoint->is_delta)
+		m_full_checkpoint_version = m_checkpoint->version;
+	m_last_checkpoint_gen = m_checkpoint->gen;
 
 	checkpoint_destroy(m_checkpoint);
 	m_checkpoint = 0;
@@ -1206,11 +2199,13 @@ MemtxEngine::abortCheckpoint()
 
 	tuple_end_snapshot();
 
-	/** Remove garbage .inprogress file. */
-	char *filename = format_filename(&m_checkpoint->dir,
-					 m_checkpoint->lsn,
-					 INPROGRESS);
-	(void) coeio_unlink(filename);
+	/** Remove garbage .inprogress files. */
+	for (uint32_t part = 0; part <= m_checkpoint->part_count; part++) {
+		char *filename = format_part_filename(&m_checkpoint->dir,
+						      m_checkpoint->lsn,
+						      part, INPROGRESS);
+		(void) coeio_unlink(filename);
+	}
 
 	checkpoint_destroy(m_checkpoint);
 	m_checkpoint = 0;
@@ -1219,7 +2214,7 @@ MemtxEngine::abortCheckpoint()
 void
 MemtxEngine::join(struct relay *relay)
 {
-	recover_snap(relay->r);
+	recover_snap(relay->r, NULL);
 }
 
 /**
@@ -69,6 +69,25 @@ private:
 	/** Non-zero if there is a checkpoint (snapshot) in * progress. */
 	struct checkpoint *m_checkpoint;
 	enum memtx_recovery_state m_state;
+	/**
+	 * The signature of the last snapshot, written or read
+	 * at start, -1 if none. The next snapshot can be a delta
+	 * of it, see snap_delta_max.
+	 */
+	int64_t m_last_checkpoint;
+	/** The number of incremental snapshots in its chain. */
+	uint32_t m_delta_count;
+	/**
+	 * memtx_checkpoint_gen after the start of the last
+	 * snapshot: spaces changed since then are saved in
+	 * the next incremental snapshot.
+	 */
+	uint32_t m_last_checkpoint_gen;
+	/**
+	 * The tuple version of the last full snapshot, which
+	 * has passed all tuples, see TUPLE_VERSION_STALE.
+	 */
+	uint16_t m_full_checkpoint_version;
 };
 
 enum {
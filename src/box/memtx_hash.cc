@@ -36,12 +36,6 @@
 #include "schema.h" /* space_cache_find() */
 #include "errinj.h"
 
-#include "third_party/PMurHash.h"
-
-enum {
-	HASH_SEED = 13U
-};
-
 static inline bool
 equal(struct tuple *tuple_a, struct tuple *tuple_b,
 	    const struct key_def *key_def)
@@ -57,92 +51,6 @@ equal_key(struct tuple *tuple, const char *key,
 					       key_def) == 0;
 }
 
-static inline uint32_t
-mh_hash_field(uint32_t *ph1, uint32_t *pcarry, const char **field,
-	      enum field_type type)
-{
-	const char *f = *field;
-	uint32_t size;
-
-	switch (type) {
-	case STRING:
-		/*
-		 * (!) MP_STR fields hashed **excluding** MsgPack format
-		 * indentifier. We have to do that to keep compatibility
-		 * with old third-party MsgPack (spec-old.md) implementations.
-		 * \sa https://github.com/tarantool/tarantool/issues/522
-		 */
-		f = mp_decode_str(field, &size);
-		break;
-	default:
-		mp_next(field);
-		size = *field - f;  /* calculate the size of field */
-		/*
-		 * (!) All other fields hashed **including** MsgPack format
-		 * identifier (e.g. 0xcc). This was done **intentionally**
-		 * for performance reasons. Please follow MsgPack specification
-		 * and pack all your numbers to the most compact representation.
-		 * If you still want to add support for broken MsgPack,
-		 * please don't forget to patch tuple_compare_field().
-		 */
-		break;
-	}
-	assert(size < INT32_MAX);
-	PMurHash32_Process(ph1, pcarry, f, size);
-	return size;
-}
-
-static inline uint32_t
-tuple_hash(struct tuple *tuple, const struct key_def *key_def)
-{
-	const struct key_part *part = key_def->parts;
-	/*
-	 * Speed up the simplest case when we have a
-	 * single-part hash_table over an integer field.
-	 */
-	if (key_def->part_count == 1 && part->type == NUM) {
-		const char *field = tuple_field(tuple, part->fieldno);
-		uint64_t val = mp_decode_uint(&field);
-		if (likely(val <= UINT32_MAX))
-			return val;
-		return ((uint32_t)((val)>>33^(val)^(val)<<11));
-	}
-
-	uint32_t h = HASH_SEED;
-	uint32_t carry = 0;
-	uint32_t total_size = 0;
-
-	for ( ; part < key_def->parts + key_def->part_count; part++) {
-		const char *field = tuple_field(tuple, part->fieldno);
-		total_size += mh_hash_field(&h, &carry, &field, part->type);
-	}
-
-	return PMurHash32_Result(h, carry, total_size);
-}
-
-static inline uint32_t
-key_hash(const char *key, const struct key_def *key_def)
-{
-	const struct key_part *part = key_def->parts;
-
-	if (key_def->part_count == 1 && part->type == NUM) {
-		uint64_t val = mp_decode_uint(&key);
-		if (likely(val <= UINT32_MAX))
-			return val;
-		return ((uint32_t)((val)>>33^(val)^(val)<<11));
-	}
-
-	uint32_t h = HASH_SEED;
-	uint32_t carry = 0;
-	uint32_t total_size = 0;
-
-	/* Hash fields part by part (see mh_hash_field() comments) */
-	for ( ; part < key_def->parts + key_def->part_count; part++)
-		total_size += mh_hash_field(&h, &carry, &key, part->type);
-
-	return PMurHash32_Result(h, carry, total_size);
-}
-
 #define LIGHT_NAME _index
 #define LIGHT_DATA_TYPE struct tuple *
 #define LIGHT_KEY_TYPE const char *
@@ -275,6 +183,34 @@ MemtxHash::findByKey(const char *key, uint32_t part_count) const
 	return ret;
 }
 
+void
+MemtxHash::findByKeys(const char **keys, uint32_t part_count,
+		      uint32_t count, struct tuple **result) const
+{
+	assert(key_def->opts.is_unique && part_count == key_def->part_count);
+	(void) part_count;
+	/*
+	 * Prefetch the buckets of a batch of keys before
+	 * looking any of them up, so that cache misses overlap.
+	 */
+	enum { BATCH = 8 };
+	uint32_t hashes[BATCH];
+	for (uint32_t first = 0; first < count; first += BATCH) {
+		uint32_t n = MIN(count - first, (uint32_t) BATCH);
+		for (uint32_t i = 0; i < n; i++) {
+			hashes[i] = key_hash(keys[first + i], key_def);
+			light_index_prefetch(hash_table, hashes[i]);
+		}
+		for (uint32_t i = 0; i < n; i++) {
+			uint32_t k = light_index_find_key(hash_table, hashes[i],
+							  keys[first + i]);
+			result[first + i] = k != light_index_end ?
+				light_index_get(hash_table, k) : NULL;
+		}
+	}
+	index_ref_found(result, count);
+}
+
 struct tuple *
 MemtxHash::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 		   enum dup_replace_mode mode)
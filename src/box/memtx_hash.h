@@ -44,6 +44,8 @@ public:
 	virtual size_t size() const;
 	virtual struct tuple *random(uint32_t rnd) const;
 	virtual struct tuple *findByKey(const char *key, uint32_t part_count) const;
+	virtual void findByKeys(const char **keys, uint32_t part_count,
+				uint32_t count, struct tuple **result) const;
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
 				      enum dup_replace_mode mode);
@@ -33,6 +33,8 @@
 #include "memtx_index.h"
 #include "tuple.h"
 #include "say.h"
+#include "fiber.h"
+#include "scoped_guard.h"
 #include "schema.h"
 #include "user_def.h"
 #include "space.h"
@@ -86,13 +88,16 @@ MemtxIndex::count(enum iterator_type type, const char *key,
 	return count;
 }
 
-void
-index_build(MemtxIndex *index, MemtxIndex *pk)
+/**
+ * Fill an index being built with the tuples of another index,
+ * using the given iterator over it.
+ */
+static void
+index_build_fill(MemtxIndex *index, MemtxIndex *pk, struct iterator *it)
 {
 	uint32_t n_tuples = pk->size();
 	uint32_t estimated_tuples = n_tuples * 1.2;
 
-	index->beginBuild();
 	index->reserve(estimated_tuples);
 
 	if (n_tuples > 0) {
@@ -101,11 +106,124 @@ index_build(MemtxIndex *index, MemtxIndex *pk)
 			 index_name(index));
 	}
 
-	struct iterator *it = pk->position();
 	pk->initIterator(it, ITER_ALL, NULL, 0);
 	struct tuple *tuple;
 	while ((tuple = it->next(it)))
 		index->buildNext(tuple);
+}
 
+void
+index_build(MemtxIndex *index, MemtxIndex *pk)
+{
+	index->beginBuild();
+	index_build_fill(index, pk, pk->position());
 	index->endBuild();
 }
+
+struct index_build_worker {
+	struct cord cord;
+	MemtxIndex *index;
+	MemtxIndex *pk;
+	/** A private iterator, pk->position() is used by tx. */
+	struct iterator *it;
+	bool is_started;
+};
+
+static int
+index_build_worker_f(va_list ap)
+{
+	struct index_build_worker *worker =
+		va_arg(ap, struct index_build_worker *);
+	index_build_fill(worker->index, worker->pk, worker->it);
+	worker->index->prepareEndBuild();
+	return 0;
+}
+
+void
+index_build_parallel(MemtxIndex **indexes, uint32_t count, MemtxIndex *pk)
+{
+	if (count == 0)
+		return;
+	struct index_build_worker *workers = (struct index_build_worker *)
+		calloc(count, sizeof(*workers));
+	if (workers == NULL) {
+		tnt_raise(OutOfMemory, count * sizeof(*workers),
+			  "calloc", "index_build_worker");
+	}
+	auto workers_guard = make_scoped_guard([=] {
+		for (uint32_t i = 0; i < count; i++) {
+			if (workers[i].it != NULL)
+				workers[i].it->free(workers[i].it);
+		}
+		free(workers);
+	});
+
+	/* Start a worker for each index which supports it. */
+	for (uint32_t i = 0; i < count; i++) {
+		MemtxIndex *index = indexes[i];
+		if (!index->isParallelBuild())
+			continue;
+		struct index_build_worker *worker = &workers[i];
+		worker->index = index;
+		worker->pk = pk;
+		try {
+			worker->it = pk->allocIterator();
+		} catch (Exception *e) {
+			/* Build this index in tx. */
+			diag_clear(diag_get());
+			continue;
+		}
+		index->beginBuild();
+		if (cord_costart(&worker->cord, "index_build",
+				 index_build_worker_f, worker) != 0) {
+			/* Out of threads, build this index in tx. */
+			diag_clear(diag_get());
+			continue;
+		}
+		worker->is_started = true;
+	}
+	/*
+	 * Meanwhile build the rest in tx: they allocate
+	 * from the memtx arena, which has no locking. The
+	 * workers don't touch it.
+	 */
+	struct diag error;
+	diag_create(&error);
+	try {
+		for (uint32_t i = 0; i < count; i++) {
+			struct index_build_worker *worker = &workers[i];
+			if (worker->is_started)
+				continue;
+			if (worker->it == NULL) {
+				index_build(indexes[i], pk);
+				continue;
+			}
+			/* The worker failed to start, the build is begun. */
+			index_build_fill(indexes[i], pk, worker->it);
+			indexes[i]->endBuild();
+		}
+	} catch (Exception *e) {
+		diag_move(diag_get(), &error);
+	}
+	/*
+	 * Wait for all workers, even if something has failed:
+	 * they use the iterators and the indexes until they end.
+	 */
+	for (uint32_t i = 0; i < count; i++) {
+		if (!workers[i].is_started)
+			continue;
+		cord_cojoin(&workers[i].cord);
+		if (! diag_is_empty(diag_get()) && diag_is_empty(&error))
+			diag_move(diag_get(), &error);
+		diag_clear(diag_get());
+	}
+	if (! diag_is_empty(&error)) {
+		diag_move(&error, diag_get());
+		diag_raise();
+	}
+	/* Publish the sorted results, building the trees in tx. */
+	for (uint32_t i = 0; i < count; i++) {
+		if (workers[i].is_started)
+			indexes[i]->endBuild();
+	}
+}
@@ -64,7 +64,20 @@ public:
 	 */
 	virtual void reserve(uint32_t /* size_hint */);
 	virtual void buildNext(struct tuple *tuple);
+	/**
+	 * The part of endBuild() which can be done in a worker
+	 * thread, see isParallelBuild().
+	 */
+	virtual void prepareEndBuild() {}
 	virtual void endBuild();
+	/**
+	 * True if reserve(), buildNext() and prepareEndBuild()
+	 * don't use the memtx arena and thus may be called
+	 * in a separate thread, concurrently with builds of
+	 * other indexes. beginBuild() and endBuild() are
+	 * always called in the tx thread.
+	 */
+	virtual bool isParallelBuild() const { return false; }
 protected:
 	/*
 	 * Pre-allocated iterator to speed up the main case of
@@ -77,4 +90,13 @@ protected:
 void
 index_build(MemtxIndex *index, MemtxIndex *pk);
 
+/**
+ * Build a set of indexes based on the contents of another
+ * index. Indexes which support it are filled and sorted in
+ * worker threads, one thread per index, the rest are built
+ * in the calling fiber meanwhile.
+ */
+void
+index_build_parallel(MemtxIndex **indexes, uint32_t count, MemtxIndex *pk);
+
 #endif /* TARANTOOL_BOX_MEMTX_INDEX_H_INCLUDED */
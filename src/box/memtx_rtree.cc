@@ -144,10 +144,12 @@ MemtxRTree::~MemtxRTree()
 		m_position = NULL;
 	}
 	rtree_destroy(&m_tree);
+	free(m_build_array);
 }
 
 MemtxRTree::MemtxRTree(struct key_def *key_def)
-	: MemtxIndex(key_def)
+	: MemtxIndex(key_def), m_build_array(NULL), m_build_size(0),
+	  m_build_alloc_size(0)
 {
 	assert(key_def->part_count == 1);
 	assert(key_def->parts[0].type = ARRAY);
@@ -282,9 +284,58 @@ MemtxRTree::initIterator(struct iterator *iterator, enum iterator_type type,
 	rtree_search(&m_tree, &rect, op, &it->impl);
 }
 
+void
+MemtxRTree::limitIterator(struct iterator *iterator, uint32_t limit) const
+{
+	index_rtree_iterator *it = (index_rtree_iterator *)iterator;
+	rtree_iterator_set_limit(&it->impl, limit);
+}
+
 void
 MemtxRTree::beginBuild()
 {
 	rtree_purge(&m_tree);
 }
 
+void
+MemtxRTree::reserve(uint32_t size_hint)
+{
+	if (size_hint <= m_build_alloc_size)
+		return;
+	size_t item_size = rtree_build_item_size(&m_tree);
+	char *array = (char *) realloc(m_build_array, size_hint * item_size);
+	if (array == NULL) {
+		tnt_raise(OutOfMemory, size_hint * item_size, "realloc",
+			  "MemtxRTree build array");
+	}
+	m_build_array = array;
+	m_build_alloc_size = size_hint;
+}
+
+/**
+ * The tree is not touched until endBuild(): the tuples are
+ * collected and then loaded into the tree at once.
+ */
+void
+MemtxRTree::buildNext(struct tuple *tuple)
+{
+	if (m_build_size == m_build_alloc_size)
+		reserve(MAX(m_build_alloc_size + m_build_alloc_size / 2, 1024));
+	struct rtree_rect rect;
+	extract_rectangle(&rect, tuple, key_def);
+	size_t item_size = rtree_build_item_size(&m_tree);
+	rtree_build_item_set(&m_tree, m_build_array + m_build_size * item_size,
+			     &rect, tuple);
+	m_build_size++;
+}
+
+void
+MemtxRTree::endBuild()
+{
+	rtree_build(&m_tree, m_build_array, m_build_size);
+	free(m_build_array);
+	m_build_array = NULL;
+	m_build_size = 0;
+	m_build_alloc_size = 0;
+}
+
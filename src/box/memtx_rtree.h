@@ -41,6 +41,9 @@ public:
 	~MemtxRTree();
 
 	virtual void beginBuild();
+	virtual void reserve(uint32_t size_hint);
+	virtual void buildNext(struct tuple *tuple);
+	virtual void endBuild();
 	virtual size_t size() const;
 	virtual struct tuple *findByKey(const char *key, uint32_t part_count) const;
 	virtual struct tuple *replace(struct tuple *old_tuple,
@@ -52,10 +55,15 @@ public:
 	virtual void initIterator(struct iterator *iterator,
                                   enum iterator_type type,
                                   const char *key, uint32_t part_count) const;
+	virtual void limitIterator(struct iterator *iterator,
+				   uint32_t limit) const;
 
 protected:
 	unsigned m_dimension;
 	struct rtree m_tree;
+	/** Tuples and their rectangles collected by buildNext() */
+	char *m_build_array;
+	size_t m_build_size, m_build_alloc_size;
 };
 
 #endif /* TARANTOOL_BOX_MEMTX_RTREE_H_INCLUDED */
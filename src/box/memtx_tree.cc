@@ -43,27 +43,88 @@ struct key_data
 {
 	const char *key;
 	uint32_t part_count;
+	/** The hint of the key, see struct tree_data. */
+	uint64_t hint;
 };
 
+/**
+ * The hint of a key part: the number itself or the first 8
+ * bytes of a string, big-endian, so that hints compare the way
+ * the values do. Other types have no hint.
+ */
+static inline uint64_t
+tree_hint_field(const char *field, enum field_type type)
+{
+	switch (type) {
+	case NUM:
+		assert(mp_typeof(*field) == MP_UINT);
+		return mp_decode_uint(&field);
+	case STRING: {
+		assert(mp_typeof(*field) == MP_STR);
+		uint32_t len;
+		const char *str = mp_decode_str(&field, &len);
+		uint64_t hint = 0;
+		len = MIN(len, (uint32_t) sizeof(hint));
+		for (uint32_t i = 0; i < len; i++)
+			hint |= (uint64_t) (uint8_t) str[i] << (56 - 8 * i);
+		return hint;
+	}
+	default:
+		return 0;
+	}
+}
+
+static inline uint64_t
+tree_hint_tuple(const struct tuple *tuple, struct key_def *key_def)
+{
+	if (! key_def->opts.hint)
+		return 0;
+	const char *field = tuple_field(tuple, key_def->parts[0].fieldno);
+	return tree_hint_field(field, key_def->parts[0].type);
+}
+
+static inline uint64_t
+tree_hint_key(const char *key, uint32_t part_count, struct key_def *key_def)
+{
+	if (! key_def->opts.hint || part_count == 0)
+		return 0;
+	return tree_hint_field(key, key_def->parts[0].type);
+}
+
+static inline struct tree_data
+tree_data(struct tuple *tuple, struct key_def *key_def)
+{
+	struct tree_data data;
+	data.tuple = tuple;
+	data.hint = tree_hint_tuple(tuple, key_def);
+	return data;
+}
+
 int
-tree_index_compare(const tuple *a, const tuple *b, struct key_def *key_def)
+tree_index_compare(struct tree_data a, struct tree_data b,
+		   struct key_def *key_def)
 {
-	int r = tuple_compare(a, b, key_def);
+	if (a.hint != b.hint)
+		return a.hint < b.hint ? -1 : 1;
+	int r = tuple_compare(a.tuple, b.tuple, key_def);
 	if (r == 0 && !key_def->opts.is_unique)
-		r = a < b ? -1 : a > b;
+		r = a.tuple < b.tuple ? -1 : a.tuple > b.tuple;
 	return r;
 }
 int
-tree_index_compare_key(const tuple *a, const struct key_data *key_data,
+tree_index_compare_key(struct tree_data a, const struct key_data *key_data,
 		       struct key_def *key_def)
 {
-	return tuple_compare_with_key(a, key_data->key,
+	/* An empty key matches any tuple, whatever its hint. */
+	if (key_data->part_count > 0 && a.hint != key_data->hint)
+		return a.hint < key_data->hint ? -1 : 1;
+	return tuple_compare_with_key(a.tuple, key_data->key,
 				      key_data->part_count, key_def);
 }
 int tree_index_qcompare(const void* a, const void *b, void *c)
 {
-	return tree_index_compare(*(struct tuple **)a,
-		*(struct tuple **)b, (struct key_def *)c);
+	return tree_index_compare(*(struct tree_data *)a,
+		*(struct tree_data *)b, (struct key_def *)c);
 }
 
 /* {{{ MemtxTree Iterators ****************************************/
@@ -102,29 +163,32 @@ static struct tuple *
 tree_iterator_fwd(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
+	struct tree_data *res =
+		bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
 	if (!res)
 		return 0;
 	bps_tree_index_itr_next(it->tree, &it->bps_tree_iter);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
 tree_iterator_bwd(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
+	struct tree_data *res =
+		bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
 	if (!res)
 		return 0;
 	bps_tree_index_itr_prev(it->tree, &it->bps_tree_iter);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
 tree_iterator_fwd_check_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
+	struct tree_data *res =
+		bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
 	if (!res)
 		return 0;
 	if (tree_index_compare_key(*res, &it->key_data, it->key_def) != 0) {
@@ -132,19 +196,20 @@ tree_iterator_fwd_check_equality(struct iterator *iterator)
 		return 0;
 	}
 	bps_tree_index_itr_next(it->tree, &it->bps_tree_iter);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
 tree_iterator_fwd_check_next_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
+	struct tree_data *res =
+		bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
 	if (!res)
 		return 0;
 	bps_tree_index_itr_next(it->tree, &it->bps_tree_iter);
 	iterator->next = tree_iterator_fwd_check_equality;
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
@@ -160,7 +225,8 @@ static struct tuple *
 tree_iterator_bwd_check_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
+	struct tree_data *res =
+		bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
 	if (!res)
 		return 0;
 	if (tree_index_compare_key(*res, &it->key_data, it->key_def) != 0) {
@@ -168,7 +234,7 @@ tree_iterator_bwd_check_equality(struct iterator *iterator)
 		return 0;
 	}
 	bps_tree_index_itr_prev(it->tree, &it->bps_tree_iter);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
@@ -185,7 +251,7 @@ tree_iterator_bwd_skip_one_check_next_equality(struct iterator *iterator)
 
 MemtxTree::MemtxTree(struct key_def *key_def_arg)
 	: MemtxIndex(key_def_arg), build_array(0), build_array_size(0),
-	  build_array_alloc_size(0)
+	  build_array_alloc_size(0), build_array_is_sorted(false)
 {
 	memtx_index_arena_init();
 	bps_tree_index_create(&tree, key_def,
@@ -214,8 +280,45 @@ MemtxTree::bsize() const
 struct tuple *
 MemtxTree::random(uint32_t rnd) const
 {
-	struct tuple **res = bps_tree_index_random(&tree, rnd);
-	return res ? *res : 0;
+	struct tree_data *res = bps_tree_index_random(&tree, rnd);
+	return res ? res->tuple : 0;
+}
+
+size_t
+MemtxTree::count(enum iterator_type type, const char *key,
+		 uint32_t part_count) const
+{
+	if (type == ITER_ALL)
+		return size(); /* optimization */
+	if (part_count == 0 && type >= 0 && type <= ITER_GT)
+		return size();
+
+	/*
+	 * Subtract the offsets of the range bounds instead of
+	 * iterating over the range, see BPS_INNER_CHILD_COUNTS.
+	 */
+	struct key_data key_data;
+	key_data.key = key;
+	key_data.part_count = part_count;
+	key_data.hint = tree_hint_key(key, part_count, key_def);
+	switch (type) {
+	case ITER_EQ:
+	case ITER_REQ:
+		return bps_tree_index_upper_bound_offset(&tree, &key_data, 0) -
+		       bps_tree_index_lower_bound_offset(&tree, &key_data, 0);
+	case ITER_GE:
+		return size() -
+		       bps_tree_index_lower_bound_offset(&tree, &key_data, 0);
+	case ITER_GT:
+		return size() -
+		       bps_tree_index_upper_bound_offset(&tree, &key_data, 0);
+	case ITER_LT:
+		return bps_tree_index_lower_bound_offset(&tree, &key_data, 0);
+	case ITER_LE:
+		return bps_tree_index_upper_bound_offset(&tree, &key_data, 0);
+	default:
+		return MemtxIndex::count(type, key, part_count);
+	}
 }
 
 struct tuple *
@@ -226,8 +329,36 @@ MemtxTree::findByKey(const char *key, uint32_t part_count) const
 	struct key_data key_data;
 	key_data.key = key;
 	key_data.part_count = part_count;
-	struct tuple **res = bps_tree_index_find(&tree, &key_data);
-	return res ? *res : 0;
+	key_data.hint = tree_hint_key(key, part_count, key_def);
+	struct tree_data *res = bps_tree_index_find(&tree, &key_data);
+	return res ? res->tuple : 0;
+}
+
+void
+MemtxTree::findByKeys(const char **keys, uint32_t part_count,
+		      uint32_t count, struct tuple **result) const
+{
+	assert(key_def->opts.is_unique && part_count == key_def->part_count);
+
+	enum { BATCH = 64 };
+	struct key_data key_data[BATCH];
+	struct key_data *batch_keys[BATCH];
+	struct tree_data *res[BATCH];
+	for (uint32_t first = 0; first < count; first += BATCH) {
+		uint32_t n = MIN(count - first, (uint32_t) BATCH);
+		for (uint32_t i = 0; i < n; i++) {
+			const char *key = keys[first + i];
+			key_data[i].key = key;
+			key_data[i].part_count = part_count;
+			key_data[i].hint = tree_hint_key(key, part_count,
+							 key_def);
+			batch_keys[i] = &key_data[i];
+		}
+		bps_tree_index_find_batch(&tree, batch_keys, n, res);
+		for (uint32_t i = 0; i < n; i++)
+			result[first + i] = res[i] ? res[i]->tuple : NULL;
+	}
+	index_ref_found(result, count);
 }
 
 struct tuple *
@@ -237,22 +368,25 @@ MemtxTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 	uint32_t errcode;
 
 	if (new_tuple) {
-		struct tuple *dup_tuple = NULL;
+		struct tree_data new_data = tree_data(new_tuple, key_def);
+		struct tree_data dup_data;
+		dup_data.tuple = NULL;
 
 		/* Try to optimistically replace the new_tuple. */
 		int tree_res =
-		bps_tree_index_insert(&tree, new_tuple, &dup_tuple);
+		bps_tree_index_insert(&tree, new_data, &dup_data);
 		if (tree_res) {
 			tnt_raise(OutOfMemory, BPS_TREE_EXTENT_SIZE,
 				  "MemtxTree", "replace");
 		}
 
+		struct tuple *dup_tuple = dup_data.tuple;
 		errcode = replace_check_dup(old_tuple, dup_tuple, mode);
 
 		if (errcode) {
-			bps_tree_index_delete(&tree, new_tuple);
+			bps_tree_index_delete(&tree, new_data);
 			if (dup_tuple)
-				bps_tree_index_insert(&tree, dup_tuple, 0);
+				bps_tree_index_insert(&tree, dup_data, 0);
 			struct space *sp = space_cache_find(key_def->space_id);
 			tnt_raise(ClientError, errcode, index_name(this),
 				  space_name(sp));
@@ -261,7 +395,7 @@ MemtxTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 			return dup_tuple;
 	}
 	if (old_tuple) {
-		bps_tree_index_delete(&tree, old_tuple);
+		bps_tree_index_delete(&tree, tree_data(old_tuple, key_def));
 	}
 	return old_tuple;
 }
@@ -304,6 +438,7 @@ MemtxTree::initIterator(struct iterator *iterator, enum iterator_type type,
 	}
 	it->key_data.key = key;
 	it->key_data.part_count = part_count;
+	it->key_data.hint = tree_hint_key(key, part_count, key_def);
 
 	bool exact = false;
 	if (key == 0) {
@@ -352,6 +487,68 @@ MemtxTree::initIterator(struct iterator *iterator, enum iterator_type type,
 	}
 }
 
+/**
+ * Jump over the tuples to skip by their offsets in the tree
+ * instead of visiting them one by one. The state of the
+ * iterator is derived from its next() function: an equality
+ * iterator stops at the bound of the key.
+ */
+uint32_t
+MemtxTree::skipIterator(struct iterator *iterator, uint32_t count) const
+{
+	struct tree_iterator *it = tree_iterator(iterator);
+	if (count == 0 || matras_is_read_view_created(&it->bps_tree_iter.view))
+		return Index::skipIterator(iterator, count);
+
+	if (iterator->next == tree_iterator_fwd ||
+	    iterator->next == tree_iterator_fwd_check_equality ||
+	    iterator->next == tree_iterator_fwd_check_next_equality) {
+		size_t pos = bps_tree_index_itr_offset(it->tree,
+						       &it->bps_tree_iter);
+		size_t end = bps_tree_index_size(it->tree);
+		if (iterator->next != tree_iterator_fwd) {
+			end = bps_tree_index_upper_bound_offset(it->tree,
+								&it->key_data,
+								0);
+			iterator->next = tree_iterator_fwd_check_equality;
+		}
+		size_t skipped = pos < end ? MIN(end - pos, (size_t) count) : 0;
+		it->bps_tree_iter = bps_tree_index_itr_at(it->tree,
+							  pos + skipped);
+		return skipped;
+	}
+
+	bool is_skip_one = iterator->next == tree_iterator_bwd_skip_one ||
+		iterator->next == tree_iterator_bwd_skip_one_check_next_equality;
+	bool is_req = iterator->next == tree_iterator_bwd_check_equality ||
+		iterator->next == tree_iterator_bwd_skip_one_check_next_equality;
+	if (!is_skip_one && !is_req && iterator->next != tree_iterator_bwd)
+		return Index::skipIterator(iterator, count);
+
+	/* One past the offset of the next tuple to return. */
+	size_t end = bps_tree_index_itr_offset(it->tree, &it->bps_tree_iter);
+	if (!is_skip_one) {
+		if (bps_tree_index_itr_is_invalid(&it->bps_tree_iter))
+			end = 0;
+		else
+			end++;
+	}
+	size_t begin = 0;
+	if (is_req) {
+		begin = bps_tree_index_lower_bound_offset(it->tree,
+							  &it->key_data, 0);
+	}
+	size_t skipped = end > begin ? MIN(end - begin, (size_t) count) : 0;
+	end -= skipped;
+	if (end == 0)
+		it->bps_tree_iter = bps_tree_index_invalid_iterator();
+	else
+		it->bps_tree_iter = bps_tree_index_itr_at(it->tree, end - 1);
+	iterator->next = is_req ? tree_iterator_bwd_check_equality :
+				  tree_iterator_bwd;
+	return skipped;
+}
+
 void
 MemtxTree::beginBuild()
 {
@@ -363,8 +560,8 @@ MemtxTree::reserve(uint32_t size_hint)
 {
 	if (size_hint < build_array_alloc_size)
 		return;
-	build_array = (struct tuple**)
-		realloc(build_array, size_hint * sizeof(struct tuple *));
+	build_array = (struct tree_data *)
+		realloc(build_array, size_hint * sizeof(struct tree_data));
 	build_array_alloc_size = size_hint;
 }
 
@@ -372,32 +569,48 @@ void
 MemtxTree::buildNext(struct tuple *tuple)
 {
 	if (!build_array) {
-		build_array = (struct tuple**)malloc(BPS_TREE_EXTENT_SIZE);
+		build_array = (struct tree_data *)malloc(BPS_TREE_EXTENT_SIZE);
 		build_array_alloc_size =
-			BPS_TREE_EXTENT_SIZE / sizeof(struct tuple*);
+			BPS_TREE_EXTENT_SIZE / sizeof(struct tree_data);
 	}
 	assert(build_array_size <= build_array_alloc_size);
 	if (build_array_size == build_array_alloc_size) {
 		build_array_alloc_size = build_array_alloc_size +
 					 build_array_alloc_size / 2;
-		build_array = (struct tuple**)
+		build_array = (struct tree_data *)
 			realloc(build_array,
 				build_array_alloc_size *
-				sizeof(struct tuple *));
+				sizeof(struct tree_data));
 	}
-	build_array[build_array_size++] = tuple;
+	build_array[build_array_size++] = tree_data(tuple, key_def);
+}
+
+/**
+ * Sorting touches neither the tree nor the memtx arena, so
+ * it is done before the tree is built and can run in a worker
+ * thread. qsort_arg() is itself parallel when built with OpenMP.
+ */
+void
+MemtxTree::prepareEndBuild()
+{
+	if (build_array_is_sorted)
+		return;
+	qsort_arg(build_array, build_array_size, sizeof(struct tree_data),
+		  tree_index_qcompare, key_def);
+	build_array_is_sorted = true;
 }
 
 void
 MemtxTree::endBuild()
 {
-	qsort_arg(build_array, build_array_size, sizeof(struct tuple *), tree_index_qcompare, key_def);
+	prepareEndBuild();
 	bps_tree_index_build(&tree, build_array, build_array_size);
 
 	free(build_array);
 	build_array = 0;
 	build_array_size = 0;
 	build_array_alloc_size = 0;
+	build_array_is_sorted = false;
 }
 
 /**
@@ -37,20 +37,38 @@
 struct tuple;
 struct key_data;
 
+/**
+ * An element of a TREE: a tuple and a hint of its key, so that
+ * most comparisons don't have to look into the tuple.
+ */
+struct tree_data {
+	struct tuple *tuple;
+	/**
+	 * An order-preserving prefix of the first key part: if
+	 * hints differ, so do the keys, in the same order. 0 if
+	 * the index doesn't use hints, see key_opts::hint.
+	 */
+	uint64_t hint;
+};
+
 int
-tree_index_compare(const struct tuple *a, const struct tuple *b, struct key_def *key_def);
+tree_index_compare(struct tree_data a, struct tree_data b,
+		   struct key_def *key_def);
 
 int
-tree_index_compare_key(const tuple *a, const key_data *b, struct key_def *key_def);
+tree_index_compare_key(struct tree_data a, const key_data *b,
+		       struct key_def *key_def);
 
 #define BPS_TREE_NAME _index
 #define BPS_TREE_BLOCK_SIZE (512)
 #define BPS_TREE_EXTENT_SIZE MEMTX_EXTENT_SIZE
 #define BPS_TREE_COMPARE(a, b, arg) tree_index_compare(a, b, arg)
 #define BPS_TREE_COMPARE_KEY(a, b, arg) tree_index_compare_key(a, b, arg)
-#define bps_tree_elem_t struct tuple *
+#define BPS_TREE_IS_IDENTICAL(a, b) ((a).tuple == (b).tuple)
+#define bps_tree_elem_t struct tree_data
 #define bps_tree_key_t struct key_data *
 #define bps_tree_arg_t struct key_def *
+#define BPS_INNER_CHILD_COUNTS
 
 #include "salad/bps_tree.h"
 
@@ -62,11 +80,17 @@ public:
 	virtual void beginBuild();
 	virtual void reserve(uint32_t size_hint);
 	virtual void buildNext(struct tuple *tuple);
+	virtual void prepareEndBuild();
 	virtual void endBuild();
+	virtual bool isParallelBuild() const { return true; }
 	virtual size_t size() const;
 	virtual struct tuple *random(uint32_t rnd) const;
+	virtual size_t count(enum iterator_type type, const char *key,
+			     uint32_t part_count) const;
 	virtual struct tuple *findByKey(const char *key,
 					uint32_t part_count) const;
+	virtual void findByKeys(const char **keys, uint32_t part_count,
+				uint32_t count, struct tuple **result) const;
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
 				      enum dup_replace_mode mode);
@@ -76,6 +100,8 @@ public:
 	virtual void initIterator(struct iterator *iterator,
 				  enum iterator_type type,
 				  const char *key, uint32_t part_count) const;
+	virtual uint32_t skipIterator(struct iterator *iterator,
+				      uint32_t count) const;
 
 	/**
 	 * Create a read view for iterator so further index modifications
@@ -90,8 +116,10 @@ public:
 
 // protected:
 	struct bps_tree_index tree;
-	struct tuple **build_array;
+	struct tree_data *build_array;
 	size_t build_array_size, build_array_alloc_size;
+	/** True if build_array is sorted by prepareEndBuild(). */
+	bool build_array_is_sorted;
 };
 
 #endif /* TARANTOOL_BOX_TREE_INDEX_H_INCLUDED */
@@ -134,7 +134,8 @@ recovery_last_checkpoint(struct recovery *r)
  */
 struct recovery *
 recovery_new(const char *snap_dirname, const char *wal_dirname,
-	     apply_row_f apply_row, void *apply_row_param)
+	     apply_row_f apply_row, apply_request_f apply_request,
+	     void *apply_row_param)
 {
 	struct recovery *r = (struct recovery *)
 			calloc(1, sizeof(*r));
@@ -151,8 +152,12 @@ recovery_new(const char *snap_dirname, const char *wal_dirname,
 	recovery_update_mode(r, WAL_NONE);
 
 	r->apply_row = apply_row;
+	r->apply_request = apply_request;
 	r->apply_row_param = apply_row_param;
 	r->snap_io_rate_limit = UINT64_MAX;
+	r->snap_io_rate_burst = 1024 * 1024;
+	r->snap_index_image = false;
+	r->snap_delta_max = 0;
 
 	xdir_create(&r->snap_dir, snap_dirname, SNAP, &r->server_uuid);
 
@@ -191,6 +196,12 @@ recovery_update_io_rate_limit(struct recovery *r, double new_limit)
 		r->snap_io_rate_limit = UINT64_MAX;
 }
 
+void
+recovery_update_io_rate_burst(struct recovery *r, double new_burst)
+{
+	r->snap_io_rate_burst = new_burst * 1024 * 1024;
+}
+
 void
 recovery_setup_panic(struct recovery *r, bool on_snap_error,
 		     bool on_wal_error)
@@ -412,7 +423,8 @@ recover_current_wal:
 
 void
 recovery_finalize(struct recovery *r, enum wal_mode wal_mode,
-		  int64_t rows_per_wal)
+		  int64_t rows_per_wal, int64_t wal_max_size,
+		  int64_t wal_prealloc_size, bool wal_direct_io)
 {
 	recovery_stop_local(r);
 
@@ -433,10 +445,9 @@ recovery_finalize(struct recovery *r, enum wal_mode wal_mode,
 		vclock_inc(&r->vclock, r->server_id);
 	}
 	r->wal_mode = wal_mode;
-	if (r->wal_mode == WAL_FSYNC)
-		(void) strcat(r->wal_dir.open_wflags, "s");
 
-	wal_writer_start(r, rows_per_wal);
+	wal_writer_start(r, rows_per_wal, wal_max_size, wal_prealloc_size,
+			 wal_direct_io);
 }
 
 
@@ -47,6 +47,9 @@ extern struct recovery *recovery;
 struct xrow_header;
 typedef void (apply_row_f)(struct recovery *, void *,
 			   struct xrow_header *packet);
+struct request;
+typedef void (apply_request_f)(struct recovery *, void *,
+			       struct request *request);
 
 /** A "condition variable" that allows fibers to wait when a given
  * LSN makes it to disk.
@@ -73,8 +76,22 @@ struct recovery {
 	 * recovery and when reading rows from the master.
 	 */
 	apply_row_f *apply_row;
+	/**
+	 * Optional: apply a row with the request in its body
+	 * already decoded, used to recover from a snapshot.
+	 */
+	apply_request_f *apply_request;
 	void *apply_row_param;
 	uint64_t snap_io_rate_limit;
+	/** The number of bytes written in a burst, see snap_io_rate_limit. */
+	uint64_t snap_io_rate_burst;
+	/** Write secondary TREE index images to snapshots. */
+	bool snap_index_image;
+	/**
+	 * The maximal number of incremental snapshots after
+	 * a full one, 0 if all snapshots are full.
+	 */
+	uint32_t snap_delta_max;
 	enum wal_mode wal_mode;
 	struct tt_uuid server_uuid;
 	uint32_t server_id;
@@ -82,7 +99,8 @@ struct recovery {
 
 struct recovery *
 recovery_new(const char *snap_dirname, const char *wal_dirname,
-	     apply_row_f apply_row, void *apply_row_param);
+	     apply_row_f apply_row, apply_request_f apply_request,
+	     void *apply_row_param);
 
 void
 recovery_delete(struct recovery *r);
@@ -97,6 +115,9 @@ recovery_update_mode(struct recovery *r, enum wal_mode mode);
 void
 recovery_update_io_rate_limit(struct recovery *r, double new_limit);
 
+void
+recovery_update_io_rate_burst(struct recovery *r, double new_burst);
+
 void
 recovery_setup_panic(struct recovery *r, bool on_snap_error, bool on_wal_error);
 
@@ -122,7 +143,8 @@ recovery_stop_local(struct recovery *r);
 
 void
 recovery_finalize(struct recovery *r, enum wal_mode mode,
-		  int64_t rows_per_wal);
+		  int64_t rows_per_wal, int64_t wal_max_size,
+		  int64_t wal_prealloc_size, bool wal_direct_io);
 
 void
 recovery_fill_lsn(struct recovery *r, struct xrow_header *row);
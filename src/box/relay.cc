@@ -54,7 +54,7 @@ relay_create(struct relay *relay, int fd, uint64_t sync)
 {
 	memset(relay, 0, sizeof(*relay));
 	relay->r = recovery_new(cfg_gets("snap_dir"), cfg_gets("wal_dir"),
-			 relay_send_row, relay);
+			 relay_send_row, NULL, relay);
 	recovery_setup_panic(relay->r, cfg_geti("panic_on_snap_error"),
 			     cfg_geti("panic_on_wal_error"));
 
@@ -279,7 +279,8 @@ void
 relay_send_row(struct recovery *r, void *param, struct xrow_header *packet)
 {
 	struct relay *relay = (struct relay *) param;
-	assert(iproto_type_is_dml(packet->type));
+	assert(iproto_type_is_dml(packet->type) ||
+	       packet->type == IPROTO_INDEX_IMAGE);
 
 	/*
 	 * If packet->server_id == 0 this is a snapshot packet.
@@ -287,9 +288,11 @@ relay_send_row(struct recovery *r, void *param, struct xrow_header *packet)
 	 * Otherwise, we're feeding a WAL, thus responding to
 	 * SUBSCRIBE request. In that case, only send a row if
 	 * it is not from the same server (i.e. don't send
-	 * replica's own rows back).
+	 * replica's own rows back). Index images are local
+	 * to the snapshot, the replica builds its own indexes.
 	 */
-	if (packet->server_id == 0 || packet->server_id != r->server_id) {
+	if (packet->type != IPROTO_INDEX_IMAGE &&
+	    (packet->server_id == 0 || packet->server_id != r->server_id)) {
 		relay_send(relay, packet);
 		ERROR_INJECT(ERRINJ_RELAY,
 		{
@@ -193,12 +193,12 @@ request_rebind_to_primary_key(struct request *request, struct space *space,
 			      struct tuple *found_tuple)
 {
 	Index *primary = index_find(space, 0);
-	uint32_t key_len = found_tuple->bsize;
+	uint32_t key_len = tuple_bsize(found_tuple);
 	char *key = (char *) region_alloc_xc(&fiber()->gc, key_len);
 	const char *data = found_tuple->data;
 	key_len = key_create_from_tuple(primary->key_def, data,
 					key, key_len);
-	assert(key_len <= found_tuple->bsize);
+	assert(key_len <= tuple_bsize(found_tuple));
 	request->key = key;
 	request->key_end = key + key_len;
 	request->index_id = 0;
@@ -78,6 +78,7 @@ session_create(int fd)
 	session->id = sid_max();
 	session->fd =  fd;
 	session->sync = 0;
+	session->async_commit = false;
 	/* For on_connect triggers. */
 	credentials_init(&session->credentials, guest_user);
 	if (fd >= 0)
@@ -79,6 +79,11 @@ struct session {
 	struct credentials credentials;
 	/** Trigger for fiber on_stop to cleanup created on-demand session */
 	struct trigger fiber_on_stop;
+	/**
+	 * Don't wait for transactions of this session to get
+	 * written to the WAL, see box.session.async_commit().
+	 */
+	bool async_commit;
 };
 
 /**
@@ -0,0 +1,520 @@
+/*
+ * Copyright 2010-2015, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "snap_reader.h"
+
+#include "recovery.h"
+#include "xlog.h"
+#include "xrow.h"
+#include "request.h"
+#include "iproto_constants.h"
+#include "cbus.h"
+#include "fiber.h"
+#include "scoped_guard.h"
+#include <msgpuck.h>
+
+enum {
+	/** The maximal number of rows in a batch. */
+	SNAP_BATCH_ROWS = 1024,
+	/** The size of row bodies at which a batch is complete. */
+	SNAP_BATCH_SIZE = 1024 * 1024,
+	/** How many batches can be read ahead of the tx thread. */
+	SNAP_BATCH_COUNT = 4
+};
+
+/** A snapshot row and the request in its body. */
+struct snap_row {
+	struct xrow_header header;
+	struct request request;
+	/**
+	 * False if the request failed to decode. The row is
+	 * then applied with recovery->apply_row, to raise the
+	 * error in the tx thread.
+	 */
+	bool is_decoded;
+};
+
+/**
+ * A batch of rows read from the snapshot. Batches circulate
+ * between the reader and the tx threads.
+ */
+struct snap_batch: public cmsg {
+	int n_rows;
+	struct snap_row rows[SNAP_BATCH_ROWS];
+	/** Row bodies. */
+	char *buf;
+	size_t size;
+	size_t capacity;
+	/** True for the last batch sent by the reader. */
+	bool is_last;
+};
+
+struct snap_reader {
+	struct cord cord;
+	struct cbus bus;
+	/** Read batches, from the reader to tx. */
+	struct cpipe tx_pipe;
+	/** Free batches, from tx back to the reader. */
+	struct cpipe reader_pipe;
+	struct xlog *snap;
+	/** Rows to skip, see snap_filter. */
+	const struct snap_filter *filter;
+	/** The tx fiber waiting for a batch, if any. */
+	struct fiber *fiber;
+	/** Set by tx to stop the reader early. */
+	bool is_shutdown;
+	/** Set by tx when the last batch is applied. */
+	bool is_done;
+	/** True if the reader thread is running. */
+	bool is_started;
+	struct snap_batch *batches[SNAP_BATCH_COUNT];
+};
+
+static int
+snap_space_id_cmp(const void *a, const void *b)
+{
+	uint32_t id_a = *(const uint32_t *) a;
+	uint32_t id_b = *(const uint32_t *) b;
+	return id_a < id_b ? -1 : id_a > id_b;
+}
+
+bool
+snap_filter_skips(const struct snap_filter *filter,
+		  const struct xrow_header *row)
+{
+	if (filter == NULL || filter->space_count == 0 || row->bodycnt == 0)
+		return false;
+	/*
+	 * The space id goes first in the body of every row
+	 * written to a snapshot, see checkpoint_write_tuple()
+	 * and checkpoint_write_image().
+	 */
+	const char *data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	if (data == end || mp_typeof(*data) != MP_MAP ||
+	    mp_check_map(data, end) > 0 || mp_decode_map(&data) == 0)
+		return false;
+	if (data == end || mp_typeof(*data) != MP_UINT ||
+	    mp_check_uint(data, end) > 0 ||
+	    mp_decode_uint(&data) != IPROTO_SPACE_ID)
+		return false;
+	if (data == end || mp_typeof(*data) != MP_UINT ||
+	    mp_check_uint(data, end) > 0)
+		return false;
+	uint64_t space_id = mp_decode_uint(&data);
+	if (space_id > UINT32_MAX)
+		return false;
+	uint32_t key = space_id;
+	return bsearch(&key, filter->space_ids, filter->space_count,
+		       sizeof(uint32_t), snap_space_id_cmp) != NULL;
+}
+
+static struct snap_batch *
+snap_batch_new(void)
+{
+	struct snap_batch *batch = (struct snap_batch *)
+		calloc(1, sizeof(*batch));
+	if (batch == NULL) {
+		tnt_raise(OutOfMemory, sizeof(*batch), "malloc",
+			  "struct snap_batch");
+	}
+	return batch;
+}
+
+static void
+snap_batch_delete(struct snap_batch *batch)
+{
+	free(batch->buf);
+	free(batch);
+}
+
+/**
+ * Add a copy of the row to the batch. The body is stored as
+ * an offset in the buffer until the batch is complete, since
+ * the buffer may move.
+ */
+static void
+snap_batch_add(struct snap_batch *batch, struct xrow_header *row)
+{
+	assert(row->bodycnt == 1); /* always 1 for read */
+	size_t len = row->body[0].iov_len;
+	if (batch->size + len > batch->capacity) {
+		size_t capacity = MAX(batch->capacity * 2,
+				      (size_t) SNAP_BATCH_SIZE);
+		while (capacity < batch->size + len)
+			capacity *= 2;
+		char *buf = (char *) realloc(batch->buf, capacity);
+		if (buf == NULL) {
+			tnt_raise(OutOfMemory, capacity, "realloc",
+				  "snapshot batch");
+		}
+		batch->buf = buf;
+		batch->capacity = capacity;
+	}
+	memcpy(batch->buf + batch->size, row->body[0].iov_base, len);
+	struct snap_row *r = &batch->rows[batch->n_rows++];
+	r->header = *row;
+	r->header.body[0].iov_base = (void *) (uintptr_t) batch->size;
+	batch->size += len;
+}
+
+/**
+ * Make the bodies point into the buffer and decode
+ * the requests.
+ */
+static void
+snap_batch_finish(struct snap_batch *batch)
+{
+	for (int i = 0; i < batch->n_rows; i++) {
+		struct snap_row *r = &batch->rows[i];
+		struct iovec *body = &r->header.body[0];
+		body->iov_base = batch->buf + (uintptr_t) body->iov_base;
+		if (! iproto_type_is_dml(r->header.type)) {
+			r->is_decoded = false;
+			continue;
+		}
+		request_create(&r->request, r->header.type);
+		try {
+			request_decode(&r->request,
+				       (const char *) body->iov_base,
+				       body->iov_len);
+			r->request.header = &r->header;
+			r->is_decoded = true;
+		} catch (ClientError *e) {
+			diag_clear(diag_get());
+			r->is_decoded = false;
+		}
+	}
+}
+
+/** Pass a batch to the tx thread. */
+static void
+snap_reader_send(struct snap_reader *reader, struct snap_batch *batch)
+{
+	cbus_lock(&reader->bus);
+	stailq_add_tail_entry(&reader->tx_pipe.pipe, batch, fifo);
+	cbus_unlock(&reader->bus);
+	ev_async_send(reader->tx_pipe.consumer,
+		      &reader->tx_pipe.fetch_output);
+}
+
+/**
+ * Get a free batch, waiting for the tx thread to return one.
+ * @return NULL if the reader has been stopped.
+ */
+static struct snap_batch *
+snap_reader_get(struct snap_reader *reader)
+{
+	struct stailq *free_batches = &reader->reader_pipe.pipe;
+	struct snap_batch *batch = NULL;
+	cbus_lock(&reader->bus);
+	while (stailq_empty(free_batches) && ! reader->is_shutdown)
+		cbus_wait_signal(&reader->bus);
+	if (! reader->is_shutdown)
+		batch = stailq_shift_entry(free_batches, struct snap_batch,
+					   fifo);
+	cbus_unlock(&reader->bus);
+	if (batch != NULL) {
+		batch->n_rows = 0;
+		batch->size = 0;
+		batch->is_last = false;
+	}
+	return batch;
+}
+
+/** Reader thread main loop. */
+static int
+snap_reader_f(va_list ap)
+{
+	struct snap_reader *reader = va_arg(ap, struct snap_reader *);
+	struct xlog_cursor i;
+
+	cbus_join(&reader->bus, &reader->reader_pipe);
+	xlog_cursor_open(&i, reader->snap);
+
+	struct snap_batch *batch = snap_reader_get(reader);
+	try {
+		struct xrow_header row;
+		while (batch != NULL &&
+		       xlog_cursor_next_xc(&i, &row) == 0) {
+			if (snap_filter_skips(reader->filter, &row))
+				continue;
+			snap_batch_add(batch, &row);
+			if (batch->n_rows < SNAP_BATCH_ROWS &&
+			    batch->size < SNAP_BATCH_SIZE)
+				continue;
+			snap_batch_finish(batch);
+			snap_reader_send(reader, batch);
+			batch = snap_reader_get(reader);
+		}
+	} catch (Exception *e) {
+		/* Let tx know the reading is over. */
+		xlog_cursor_close(&i);
+		if (batch != NULL) {
+			batch->n_rows = 0;
+			batch->is_last = true;
+			snap_reader_send(reader, batch);
+		}
+		cbus_leave(&reader->bus);
+		throw;
+	}
+	/*
+	 * Errors of skipped rows are logged by the cursor,
+	 * don't pass them on to the tx thread.
+	 */
+	diag_clear(diag_get());
+	xlog_cursor_close(&i);
+	if (batch != NULL) {
+		snap_batch_finish(batch);
+		batch->is_last = true;
+		snap_reader_send(reader, batch);
+	}
+	cbus_leave(&reader->bus);
+	return 0;
+}
+
+static void
+snap_reader_fetch_output(ev_loop * /* loop */, ev_async *watcher,
+			 int /* event */)
+{
+	struct snap_reader *reader = (struct snap_reader *) watcher->data;
+	if (reader->fiber != NULL)
+		fiber_wakeup(reader->fiber);
+}
+
+/**
+ * Get the next read batch, if any.
+ * @return NULL if there is no batch ready yet.
+ */
+static struct snap_batch *
+snap_reader_pop(struct snap_reader *reader)
+{
+	struct cpipe *pipe = &reader->tx_pipe;
+	if (stailq_empty(&pipe->output)) {
+		cbus_lock(&reader->bus);
+		stailq_concat(&pipe->output, &pipe->pipe);
+		cbus_unlock(&reader->bus);
+		if (stailq_empty(&pipe->output))
+			return NULL;
+	}
+	return stailq_shift_entry(&pipe->output, struct snap_batch, fifo);
+}
+
+/** Give an applied batch back to the reader. */
+static void
+snap_reader_put(struct snap_reader *reader, struct snap_batch *batch)
+{
+	cbus_lock(&reader->bus);
+	stailq_add_tail_entry(&reader->reader_pipe.pipe, batch, fifo);
+	cbus_signal(&reader->bus);
+	cbus_unlock(&reader->bus);
+}
+
+/**
+ * Stop the reader thread. Its error, if any, is moved to the
+ * diagnostics area, unless there is an error already: the
+ * reader may be stopped while an exception is in flight.
+ */
+static void
+snap_reader_stop(struct snap_reader *reader)
+{
+	cbus_lock(&reader->bus);
+	reader->is_shutdown = true;
+	cbus_signal(&reader->bus);
+	cbus_unlock(&reader->bus);
+
+	struct diag diag;
+	diag_create(&diag);
+	diag_move(diag_get(), &diag);
+	if (cord_join(&reader->cord)) {
+		/* We can't recover from this in any reasonable way. */
+		panic_syserror("snapshot reader: thread join failed");
+	}
+	if (! diag_is_empty(&diag))
+		diag_move(&diag, diag_get());
+	diag_destroy(&diag);
+	cbus_leave(&reader->bus);
+}
+
+/**
+ * Apply a row. Rows of a snapshot are numbered in each file
+ * independently and all of them are applied, so, unlike
+ * recovery_apply_row(), there is no lsn check.
+ */
+static void
+snap_reader_apply(struct recovery *r, struct snap_row *row,
+		  apply_row_f apply_image, void *image_param)
+{
+	struct xrow_header *header = &row->header;
+	if (header->type == IPROTO_INDEX_IMAGE) {
+		if (apply_image != NULL)
+			apply_image(r, image_param, header);
+	} else if (row->is_decoded)
+		r->apply_request(r, r->apply_row_param, &row->request);
+	else
+		r->apply_row(r, r->apply_row_param, header);
+}
+
+/** Free the resources of a reader which is not running. */
+static void
+snap_reader_destroy(struct snap_reader *reader)
+{
+	assert(! reader->is_started);
+	for (int i = 0; i < SNAP_BATCH_COUNT; i++) {
+		if (reader->batches[i] != NULL)
+			snap_batch_delete(reader->batches[i]);
+	}
+	cbus_destroy(&reader->bus);
+}
+
+/** Start a reader thread for a snapshot file. */
+static void
+snap_reader_start(struct snap_reader *reader, struct xlog *snap,
+		  const struct snap_filter *filter)
+{
+	memset(reader, 0, sizeof(*reader));
+	reader->snap = snap;
+	reader->filter = filter;
+	cbus_create(&reader->bus);
+	auto reader_guard = make_scoped_guard([=]{
+		snap_reader_destroy(reader);
+	});
+	cpipe_create(&reader->tx_pipe);
+	cpipe_create(&reader->reader_pipe);
+	cpipe_set_fetch_cb(&reader->tx_pipe, snap_reader_fetch_output,
+			   reader);
+	for (int i = 0; i < SNAP_BATCH_COUNT; i++) {
+		reader->batches[i] = snap_batch_new();
+		stailq_add_tail_entry(&reader->reader_pipe.pipe,
+				      reader->batches[i], fifo);
+	}
+
+	if (cord_costart(&reader->cord, "snap_reader", snap_reader_f,
+			 reader)) {
+		tnt_raise(SystemError, "failed to start snapshot reader");
+	}
+	cbus_join(&reader->bus, &reader->tx_pipe);
+	reader->is_started = true;
+	reader_guard.is_active = false;
+}
+
+void
+snap_reader_recover(struct recovery *r, struct xlog **snaps, int count,
+		    apply_row_f apply_image, void *image_param,
+		    const struct snap_filter *filter)
+{
+	assert(r->apply_request != NULL);
+	assert(count > 0);
+
+	struct snap_reader *readers = (struct snap_reader *)
+		calloc(count, sizeof(*readers));
+	if (readers == NULL) {
+		tnt_raise(OutOfMemory, count * sizeof(*readers), "calloc",
+			  "struct snap_reader");
+	}
+	int n_started = 0;
+	/*
+	 * Stop the readers on error: the reader may be stopped
+	 * while an exception is in flight, see snap_reader_stop().
+	 */
+	auto readers_guard = make_scoped_guard([&]{
+		for (int i = 0; i < n_started; i++) {
+			if (readers[i].is_started) {
+				snap_reader_stop(&readers[i]);
+				readers[i].is_started = false;
+			}
+			snap_reader_destroy(&readers[i]);
+		}
+		free(readers);
+	});
+	for (; n_started < count; n_started++)
+		snap_reader_start(&readers[n_started], snaps[n_started],
+				  filter);
+
+	/*
+	 * Apply batches in the order they are read. A space
+	 * is never split between files, so batches of different
+	 * files can be applied in any order.
+	 */
+	int n_done = 0;
+	int next = 0;
+	while (n_done < count) {
+		struct snap_reader *reader = NULL;
+		struct snap_batch *batch = NULL;
+		for (int i = 0; i < count && batch == NULL; i++) {
+			reader = &readers[(next + i) % count];
+			if (! reader->is_done)
+				batch = snap_reader_pop(reader);
+		}
+		if (batch == NULL) {
+			for (int i = 0; i < count; i++)
+				readers[i].fiber = fiber();
+			fiber_yield();
+			for (int i = 0; i < count; i++)
+				readers[i].fiber = NULL;
+			continue;
+		}
+		/* Take turns, to keep all readers busy. */
+		next = (reader - readers + 1) % count;
+		for (int i = 0; i < batch->n_rows; i++) {
+			try {
+				snap_reader_apply(r, &batch->rows[i],
+						  apply_image, image_param);
+			} catch (ClientError *e) {
+				if (reader->snap->dir->panic_if_error)
+					throw;
+				say_error("can't apply row: ");
+				e->log();
+			}
+		}
+		if (batch->is_last) {
+			reader->is_done = true;
+			n_done++;
+		}
+		snap_reader_put(reader, batch);
+	}
+	/* Raise the first reader error, if any. */
+	diag_clear(diag_get());
+	for (int i = 0; i < count; i++) {
+		snap_reader_stop(&readers[i]);
+		readers[i].is_started = false;
+	}
+	diag_raise();
+	/*
+	 * We should never try to read snapshots with no EOF
+	 * marker, see recover_xlog().
+	 */
+	for (int i = 0; i < count; i++) {
+		struct xlog *snap = snaps[i];
+		if (snap->is_inprogress == false && snap->eof_read == false)
+			panic("snapshot `%s' has no EOF marker",
+			      snap->filename);
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef TARANTOOL_BOX_SNAP_READER_H_INCLUDED
+#define TARANTOOL_BOX_SNAP_READER_H_INCLUDED
+/*
+ * Copyright 2010-2015, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "recovery.h"
+
+struct xlog;
+
+/**
+ * Spaces whose rows are skipped when reading a file of an
+ * incremental snapshot: they are saved again in a newer file.
+ * See snap_delta_max.
+ */
+struct snap_filter {
+	/** Sorted space ids. */
+	const uint32_t *space_ids;
+	uint32_t space_count;
+};
+
+/**
+ * Check if a snapshot row, a tuple or an index image, belongs
+ * to a space of the filter. The filter may be NULL.
+ */
+bool
+snap_filter_skips(const struct snap_filter *filter,
+		  const struct xrow_header *row);
+
+/**
+ * Recover from a snapshot with separate reader threads, one
+ * per file. A thread reads the file, checks checksums and
+ * decodes rows and requests in their bodies, and passes ready
+ * batches of requests to the tx thread, which only applies them
+ * with recovery->apply_request. Read and apply overlap, so a
+ * restart takes about as long as the slower of the two.
+ *
+ * Several files are read at once and their rows are applied in
+ * no particular order, so they must not depend on each other,
+ * like parts of a multi-part snapshot.
+ *
+ * Index image rows (IPROTO_INDEX_IMAGE) are passed to
+ * apply_image instead, or skipped if it is NULL. Rows of the
+ * spaces of the filter, if it's set, are dropped by the readers.
+ *
+ * Throws an exception on error, like recover_xlog().
+ */
+void
+snap_reader_recover(struct recovery *r, struct xlog **snaps, int count,
+		    apply_row_f apply_image, void *image_param,
+		    const struct snap_filter *filter);
+
+#endif /* TARANTOOL_BOX_SNAP_READER_H_INCLUDED */
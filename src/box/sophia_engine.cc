@@ -279,7 +279,7 @@ SophiaSpace::executeUpdate(struct txn *txn, struct space *space,
 	space_check_update(space, old_tuple, new_tuple);
 
 	index->replace_or_insert(new_tuple->data,
-	                         new_tuple->data + new_tuple->bsize,
+	                         new_tuple->data + tuple_bsize(new_tuple),
 	                         DUP_REPLACE);
 	return NULL;
 }
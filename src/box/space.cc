@@ -116,7 +116,7 @@ space_new(struct space_def *def, struct rlist *key_list)
 	space->index_map = (Index **)((char *) space + sizeof(*space) +
 				      index_count * sizeof(Index *));
 	space->def = *def;
-	space->format = tuple_format_new(key_list);
+	space->format = tuple_format_new(key_list, def->opts.field_map_count);
 	space->has_unique_secondary_key = has_unique_secondary_key;
 	tuple_format_ref(space->format, 1);
 	space->index_id_max = index_id_max;
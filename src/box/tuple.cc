@@ -30,12 +30,15 @@
  */
 #include "tuple.h"
 
+#include <math.h>
+
 #include "small/small.h"
 #include "small/quota.h"
+#include "small/pmatomic.h"
 
 #include "fiber.h"
 
-uint32_t snapshot_version;
+uint16_t snapshot_version;
 
 struct quota memtx_quota;
 
@@ -68,7 +71,7 @@ void
 tuple_init_field_map(struct tuple_format *format, struct tuple *tuple,
 		     uint32_t *field_map)
 {
-	if (format->field_count == 0)
+	if (format->field_map_count == 0)
 		return; /* Nothing to initialize */
 
 	const char *pos = tuple->data;
@@ -81,13 +84,15 @@ tuple_init_field_map(struct tuple_format *format, struct tuple *tuple,
 			  (unsigned) format->field_count);
 
 	/* first field is simply accessible, so we do not store offset to it */
-	enum mp_type mp_type = mp_typeof(*pos);
-	key_mp_type_validate(format->fields[0].type, mp_type,
-			     ER_FIELD_TYPE, INDEX_OFFSET);
-	mp_next(&pos);
+	if (field_count > 0) {
+		enum mp_type mp_type = mp_typeof(*pos);
+		key_mp_type_validate(format->fields[0].type, mp_type,
+				     ER_FIELD_TYPE, INDEX_OFFSET);
+		mp_next(&pos);
+	}
 	/* other fields...*/
 	for (uint32_t i = 1; i < format->field_count; i++) {
-		mp_type = mp_typeof(*pos);
+		enum mp_type mp_type = mp_typeof(*pos);
 		key_mp_type_validate(format->fields[i].type, mp_type,
 				     ER_FIELD_TYPE, i + INDEX_OFFSET);
 		if (format->fields[i].offset_slot < 0)
@@ -95,6 +100,16 @@ tuple_init_field_map(struct tuple_format *format, struct tuple *tuple,
 				(uint32_t) (pos - tuple->data);
 		mp_next(&pos);
 	}
+	/* unindexed fields the space keeps offsets of, if any */
+	uint32_t i = MAX(format->field_count, 1u);
+	for (; i < MIN(format->field_map_count, field_count); i++) {
+		field_map[format->fields[i].offset_slot] =
+			(uint32_t) (pos - tuple->data);
+		mp_next(&pos);
+	}
+	/* 0 is not a valid offset: the tuple has no such field */
+	for (; i < format->field_map_count; i++)
+		field_map[format->fields[i].offset_slot] = 0;
 }
 
 
@@ -134,15 +149,113 @@ tuple_validate_raw(struct tuple_format *format, const char *data)
  * to the snapshot file).
  */
 
+/** A tuple deleted while the snapshot may still need it. */
+struct tuple_delayed {
+	struct tuple *tuple;
+	/** The size of the tuple, with its field map. */
+	uint32_t total;
+	/** See tuple_prefix_size(). */
+	uint32_t prefix_size;
+};
+
+enum {
+	/** Don't scan the delayed tuples more often. */
+	DELAYED_COLLECT_MIN = 1024
+};
+
+/**
+ * Tuples deleted during a snapshot, which the snapshot thread
+ * hasn't written yet. Freed as soon as it passes them, see
+ * tuple_snapshot_pass(), rather than at the end of the snapshot.
+ */
+static struct tuple_delayed *delayed_tuples;
+static uint32_t delayed_count;
+static uint32_t delayed_capacity;
+/** Look for tuples to free when delayed_count reaches it. */
+static uint32_t delayed_collect_count = DELAYED_COLLECT_MIN;
+
+/** The size of the tuples waiting for the snapshot. */
+size_t tuple_delayed_free_size;
+
+/**
+ * Free the delayed tuples the snapshot doesn't need any more,
+ * or all of them if it is over.
+ */
+static void
+tuple_delayed_collect(bool is_snapshot_over)
+{
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < delayed_count; i++) {
+		struct tuple_delayed *d = &delayed_tuples[i];
+		if (is_snapshot_over ||
+		    pm_atomic_load_explicit(&d->tuple->version,
+					    pm_memory_order_acquire) ==
+		    snapshot_version) {
+			smfree(&memtx_alloc, (char *) d->tuple -
+			       d->prefix_size, d->total);
+			tuple_delayed_free_size -= d->total;
+		} else {
+			delayed_tuples[count++] = *d;
+		}
+	}
+	delayed_count = count;
+	/* Amortize the scans over the deletions. */
+	delayed_collect_count = MAX(2 * count, (uint32_t) DELAYED_COLLECT_MIN);
+}
+
+static void
+tuple_delay_free(struct tuple *tuple, uint32_t total, uint32_t prefix_size)
+{
+	if (delayed_count == delayed_capacity) {
+		uint32_t capacity = MAX(delayed_capacity * 2,
+					(uint32_t) DELAYED_COLLECT_MIN);
+		struct tuple_delayed *buf = (struct tuple_delayed *)
+			realloc(delayed_tuples, capacity * sizeof(*buf));
+		/*
+		 * smfree_delayed() can't be a fallback: its free
+		 * list may overlap the version the snapshot thread
+		 * sets.
+		 */
+		if (buf == NULL)
+			panic("can't allocate %u delayed tuples", capacity);
+		delayed_tuples = buf;
+		delayed_capacity = capacity;
+	}
+	struct tuple_delayed *d = &delayed_tuples[delayed_count++];
+	d->tuple = tuple;
+	d->total = total;
+	d->prefix_size = prefix_size;
+	tuple_delayed_free_size += total;
+	if (delayed_count >= delayed_collect_count)
+		tuple_delayed_collect(false);
+}
+
+/**
+ * The size of what precedes a tuple in its memory block: the
+ * field map and the length of a big tuple.
+ */
+static inline uint32_t
+tuple_prefix_size(struct tuple_format *format, size_t bsize)
+{
+	return format->field_map_size +
+	       (bsize >= TUPLE_BSIZE_BIG ? sizeof(uint32_t) : 0);
+}
+
 /** Allocate a tuple */
 struct tuple *
 tuple_alloc(struct tuple_format *format, size_t size)
 {
-	size_t total = sizeof(struct tuple) + size + format->field_map_size;
+	uint32_t prefix_size = tuple_prefix_size(format, size);
+	size_t total = sizeof(struct tuple) + size + prefix_size;
 	ERROR_INJECT(ERRINJ_TUPLE_ALLOC,
 		     tnt_raise(OutOfMemory, (unsigned) total,
 			       "slab allocator", "tuple"));
 	char *ptr = (char *) smalloc(&memtx_alloc, total);
+	if (ptr == NULL && delayed_count > 0) {
+		/* The snapshot may have passed some deleted tuples. */
+		tuple_delayed_collect(false);
+		ptr = (char *) smalloc(&memtx_alloc, total);
+	}
 	/**
 	 * Use a nothrow version and throw an exception here,
 	 * to throw an instance of ClientError. Apart from being
@@ -160,11 +273,17 @@ tuple_alloc(struct tuple_format *format, size_t size)
 				  "slab allocator", "tuple");
 		}
 	}
-	struct tuple *tuple = (struct tuple *)(ptr + format->field_map_size);
+	struct tuple *tuple = (struct tuple *)(ptr + prefix_size);
 
 	tuple->refs = 0;
 	tuple->version = snapshot_version;
-	tuple->bsize = size;
+	if (size < TUPLE_BSIZE_BIG) {
+		tuple->small_bsize = size;
+	} else {
+		uint32_t bsize = size;
+		tuple->small_bsize = TUPLE_BSIZE_BIG;
+		memcpy(ptr, &bsize, sizeof(bsize));
+	}
 	tuple->format_id = tuple_format_id(format);
 	tuple_format_ref(format, 1);
 
@@ -182,13 +301,17 @@ tuple_delete(struct tuple *tuple)
 	say_debug("tuple_delete(%p)", tuple);
 	assert(tuple->refs == 0);
 	struct tuple_format *format = tuple_format(tuple);
-	size_t total = sizeof(struct tuple) + tuple->bsize + format->field_map_size;
-	char *ptr = (char *) tuple - format->field_map_size;
+	uint32_t bsize = tuple_bsize(tuple);
+	uint32_t prefix_size = tuple_prefix_size(format, bsize);
+	size_t total = sizeof(struct tuple) + bsize + prefix_size;
+	char *ptr = (char *) tuple - prefix_size;
 	tuple_format_ref(format, -1);
-	if (!memtx_alloc.is_delayed_free_mode || tuple->version == snapshot_version)
+	if (!memtx_alloc.is_delayed_free_mode ||
+	    pm_atomic_load_explicit(&tuple->version,
+				    pm_memory_order_acquire) == snapshot_version)
 		smfree(&memtx_alloc, ptr, total);
 	else
-		smfree_delayed(&memtx_alloc, ptr, total);
+		tuple_delay_free(tuple, total, prefix_size);
 }
 
 /**
@@ -209,7 +332,7 @@ tuple_seek(struct tuple_iterator *it, uint32_t i)
 		it->fieldno = i;
 		return tuple_next(it);
 	} else {
-		it->pos = it->tuple->data + it->tuple->bsize;
+		it->pos = it->tuple->data + tuple_bsize(it->tuple);
 		it->fieldno = tuple_field_count(it->tuple);
 		return NULL;
 	}
@@ -218,7 +341,7 @@ tuple_seek(struct tuple_iterator *it, uint32_t i)
 const char *
 tuple_next(struct tuple_iterator *it)
 {
-	const char *tuple_end = it->tuple->data + it->tuple->bsize;
+	const char *tuple_end = it->tuple->data + tuple_bsize(it->tuple);
 	if (it->pos < tuple_end) {
 		const char *field = it->pos;
 		mp_next(&it->pos);
@@ -354,7 +477,7 @@ tuple_update(struct tuple_format *format,
 	const char *new_data =
 		tuple_update_execute(f, alloc_ctx,
 				     expr, expr_end, old_tuple->data,
-				     old_tuple->data + old_tuple->bsize,
+				     old_tuple->data + tuple_bsize(old_tuple),
 				     &new_size, field_base);
 
 	return tuple_new(format, new_data, new_data + new_size);
@@ -370,7 +493,7 @@ tuple_upsert(struct tuple_format *format,
 	const char *new_data =
 		tuple_upsert_execute(region_alloc, alloc_ctx, expr, expr_end,
 				     old_tuple->data,
-				     old_tuple->data + old_tuple->bsize,
+				     old_tuple->data + tuple_bsize(old_tuple),
 				     &new_size, field_base);
 
 	return tuple_new(format, new_data, new_data + new_size);
@@ -402,6 +525,114 @@ tuple_new(struct tuple_format *format, const char *data, const char *end)
 inline __attribute__((always_inline)) int
 mp_compare_uint(const char **data_a, const char **data_b);
 
+/** Compare a double with an unsigned integer exactly. */
+static int
+mp_compare_double_uint(double a, uint64_t b)
+{
+	if (isnan(a) || a < 0)
+		return -1;
+	/* 2^64 */
+	if (a >= 18446744073709551616.0)
+		return 1;
+	/*
+	 * A double above 2^53 has no fraction and is converted
+	 * exactly, one below it has the integer part below 2^53,
+	 * which converts back to a double exactly.
+	 */
+	uint64_t i = (uint64_t) a;
+	if (i != b)
+		return i < b ? -1 : 1;
+	return a > (double) i;
+}
+
+/** Compare a double with a negative integer exactly. */
+static int
+mp_compare_double_neg_int(double a, int64_t b)
+{
+	assert(b < 0);
+	if (isnan(a))
+		return -1;
+	if (a >= 0)
+		return 1;
+	/* -2^63 */
+	if (a < -9223372036854775808.0)
+		return -1;
+	/* Truncated towards zero, see mp_compare_double_uint(). */
+	int64_t i = (int64_t) a;
+	if (i != b)
+		return i < b ? -1 : 1;
+	return a < (double) i ? -1 : 0;
+}
+
+static inline double
+mp_decode_double_any(const char *field)
+{
+	if (mp_typeof(*field) == MP_FLOAT)
+		return mp_decode_float(&field);
+	return mp_decode_double(&field);
+}
+
+/** Compare a double with an MP_UINT or MP_INT field exactly. */
+static int
+mp_compare_double_integer(double a, const char *field_b)
+{
+	if (mp_typeof(*field_b) == MP_UINT)
+		return mp_compare_double_uint(a, mp_decode_uint(&field_b));
+	int64_t b = mp_decode_int(&field_b);
+	if (b >= 0)
+		return mp_compare_double_uint(a, b);
+	return mp_compare_double_neg_int(a, b);
+}
+
+/*
+ * Integers are compared exactly, even if they don't fit in a
+ * double. NaN is equal to itself, so it can be a unique key.
+ */
+int
+mp_compare_number(const char *field_a, const char *field_b)
+{
+	enum mp_type type_a = mp_typeof(*field_a);
+	enum mp_type type_b = mp_typeof(*field_b);
+	if (type_a == MP_UINT && type_b == MP_UINT)
+		return mp_compare_uint(field_a, field_b);
+	bool is_double_a = type_a == MP_FLOAT || type_a == MP_DOUBLE;
+	bool is_double_b = type_b == MP_FLOAT || type_b == MP_DOUBLE;
+	if (!is_double_a && !is_double_b) {
+		/* MP_INT is compared as int64_t, MP_UINT as uint64_t. */
+		int64_t a, b;
+		if (type_a == MP_UINT) {
+			uint64_t u = mp_decode_uint(&field_a);
+			if (u > INT64_MAX)
+				return 1;
+			a = u;
+		} else {
+			a = mp_decode_int(&field_a);
+		}
+		if (type_b == MP_UINT) {
+			uint64_t u = mp_decode_uint(&field_b);
+			if (u > INT64_MAX)
+				return -1;
+			b = u;
+		} else {
+			b = mp_decode_int(&field_b);
+		}
+		return a < b ? -1 : a > b;
+	}
+	if (!is_double_b)
+		return mp_compare_double_integer(mp_decode_double_any(field_a),
+						 field_b);
+	if (!is_double_a)
+		return -mp_compare_double_integer(mp_decode_double_any(field_b),
+						  field_a);
+	double a = mp_decode_double_any(field_a);
+	double b = mp_decode_double_any(field_b);
+	if (isnan(a))
+		return isnan(b) ? 0 : -1;
+	if (isnan(b))
+		return 1;
+	return a < b ? -1 : a > b;
+}
+
 int
 tuple_compare_field(const char *field_a, const char *field_b,
 		    enum field_type type)
@@ -420,6 +651,8 @@ tuple_compare_field(const char *field_a, const char *field_b,
 			r = size_a < size_b ? -1 : size_a > size_b;
 		return r;
 	}
+	case NUMBER:
+		return mp_compare_number(field_a, field_b);
 	default:
 	{
 		assert(false);
@@ -553,16 +786,28 @@ tuple_free()
 	mempool_destroy(&tuple_iterator_pool);
 }
 
-void
+uint16_t
 tuple_begin_snapshot()
 {
 	snapshot_version++;
 	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, true);
+	return snapshot_version;
+}
+
+void
+tuple_snapshot_pass(struct tuple *tuple, uint16_t version)
+{
+	pm_atomic_store_explicit(&tuple->version, version,
+				 pm_memory_order_release);
 }
 
 void
 tuple_end_snapshot()
 {
+	tuple_delayed_collect(true);
+	free(delayed_tuples);
+	delayed_tuples = NULL;
+	delayed_capacity = 0;
 	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, false);
 }
 
@@ -635,7 +880,7 @@ size_t
 box_tuple_bsize(const box_tuple_t *tuple)
 {
 	assert(tuple != NULL);
-	return tuple->bsize;
+	return tuple_bsize(tuple);
 }
 
 ssize_t
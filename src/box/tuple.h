@@ -261,6 +261,20 @@ box_tuple_upsert(const box_tuple_t *tuple, const char *expr, const
 
 enum { TUPLE_REF_MAX = UINT16_MAX };
 
+enum {
+	/**
+	 * tuple::small_bsize of a tuple which is too big for it.
+	 * The size is stored in front of the field map then.
+	 */
+	TUPLE_BSIZE_BIG = UINT16_MAX,
+	/**
+	 * Versions wrap around, so a tuple which no snapshot has
+	 * passed for this many snapshots must be passed by a full
+	 * one, not to look like a new tuple to a later snapshot.
+	 */
+	TUPLE_VERSION_STALE = INT16_MAX
+};
+
 /** Common quota for tuples and indexes */
 extern struct quota memtx_quota;
 /** Tuple allocator */
@@ -270,23 +284,30 @@ extern struct slab_arena memtx_arena;
 
 /**
  * An atom of Tarantool storage. Represents MsgPack Array.
+ *
+ * The header is kept at 8 bytes, since most tuples are small:
+ * a tuple is preceded by its field map and, only if it is
+ * TUPLE_BSIZE_BIG or longer, by a 32-bit length.
  */
 struct tuple
 {
 	/*
-	 * sic: the header of the tuple is used
-	 * to store a free list pointer in smfree_delayed.
+	 * sic: the snapshot thread sets the version of
+	 * a tuple it has written, see tuple_snapshot_pass().
 	 * Please don't change it without understanding
-	 * how smfree_delayed and snapshotting COW works.
+	 * how tuple_delete() and snapshotting COW works.
 	 */
-	/** snapshot generation version */
-	uint32_t version;
+	/** snapshot generation version, see TUPLE_VERSION_STALE */
+	uint16_t version;
 	/** reference counter */
 	uint16_t refs;
 	/** format identifier */
 	uint16_t format_id;
-	/** length of the variable part of the tuple */
-	uint32_t bsize;
+	/**
+	 * length of the variable part of the tuple, or
+	 * TUPLE_BSIZE_BIG, use tuple_bsize()
+	 */
+	uint16_t small_bsize;
 	/**
 	 * Fields can have variable length, and thus are packed
 	 * into a contiguous byte array. Each field is prefixed
@@ -314,7 +335,7 @@ tuple_new(struct tuple_format *format, const char *data, const char *end);
  * After tuple_alloc and filling tuple data the tuple_init_field_map must be
  * called!
  *
- * @param size  tuple->bsize
+ * @param size  tuple_bsize()
  */
 struct tuple *
 tuple_alloc(struct tuple_format *format, size_t size);
@@ -413,6 +434,21 @@ tuple_format(const struct tuple *tuple)
 	return format;
 }
 
+/**
+ * @brief Return the length of the variable part of the tuple
+ */
+static inline uint32_t
+tuple_bsize(const struct tuple *tuple)
+{
+	if (likely(tuple->small_bsize != TUPLE_BSIZE_BIG))
+		return tuple->small_bsize;
+	uint32_t bsize;
+	memcpy(&bsize, (const char *) tuple -
+	       tuple_format(tuple)->field_map_size - sizeof(bsize),
+	       sizeof(bsize));
+	return bsize;
+}
+
 /**
  * @brief Return the number of fields in tuple
  * @param tuple
@@ -471,9 +507,15 @@ tuple_field_old(const struct tuple_format *format,
 			int32_t slot = format->fields[i].offset_slot;
 			return tuple->data + field_map[slot];
 		}
+	} else if (i < format->field_map_count &&
+		   format->fields[i].offset_slot != INT32_MAX) {
+		/* Unindexed field, the tuple may lack it */
+		uint32_t *field_map = (uint32_t *) tuple;
+		uint32_t offset = field_map[format->fields[i].offset_slot];
+		return offset != 0 ? tuple->data + offset : NULL;
 	}
 	ERROR_INJECT(ERRINJ_TUPLE_FIELD, return NULL);
-	return tuple_field_raw(tuple->data, tuple->bsize, i);
+	return tuple_field_raw(tuple->data, tuple_bsize(tuple), i);
 }
 
 /**
@@ -661,6 +703,13 @@ tuple_upsert(struct tuple_format *new_format,
 	     const struct tuple *old_tuple,
 	     const char *expr, const char *expr_end, int field_base);
 
+/**
+ * Compare two numbers of any MsgPack numeric type by value.
+ * NaN is less than any other number. Used for NUMBER key parts.
+ */
+int
+mp_compare_number(const char *field_a, const char *field_b);
+
 /**
  * @brief Compare two tuple fields using using field type definition
  * @param field_a field
@@ -730,6 +779,18 @@ tuple_compare(const struct tuple *tuple_a, const struct tuple *tuple_b,
 	return key_def->tuple_compare(tuple_a, tuple_b, key_def);
 }
 
+inline uint32_t
+tuple_hash(const struct tuple *tuple, const struct key_def *key_def)
+{
+	return key_def->tuple_hash(tuple, key_def);
+}
+
+inline uint32_t
+key_hash(const char *key, const struct key_def *key_def)
+{
+	return key_def->key_hash(key, key_def);
+}
+
 
 /** These functions are implemented in tuple_convert.cc. */
 
@@ -752,12 +813,28 @@ tuple_init(float alloc_arena_max_size, uint32_t slab_alloc_minimal,
 void
 tuple_free();
 
-void
+/**
+ * Start a snapshot: tuples created before it are freed only when
+ * the snapshot is done with them.
+ * @return the version of the snapshot
+ */
+uint16_t
 tuple_begin_snapshot();
 
+/**
+ * Tell that the snapshot has written the tuple and won't read it
+ * any more, so it can be freed as soon as it's deleted. Called
+ * from the snapshot thread.
+ */
+void
+tuple_snapshot_pass(struct tuple *tuple, uint16_t version);
+
 void
 tuple_end_snapshot();
 
+/** The size of the tuples deleted but kept for the snapshot. */
+extern size_t tuple_delayed_free_size;
+
 extern struct tuple *box_tuple_last;
 
 /**
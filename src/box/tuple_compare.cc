@@ -57,6 +57,13 @@ field_compare<STRING>(const char **field_a, const char **field_b)
 	return r;
 }
 
+template <>
+inline int
+field_compare<NUMBER>(const char **field_a, const char **field_b)
+{
+	return mp_compare_number(*field_a, *field_b);
+}
+
 template <int TYPE>
 static inline int
 field_compare_and_next(const char **field_a, const char **field_b);
@@ -86,6 +93,16 @@ field_compare_and_next<STRING>(const char **field_a, const char **field_b)
 	return r;
 }
 
+template <>
+inline int
+field_compare_and_next<NUMBER>(const char **field_a, const char **field_b)
+{
+	int r = mp_compare_number(*field_a, *field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
 /* Tuple comparator */
 namespace /* local symbols */ {
 
@@ -172,6 +189,122 @@ struct TupleCompare<0, TYPE, MORE_TYPES...> {
 					format_a, format_b, field_a, field_b);
 	}
 };
+
+/**
+ * Comparators for keys missing in cmp_arr[]: specialized by
+ * part types only, field numbers are taken from key_def.
+ */
+template <int TYPE, int ...MORE_TYPES>
+struct PartCompare
+{
+	inline static int compare(const struct tuple *tuple_a,
+				  const struct tuple *tuple_b,
+				  const struct tuple_format *format_a,
+				  const struct tuple_format *format_b,
+				  const struct key_part *part,
+				  const char *field_a,
+				  const char *field_b)
+	{
+		int r;
+		if (part[1].fieldno == part->fieldno + 1) {
+			if ((r = field_compare_and_next<TYPE>(&field_a,
+							      &field_b)) != 0)
+				return r;
+		} else {
+			if ((r = field_compare<TYPE>(&field_a, &field_b)) != 0)
+				return r;
+			field_a = tuple_field_old(format_a, tuple_a,
+						  part[1].fieldno);
+			field_b = tuple_field_old(format_b, tuple_b,
+						  part[1].fieldno);
+		}
+		return PartCompare<MORE_TYPES...>::
+			compare(tuple_a, tuple_b, format_a, format_b,
+				part + 1, field_a, field_b);
+	}
+};
+
+template <int TYPE>
+struct PartCompare<TYPE>
+{
+	inline static int compare(const struct tuple *,
+				  const struct tuple *,
+				  const struct tuple_format *,
+				  const struct tuple_format *,
+				  const struct key_part *,
+				  const char *field_a,
+				  const char *field_b)
+	{
+		return field_compare<TYPE>(&field_a, &field_b);
+	}
+};
+
+template <int ...TYPES>
+struct TuplePartCompare
+{
+	static int compare(const struct tuple *tuple_a,
+			   const struct tuple *tuple_b,
+			   const struct key_def *key_def)
+	{
+		struct tuple_format *format_a = tuple_format(tuple_a);
+		struct tuple_format *format_b = tuple_format(tuple_b);
+		const struct key_part *part = key_def->parts;
+		const char *field_a = tuple_field_old(format_a, tuple_a,
+						      part->fieldno);
+		const char *field_b = tuple_field_old(format_b, tuple_b,
+						      part->fieldno);
+		return PartCompare<TYPES...>::compare(tuple_a, tuple_b,
+					format_a, format_b, part,
+					field_a, field_b);
+	}
+};
+
+/**
+ * Find GEN<types of parts>::f for a key of up to LEFT more
+ * parts, or return NULL if the key is too long or has a part
+ * of a type with no comparator. TYPES are types of the parts
+ * seen so far.
+ */
+template <class F, template <int ...> class GEN, int LEFT, int ...TYPES>
+struct PartTypeSelector
+{
+	static F select(const struct key_part *part,
+			const struct key_part *end)
+	{
+		switch (part->type) {
+		case NUM:
+			return PartTypeSelector<F, GEN, LEFT - 1, TYPES..., NUM>::
+				next(part + 1, end);
+		case STRING:
+			return PartTypeSelector<F, GEN, LEFT - 1, TYPES..., STRING>::
+				next(part + 1, end);
+		case NUMBER:
+			return PartTypeSelector<F, GEN, LEFT - 1, TYPES..., NUMBER>::
+				next(part + 1, end);
+		default:
+			return NULL;
+		}
+	}
+
+	static F next(const struct key_part *part,
+		      const struct key_part *end)
+	{
+		if (part == end)
+			return GEN<TYPES...>::compare;
+		return select(part, end);
+	}
+};
+
+template <class F, template <int ...> class GEN, int ...TYPES>
+struct PartTypeSelector<F, GEN, 0, TYPES...>
+{
+	static F next(const struct key_part *part,
+		      const struct key_part *end)
+	{
+		return part == end ? GEN<TYPES...>::compare : NULL;
+	}
+};
+
 } /* end of anonymous namespace */
 
 struct comparator_signature {
@@ -214,7 +347,13 @@ tuple_compare_create(const struct key_def *def) {
 		if (i == def->part_count && cmp_arr[k].p[i * 2] == UINT32_MAX)
 			return cmp_arr[k].f;
 	}
-	return tuple_compare_default;
+	tuple_compare_t f = NULL;
+	if (def->part_count > 0) {
+		f = PartTypeSelector<tuple_compare_t, TuplePartCompare,
+				     TUPLE_COMPARE_PART_MAX>::
+			select(def->parts, def->parts + def->part_count);
+	}
+	return f != NULL ? f : tuple_compare_default;
 }
 
 /* }}} tuple_compare */
@@ -244,6 +383,13 @@ field_compare_with_key<STRING>(const char **field, const char **key)
 	return r;
 }
 
+template <>
+inline int
+field_compare_with_key<NUMBER>(const char **field, const char **key)
+{
+	return mp_compare_number(*field, *key);
+}
+
 template <int TYPE>
 static inline int
 field_compare_with_key_and_next(const char **field_a, const char **field_b);
@@ -274,6 +420,17 @@ field_compare_with_key_and_next<STRING>(const char **field_a,
 	return r;
 }
 
+template <>
+inline int
+field_compare_with_key_and_next<NUMBER>(const char **field_a,
+					const char **field_b)
+{
+	int r = mp_compare_number(*field_a, *field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
 /* Tuple with key comparator */
 namespace /* local symbols */ {
 
@@ -363,6 +520,67 @@ struct TupleCompareWithKey<0, 0, TYPE, MORE_TYPES...>
 	}
 };
 
+/**
+ * Key comparators for keys missing in cmp_wk_arr[], see
+ * PartCompare.
+ */
+template <int TYPE, int ...MORE_TYPES>
+struct PartCompareWithKey
+{
+	inline static int
+	compare(const struct tuple *tuple, const char *key,
+		uint32_t part_count, const struct tuple_format *format,
+		const struct key_part *part, const char *field)
+	{
+		int r;
+		if (part[1].fieldno == part->fieldno + 1) {
+			r = field_compare_with_key_and_next<TYPE>(&field, &key);
+			if (r || part_count == 1)
+				return r;
+		} else {
+			r = field_compare_with_key<TYPE>(&field, &key);
+			if (r || part_count == 1)
+				return r;
+			field = tuple_field_old(format, tuple, part[1].fieldno);
+			mp_next(&key);
+		}
+		return PartCompareWithKey<MORE_TYPES...>::
+			compare(tuple, key, part_count - 1, format,
+				part + 1, field);
+	}
+};
+
+template <int TYPE>
+struct PartCompareWithKey<TYPE>
+{
+	inline static int
+	compare(const struct tuple *, const char *key, uint32_t,
+		const struct tuple_format *, const struct key_part *,
+		const char *field)
+	{
+		return field_compare_with_key<TYPE>(&field, &key);
+	}
+};
+
+template <int ...TYPES>
+struct TuplePartCompareWithKey
+{
+	static int
+	compare(const struct tuple *tuple, const char *key,
+		uint32_t part_count, const struct key_def *key_def)
+	{
+		/* Part count can be 0 in wildcard searches. */
+		if (part_count == 0)
+			return 0;
+		struct tuple_format *format = tuple_format(tuple);
+		const struct key_part *part = key_def->parts;
+		const char *field = tuple_field_old(format, tuple,
+						    part->fieldno);
+		return PartCompareWithKey<TYPES...>::
+			compare(tuple, key, part_count, format, part, field);
+	}
+};
+
 } /* end of anonymous namespace */
 
 struct comparator_with_key_signature
@@ -411,7 +629,14 @@ tuple_compare_with_key_create(const struct key_def *def)
 		if (i == def->part_count)
 			return cmp_wk_arr[k].f;
 	}
-	return tuple_compare_with_key_default;
+	tuple_compare_with_key_t f = NULL;
+	if (def->part_count > 0) {
+		f = PartTypeSelector<tuple_compare_with_key_t,
+				     TuplePartCompareWithKey,
+				     TUPLE_COMPARE_PART_MAX>::
+			select(def->parts, def->parts + def->part_count);
+	}
+	return f != NULL ? f : tuple_compare_with_key_default;
 }
 
 /* }}} tuple_compare_with_key */
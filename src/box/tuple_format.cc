@@ -42,7 +42,7 @@ static void
 field_type_create(struct tuple_format *format, struct rlist *key_list)
 {
 	/* There may be fields between indexed fields (gaps). */
-	for (uint32_t i = 0; i < format->field_count; i++)
+	for (uint32_t i = 0; i < format->field_map_count; i++)
 		format->fields[i].type = UNKNOWN;
 
 	struct key_def *key_def;
@@ -109,7 +109,7 @@ tuple_format_deregister(struct tuple_format *format)
 }
 
 static struct tuple_format *
-tuple_format_alloc(struct rlist *key_list)
+tuple_format_alloc(struct rlist *key_list, uint32_t field_map_count)
 {
 	struct key_def *key_def;
 	uint32_t max_fieldno = 0;
@@ -124,9 +124,10 @@ tuple_format_alloc(struct rlist *key_list)
 			max_fieldno = MAX(max_fieldno, part->fieldno);
 	}
 	uint32_t field_count = key_count > 0 ? max_fieldno + 1 : 0;
+	field_map_count = MAX(field_map_count, field_count);
 
 	uint32_t total = sizeof(struct tuple_format) +
-			 field_count * sizeof(struct tuple_field_format);
+			 field_map_count * sizeof(struct tuple_field_format);
 
 	struct tuple_format *format = (struct tuple_format *) malloc(total);
 
@@ -137,6 +138,7 @@ tuple_format_alloc(struct rlist *key_list)
 	format->refs = 0;
 	format->id = FORMAT_ID_NIL;
 	format->field_count = field_count;
+	format->field_map_count = field_map_count;
 	return format;
 }
 
@@ -148,9 +150,10 @@ tuple_format_delete(struct tuple_format *format)
 }
 
 struct tuple_format *
-tuple_format_new(struct rlist *key_list)
+tuple_format_new(struct rlist *key_list, uint32_t field_map_count)
 {
-	struct tuple_format *format = tuple_format_alloc(key_list);
+	struct tuple_format *format = tuple_format_alloc(key_list,
+							 field_map_count);
 
 	try {
 		tuple_format_register(format);
@@ -161,7 +164,7 @@ tuple_format_new(struct rlist *key_list)
 	}
 
 	/* Set up offset slots */
-	if (format->field_count == 0) {
+	if (format->field_map_count == 0) {
 		/* Nothing to store */
 		format->field_map_size = 0;
 		return format;
@@ -173,12 +176,14 @@ tuple_format_new(struct rlist *key_list)
 	format->fields[0].offset_slot = INT32_MAX;
 
 	int current_slot = 0;
-	for (uint32_t i = 1; i < format->field_count; i++) {
+	for (uint32_t i = 1; i < format->field_map_count; i++) {
 		/*
 		 * In the tuple, store only offsets necessary to
-		 * quickly access indexed fields.
+		 * quickly access indexed fields, unless the space
+		 * asks for more.
 		 */
-		if (format->fields[i].type == UNKNOWN)
+		if (format->fields[i].type == UNKNOWN &&
+		    i >= field_map_count)
 			format->fields[i].offset_slot = INT32_MAX;
 		else
 			format->fields[i].offset_slot = --current_slot;
@@ -191,7 +196,7 @@ void
 tuple_format_init()
 {
 	RLIST_HEAD(empty_list);
-	tuple_format_ber = tuple_format_new(&empty_list);
+	tuple_format_ber = tuple_format_new(&empty_list, 0);
 	/* Make sure this one stays around. */
 	tuple_format_ref(tuple_format_ber, 1);
 }
@@ -66,7 +66,9 @@ struct tuple_field_format {
 	 * This member stores position in the field map of tuple
 	 * for current field.
 	 * If the field does not participate in indexes then it has
-	 * no offset in field map and INT_MAX is stored in this member.
+	 * no offset in field map and INT_MAX is stored in this member,
+	 * unless the space keeps offsets of unindexed fields too,
+	 * see space_opts::field_map_count.
 	 * Due to specific field map in tuple (it is stored before tuple),
 	 * the positions in field map is negative.
 	 * Thus if this member is negative, smth like
@@ -84,8 +86,17 @@ struct tuple_format {
 	uint16_t id;
 	/* Format objects are reference counted. */
 	int refs;
-	/* Length of 'fields' array. */
+	/**
+	 * The number of fields a tuple must have: indexed
+	 * fields and gaps between them.
+	 */
 	uint32_t field_count;
+	/**
+	 * Length of 'fields' array: field_count, or more if
+	 * the space keeps offsets of unindexed fields. A tuple
+	 * may lack fields past field_count, their offsets are 0.
+	 */
+	uint32_t field_map_count;
 	/**
 	 * Size of field map of tuple in bytes.
 	 * See tuple_field_format::ofset for details//
@@ -121,11 +132,13 @@ tuple_format_by_id(uint32_t tuple_format_id)
  * @brief Allocate, construct and register a new in-memory tuple
  *	 format.
  * @param space description
+ * @param field_map_count store offsets of this many first
+ *        fields in tuples, whether they are indexed or not
  *
  * @return tuple format or raise an exception on error
  */
 struct tuple_format *
-tuple_format_new(struct rlist *key_list);
+tuple_format_new(struct rlist *key_list, uint32_t field_map_count);
 
 /** Delete a format with zero ref count. */
 void
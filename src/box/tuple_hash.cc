@@ -0,0 +1,325 @@
+/*
+ * Copyright 2010-2015, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "tuple_hash.h"
+#include "tuple.h"
+#include "third_party/PMurHash.h"
+
+enum {
+	HASH_SEED = 13U
+};
+
+static inline uint32_t
+mh_hash_field(uint32_t *ph1, uint32_t *pcarry, const char **field,
+	      enum field_type type)
+{
+	const char *f = *field;
+	uint32_t size;
+
+	switch (type) {
+	case STRING:
+		/*
+		 * (!) MP_STR fields hashed **excluding** MsgPack format
+		 * indentifier. We have to do that to keep compatibility
+		 * with old third-party MsgPack (spec-old.md) implementations.
+		 * \sa https://github.com/tarantool/tarantool/issues/522
+		 */
+		f = mp_decode_str(field, &size);
+		break;
+	default:
+		mp_next(field);
+		size = *field - f;  /* calculate the size of field */
+		/*
+		 * (!) All other fields hashed **including** MsgPack format
+		 * identifier (e.g. 0xcc). This was done **intentionally**
+		 * for performance reasons. Please follow MsgPack specification
+		 * and pack all your numbers to the most compact representation.
+		 * If you still want to add support for broken MsgPack,
+		 * please don't forget to patch tuple_compare_field().
+		 */
+		break;
+	}
+	assert(size < INT32_MAX);
+	PMurHash32_Process(ph1, pcarry, f, size);
+	return size;
+}
+
+/** Fold a NUM value of a single-part key into 32 bits. */
+static inline uint32_t
+mh_hash_uint(uint64_t val)
+{
+	if (likely(val <= UINT32_MAX))
+		return val;
+	return ((uint32_t)((val)>>33^(val)^(val)<<11));
+}
+
+uint32_t
+tuple_hash_default(const struct tuple *tuple, const struct key_def *key_def)
+{
+	const struct key_part *part = key_def->parts;
+	/*
+	 * Speed up the simplest case when we have a
+	 * single-part hash_table over an integer field.
+	 */
+	if (key_def->part_count == 1 && part->type == NUM) {
+		const char *field = tuple_field(tuple, part->fieldno);
+		return mh_hash_uint(mp_decode_uint(&field));
+	}
+
+	uint32_t h = HASH_SEED;
+	uint32_t carry = 0;
+	uint32_t total_size = 0;
+
+	for ( ; part < key_def->parts + key_def->part_count; part++) {
+		const char *field = tuple_field(tuple, part->fieldno);
+		total_size += mh_hash_field(&h, &carry, &field, part->type);
+	}
+
+	return PMurHash32_Result(h, carry, total_size);
+}
+
+uint32_t
+key_hash_default(const char *key, const struct key_def *key_def)
+{
+	const struct key_part *part = key_def->parts;
+
+	if (key_def->part_count == 1 && part->type == NUM)
+		return mh_hash_uint(mp_decode_uint(&key));
+
+	uint32_t h = HASH_SEED;
+	uint32_t carry = 0;
+	uint32_t total_size = 0;
+
+	/* Hash fields part by part (see mh_hash_field() comments) */
+	for ( ; part < key_def->parts + key_def->part_count; part++)
+		total_size += mh_hash_field(&h, &carry, &key, part->type);
+
+	return PMurHash32_Result(h, carry, total_size);
+}
+
+/**
+ * Same as mh_hash_field(), with the field type known at
+ * compile time.
+ */
+template <int TYPE>
+static inline uint32_t
+field_hash(uint32_t *ph1, uint32_t *pcarry, const char **field);
+
+template <>
+inline uint32_t
+field_hash<NUM>(uint32_t *ph1, uint32_t *pcarry, const char **field)
+{
+	const char *f = *field;
+	mp_decode_uint(field);
+	uint32_t size = *field - f;
+	PMurHash32_Process(ph1, pcarry, f, size);
+	return size;
+}
+
+template <>
+inline uint32_t
+field_hash<STRING>(uint32_t *ph1, uint32_t *pcarry, const char **field)
+{
+	uint32_t size;
+	const char *f = mp_decode_str(field, &size);
+	assert(size < INT32_MAX);
+	PMurHash32_Process(ph1, pcarry, f, size);
+	return size;
+}
+
+namespace /* local symbols */ {
+
+template <int TYPE, int ...MORE_TYPES>
+struct PartHash
+{
+	inline static uint32_t
+	hash(uint32_t *ph1, uint32_t *pcarry, const struct tuple *tuple,
+	     const struct key_part *part, const char *field)
+	{
+		uint32_t size = field_hash<TYPE>(ph1, pcarry, &field);
+		if (part[1].fieldno != part->fieldno + 1)
+			field = tuple_field(tuple, part[1].fieldno);
+		return size + PartHash<MORE_TYPES...>::
+			hash(ph1, pcarry, tuple, part + 1, field);
+	}
+};
+
+template <int TYPE>
+struct PartHash<TYPE>
+{
+	inline static uint32_t
+	hash(uint32_t *ph1, uint32_t *pcarry, const struct tuple *,
+	     const struct key_part *, const char *field)
+	{
+		return field_hash<TYPE>(ph1, pcarry, &field);
+	}
+};
+
+template <int ...TYPES>
+struct TupleHash
+{
+	static uint32_t
+	hash(const struct tuple *tuple, const struct key_def *key_def)
+	{
+		uint32_t h = HASH_SEED;
+		uint32_t carry = 0;
+		const struct key_part *part = key_def->parts;
+		const char *field = tuple_field(tuple, part->fieldno);
+		uint32_t total_size = PartHash<TYPES...>::
+			hash(&h, &carry, tuple, part, field);
+		return PMurHash32_Result(h, carry, total_size);
+	}
+};
+
+template <>
+struct TupleHash<NUM>
+{
+	static uint32_t
+	hash(const struct tuple *tuple, const struct key_def *key_def)
+	{
+		const char *field = tuple_field(tuple,
+						key_def->parts[0].fieldno);
+		return mh_hash_uint(mp_decode_uint(&field));
+	}
+};
+
+template <int TYPE, int ...MORE_TYPES>
+struct PartKeyHash
+{
+	inline static uint32_t
+	hash(uint32_t *ph1, uint32_t *pcarry, const char *key)
+	{
+		uint32_t size = field_hash<TYPE>(ph1, pcarry, &key);
+		return size + PartKeyHash<MORE_TYPES...>::
+			hash(ph1, pcarry, key);
+	}
+};
+
+template <int TYPE>
+struct PartKeyHash<TYPE>
+{
+	inline static uint32_t
+	hash(uint32_t *ph1, uint32_t *pcarry, const char *key)
+	{
+		return field_hash<TYPE>(ph1, pcarry, &key);
+	}
+};
+
+template <int ...TYPES>
+struct KeyHash
+{
+	static uint32_t
+	hash(const char *key, const struct key_def *)
+	{
+		uint32_t h = HASH_SEED;
+		uint32_t carry = 0;
+		uint32_t total_size = PartKeyHash<TYPES...>::
+			hash(&h, &carry, key);
+		return PMurHash32_Result(h, carry, total_size);
+	}
+};
+
+template <>
+struct KeyHash<NUM>
+{
+	static uint32_t
+	hash(const char *key, const struct key_def *)
+	{
+		return mh_hash_uint(mp_decode_uint(&key));
+	}
+};
+
+/**
+ * Find GEN<types of parts>::hash for a key of up to LEFT more
+ * parts, or return NULL. NUMBER parts are not hashed by value,
+ * so they are left to the generic function.
+ */
+template <class F, template <int ...> class GEN, int LEFT, int ...TYPES>
+struct HashSelector
+{
+	static F select(const struct key_part *part,
+			const struct key_part *end)
+	{
+		switch (part->type) {
+		case NUM:
+			return HashSelector<F, GEN, LEFT - 1, TYPES..., NUM>::
+				next(part + 1, end);
+		case STRING:
+			return HashSelector<F, GEN, LEFT - 1, TYPES..., STRING>::
+				next(part + 1, end);
+		default:
+			return NULL;
+		}
+	}
+
+	static F next(const struct key_part *part,
+		      const struct key_part *end)
+	{
+		if (part == end)
+			return GEN<TYPES...>::hash;
+		return select(part, end);
+	}
+};
+
+template <class F, template <int ...> class GEN, int ...TYPES>
+struct HashSelector<F, GEN, 0, TYPES...>
+{
+	static F next(const struct key_part *part,
+		      const struct key_part *end)
+	{
+		return part == end ? GEN<TYPES...>::hash : NULL;
+	}
+};
+
+} /* end of anonymous namespace */
+
+tuple_hash_t
+tuple_hash_create(const struct key_def *def)
+{
+	tuple_hash_t f = NULL;
+	if (def->part_count > 0) {
+		f = HashSelector<tuple_hash_t, TupleHash,
+				 TUPLE_COMPARE_PART_MAX>::
+			select(def->parts, def->parts + def->part_count);
+	}
+	return f != NULL ? f : tuple_hash_default;
+}
+
+key_hash_t
+key_hash_create(const struct key_def *def)
+{
+	key_hash_t f = NULL;
+	if (def->part_count > 0) {
+		f = HashSelector<key_hash_t, KeyHash,
+				 TUPLE_COMPARE_PART_MAX>::
+			select(def->parts, def->parts + def->part_count);
+	}
+	return f != NULL ? f : key_hash_default;
+}
@@ -35,6 +35,7 @@
 #include "recovery.h"
 #include <fiber.h>
 #include "request.h" /* for request_name */
+#include "session.h"
 #include "xrow.h"
 
 double too_long_threshold;
@@ -98,6 +99,9 @@ txn_begin(bool is_autocommit)
 	txn->is_autocommit = is_autocommit;
 	txn->has_triggers  = false;
 	txn->in_stmt = false;
+	struct session *session = (struct session *)
+		fiber_get_key(fiber(), FIBER_KEY_SESSION);
+	txn->is_async = session != NULL && session->async_commit;
 	txn->engine = NULL;
 	txn->engine_tx = NULL;
 	/* fiber_on_yield/fiber_on_stop initialized by engine on demand */
@@ -208,7 +212,8 @@ txn_write_to_wal(struct txn *txn)
 	assert(req->n_rows == txn->n_rows);
 
 	ev_tstamp start = ev_now(loop()), stop;
-	int64_t res = wal_write(recovery, req);
+	int64_t res = txn->is_async ? wal_write_async(recovery, req) :
+		      wal_write(recovery, req);
 	stop = ev_now(loop());
 	if (stop - start > too_long_threshold)
 		say_warn("too long WAL write: %.3f sec", stop - start);
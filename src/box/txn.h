@@ -74,6 +74,11 @@ struct txn {
 	bool has_triggers;
 	/** A statement-level transaction is active. */
 	bool in_stmt;
+	/**
+	 * True if commit doesn't wait for the WAL write,
+	 * inherited from the session at transaction start.
+	 */
+	bool is_async;
 	/** Engine involved in multi-statement transaction. */
 	Engine *engine;
 	/** Engine-specific transaction data */
@@ -31,15 +31,71 @@
 #include "wal.h"
 
 #include "recovery.h"
+#include "box.h"
 
 #include "fiber.h"
 #include "fio.h"
+#include <fcntl.h>
 #include "errinj.h"
+#include "clock.h"
+#include "bit/bit.h"
 
 #include "xrow.h"
+#include "iproto_constants.h"
 
 const char *wal_mode_STRS[] = { "none", "write", "fsync", NULL };
 
+enum {
+	/** Alignment of direct I/O buffers, offsets and sizes. */
+	WAL_DIO_ALIGN = 4096,
+	/** Size of the direct I/O buffer. */
+	WAL_DIO_BUF_SIZE = 1024 * 1024
+};
+
+/**
+ * Direct (O_DIRECT) output of the current WAL. Writes must be
+ * aligned in memory, file offset and size, so rows are copied
+ * to an aligned buffer which is written out in whole blocks,
+ * the last one padded with zeros. The partially filled last
+ * block stays in the buffer and is written again, together
+ * with the rows of the next batch.
+ * Bytes of the buffer past 'used' are always zero.
+ */
+struct wal_dio {
+	char *buf;
+	/** Bytes of data in the buffer. */
+	size_t used;
+	/** File offset of the buffer start, block aligned. */
+	off_t offset;
+	/** End of the data successfully written to the file. */
+	off_t written;
+	/** True if the current WAL is opened with O_DIRECT. */
+	bool is_active;
+};
+
+/**
+ * The sync stage of the WAL writer in fsync mode. Instead of
+ * syncing every write, the WAL thread hands written requests
+ * over to this thread, which syncs the file and only then
+ * passes the requests on to the tx thread for commit. The next
+ * batch is written while the previous one is being synced, and
+ * all batches which pile up during a sync share the next one.
+ * The queue is FIFO, so commits are still acknowledged in LSN
+ * order.
+ */
+struct wal_syncer {
+	struct cord cord;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	/** Written requests waiting for a sync. */
+	struct stailq input;
+	/** The file the input requests are written to. */
+	int fd;
+	/** True while a sync of requests taken from input is in progress. */
+	bool is_busy;
+	bool is_shutdown;
+};
+
 /*
  * WAL writer - maintain a Write Ahead Log for every change
  * in the data state.
@@ -51,11 +107,41 @@ struct wal_writer
 	struct cpipe wal_pipe;
 	struct cbus tx_wal_bus;
 	int64_t rows_per_wal;
+	/** The size of a WAL file to rotate at, in bytes, 0 for none. */
+	int64_t max_size;
+	/** Bytes of rows written to the current WAL. */
+	int64_t current_wal_size;
+	/** Disk space to allocate for a new WAL file, 0 for none. */
+	int64_t prealloc_size;
+	/** Whether to write WAL files with O_DIRECT. */
+	bool direct_io;
+	/** Direct I/O state, used only by the WAL thread. */
+	struct wal_dio dio;
+	/** True if written requests are synced by the syncer. */
+	bool is_sync;
+	struct wal_syncer syncer;
+	/**
+	 * Group commit settings: how long to wait for more
+	 * requests before writing a batch and the batch size
+	 * which cuts the wait short. Protected by the bus mutex.
+	 */
+	double commit_delay;
+	int64_t commit_max_rows;
+	int64_t commit_max_bytes;
+	/** Statistics, protected by the bus mutex. */
+	struct wal_stat stat;
 	struct fio_batch *batch;
 	bool is_shutdown;
 	bool is_rollback;
 	ev_loop *txn_loop;
 	struct vclock vclock;
+	/**
+	 * The vclock of the requests acknowledged to the tx
+	 * thread, i.e. written (and synced in fsync mode),
+	 * and fibers waiting for it. Used only by tx.
+	 */
+	struct vclock durable_vclock;
+	struct rlist lsn_waiters;
 	pthread_mutex_t watchers_mutex;
 	struct rlist watchers;
 };
@@ -89,6 +175,43 @@ wal_flush_input(ev_loop * /* loop */, ev_async *watcher, int /* event */)
  * handling a pack of requests (look for ev_async_send()
  * call in the writer thread loop).
  */
+/** A fiber waiting in wal_wait_lsn(). */
+struct wal_lsn_waiter {
+	struct rlist link;
+	uint32_t server_id;
+	int64_t lsn;
+	struct fiber *fiber;
+};
+
+/**
+ * Complete a request queued by wal_write_async(): nobody
+ * waits for it, so just free it.
+ *
+ * A failed request is already committed in memory, while
+ * the cascading rollback undoes the synchronous transactions
+ * around it, so memory no longer matches the WAL and the
+ * replicas. Panic if panic_on_wal_error is set, otherwise
+ * stop accepting writes until the server is restarted and
+ * recovers a consistent state from the WAL.
+ */
+static void
+tx_complete_async(struct wal_request *req)
+{
+	if (req->res < 0) {
+		struct xrow_header *row = req->rows[req->n_rows - 1];
+		if (recovery->wal_dir.panic_if_error) {
+			panic("failed to write an asynchronously committed "
+			      "transaction to WAL, lsn %lld",
+			      (long long) row->lsn);
+		}
+		say_crit("failed to write an asynchronously committed "
+			 "transaction to WAL, lsn %lld is lost, switching "
+			 "to read-only mode", (long long) row->lsn);
+		box_set_ro(true);
+	}
+	free(req);
+}
+
 static void
 tx_schedule_queue(struct stailq *queue)
 {
@@ -97,8 +220,37 @@ tx_schedule_queue(struct stailq *queue)
 	 * destroys the list entry.
 	 */
 	struct wal_request *req, *tmp;
-	stailq_foreach_entry_safe(req, tmp, queue, fifo)
-		fiber_call(req->fiber);
+	stailq_foreach_entry_safe(req, tmp, queue, fifo) {
+		if (req->fiber != NULL)
+			fiber_call(req->fiber);
+		else
+			tx_complete_async(req);
+	}
+}
+
+/**
+ * Advance the durable vclock past the written requests and
+ * wake up fibers waiting for it.
+ * @pre the requests are not completed yet, their rows
+ *      are still alive.
+ */
+static void
+tx_follow_durable(struct wal_writer *writer, struct stailq *commit)
+{
+	if (stailq_empty(commit))
+		return;
+	struct wal_request *req;
+	stailq_foreach_entry(req, commit, fifo) {
+		struct xrow_header *row = req->rows[req->n_rows - 1];
+		vclock_follow(&writer->durable_vclock, row->server_id,
+			      row->lsn);
+	}
+	struct wal_lsn_waiter *waiter;
+	rlist_foreach_entry(waiter, &writer->lsn_waiters, link) {
+		if (vclock_get(&writer->durable_vclock,
+			       waiter->server_id) >= waiter->lsn)
+			fiber_wakeup(waiter->fiber);
+	}
 }
 
 static void
@@ -121,6 +273,7 @@ tx_fetch_output(ev_loop * /* loop */, ev_async *watcher, int /* event */)
 	if (is_rollback)
 		stailq_concat(&rollback, &writer->wal_pipe.input);
 
+	tx_follow_durable(writer, &commit);
 	tx_schedule_queue(&commit);
 	/*
 	 * Perform a cascading abort of all transactions which
@@ -140,7 +293,8 @@ tx_fetch_output(ev_loop * /* loop */, ev_async *watcher, int /* event */)
  */
 static void
 wal_writer_init(struct wal_writer *writer, struct vclock *vclock,
-		int64_t rows_per_wal)
+		int64_t rows_per_wal, int64_t max_size, int64_t prealloc_size,
+		bool direct_io)
 {
 	cbus_create(&writer->tx_wal_bus);
 
@@ -149,6 +303,30 @@ wal_writer_init(struct wal_writer *writer, struct vclock *vclock,
 	cpipe_set_fetch_cb(&writer->tx_pipe, tx_fetch_output, writer);
 
 	writer->rows_per_wal = rows_per_wal;
+	writer->max_size = max_size;
+	writer->current_wal_size = 0;
+	writer->prealloc_size = prealloc_size;
+#if !defined(O_DIRECT)
+	if (direct_io) {
+		say_warn("O_DIRECT is not supported, "
+			 "wal_direct_io is ignored");
+		direct_io = false;
+	}
+#endif
+	writer->direct_io = direct_io;
+	memset(&writer->dio, 0, sizeof(writer->dio));
+	writer->is_sync = false;
+	if (direct_io) {
+		void *buf;
+		if (posix_memalign(&buf, WAL_DIO_ALIGN, WAL_DIO_BUF_SIZE))
+			panic_syserror("posix_memalign");
+		memset(buf, 0, WAL_DIO_BUF_SIZE);
+		writer->dio.buf = (char *) buf;
+	}
+	writer->commit_delay = 0;
+	writer->commit_max_rows = INT64_MAX;
+	writer->commit_max_bytes = INT64_MAX;
+	memset(&writer->stat, 0, sizeof(writer->stat));
 
 	writer->batch = fio_batch_new();
 
@@ -158,6 +336,8 @@ wal_writer_init(struct wal_writer *writer, struct vclock *vclock,
 	/* Create and fill writer->cluster hash */
 	vclock_create(&writer->vclock);
 	vclock_copy(&writer->vclock, vclock);
+	vclock_copy(&writer->durable_vclock, vclock);
+	rlist_create(&writer->lsn_waiters);
 
 	tt_pthread_mutex_init(&writer->watchers_mutex, NULL);
 	rlist_create(&writer->watchers);
@@ -171,6 +351,7 @@ wal_writer_destroy(struct wal_writer *writer)
 	cpipe_destroy(&writer->wal_pipe);
 	cbus_destroy(&writer->tx_wal_bus);
 	fio_batch_delete(writer->batch);
+	free(writer->dio.buf);
 	tt_pthread_mutex_destroy(&writer->watchers_mutex);
 }
 
@@ -178,6 +359,127 @@ wal_writer_destroy(struct wal_writer *writer)
 static int
 wal_writer_f(va_list ap);
 
+/** WAL syncer thread routine. */
+static void *
+wal_syncer_f(void *arg);
+
+static int
+wal_syncer_start(struct wal_writer *writer)
+{
+	struct wal_syncer *syncer = &writer->syncer;
+	tt_pthread_mutex_init(&syncer->mutex, NULL);
+	tt_pthread_cond_init(&syncer->cond, NULL);
+	stailq_create(&syncer->input);
+	syncer->fd = -1;
+	syncer->is_busy = false;
+	syncer->is_shutdown = false;
+	if (cord_start(&syncer->cord, "wal_sync", wal_syncer_f, writer)) {
+		tt_pthread_cond_destroy(&syncer->cond);
+		tt_pthread_mutex_destroy(&syncer->mutex);
+		return -1;
+	}
+	writer->is_sync = true;
+	return 0;
+}
+
+static void
+wal_syncer_stop(struct wal_writer *writer)
+{
+	struct wal_syncer *syncer = &writer->syncer;
+	if (! writer->is_sync)
+		return;
+	tt_pthread_mutex_lock(&syncer->mutex);
+	syncer->is_shutdown = true;
+	tt_pthread_cond_signal(&syncer->cond);
+	tt_pthread_mutex_unlock(&syncer->mutex);
+	if (cord_join(&syncer->cord)) {
+		/* We can't recover from this in any reasonable way. */
+		panic_syserror("WAL syncer: thread join failed");
+	}
+	tt_pthread_cond_destroy(&syncer->cond);
+	tt_pthread_mutex_destroy(&syncer->mutex);
+	writer->is_sync = false;
+}
+
+/**
+ * Queue requests written to fd for a sync. Called by the WAL
+ * thread in place of passing them to the tx thread directly.
+ */
+static void
+wal_syncer_push(struct wal_writer *writer, struct stailq *commit, int fd)
+{
+	struct wal_syncer *syncer = &writer->syncer;
+	tt_pthread_mutex_lock(&syncer->mutex);
+	stailq_concat(&syncer->input, commit);
+	syncer->fd = fd;
+	tt_pthread_cond_signal(&syncer->cond);
+	tt_pthread_mutex_unlock(&syncer->mutex);
+}
+
+/**
+ * Wait until all queued requests are synced and passed on to
+ * the tx thread. The WAL thread must do this before it closes
+ * or truncates the file being synced, and before it reports a
+ * rollback, so that it never overtakes earlier commits.
+ */
+static void
+wal_syncer_drain(struct wal_writer *writer)
+{
+	struct wal_syncer *syncer = &writer->syncer;
+	if (! writer->is_sync)
+		return;
+	tt_pthread_mutex_lock(&syncer->mutex);
+	while (syncer->is_busy || ! stailq_empty(&syncer->input))
+		tt_pthread_cond_wait(&syncer->cond, &syncer->mutex);
+	tt_pthread_mutex_unlock(&syncer->mutex);
+}
+
+static void *
+wal_syncer_f(void *arg)
+{
+	struct wal_writer *writer = (struct wal_writer *) arg;
+	struct wal_syncer *syncer = &writer->syncer;
+	struct stailq commit;
+	stailq_create(&commit);
+
+	tt_pthread_mutex_lock(&syncer->mutex);
+	while (true) {
+		while (stailq_empty(&syncer->input) && ! syncer->is_shutdown)
+			tt_pthread_cond_wait(&syncer->cond, &syncer->mutex);
+		if (stailq_empty(&syncer->input))
+			break;
+		stailq_concat(&commit, &syncer->input);
+		int fd = syncer->fd;
+		syncer->is_busy = true;
+		tt_pthread_mutex_unlock(&syncer->mutex);
+
+		/*
+		 * The requests are already written, there is
+		 * no way to roll them back.
+		 */
+		double start = clock_monotonic();
+		if (fdatasync(fd) < 0)
+			panic_syserror("failed to sync xlog");
+		double sync_time = clock_monotonic() - start;
+
+		cbus_lock(&writer->tx_wal_bus);
+		writer->stat.sync_count++;
+		writer->stat.sync_time += sync_time;
+		writer->stat.sync_max = MAX(writer->stat.sync_max, sync_time);
+		stailq_concat(&writer->tx_pipe.pipe, &commit);
+		ev_async_send(writer->tx_pipe.consumer,
+			      &writer->tx_pipe.fetch_output);
+		cbus_unlock(&writer->tx_wal_bus);
+
+		tt_pthread_mutex_lock(&syncer->mutex);
+		syncer->is_busy = false;
+		/* Wake up wal_syncer_drain(), if any. */
+		tt_pthread_cond_signal(&syncer->cond);
+	}
+	tt_pthread_mutex_unlock(&syncer->mutex);
+	return NULL;
+}
+
 /**
  * Initialize WAL writer, start the thread.
  *
@@ -191,11 +493,13 @@ wal_writer_f(va_list ap);
  *         points to a newly created WAL writer.
  */
 int
-wal_writer_start(struct recovery *r, int64_t rows_per_wal)
+wal_writer_start(struct recovery *r, int64_t rows_per_wal,
+		 int64_t max_size, int64_t prealloc_size, bool direct_io)
 {
 	assert(r->writer == NULL);
 	assert(r->current_wal == NULL);
 	assert(rows_per_wal > 1);
+	assert(max_size >= 0);
 
 	static struct wal_writer wal_writer;
 
@@ -203,11 +507,18 @@ wal_writer_start(struct recovery *r, int64_t rows_per_wal)
 	r->writer = writer;
 
 	/* I. Initialize the state. */
-	wal_writer_init(writer, &r->vclock, rows_per_wal);
+	wal_writer_init(writer, &r->vclock, rows_per_wal, max_size,
+			prealloc_size, direct_io);
 
-	/* II. Start the thread. */
+	/* II. Start the threads. */
 
+	if (r->wal_mode == WAL_FSYNC && wal_syncer_start(writer)) {
+		wal_writer_destroy(writer);
+		r->writer = NULL;
+		return -1;
+	}
 	if (cord_costart(&writer->cord, "wal", wal_writer_f, r)) {
+		wal_syncer_stop(writer);
 		wal_writer_destroy(writer);
 		r->writer = NULL;
 		return -1;
@@ -227,6 +538,13 @@ wal_writer_stop(struct recovery *r)
 	/* Stop the worker thread. */
 
 	cbus_lock(&writer->tx_wal_bus);
+	/*
+	 * The event loop is stopped, so pass on the input which
+	 * is still waiting for wal_flush_input() for the worker
+	 * thread to write it before exit.
+	 */
+	stailq_concat(&writer->wal_pipe.pipe, &writer->wal_pipe.input);
+	writer->wal_pipe.n_input = 0;
 	writer->is_shutdown= true;
 	cbus_unlock(&writer->tx_wal_bus);
 	cbus_signal(&writer->tx_wal_bus);
@@ -234,6 +552,29 @@ wal_writer_stop(struct recovery *r)
 		/* We can't recover from this in any reasonable way. */
 		panic_syserror("WAL writer: thread join failed");
 	}
+	wal_syncer_stop(writer);
+	/*
+	 * Free the asynchronous requests, reporting the ones
+	 * which couldn't be written. It's too late to panic or
+	 * to switch to read-only mode, see tx_complete_async().
+	 * Fibers waiting for the rest are never woken up.
+	 */
+	struct stailq queue;
+	stailq_create(&queue);
+	stailq_concat(&queue, &writer->tx_pipe.pipe);
+	stailq_concat(&queue, &writer->wal_pipe.pipe);
+	struct wal_request *req, *tmp;
+	stailq_foreach_entry_safe(req, tmp, &queue, fifo) {
+		if (req->fiber != NULL)
+			continue;
+		if (req->res < 0) {
+			struct xrow_header *row = req->rows[req->n_rows - 1];
+			say_crit("failed to write an asynchronously "
+				 "committed transaction to WAL at shutdown, "
+				 "lsn %lld is lost", (long long) row->lsn);
+		}
+		free(req);
+	}
 
 	cbus_leave(&writer->tx_wal_bus);
 	wal_writer_destroy(writer);
@@ -241,6 +582,174 @@ wal_writer_stop(struct recovery *r)
 	r->writer = NULL;
 }
 
+/**
+ * Position the direct I/O buffer at the given end of the
+ * file data: read in the partially written block the end
+ * falls into, so that it's written again along with the
+ * next rows.
+ */
+static int
+wal_dio_load(struct wal_dio *dio, int fd, off_t end)
+{
+	memset(dio->buf, 0, dio->used);
+	dio->offset = end & ~((off_t) WAL_DIO_ALIGN - 1);
+	dio->used = end - dio->offset;
+	dio->written = end;
+	if (dio->used == 0)
+		return 0;
+	if (fio_pread(fd, dio->buf, WAL_DIO_ALIGN,
+		      dio->offset) < (ssize_t) dio->used)
+		return -1;
+	/* Drop whatever follows the end in this block. */
+	memset(dio->buf + dio->used, 0, WAL_DIO_ALIGN - dio->used);
+	return 0;
+}
+
+/**
+ * Write out the buffer in whole blocks. Full blocks are
+ * dropped from the buffer afterwards.
+ */
+static int
+wal_dio_flush(struct wal_dio *dio, int fd)
+{
+	size_t size = (dio->used + WAL_DIO_ALIGN - 1) &
+		~((size_t) WAL_DIO_ALIGN - 1);
+	if (size == 0)
+		return 0;
+	if (fio_pwrite(fd, dio->buf, size, dio->offset) != (ssize_t) size)
+		return -1;
+	size_t full = dio->used & ~((size_t) WAL_DIO_ALIGN - 1);
+	if (full > 0) {
+		size_t tail = dio->used - full;
+		memmove(dio->buf, dio->buf + full, tail);
+		memset(dio->buf + tail, 0, full);
+		dio->offset += full;
+		dio->used = tail;
+	}
+	return 0;
+}
+
+/**
+ * fio_batch_write() for a WAL opened with O_DIRECT: copy
+ * the batch to the aligned buffer and write it out.
+ * The batch is either written or failed as a whole.
+ */
+static ssize_t
+wal_dio_batch_write(struct wal_dio *dio, struct fio_batch *batch, int fd)
+{
+	for (int i = 0; i < batch->iovcnt; i++) {
+		const char *data = (const char *) batch->iov[i].iov_base;
+		size_t len = batch->iov[i].iov_len;
+		while (len > 0) {
+			if (dio->used == WAL_DIO_BUF_SIZE &&
+			    wal_dio_flush(dio, fd) != 0)
+				return -1;
+			size_t chunk = MIN(len, WAL_DIO_BUF_SIZE - dio->used);
+			memcpy(dio->buf + dio->used, data, chunk);
+			dio->used += chunk;
+			data += chunk;
+			len -= chunk;
+		}
+	}
+	if (wal_dio_flush(dio, fd) != 0)
+		return -1;
+	dio->written = dio->offset + dio->used;
+	ssize_t bytes = fio_batch_size(batch);
+	fio_batch_reset(batch);
+	return bytes;
+}
+
+/**
+ * Prepare a newly created WAL for writing: allocate disk
+ * space for it up front, so that appends don't have to
+ * update the file size, and turn on O_DIRECT. Neither is
+ * critical: on failure a message is logged and the file is
+ * written the usual way.
+ */
+static void
+wal_file_open(struct wal_writer *writer, struct xlog *wal)
+{
+	int fd = fileno(wal->f);
+	writer->current_wal_size = 0;
+	if (writer->prealloc_size > 0)
+		(void) fio_fallocate(fd, writer->prealloc_size);
+	writer->dio.is_active = false;
+#if defined(O_DIRECT)
+	if (! writer->direct_io)
+		return;
+	/* The file header has already been written by stdio. */
+	off_t end = fio_lseek(fd, 0, SEEK_CUR);
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (end < 0 || flags == -1 ||
+	    fcntl(fd, F_SETFL, flags | O_DIRECT) == -1) {
+		say_syserror("%s: failed to enable O_DIRECT", wal->filename);
+		return;
+	}
+	if (wal_dio_load(&writer->dio, fd, end) != 0) {
+		(void) fcntl(fd, F_SETFL, flags);
+		return;
+	}
+	writer->dio.is_active = true;
+#endif
+}
+
+/**
+ * Close a WAL opened by the writer: cut off the preallocated
+ * space past the last row and get back to buffered output,
+ * for xlog_close() to append the EOF marker.
+ */
+static void
+wal_file_close(struct wal_writer *writer, struct xlog *wal)
+{
+	int fd = fileno(wal->f);
+	off_t end;
+	if (writer->dio.is_active) {
+		end = writer->dio.written;
+#if defined(O_DIRECT)
+		int flags = fcntl(fd, F_GETFL, 0);
+		if (flags != -1)
+			(void) fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+#endif
+		(void) fio_lseek(fd, end, SEEK_SET);
+		writer->dio.is_active = false;
+	} else {
+		end = fio_lseek(fd, 0, SEEK_CUR);
+	}
+	if (end >= 0 && (writer->prealloc_size > 0 || writer->direct_io))
+		(void) fio_truncate(fd, end);
+	/*
+	 * We can not handle xlog_close() failure in any
+	 * reasonable way. A warning is written to the server
+	 * log file.
+	 */
+	xlog_close(wal);
+}
+
+/**
+ * Drop the last garbage_bytes of the current WAL after a
+ * failed write and continue writing from the new end.
+ */
+static void
+wal_file_rollback(struct wal_writer *writer, struct xlog *wal,
+		  off_t garbage_bytes)
+{
+	int fd = fileno(wal->f);
+	off_t good_offset;
+	if (writer->dio.is_active) {
+		good_offset = writer->dio.written - garbage_bytes;
+		if (wal_dio_load(&writer->dio, fd, good_offset) != 0)
+			panic_syserror("failed to rollback xlog");
+	} else {
+		good_offset = fio_lseek(fd, -garbage_bytes, SEEK_CUR);
+		if (good_offset < 0)
+			panic_syserror("failed to get xlog position");
+	}
+	if (ftruncate(fd, good_offset) != 0)
+		panic_syserror("failed to rollback xlog");
+	if (writer->prealloc_size > 0)
+		(void) fio_fallocate(fd, writer->prealloc_size);
+}
+
 /**
  * If there is no current WAL, try to open it, and close the
  * previous WAL. We close the previous WAL only after opening
@@ -259,7 +768,9 @@ wal_opt_rotate(struct xlog **wal, struct recovery *r,
 
 	ERROR_INJECT_RETURN(ERRINJ_WAL_ROTATE);
 
-	if (l != NULL && l->rows >= r->writer->rows_per_wal) {
+	if (l != NULL && (l->rows >= r->writer->rows_per_wal ||
+			  (r->writer->max_size > 0 &&
+			   r->writer->current_wal_size >= r->writer->max_size))) {
 		wal_to_close = l;
 		l = NULL;
 	}
@@ -271,17 +782,14 @@ wal_opt_rotate(struct xlog **wal, struct recovery *r,
 		 * one.
 		 */
 		if (wal_to_close) {
-			/*
-			 * We can not handle xlog_close()
-			 * failure in any reasonable way.
-			 * A warning is written to the server
-			 * log file.
-			 */
-			xlog_close(wal_to_close);
+			wal_syncer_drain(r->writer);
+			wal_file_close(r->writer, wal_to_close);
 			wal_to_close = NULL;
 		}
 		/* Open WAL with '.inprogress' suffix. */
 		l = xlog_create(&r->wal_dir, vclock);
+		if (l != NULL)
+			wal_file_open(r->writer, l);
 	}
 	assert(wal_to_close == NULL);
 	*wal = l;
@@ -293,12 +801,93 @@ wal_opt_rotate(struct xlog **wal, struct recovery *r,
  * error injection.
  */
 static inline ssize_t
-wal_fio_batch_write(struct fio_batch *batch, int fd)
+wal_fio_batch_write(struct wal_writer *writer, struct fio_batch *batch,
+		    int fd)
 {
 	ERROR_INJECT(ERRINJ_WAL_WRITE, return 0);
+	if (writer->dio.is_active)
+		return wal_dio_batch_write(&writer->dio, batch, fd);
 	return fio_batch_write(batch, fd);
 }
 
+void
+wal_writer_set_group_commit(struct recovery *r, double delay,
+			    int64_t max_rows, int64_t max_bytes)
+{
+	struct wal_writer *writer = r->writer;
+	if (writer == NULL)
+		return;
+	cbus_lock(&writer->tx_wal_bus);
+	writer->commit_delay = delay;
+	writer->commit_max_rows = max_rows;
+	writer->commit_max_bytes = max_bytes;
+	cbus_unlock(&writer->tx_wal_bus);
+}
+
+/**
+ * An estimate of how many bytes the request takes in the
+ * xlog, used to limit the size of a group commit.
+ */
+static inline int64_t
+wal_request_size(struct wal_request *req)
+{
+	int64_t size = 0;
+	for (int i = 0; i < req->n_rows; i++) {
+		struct xrow_header *row = req->rows[i];
+		size += XLOG_FIXHEADER_SIZE;
+		for (int j = 0; j < row->bodycnt; j++)
+			size += row->body[j].iov_len;
+	}
+	return size;
+}
+
+/**
+ * Group commit: keep collecting requests into the popped
+ * bulk until either the group commit delay expires or the
+ * bulk has grown over the configured row or byte limit.
+ * This trades some latency of a single commit for fewer
+ * write(2) and, in fsync mode, fewer sync calls when there
+ * are many concurrent transactions.
+ *
+ * @pre the bus is locked, the output queue is not empty.
+ */
+static void
+wal_writer_group(struct wal_writer *writer)
+{
+	struct stailq *output = &writer->wal_pipe.output;
+	struct wal_request *req;
+	int64_t rows = 0;
+	int64_t bytes = 0;
+	stailq_foreach_entry(req, output, fifo) {
+		rows += req->n_rows;
+		bytes += wal_request_size(req);
+	}
+	double start = clock_monotonic();
+	double deadline = clock_realtime() + writer->commit_delay;
+	struct timespec ts;
+	ts.tv_sec = (time_t) deadline;
+	ts.tv_nsec = (long) ((deadline - ts.tv_sec) * 1e9);
+
+	while (rows < writer->commit_max_rows &&
+	       bytes < writer->commit_max_bytes &&
+	       ! writer->is_shutdown) {
+		bool timed_out = cbus_timedwait_signal(&writer->tx_wal_bus,
+						       &ts);
+		/*
+		 * Empty the pipe on every wakeup, otherwise the
+		 * tx thread won't signal the bus on the next push.
+		 */
+		stailq_foreach_entry(req, &writer->wal_pipe.pipe, fifo) {
+			rows += req->n_rows;
+			bytes += wal_request_size(req);
+		}
+		stailq_concat(output, &writer->wal_pipe.pipe);
+		if (timed_out)
+			break;
+	}
+	writer->stat.wait_time += clock_monotonic() - start;
+}
+
 /**
  * Pop a bulk of requests to write to disk to process.
  * Block on the condition only if we have no other work to
@@ -307,22 +896,50 @@ wal_fio_batch_write(struct fio_batch *batch, int fd)
 void
 wal_writer_pop(struct wal_writer *writer)
 {
-	while (! writer->is_shutdown)
+	while (true)
 	{
 		if (! writer->is_rollback &&
 		    ! stailq_empty(&writer->wal_pipe.pipe)) {
 			stailq_concat(&writer->wal_pipe.output,
 				      &writer->wal_pipe.pipe);
+			if (writer->commit_delay > 0)
+				wal_writer_group(writer);
 			break;
 		}
+		if (writer->is_shutdown)
+			break;
 		cbus_wait_signal(&writer->tx_wal_bus);
 	}
 }
 
+/** What a single wal_write_to_disk() call did, for statistics. */
+struct wal_batch_stat {
+	/** Time spent in write calls, seconds. */
+	double write_time;
+	/** True if there were write calls. */
+	bool is_written;
+	/** True if a new WAL file was created for the batch. */
+	bool is_rotated;
+};
+
+/**
+ * Write a batch with error injection and time it.
+ */
+static inline ssize_t
+wal_batch_write_timed(struct wal_writer *writer, struct fio_batch *batch,
+		      int fd, struct wal_batch_stat *stat)
+{
+	double start = clock_monotonic();
+	ssize_t nwr = wal_fio_batch_write(writer, batch, fd);
+	stat->write_time += clock_monotonic() - start;
+	stat->is_written = true;
+	return nwr;
+}
+
 static void
 wal_write_to_disk(struct recovery *r, struct wal_writer *writer,
 		  struct stailq *input, struct stailq *commit,
-		  struct stailq *rollback)
+		  struct stailq *rollback, struct wal_batch_stat *stat)
 {
 	/*
 	 * Input queue can only be empty on wal writer shutdown.
@@ -332,10 +949,12 @@ wal_write_to_disk(struct recovery *r, struct wal_writer *writer,
 		return;
 
 	/* Xlog is only rotated between queue processing  */
+	struct xlog *prev_wal = r->current_wal;
 	if (wal_opt_rotate(&r->current_wal, r, &writer->vclock) != 0) {
 		stailq_concat(rollback, input);
 		return;
 	}
+	stat->is_rotated = r->current_wal != prev_wal;
 
 	/*
 	 * This code tries to write queued requests (=transactions) using as
@@ -388,8 +1007,8 @@ wal_write_to_disk(struct recovery *r, struct wal_writer *writer,
 				 * flush added statements and rotate batch.
 				 */
 				assert(fio_batch_size(batch) > 0);
-				ssize_t nwr = wal_fio_batch_write(batch,
-					fileno(wal->f));
+				ssize_t nwr = wal_batch_write_timed(writer,
+					batch, fileno(wal->f), stat);
 				if (nwr < 0)
 					goto done; /* to break outer loop */
 
@@ -409,7 +1028,8 @@ wal_write_to_disk(struct recovery *r, struct wal_writer *writer,
 	}
 	/* Flush remaining data in batch (if any) */
 	if (fio_batch_size(batch) > 0) {
-		ssize_t nwr = wal_fio_batch_write(batch, fileno(wal->f));
+		ssize_t nwr = wal_batch_write_timed(writer, batch,
+						    fileno(wal->f), stat);
 		if (nwr > 0) {
 			/* Update cached file offset */
 			written_bytes += nwr;
@@ -440,15 +1060,9 @@ done:
 			off_t garbage_bytes = written_bytes - req->start_offset;
 			assert(garbage_bytes >= 0);
 
-			/* Get absolute position */
-			off_t good_offset = fio_lseek(fileno(wal->f),
-				-garbage_bytes, SEEK_CUR);
-			if (good_offset < 0)
-				panic_syserror("failed to get xlog position");
-
 			/* Truncate xlog */
-			if (ftruncate(fileno(wal->f), good_offset) != 0)
-				panic_syserror("failed to rollback xlog");
+			wal_syncer_drain(writer);
+			wal_file_rollback(writer, wal, garbage_bytes);
 			written_bytes = req->start_offset;
 
 			/* Move tail to `rollback` queue. */
@@ -466,12 +1080,24 @@ done:
 		req->res = vclock_sum(&writer->vclock);
 	}
 
+	/* Update the file size for wal_opt_rotate() */
+	writer->current_wal_size += written_bytes;
+
 	fiber_gc();
 	/* Move all processed requests to `commit` queue */
 	stailq_concat(commit, input);
 	return;
 }
 
+/** The histogram bucket of a batch of the given size. */
+static inline int
+wal_stat_bucket(int64_t size)
+{
+	assert(size > 0);
+	int bucket = 63 - bit_clz_u64(size);
+	return MIN(bucket, WAL_STAT_HIST_SIZE - 1);
+}
+
 /** WAL writer thread main loop.  */
 static int
 wal_writer_f(va_list ap)
@@ -488,12 +1114,32 @@ wal_writer_f(va_list ap)
 	stailq_create(&rollback);
 
 	cbus_lock(&writer->tx_wal_bus);
-	while (! writer->is_shutdown) {
+	while (true) {
 		wal_writer_pop(writer);
+		/*
+		 * Requests queued before the shutdown are written,
+		 * unless they are to be rolled back: asynchronous
+		 * commits are acknowledged already.
+		 */
+		if (stailq_empty(&writer->wal_pipe.output))
+			break;
 		cbus_unlock(&writer->tx_wal_bus);
 
+		int64_t queue_len = 0;
+		struct wal_request *req;
+		stailq_foreach_entry(req, &writer->wal_pipe.output, fifo)
+			queue_len++;
+
+		struct wal_batch_stat batch_stat = { 0, false, false };
 		wal_write_to_disk(r, writer, &writer->wal_pipe.output,
-				  &commit, &rollback);
+				  &commit, &rollback, &batch_stat);
+
+		int64_t batch_rows = 0;
+		int64_t batch_bytes = 0;
+		stailq_foreach_entry(req, &commit, fifo) {
+			batch_rows += req->n_rows;
+			batch_bytes += req->end_offset - req->start_offset;
+		}
 
 		/* notify watchers */
 		tt_pthread_mutex_lock(&writer->watchers_mutex);
@@ -502,7 +1148,35 @@ wal_writer_f(va_list ap)
 		}
 		tt_pthread_mutex_unlock(&writer->watchers_mutex);
 
+		if (writer->is_sync) {
+			/* Commit after the sync. */
+			if (! stailq_empty(&commit))
+				wal_syncer_push(writer, &commit,
+						fileno(r->current_wal->f));
+			/* Rollback must not overtake earlier commits. */
+			if (! stailq_empty(&rollback))
+				wal_syncer_drain(writer);
+		}
+
 		cbus_lock(&writer->tx_wal_bus);
+		struct wal_stat *stat = &writer->stat;
+		if (batch_rows > 0) {
+			stat->batch_count++;
+			stat->rows += batch_rows;
+			stat->bytes += batch_bytes;
+			stat->batch_rows_hist[wal_stat_bucket(batch_rows)]++;
+			stat->batch_bytes_hist[wal_stat_bucket(batch_bytes)]++;
+		}
+		if (batch_stat.is_written) {
+			stat->write_count++;
+			stat->write_time += batch_stat.write_time;
+			stat->write_max = MAX(stat->write_max,
+					      batch_stat.write_time);
+		}
+		stat->requests += queue_len;
+		stat->queue_max = MAX(stat->queue_max, queue_len);
+		if (batch_stat.is_rotated)
+			stat->rotate_count++;
 		stailq_concat(&writer->tx_pipe.pipe, &commit);
 		if (! stailq_empty(&rollback)) {
 			/*
@@ -513,14 +1187,17 @@ wal_writer_f(va_list ap)
 			 */
 			writer->is_rollback = true;
 			stailq_concat(&rollback, &writer->wal_pipe.pipe);
+			stailq_foreach_entry(req, &rollback, fifo)
+				stat->rollback_count++;
 			stailq_concat(&writer->wal_pipe.pipe, &rollback);
 		}
 		ev_async_send(writer->tx_pipe.consumer,
 			      &writer->tx_pipe.fetch_output);
 	}
 	cbus_unlock(&writer->tx_wal_bus);
+	wal_syncer_drain(writer);
 	if (r->current_wal != NULL) {
-		xlog_close(r->current_wal);
+		wal_file_close(writer, r->current_wal);
 		r->current_wal = NULL;
 	}
 	cbus_leave(&writer->tx_wal_bus);
@@ -559,6 +1236,100 @@ wal_write(struct recovery *r, struct wal_request *req)
 	return req->res;
 }
 
+int64_t
+wal_write_async(struct recovery *r, struct wal_request *req)
+{
+	if (r->wal_mode == WAL_NONE)
+		return vclock_sum(&r->vclock);
+
+	ERROR_INJECT_RETURN(ERRINJ_WAL_IO);
+
+	/*
+	 * The request and its rows live in the fiber's region,
+	 * which is gone by the time the request is written.
+	 * Copy all of it to a single block, squashing the body
+	 * of each row into one piece.
+	 */
+	size_t size = sizeof(*req) + req->n_rows *
+		(sizeof(req->rows[0]) + sizeof(struct xrow_header));
+	for (int i = 0; i < req->n_rows; i++) {
+		struct xrow_header *row = req->rows[i];
+		for (int j = 0; j < row->bodycnt; j++)
+			size += row->body[j].iov_len;
+	}
+	struct wal_request *copy = (struct wal_request *) malloc(size);
+	if (copy == NULL)
+		tnt_raise(OutOfMemory, size, "malloc", "struct wal_request");
+	copy->fiber = NULL;
+	copy->res = -1;
+	copy->n_rows = req->n_rows;
+	struct xrow_header *rows = (struct xrow_header *)
+		(copy->rows + req->n_rows);
+	char *data = (char *) (rows + req->n_rows);
+	for (int i = 0; i < req->n_rows; i++) {
+		struct xrow_header *row = &rows[i];
+		*row = *req->rows[i];
+		char *body = data;
+		for (int j = 0; j < row->bodycnt; j++) {
+			memcpy(data, row->body[j].iov_base,
+			       row->body[j].iov_len);
+			data += row->body[j].iov_len;
+		}
+		if (row->bodycnt > 0) {
+			row->bodycnt = 1;
+			row->body[0].iov_base = body;
+			row->body[0].iov_len = data - body;
+		}
+		copy->rows[i] = row;
+	}
+	cpipe_push(&r->writer->wal_pipe, copy);
+	return vclock_sum(&r->vclock);
+}
+
+int64_t
+wal_durable_lsn(struct recovery *r)
+{
+	if (r == NULL || r->writer == NULL)
+		return -1;
+	return vclock_get(&r->writer->durable_vclock, r->server_id);
+}
+
+int
+wal_wait_lsn(struct recovery *r, int64_t lsn, double timeout)
+{
+	/* Nothing is going to be written in "none" mode. */
+	if (r->writer == NULL || r->wal_mode == WAL_NONE)
+		return 0;
+
+	struct wal_lsn_waiter waiter;
+	waiter.server_id = r->server_id;
+	waiter.lsn = lsn;
+	waiter.fiber = fiber();
+	rlist_add_tail_entry(&r->writer->lsn_waiters, &waiter, link);
+	ev_tstamp deadline = ev_now(loop()) + timeout;
+	while (wal_durable_lsn(r) < lsn && ! fiber_is_cancelled()) {
+		ev_tstamp now = ev_now(loop());
+		if (now >= deadline)
+			break;
+		fiber_yield_timeout(deadline - now);
+	}
+	rlist_del_entry(&waiter, link);
+	return wal_durable_lsn(r) >= lsn ? 0 : -1;
+}
+
+int
+wal_writer_stat(struct recovery *r, struct wal_stat *stat)
+{
+	if (r == NULL || r->writer == NULL)
+		return -1;
+
+	struct wal_writer *writer = r->writer;
+	cbus_lock(&writer->tx_wal_bus);
+	*stat = writer->stat;
+	cbus_unlock(&writer->tx_wal_bus);
+	return 0;
+}
+
 int
 wal_register_watcher(
 	struct recovery *recovery,
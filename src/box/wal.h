@@ -43,6 +43,79 @@ enum wal_mode { WAL_NONE = 0, WAL_WRITE, WAL_FSYNC, WAL_MODE_MAX };
 extern const char *wal_mode_STRS[];
 
 #if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+enum {
+	/**
+	 * Number of buckets in a WAL batch size histogram.
+	 * Bucket i counts batches of [2^i, 2^(i+1)) rows or bytes,
+	 * the last one also counts all larger batches.
+	 */
+	WAL_STAT_HIST_SIZE = 32
+};
+
+/** WAL writer statistics, see box.info.wal. */
+struct wal_stat {
+	/** How many batches have been written to disk. */
+	int64_t batch_count;
+	/** Total number of rows in all written batches. */
+	int64_t rows;
+	/** Total number of bytes in all written batches. */
+	int64_t bytes;
+	/** Total time spent waiting for a group commit, seconds. */
+	double wait_time;
+	/** Batch size histograms, in rows and in bytes. */
+	int64_t batch_rows_hist[WAL_STAT_HIST_SIZE];
+	int64_t batch_bytes_hist[WAL_STAT_HIST_SIZE];
+	/**
+	 * Number of batches which were written, even if
+	 * unsuccessfully, and the total and maximal time of
+	 * writing one, seconds.
+	 */
+	int64_t write_count;
+	double write_time;
+	double write_max;
+	/** Number, total and maximal time of WAL syncs. */
+	int64_t sync_count;
+	double sync_time;
+	double sync_max;
+	/**
+	 * Total and maximal number of requests taken from
+	 * the WAL queue at once.
+	 */
+	int64_t requests;
+	int64_t queue_max;
+	/** How many requests have been rolled back. */
+	int64_t rollback_count;
+	/** How many WAL files have been created. */
+	int64_t rotate_count;
+};
+
+/**
+ * Get a consistent copy of the WAL writer statistics.
+ * Fails (-1) if recovery is NULL or lacking a WAL writer.
+ */
+int
+wal_writer_stat(struct recovery *r, struct wal_stat *stat);
+
+/**
+ * The LSN of this server up to which all rows are written
+ * to the WAL (and synced, in fsync mode), or -1 if none.
+ */
+int64_t
+wal_durable_lsn(struct recovery *r);
+
+/**
+ * Wait until the durable LSN reaches the given LSN.
+ * @return 0 on success, -1 on timeout or fiber cancellation.
+ */
+int
+wal_wait_lsn(struct recovery *r, int64_t lsn, double timeout);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+
 
 struct wal_request: public cmsg {
 	/* Auxiliary. */
@@ -59,12 +132,33 @@ struct wal_request: public cmsg {
 int64_t
 wal_write(struct recovery *r, struct wal_request *req);
 
+/**
+ * Queue a request to be written to disk and return without
+ * waiting for the write. The request is copied and can be
+ * freed right away. A failed write of such request can't be
+ * rolled back, so the server panics or, if panic_on_wal_error
+ * is off, switches to read-only mode.
+ */
+int64_t
+wal_write_async(struct recovery *r, struct wal_request *req);
+
 int
-wal_writer_start(struct recovery *state, int64_t rows_per_wal);
+wal_writer_start(struct recovery *state, int64_t rows_per_wal,
+		 int64_t max_size, int64_t prealloc_size, bool direct_io);
 
 void
 wal_writer_stop(struct recovery *r);
 
+/**
+ * Configure group commit. The writer waits up to 'delay'
+ * seconds for more requests to arrive before it writes a
+ * batch, unless the batch already has at least 'max_rows'
+ * rows or 'max_bytes' bytes. Zero delay disables the wait.
+ */
+void
+wal_writer_set_group_commit(struct recovery *r, double delay,
+			    int64_t max_rows, int64_t max_bytes);
+
 struct wal_watcher
 {
 	struct rlist next;
@@ -32,6 +32,8 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "fiber.h"
 #include "crc32.h"
@@ -42,6 +44,9 @@
 #include "scoped_guard.h"
 #include "xrow.h"
 #include "iproto_constants.h"
+#if defined(HAVE_ZSTD)
+#include <zstd.h>
+#endif /* defined(HAVE_ZSTD) */
 
 /*
  * marker is MsgPack fixext2
@@ -53,8 +58,23 @@ typedef uint32_t log_magic_t;
 
 static const log_magic_t row_marker = mp_bswap_u32(0xd5ba0bab); /* host byte order */
 static const log_magic_t eof_marker = mp_bswap_u32(0xd510aded); /* host byte order */
+static const log_magic_t block_marker = mp_bswap_u32(0xd5b10cc5); /* host byte order */
 static const char inprogress_suffix[] = ".inprogress";
 static const char v12[] = "0.12\n";
+/**
+ * Version of the files with compressed blocks of rows or
+ * with parts (multi-part snapshots).
+ */
+static const char v13[] = "0.13\n";
+
+enum {
+	/** Size of the rows written or compressed as one block. */
+	XLOG_BLOCK_SIZE = 128 * 1024,
+	/** Compression level, the fastest one. */
+	XLOG_ZSTD_LEVEL = 1,
+	/** Read rows of a mapped file are dropped in chunks of this size. */
+	XLOG_MAP_RELEASE_SIZE = 8 * 1024 * 1024
+};
 
 const struct type type_XlogError = make_type("XlogError", &type_Exception);
 XlogError::XlogError(const char *file, unsigned line,
@@ -95,6 +115,97 @@ XlogGapError::XlogGapError(const char *file, unsigned line,
 	free(s_to);
 }
 
+/* {{{ compression */
+
+const char *xlog_codec_STRS[] = { "none", "zstd", NULL };
+
+bool
+xlog_codec_is_supported(enum xlog_codec codec)
+{
+	switch (codec) {
+	case XLOG_CODEC_NONE:
+		return true;
+#if defined(HAVE_ZSTD)
+	case XLOG_CODEC_ZSTD:
+		return true;
+#endif /* defined(HAVE_ZSTD) */
+	default:
+		return false;
+	}
+}
+
+/** The maximal size of compressed data of the given size. */
+static size_t
+xlog_compress_bound(enum xlog_codec codec, size_t size)
+{
+#if defined(HAVE_ZSTD)
+	if (codec == XLOG_CODEC_ZSTD)
+		return ZSTD_compressBound(size);
+#endif /* defined(HAVE_ZSTD) */
+	(void) codec;
+	return size;
+}
+
+/**
+ * @return the size of the compressed data, -1 on error.
+ */
+static ssize_t
+xlog_compress(enum xlog_codec codec, char *dst, size_t dst_size,
+	      const char *src, size_t src_size)
+{
+#if defined(HAVE_ZSTD)
+	if (codec == XLOG_CODEC_ZSTD) {
+		size_t rc = ZSTD_compress(dst, dst_size, src, src_size,
+					  XLOG_ZSTD_LEVEL);
+		return ZSTD_isError(rc) ? -1 : (ssize_t) rc;
+	}
+#endif /* defined(HAVE_ZSTD) */
+	(void) codec; (void) dst; (void) dst_size;
+	(void) src; (void) src_size;
+	return -1;
+}
+
+/**
+ * Decompress exactly dst_size bytes.
+ * @retval 0 success
+ * @retval -1 error
+ */
+static int
+xlog_decompress(enum xlog_codec codec, char *dst, size_t dst_size,
+		const char *src, size_t src_size)
+{
+#if defined(HAVE_ZSTD)
+	if (codec == XLOG_CODEC_ZSTD) {
+		size_t rc = ZSTD_decompress(dst, dst_size, src, src_size);
+		return ZSTD_isError(rc) || rc != dst_size ? -1 : 0;
+	}
+#endif /* defined(HAVE_ZSTD) */
+	(void) codec; (void) dst; (void) dst_size;
+	(void) src; (void) src_size;
+	return -1;
+}
+
+/** Make sure the block buffer can hold size more bytes. */
+static int
+xlog_block_reserve(struct xlog_block *b, size_t size)
+{
+	if (b->size + size <= b->capacity)
+		return 0;
+	size_t capacity = b->capacity > 0 ? b->capacity : XLOG_BLOCK_SIZE;
+	while (capacity < b->size + size)
+		capacity *= 2;
+	char *buf = (char *) realloc(b->buf, capacity);
+	if (buf == NULL) {
+		tnt_error(OutOfMemory, capacity, "realloc", "xlog block");
+		return -1;
+	}
+	b->buf = buf;
+	b->capacity = capacity;
+	return 0;
+}
+
+/* }}} */
+
 /* {{{ struct xdir */
 
 void
@@ -369,13 +480,23 @@ xdir_check(struct xdir *dir)
 char *
 format_filename(struct xdir *dir, int64_t signature,
 		enum log_suffix suffix)
+{
+	return format_part_filename(dir, signature, 0, suffix);
+}
+
+char *
+format_part_filename(struct xdir *dir, int64_t signature, uint32_t part,
+		     enum log_suffix suffix)
 {
 	static __thread char filename[PATH_MAX + 1];
 	const char *suffix_str = (suffix == INPROGRESS ?
 				  inprogress_suffix : "");
-	snprintf(filename, PATH_MAX, "%s/%020lld%s%s",
+	char part_str[16] = "";
+	if (part > 0)
+		snprintf(part_str, sizeof(part_str), ".%u", (unsigned) part);
+	snprintf(filename, PATH_MAX, "%s/%020lld%s%s%s",
 		 dir->dirname, (long long) signature,
-		 dir->filename_ext, suffix_str);
+		 dir->filename_ext, part_str, suffix_str);
 	return filename;
 }
 
@@ -383,6 +504,56 @@ format_filename(struct xdir *dir, int64_t signature,
 
 /* {{{ struct xlog_cursor */
 
+/**
+ * Decode the fixed header which follows a row or block marker:
+ * the length of the data, an auxiliary value (previous crc32,
+ * always 0, for a row and the decompressed size for a block),
+ * and crc32 of the data.
+ *
+ * @retval 0 success
+ * @retval -1 the header is malformed
+ */
+static int
+xlog_decode_fixheader(const char *fixheader, uint32_t *len,
+		      uint32_t *aux, uint32_t *crc32c)
+{
+	const char *end = fixheader + XLOG_FIXHEADER_SIZE -
+		sizeof(log_magic_t);
+	const char *data = fixheader;
+	if (mp_check(&data, end) != 0)
+		return -1;
+	data = fixheader;
+	if (mp_typeof(*data) != MP_UINT)
+		return -1;
+	*len = mp_decode_uint(&data);
+	if (mp_typeof(*data) != MP_UINT)
+		return -1;
+	*aux = mp_decode_uint(&data);
+	if (mp_typeof(*data) != MP_UINT)
+		return -1;
+	*crc32c = mp_decode_uint(&data);
+	assert(data <= end);
+	return 0;
+}
+
+/** Encode a marker and the fixed header, with padding. */
+static void
+xlog_encode_fixheader(char *fixheader, log_magic_t magic, uint32_t len,
+		      uint32_t aux, uint32_t crc32c)
+{
+	char *data = fixheader;
+	*(log_magic_t *) data = magic;
+	data += sizeof(magic);
+	data = mp_encode_uint(data, len);
+	data = mp_encode_uint(data, aux);
+	data = mp_encode_uint(data, crc32c);
+	/* Encode padding */
+	ssize_t padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
+	if (padding > 0)
+		data = mp_encode_strl(data, padding - 1) + padding - 1;
+	assert(data == fixheader + XLOG_FIXHEADER_SIZE);
+}
+
 /**
  * @retval -1 error
  * @retval 0 success
@@ -395,10 +566,12 @@ row_reader(FILE *f, struct xrow_header *row)
 
 	/* Read fixed header */
 	char fixheader[XLOG_FIXHEADER_SIZE - sizeof(log_magic_t)];
-	if (fread(fixheader, sizeof(fixheader), 1, f) != 1) {
+	/* Decode len, previous crc32 and row crc32 */
+	uint32_t len, crc32p, crc32c;
+	if (fread(fixheader, sizeof(fixheader), 1, f) != 1 ||
+	    xlog_decode_fixheader(fixheader, &len, &crc32p, &crc32c) != 0) {
 		if (feof(f))
 			return 1;
-error:
 		char buf[PATH_MAX];
 		snprintf(buf, sizeof(buf), "%s: failed to read or parse row "
 			 "header at offset %" PRIu64, fio_filename(fileno(f)),
@@ -406,17 +579,8 @@ error:
 		tnt_error(ClientError, ER_INVALID_MSGPACK, buf);
 		return -1;
 	}
+	(void) crc32p;
 
-	/* Decode len, previous crc32 and row crc32 */
-	data = fixheader;
-	if (mp_check(&data, data + sizeof(fixheader)) != 0)
-		goto error;
-	data = fixheader;
-
-	/* Read length */
-	if (mp_typeof(*data) != MP_UINT)
-		goto error;
-	uint32_t len = mp_decode_uint(&data);
 	if (len > IPROTO_BODY_LEN_MAX) {
 		char buf[PATH_MAX];
 		snprintf(buf, sizeof(buf),
@@ -426,18 +590,6 @@ error:
 		return -1;
 	}
 
-	/* Read previous crc32 */
-	if (mp_typeof(*data) != MP_UINT)
-		goto error;
-
-	/* Read current crc32 */
-	uint32_t crc32p = mp_decode_uint(&data);
-	if (mp_typeof(*data) != MP_UINT)
-		goto error;
-	uint32_t crc32c = mp_decode_uint(&data);
-	assert(data <= fixheader + sizeof(fixheader));
-	(void) crc32p;
-
 	/* Allocate memory for body */
 	char *bodybuf = (char *) region_alloc(&fiber()->gc, len);
 	if (bodybuf == NULL) {
@@ -480,25 +632,218 @@ xlog_encode_row(const struct xrow_header *row, struct iovec *iov)
 				    iov[i].iov_len);
 		len += iov[i].iov_len;
 	}
-
-	char *data = fixheader;
-	*(log_magic_t *) data = row_marker;
-	data += sizeof(row_marker);
-	data = mp_encode_uint(data, len);
-	/* Encode crc32 for previous row */
-	data = mp_encode_uint(data, crc32p);
-	/* Encode crc32 for current row */
-	data = mp_encode_uint(data, crc32c);
-	/* Encode padding */
-	ssize_t padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
-	if (padding > 0)
-		data = mp_encode_strl(data, padding - 1) + padding - 1;
-	assert(data == fixheader + XLOG_FIXHEADER_SIZE);
+	xlog_encode_fixheader(fixheader, row_marker, len, crc32p, crc32c);
 
 	assert(iovcnt <= XROW_IOVMAX);
 	return iovcnt;
 }
 
+/**
+ * Check and decompress a block of rows into the block buffer.
+ * The offset is only used in the error message.
+ *
+ * @retval -1 error
+ * @retval 0 success
+ */
+static int
+block_load(struct xlog *l, const char *zbuf, uint32_t zsize,
+	   uint32_t size, uint32_t crc32c, off_t offset)
+{
+	struct xlog_block *b = &l->block;
+	b->size = b->pos = 0;
+	if (crc32_calc(0, zbuf, zsize) != crc32c ||
+	    xlog_block_reserve(b, size) != 0 ||
+	    xlog_decompress(l->codec, b->buf, size, zbuf, zsize) != 0) {
+		char buf[PATH_MAX];
+		snprintf(buf, sizeof(buf), "%s: corrupt block at offset %"
+			 PRIu64, l->filename, (uint64_t) offset);
+		tnt_error(ClientError, ER_INVALID_MSGPACK, buf);
+		return -1;
+	}
+	b->size = size;
+	return 0;
+}
+
+/**
+ * Read a compressed block of rows into the block buffer.
+ *
+ * @retval -1 error
+ * @retval 0 success
+ * @retval 1 EOF
+ */
+static int
+block_reader(struct xlog *l)
+{
+	FILE *f = l->f;
+	struct xlog_block *b = &l->block;
+	b->size = b->pos = 0;
+
+	char fixheader[XLOG_FIXHEADER_SIZE - sizeof(log_magic_t)];
+	uint32_t zsize, size, crc32c;
+	if (fread(fixheader, sizeof(fixheader), 1, f) != 1 ||
+	    xlog_decode_fixheader(fixheader, &zsize, &size, &crc32c) != 0) {
+		if (feof(f))
+			return 1;
+		char buf[PATH_MAX];
+		snprintf(buf, sizeof(buf), "%s: failed to read or parse block "
+			 "header at offset %" PRIu64, l->filename,
+			 (uint64_t) ftello(f));
+		tnt_error(ClientError, ER_INVALID_MSGPACK, buf);
+		return -1;
+	}
+	char *zbuf = (char *) region_alloc(&fiber()->gc, zsize);
+	if (zbuf == NULL) {
+		tnt_error(OutOfMemory, zsize, "region", "new slab");
+		return -1;
+	}
+	if (fread(zbuf, zsize, 1, f) != 1)
+		return 1;
+	return block_load(l, zbuf, zsize, size, crc32c, ftello(f));
+}
+
+/**
+ * Decode a row which follows a row marker in memory, *data
+ * points past the marker. The row body is not copied, it
+ * points into the memory. On success *data is advanced past
+ * the row.
+ *
+ * @retval -1 error
+ * @retval 0 success
+ * @retval 1 the row is incomplete
+ */
+static int
+mem_row_reader(struct xlog *l, const char **data, const char *end,
+	       struct xrow_header *row)
+{
+	const char *pos = *data;
+	const size_t fixheader_size = XLOG_FIXHEADER_SIZE -
+		sizeof(log_magic_t);
+	if ((size_t) (end - pos) < fixheader_size)
+		return 1;
+	uint32_t len, crc32p, crc32c;
+	if (xlog_decode_fixheader(pos, &len, &crc32p, &crc32c) != 0) {
+		char buf[PATH_MAX];
+		snprintf(buf, sizeof(buf), "%s: failed to parse row header",
+			 l->filename);
+		tnt_error(ClientError, ER_INVALID_MSGPACK, buf);
+		return -1;
+	}
+	(void) crc32p;
+	if (len > IPROTO_BODY_LEN_MAX) {
+		char buf[PATH_MAX];
+		snprintf(buf, sizeof(buf), "%s: row is too big",
+			 l->filename);
+		tnt_error(ClientError, ER_INVALID_MSGPACK, buf);
+		return -1;
+	}
+	pos += fixheader_size;
+	if ((size_t) (end - pos) < len)
+		return 1;
+	if (crc32_calc(0, pos, len) != crc32c) {
+		char buf[PATH_MAX];
+		snprintf(buf, sizeof(buf), "%s: row checksum mismatch "
+			 "(expected %u)", l->filename, (unsigned) crc32c);
+		tnt_error(ClientError, ER_INVALID_MSGPACK, buf);
+		return -1;
+	}
+	*data = pos + len;
+	xrow_header_decode(row, &pos, pos + len);
+	return 0;
+}
+
+/**
+ * Take the next row from the block buffer. The row data
+ * stays valid until the next block is read.
+ *
+ * @retval -1 error, the rest of the block is dropped
+ * @retval 0 success
+ * @retval 1 no more rows in the block
+ */
+static int
+block_row_reader(struct xlog *l, struct xrow_header *row)
+{
+	struct xlog_block *b = &l->block;
+	if (b->pos == b->size)
+		return 1;
+	const char *data = b->buf + b->pos;
+	const char *end = b->buf + b->size;
+	log_magic_t magic;
+	if (end - data < (ptrdiff_t) sizeof(magic))
+		goto error;
+	memcpy(&magic, data, sizeof(magic));
+	if (magic != row_marker)
+		goto error;
+	data += sizeof(magic);
+	int rc;
+	rc = mem_row_reader(l, &data, end, row);
+	if (rc > 0)
+		goto error;
+	if (rc < 0) {
+		b->pos = b->size;
+		return -1;
+	}
+	b->pos = data - b->buf;
+	return 0;
+error:
+	b->pos = b->size;
+	char buf[PATH_MAX];
+	snprintf(buf, sizeof(buf), "%s: corrupt row in a block",
+		 l->filename);
+	tnt_error(ClientError, ER_INVALID_MSGPACK, buf);
+	return -1;
+}
+
+/**
+ * Map the file being read into memory, to decode rows right
+ * from the page cache instead of copying them. Only complete
+ * files, ending with the EOF marker, are mapped: a file being
+ * written may be truncated under the reader, and an access to
+ * the mapping past the end of file is fatal. Other files are
+ * read with stdio.
+ */
+static void
+xlog_cursor_map(struct xlog_cursor *i)
+{
+	struct xlog *l = i->log;
+	int fd = fileno(l->f);
+	struct stat st;
+	if (l->mode != LOG_READ || fd < 0 || fstat(fd, &st) != 0 ||
+	    ! S_ISREG(st.st_mode) ||
+	    st.st_size < i->good_offset + (off_t) sizeof(log_magic_t) ||
+	    (uint64_t) st.st_size > SIZE_MAX)
+		return;
+	log_magic_t magic;
+	if (fio_pread(fd, &magic, sizeof(magic),
+		      st.st_size - sizeof(magic)) != (ssize_t) sizeof(magic) ||
+	    magic != eof_marker)
+		return;
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		say_syserror("%s: mmap() failed", l->filename);
+		return;
+	}
+	(void) madvise(map, st.st_size, MADV_SEQUENTIAL);
+	i->map = (const char *) map;
+	i->map_size = st.st_size;
+	i->map_released = 0;
+}
+
+/**
+ * Drop the pages of the mapped file which have been read, so
+ * that reading a large file doesn't evict everything else from
+ * memory. Rows up to the good offset must not be used anymore.
+ */
+static void
+xlog_cursor_release(struct xlog_cursor *i)
+{
+	size_t end = i->good_offset & ~((off_t) getpagesize() - 1);
+	if (end < i->map_released + XLOG_MAP_RELEASE_SIZE)
+		return;
+	(void) madvise((void *) (i->map + i->map_released),
+		       end - i->map_released, MADV_DONTNEED);
+	i->map_released = end;
+}
+
 void
 xlog_cursor_open(struct xlog_cursor *i, struct xlog *l)
 {
@@ -506,6 +851,10 @@ xlog_cursor_open(struct xlog_cursor *i, struct xlog *l)
 	i->row_count = 0;
 	i->good_offset = ftello(l->f);
 	i->eof_read  = false;
+	i->map = NULL;
+	i->map_size = 0;
+	i->map_released = 0;
+	xlog_cursor_map(i);
 }
 
 void
@@ -514,6 +863,10 @@ xlog_cursor_close(struct xlog_cursor *i)
 	struct xlog *l = i->log;
 	l->rows += i->row_count;
 	l->eof_read = i->eof_read;
+	if (i->map != NULL) {
+		munmap((void *) i->map, i->map_size);
+		i->map = NULL;
+	}
 	/*
 	 * Since we don't close the xlog
 	 * we must rewind it to the last known
@@ -524,6 +877,97 @@ xlog_cursor_close(struct xlog_cursor *i)
 	region_free(&fiber()->gc);
 }
 
+/**
+ * xlog_cursor_next() for a mapped file. Follows the same
+ * steps as the stdio version, but rows are decoded in place.
+ *
+ * @retval 0    OK
+ * @retval 1    EOF
+ */
+static int
+xlog_cursor_next_mapped(struct xlog_cursor *i, struct xrow_header *row)
+{
+	struct xlog *l = i->log;
+	const char *end = i->map + i->map_size;
+	const char *marker = NULL;
+	const char *pos;
+	log_magic_t magic;
+
+	xlog_cursor_release(i);
+restart:
+	pos = marker != NULL ? marker + 1 : i->map + i->good_offset;
+	if (end - pos < (ptrdiff_t) sizeof(magic))
+		goto eof;
+	memcpy(&magic, pos, sizeof(magic));
+	/* Preallocated space, see xlog_cursor_next(). */
+	if (magic == 0 && marker == NULL)
+		goto eof;
+	while (magic != row_marker && magic != block_marker) {
+		if (end - ++pos < (ptrdiff_t) sizeof(magic)) {
+			say_debug("eof while looking for magic");
+			goto eof;
+		}
+		memcpy(&magic, pos, sizeof(magic));
+	}
+	marker = pos;
+	if (i->good_offset != marker - i->map)
+		say_warn("skipped %jd bytes after 0x%08jx offset",
+			(intmax_t)(marker - i->map - i->good_offset),
+			(uintmax_t)i->good_offset);
+	pos += sizeof(magic);
+
+	try {
+		if (magic == block_marker) {
+			const size_t fixheader_size = XLOG_FIXHEADER_SIZE -
+				sizeof(log_magic_t);
+			uint32_t zsize, size, crc32c;
+			if ((size_t) (end - pos) < fixheader_size)
+				goto eof;
+			if (xlog_decode_fixheader(pos, &zsize, &size,
+						  &crc32c) != 0)
+				goto eof;
+			pos += fixheader_size;
+			if ((size_t) (end - pos) < zsize ||
+			    block_load(l, pos, zsize, size, crc32c,
+				       pos - i->map) != 0)
+				goto eof;
+			/* The block is consumed, its rows are buffered. */
+			i->good_offset = pos + zsize - i->map;
+			if (block_row_reader(l, row) != 0) {
+				marker = NULL;
+				goto restart;
+			}
+			return 0;
+		}
+		if (mem_row_reader(l, &pos, end, row) != 0)
+			goto eof;
+	} catch (ClientError *e) {
+		if (l->dir->panic_if_error)
+			throw;
+		say_warn("failed to read row");
+		/* Drop the rest of a broken block. */
+		l->block.pos = l->block.size;
+		goto restart;
+	}
+	i->good_offset = pos - i->map;
+	return 0;
+eof:
+	/* See the comment in xlog_cursor_next(). */
+	pos = i->map + i->good_offset;
+	if (end - pos >= (ptrdiff_t) sizeof(magic)) {
+		memcpy(&magic, pos, sizeof(magic));
+		if (magic == eof_marker) {
+			i->good_offset += sizeof(magic);
+			i->eof_read = true;
+		} else if (magic != row_marker && magic != block_marker &&
+			   magic != 0) {
+			say_error("EOF marker is corrupt: %lu",
+				  (unsigned long) magic);
+		}
+	}
+	return 1;
+}
+
 /**
  * Read logfile contents using designated format, panic if
  * the log is corrupted/unreadable.
@@ -552,14 +996,39 @@ xlog_cursor_next(struct xlog_cursor *i, struct xrow_header *row)
 	 */
 	region_free_after(&fiber()->gc, 128 * 1024);
 
+	/* Rows left in the last read block go first. */
+	if (l->block.pos < l->block.size) {
+		try {
+			if (block_row_reader(l, row) == 0)
+				goto done;
+		} catch (ClientError *e) {
+			if (l->dir->panic_if_error)
+				throw;
+			say_warn("failed to read row");
+		}
+		l->block.pos = l->block.size;
+	}
+
+	if (i->map != NULL) {
+		if (xlog_cursor_next_mapped(i, row) != 0)
+			return 1;
+		goto done;
+	}
+
 restart:
 	if (marker_offset > 0)
 		fseeko(l->f, marker_offset + 1, SEEK_SET);
 
 	if (fread(&magic, sizeof(magic), 1, l->f) != 1)
 		goto eof;
+	/*
+	 * Zeros are the preallocated or padded space of a WAL
+	 * which is being written, there are no rows past them.
+	 */
+	if (magic == 0 && marker_offset == 0)
+		goto eof;
 
-	while (magic != row_marker) {
+	while (magic != row_marker && magic != block_marker) {
 		int c = fgetc(l->f);
 		if (c == EOF) {
 			say_debug("eof while looking for magic");
@@ -576,6 +1045,17 @@ restart:
 	say_debug("magic found at 0x%08jx", (uintmax_t)marker_offset);
 
 	try {
+		if (magic == block_marker) {
+			if (block_reader(l) != 0)
+				goto eof;
+			/* The block is consumed, its rows are buffered. */
+			i->good_offset = ftello(l->f);
+			if (block_row_reader(l, row) != 0) {
+				marker_offset = 0;
+				goto restart;
+			}
+			goto done;
+		}
 		if (row_reader(l->f, row) != 0)
 			goto eof;
 	} catch (ClientError *e) {
@@ -589,10 +1069,13 @@ restart:
 		 * written WAL.
 		 */
 		say_warn("failed to read row");
+		/* Drop the rest of a broken block. */
+		l->block.pos = l->block.size;
 		goto restart;
 	}
 
 	i->good_offset = ftello(l->f);
+done:
 	i->row_count++;
 
 	if (i->row_count % 100000 == 0)
@@ -618,7 +1101,7 @@ eof:
 		if (magic == eof_marker) {
 			i->good_offset = ftello(l->f);
 			i->eof_read = true;
-		} else if (magic == row_marker) {
+		} else if (magic == row_marker || magic == block_marker) {
 			/*
 			 * Row marker at the end of a file: a sign
 			 * of a corrupt log file in case of
@@ -627,6 +1110,15 @@ eof:
 			 * (i.e. data is being written to the
 			 * file.
 			 */
+		} else if (magic == 0) {
+			/*
+			 * Preallocated space of a file being
+			 * written or left after a crash. Drop
+			 * the zeros read ahead by stdio, the
+			 * rows may be written over them later.
+			 */
+			fflush(l->f);
+			fseeko(l->f, i->good_offset, SEEK_SET);
 		} else {
 			say_error("EOF marker is corrupt: %lu",
 				  (unsigned long) magic);
@@ -640,12 +1132,123 @@ eof:
 
 /* {{{ struct xlog */
 
+/**
+ * Create the header of an incremental snapshot.
+ * Sets the diagnostics area on error.
+ */
+static struct xlog_delta *
+xlog_delta_new(int64_t base, const uint32_t *space_ids, uint32_t space_count)
+{
+	struct xlog_delta *delta = (struct xlog_delta *)
+		calloc(1, sizeof(*delta));
+	if (delta == NULL) {
+		tnt_error(OutOfMemory, sizeof(*delta), "calloc",
+			  "struct xlog_delta");
+		return NULL;
+	}
+	delta->base = base;
+	if (space_count == 0)
+		return delta;
+	size_t size = space_count * sizeof(uint32_t);
+	delta->space_ids = (uint32_t *) malloc(size);
+	if (delta->space_ids == NULL) {
+		tnt_error(OutOfMemory, size, "malloc", "snapshot spaces");
+		free(delta);
+		return NULL;
+	}
+	memcpy(delta->space_ids, space_ids, size);
+	delta->space_count = space_count;
+	return delta;
+}
+
+static void
+xlog_delta_delete(struct xlog_delta *delta)
+{
+	if (delta == NULL)
+		return;
+	free(delta->space_ids);
+	free(delta);
+}
+
+ssize_t
+xlog_write_row(struct xlog *l, const struct xrow_header *row)
+{
+	assert(l->mode == LOG_WRITE);
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xlog_encode_row(row, iov);
+	size_t size = 0;
+	for (int i = 0; i < iovcnt; i++)
+		size += iov[i].iov_len;
+
+	/*
+	 * Rows of an uncompressed file are buffered as well and
+	 * go out in blocks: a stdio call per a piece of a row
+	 * costs more than a copy.
+	 */
+	struct xlog_block *b = &l->block;
+	if (xlog_block_reserve(b, size) != 0)
+		return -1;
+	for (int i = 0; i < iovcnt; i++) {
+		memcpy(b->buf + b->size, iov[i].iov_base, iov[i].iov_len);
+		b->size += iov[i].iov_len;
+	}
+	if (b->size >= XLOG_BLOCK_SIZE && xlog_flush(l) != 0)
+		return -1;
+	return size;
+}
+
+int
+xlog_flush(struct xlog *l)
+{
+	struct xlog_block *b = &l->block;
+	if (b->size == 0)
+		return 0;
+	if (l->codec == XLOG_CODEC_NONE) {
+		if (fwrite(b->buf, b->size, 1, l->f) != 1) {
+			say_syserror("%s: can't write rows (%zu bytes)",
+				     l->filename, b->size);
+			return -1;
+		}
+		b->size = 0;
+		return 0;
+	}
+	size_t bound = XLOG_FIXHEADER_SIZE +
+		xlog_compress_bound(l->codec, b->size);
+	char *zbuf = (char *) region_alloc(&fiber()->gc, bound);
+	if (zbuf == NULL) {
+		tnt_error(OutOfMemory, bound, "region", "new slab");
+		return -1;
+	}
+	ssize_t zsize = xlog_compress(l->codec, zbuf + XLOG_FIXHEADER_SIZE,
+				      bound - XLOG_FIXHEADER_SIZE,
+				      b->buf, b->size);
+	if (zsize < 0) {
+		say_error("%s: failed to compress a block", l->filename);
+		return -1;
+	}
+	xlog_encode_fixheader(zbuf, block_marker, zsize, b->size,
+			      crc32_calc(0, zbuf + XLOG_FIXHEADER_SIZE, zsize));
+	if (fwrite(zbuf, XLOG_FIXHEADER_SIZE + zsize, 1, l->f) != 1) {
+		say_syserror("%s: can't write block (%zu bytes)",
+			     l->filename, (size_t) zsize);
+		return -1;
+	}
+	b->size = 0;
+	return 0;
+}
+
 int
 xlog_close(struct xlog *l)
 {
-	int r;
+	int r = 0;
 
-	if (l->mode == LOG_WRITE) {
+	/*
+	 * A file which lost its last rows must not look complete,
+	 * so it gets no EOF marker if they can't be written.
+	 */
+	if (l->mode == LOG_WRITE && xlog_flush(l) != 0) {
+		r = -1;
+	} else if (l->mode == LOG_WRITE) {
 		fwrite(&eof_marker, 1, sizeof(log_magic_t), l->f);
 		/*
 		 * Sync the file before closing, since
@@ -657,9 +1260,12 @@ xlog_close(struct xlog *l)
 			xlog_sync(l);
 	}
 
-	r = fclose(l->f);
-	if (r < 0)
+	if (fclose(l->f) < 0) {
 		say_syserror("%s: close() failed", l->filename);
+		r = -1;
+	}
+	free(l->block.buf);
+	xlog_delta_delete(l->delta);
 	free(l);
 	return r;
 }
@@ -716,12 +1322,42 @@ xlog_sync(struct xlog *l)
 
 #define SERVER_UUID_KEY "Server"
 #define VCLOCK_KEY "VClock"
+#define COMPRESSION_KEY "Compression"
+#define PARTS_KEY "Parts"
+#define BASE_KEY "Base"
+#define SPACE_KEY "Space"
+
+/** Write the header of an incremental snapshot. */
+static int
+xlog_write_delta(struct xlog *l)
+{
+	struct xlog_delta *delta = l->delta;
+	if (fprintf(l->f, BASE_KEY ": %lld\n", (long long) delta->base) < 0)
+		return -1;
+	for (uint32_t i = 0; i < delta->space_count; i++) {
+		if (fprintf(l->f, SPACE_KEY ": %u\n",
+			    (unsigned) delta->space_ids[i]) < 0)
+			return -1;
+	}
+	return 0;
+}
 
 static int
 xlog_write_meta(struct xlog *l)
 {
 	char *vstr = NULL;
-	if (fprintf(l->f, "%s%s", l->dir->filetype, v12) < 0 ||
+	bool is_compressed = l->codec != XLOG_CODEC_NONE;
+	bool has_parts = l->part_count > 0;
+	bool is_delta = l->delta != NULL;
+	if (fprintf(l->f, "%s%s", l->dir->filetype,
+		    is_compressed || has_parts || is_delta ? v13 : v12) < 0 ||
+	    (is_compressed &&
+	     fprintf(l->f, COMPRESSION_KEY ": %s\n",
+		     xlog_codec_STRS[l->codec]) < 0) ||
+	    (has_parts &&
+	     fprintf(l->f, PARTS_KEY ": %u\n",
+		     (unsigned) l->part_count) < 0) ||
+	    (is_delta && xlog_write_delta(l) != 0) ||
 	    fprintf(l->f, SERVER_UUID_KEY ": %s\n",
 		    tt_uuid_str(l->dir->server_uuid)) < 0 ||
 	    (vstr = vclock_to_string(&l->vclock)) == NULL ||
@@ -733,6 +1369,54 @@ xlog_write_meta(struct xlog *l)
 	return 0;
 }
 
+static int
+xlog_space_id_cmp(const void *a, const void *b)
+{
+	uint32_t id_a = *(const uint32_t *) a;
+	uint32_t id_b = *(const uint32_t *) b;
+	return id_a < id_b ? -1 : id_a > id_b;
+}
+
+/**
+ * Parse a line of the header of an incremental snapshot:
+ * the base snapshot or a space of the snapshot.
+ */
+static int
+xlog_read_delta(struct xlog *l, const char *key, const char *val)
+{
+	char *end;
+	long long value = strtoll(val, &end, 10);
+	if (end == val || *end != '\0' || value < 0 ||
+	    (strcmp(key, SPACE_KEY) == 0 && value > UINT32_MAX)) {
+		tnt_error(XlogError, "%s: invalid %s", l->filename, key);
+		return -1;
+	}
+	struct xlog_delta *delta = l->delta;
+	if (delta == NULL) {
+		delta = l->delta = xlog_delta_new(-1, NULL, 0);
+		if (delta == NULL)
+			return -1;
+	}
+	if (strcmp(key, BASE_KEY) == 0) {
+		delta->base = value;
+		return 0;
+	}
+	/* Grow the array at powers of two. */
+	uint32_t count = delta->space_count;
+	if ((count & (count - 1)) == 0) {
+		size_t size = MAX(count * 2, 8u) * sizeof(uint32_t);
+		uint32_t *ids = (uint32_t *) realloc(delta->space_ids, size);
+		if (ids == NULL) {
+			tnt_error(OutOfMemory, size, "realloc",
+				  "snapshot spaces");
+			return -1;
+		}
+		delta->space_ids = ids;
+	}
+	delta->space_ids[delta->space_count++] = value;
+	return 0;
+}
+
 /**
  * Verify that file is of the given format.
  *
@@ -759,7 +1443,8 @@ xlog_read_meta(struct xlog *l, int64_t signature)
 		return -1;
 	}
 
-	if (strcmp(v12, version) != 0) {
+	bool is_v13 = strcmp(v13, version) == 0;
+	if (strcmp(v12, version) != 0 && ! is_v13) {
 		tnt_error(XlogError, "%s: unsupported file format version",
 			  l->filename);
 		return -1;
@@ -802,11 +1487,45 @@ xlog_read_meta(struct xlog *l, int64_t signature)
 					  "offset %zd", l->filename, offset);
 				return -1;
 			}
+		} else if (strcmp(key, COMPRESSION_KEY) == 0 && is_v13) {
+			int codec = strindex(xlog_codec_STRS, val,
+					     XLOG_CODEC_MAX);
+			if (codec == XLOG_CODEC_MAX ||
+			    ! xlog_codec_is_supported((enum xlog_codec) codec)) {
+				tnt_error(XlogError, "%s: unsupported "
+					  "compression '%s'", l->filename, val);
+				return -1;
+			}
+			l->codec = (enum xlog_codec) codec;
+		} else if (strcmp(key, PARTS_KEY) == 0 && is_v13) {
+			char *end_part;
+			long part_count = strtol(val, &end_part, 10);
+			if (end_part == val || *end_part != '\0' ||
+			    part_count <= 0 || part_count > XLOG_PARTS_MAX) {
+				tnt_error(XlogError, "%s: invalid number "
+					  "of parts", l->filename);
+				return -1;
+			}
+			l->part_count = part_count;
+		} else if ((strcmp(key, BASE_KEY) == 0 ||
+			    strcmp(key, SPACE_KEY) == 0) && is_v13) {
+			if (xlog_read_delta(l, key, val) != 0)
+				return -1;
 		} else {
 			/* Skip unknown key */
 		}
 	}
 
+	if (l->delta != NULL) {
+		/* Space ids are written sorted, but don't rely on it. */
+		qsort(l->delta->space_ids, l->delta->space_count,
+		      sizeof(uint32_t), xlog_space_id_cmp);
+		if (l->delta->base < 0 || l->delta->base >= signature) {
+			tnt_error(XlogError, "%s: invalid base snapshot",
+				  l->filename);
+			return -1;
+		}
+	}
 	if (!tt_uuid_is_nil(dir->server_uuid) &&
 	    !tt_uuid_is_equal(dir->server_uuid, &l->server_uuid)) {
 		tnt_error(XlogError, "%s: invalid server UUID",
@@ -844,6 +1563,8 @@ xlog_open_stream(struct xdir *dir, int64_t signature, FILE *file,
 
 	auto log_guard = make_scoped_guard([=]{
 		fclose(file);
+		if (l != NULL)
+			xlog_delta_delete(l->delta);
 		free(l);
 	});
 
@@ -870,7 +1591,14 @@ xlog_open_stream(struct xdir *dir, int64_t signature, FILE *file,
 struct xlog *
 xlog_open(struct xdir *dir, int64_t signature)
 {
-	const char *filename = format_filename(dir, signature, NONE);
+	return xlog_open_part(dir, signature, 0);
+}
+
+struct xlog *
+xlog_open_part(struct xdir *dir, int64_t signature, uint32_t part)
+{
+	const char *filename = format_part_filename(dir, signature, part,
+						    NONE);
 	FILE *f = fopen(filename, "r");
 	return xlog_open_stream(dir, signature, f, filename);
 }
@@ -905,6 +1633,13 @@ xlog_rename(struct xlog *l)
  */
 struct xlog *
 xlog_create(struct xdir *dir, const struct vclock *vclock)
+{
+	return xlog_create_part(dir, vclock, 0);
+}
+
+struct xlog *
+xlog_create_part(struct xdir *dir, const struct vclock *vclock,
+		 uint32_t part)
 {
 	char *filename;
 	FILE *f = NULL;
@@ -918,7 +1653,7 @@ xlog_create(struct xdir *dir, const struct vclock *vclock)
 	* Check whether a file with this name already exists.
 	* We don't overwrite existing files.
 	*/
-	filename = format_filename(dir, signature, NONE);
+	filename = format_part_filename(dir, signature, part, NONE);
 	if (access(filename, F_OK) == 0) {
 		errno = EEXIST;
 		goto error;
@@ -934,7 +1669,7 @@ xlog_create(struct xdir *dir, const struct vclock *vclock)
 	 * may think that this is a corrupt file and stop
 	 * replication.
 	 */
-	filename = format_filename(dir, signature, INPROGRESS);
+	filename = format_part_filename(dir, signature, part, INPROGRESS);
 	f = fiob_open(filename, dir->open_wflags);
 	if (!f)
 		goto error;
@@ -950,6 +1685,17 @@ xlog_create(struct xdir *dir, const struct vclock *vclock)
 	/*  Makes no sense, but well. */
 	l->eof_read = false;
 	vclock_copy(&l->vclock, vclock);
+	l->codec = dir->codec;
+	/* The first file of a snapshot lists the rest. */
+	if (part == 0)
+		l->part_count = dir->part_count;
+	if (part == 0 && dir->delta != NULL) {
+		l->delta = xlog_delta_new(dir->delta->base,
+					  dir->delta->space_ids,
+					  dir->delta->space_count);
+		if (l->delta == NULL)
+			goto error;
+	}
 	setvbuf(l->f, NULL, _IONBF, 0);
 	if (xlog_write_meta(l) != 0)
 		goto error;
@@ -964,6 +1710,8 @@ error:
 		fclose(f);
 		unlink(filename); /* try to remove incomplete file */
 	}
+	if (l != NULL)
+		xlog_delta_delete(l->delta);
 	free(l);
 	errno = save_errno;
 	return NULL;
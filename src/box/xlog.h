@@ -51,6 +51,37 @@ extern "C" {
  */
 enum xdir_type { SNAP, XLOG };
 
+/** The maximal number of additional parts of a snapshot. */
+enum { XLOG_PARTS_MAX = 64 };
+
+/**
+ * Text file header of an incremental snapshot, which has only
+ * the spaces changed since an earlier snapshot, its base. The
+ * rest of the data is in the base, which may be incremental
+ * too. See snap_delta_max.
+ */
+struct xlog_delta {
+	/** The signature of the base snapshot. */
+	int64_t base;
+	/** The number of spaces in this snapshot. */
+	uint32_t space_count;
+	/** Sorted ids of the spaces in this snapshot. */
+	uint32_t *space_ids;
+};
+
+/**
+ * Compression of the rows in a log file. Compressed files
+ * consist of blocks of rows compressed together.
+ */
+enum xlog_codec { XLOG_CODEC_NONE = 0, XLOG_CODEC_ZSTD, XLOG_CODEC_MAX };
+
+/** String constants for the supported codecs. */
+extern const char *xlog_codec_STRS[];
+
+/** True if this build can read and write files with the codec. */
+bool
+xlog_codec_is_supported(enum xlog_codec codec);
+
 /**
  * Newly created snapshot files get .inprogress filename suffix.
  * The suffix is removed  when the file is finished
@@ -88,6 +119,18 @@ struct xdir {
 	 * O_DIRECT flag, for example.
 	 */
 	char open_wflags[6];
+	/** Compression of new files in this directory. */
+	enum xlog_codec codec;
+	/**
+	 * The number of additional parts of a new snapshot,
+	 * 0 if the snapshot is a single file.
+	 */
+	uint32_t part_count;
+	/**
+	 * If set, a new snapshot is incremental, with this
+	 * header. The memory belongs to the caller.
+	 */
+	const struct xlog_delta *delta;
 	/**
 	 * A pointer to this server uuid. If not assigned
 	 * (tt_uuid_is_nil returns true), server id check
@@ -156,6 +199,22 @@ xdir_check(struct xdir *dir);
  */
 enum log_mode { LOG_READ, LOG_WRITE };
 
+/**
+ * A block of rows of a log file. When writing, encoded rows
+ * are collected in the buffer until there is enough of them
+ * to compress, if the file is compressed, and write out.
+ * When reading a compressed file,
+ * the buffer holds the rows of the last decompressed block.
+ */
+struct xlog_block {
+	char *buf;
+	size_t capacity;
+	/** Size of the rows in the buffer. */
+	size_t size;
+	/** Read position, the start of the next row. */
+	size_t pos;
+};
+
 /**
  * A single log file - a snapshot or a write ahead log.
  */
@@ -195,6 +254,21 @@ struct xlog {
 	 * is vector clock *at the time the snapshot is taken*.
 	 */
 	struct vclock vclock;
+	/** Text file header: compression of the rows. */
+	enum xlog_codec codec;
+	/**
+	 * Text file header: the number of additional files
+	 * <signature>.snap.1 ... <signature>.snap.N of a
+	 * snapshot, which continue this one. 0 if none.
+	 */
+	uint32_t part_count;
+	/**
+	 * Text file header: set if this is an incremental
+	 * snapshot. Only the first file of a snapshot has it.
+	 */
+	struct xlog_delta *delta;
+	/** Rows being compressed or decompressed. */
+	struct xlog_block block;
 };
 
 /**
@@ -210,6 +284,13 @@ struct xlog {
 struct xlog *
 xlog_open(struct xdir *dir, int64_t signature);
 
+/**
+ * Open a part of a multi-part snapshot, see xlog->part_count.
+ * Part 0 is the file opened by xlog_open().
+ */
+struct xlog *
+xlog_open_part(struct xdir *dir, int64_t signature, uint32_t part);
+
 /**
  * Open an xlog from a pre-created stdio stream.
  * The log is open for reading.
@@ -239,6 +320,15 @@ xlog_open_stream(struct xdir *dir, int64_t signature,
 struct xlog *
 xlog_create(struct xdir *dir, const struct vclock *vclock);
 
+/**
+ * Create a part of a multi-part snapshot. Part 0 is the
+ * file created by xlog_create(), it gets the number of
+ * parts (dir->part_count) and dir->delta in its header.
+ */
+struct xlog *
+xlog_create_part(struct xdir *dir, const struct vclock *vclock,
+		 uint32_t part);
+
 /**
  * Sync a log file. The exact action is defined
  * by xdir flags.
@@ -250,10 +340,31 @@ int
 xlog_sync(struct xlog *l);
 
 /**
- * Close the log file and free xlog object.
+ * Append a row to a log opened for writing. The row is
+ * buffered and written out later, along with a block of rows.
+ *
+ * @return the size of the encoded row, -1 on error.
+ */
+ssize_t
+xlog_write_row(struct xlog *l, const struct xrow_header *row);
+
+/**
+ * Write out the rows buffered by xlog_write_row(), if any,
+ * compressing them if the log is compressed.
  *
  * @retval 0 success
- * @retval -1 error (fclose() failed).
+ * @retval -1 error
+ */
+int
+xlog_flush(struct xlog *l);
+
+/**
+ * Close the log file and free xlog object. A log opened for
+ * writing gets the buffered rows and the EOF marker, unless
+ * the rows can't be written.
+ *
+ * @retval 0 success
+ * @retval -1 error (xlog_flush() or fclose() failed).
  */
 int
 xlog_close(struct xlog *l);
@@ -273,6 +384,14 @@ struct xlog_cursor
 	int row_count;
 	off_t good_offset;
 	bool eof_read;
+	/**
+	 * The file mapped into memory, from the start, or NULL
+	 * if the file is read with stdio.
+	 */
+	const char *map;
+	size_t map_size;
+	/** The mapped pages before this offset have been dropped. */
+	size_t map_released;
 };
 
 void
@@ -295,6 +414,15 @@ xlog_cursor_next(struct xlog_cursor *i, struct xrow_header *packet);
 char *
 format_filename(struct xdir *dir, int64_t signature, enum log_suffix suffix);
 
+/**
+ * Same as format_filename(), for a part of a multi-part
+ * snapshot: <signature>.snap.<part>. Part 0 is the
+ * first file, <signature>.snap.
+ */
+char *
+format_part_filename(struct xdir *dir, int64_t signature, uint32_t part,
+		     enum log_suffix suffix);
+
 /**
  * Construct a row to write to the log file.
  */
@@ -408,6 +408,18 @@ cbus_wait_signal(struct cbus *bus)
 	tt_pthread_cond_wait(&bus->cond, &bus->mutex);
 }
 
+/**
+ * Wait for a signal on the bus until an absolute deadline
+ * (CLOCK_REALTIME) is reached.
+ * @retval true the deadline has passed without a signal
+ */
+static inline bool
+cbus_timedwait_signal(struct cbus *bus, const struct timespec *deadline)
+{
+	return tt_pthread_cond_timedwait(&bus->cond, &bus->mutex,
+					 deadline) != 0;
+}
+
 /**
  * Dispatch the message to the next hop.
  */
@@ -84,6 +84,7 @@ void *ffi_symbols[] = {
 	(void *) box_index_bsize,
 	(void *) box_index_random,
 	(void *) box_index_get,
+	(void *) box_index_get_multi,
 	(void *) box_index_min,
 	(void *) box_index_max,
 	(void *) box_index_count,
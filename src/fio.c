@@ -34,6 +34,7 @@
 
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <limits.h>
 #include <stdio.h>
@@ -161,6 +162,73 @@ fio_truncate(int fd, off_t offset)
 	return rc;
 }
 
+ssize_t
+fio_pwrite(int fd, const void *buf, size_t count, off_t offset)
+{
+	ssize_t to_write = (ssize_t) count;
+	while (to_write > 0) {
+		ssize_t nwr = pwrite(fd, buf, to_write, offset);
+		if (nwr < 0) {
+			if (errno == EINTR) {
+				errno = 0;
+				continue;
+			}
+			say_syserror("pwrite, [%s]: offset=%jd",
+				     fio_filename(fd), (intmax_t) offset);
+			return -1;
+		}
+		if (nwr == 0)
+			break;
+
+		buf = (const char *) buf + nwr;
+		offset += nwr;
+		to_write -= nwr;
+	}
+	return count - to_write;
+}
+
+ssize_t
+fio_pread(int fd, void *buf, size_t count, off_t offset)
+{
+	ssize_t to_read = (ssize_t) count;
+	while (to_read > 0) {
+		ssize_t nrd = pread(fd, buf, to_read, offset);
+		if (nrd < 0) {
+			if (errno == EINTR) {
+				errno = 0;
+				continue;
+			}
+			say_syserror("pread, [%s]: offset=%jd",
+				     fio_filename(fd), (intmax_t) offset);
+			return -1;
+		}
+		if (nrd == 0)
+			break;
+
+		buf = (char *) buf + nrd;
+		offset += nrd;
+		to_read -= nrd;
+	}
+	return count - to_read;
+}
+
+int
+fio_fallocate(int fd, off_t size)
+{
+#if defined(HAVE_POSIX_FALLOCATE)
+	/* posix_fallocate() returns an error instead of setting errno. */
+	int rc = posix_fallocate(fd, 0, size);
+	if (rc == 0)
+		return 0;
+	errno = rc;
+#else
+	errno = ENOTSUP;
+#endif
+	say_syserror("fallocate, [%s]: size=%jd",
+		     fio_filename(fd), (intmax_t) size);
+	return -1;
+}
+
 
 struct fio_batch *
 fio_batch_new(void)
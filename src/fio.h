@@ -150,6 +150,41 @@ fio_lseek(int fd, off_t offset, int whence);
 int
 fio_truncate(int fd, off_t offset);
 
+/**
+ * Write the given buffer at the given offset, re-trying for
+ * partial writes. Does not change the file position.
+ * In case of an error, writes a message to the error log.
+ *
+ * @return the number of bytes written (always count),
+ *         or -1 if error.
+ */
+ssize_t
+fio_pwrite(int fd, const void *buf, size_t count, off_t offset);
+
+/**
+ * Read up to count bytes at the given offset, re-trying for
+ * interrupted reads. Does not change the file position.
+ * In case of an error, writes a message to the error log.
+ *
+ * @return the number of bytes read (less than count at EOF),
+ *         or -1 if error.
+ */
+ssize_t
+fio_pread(int fd, void *buf, size_t count, off_t offset);
+
+/**
+ * Make sure disk space is allocated for the first size bytes
+ * of the file, extending it if necessary. Subsequent writes
+ * within this range neither allocate blocks nor change the
+ * file size, so a data sync of them doesn't have to flush
+ * file metadata. Logs a message in case of error.
+ *
+ * @return 0 on success, -1 if error or the platform has
+ *         no posix_fallocate() (errno is ENOTSUP).
+ */
+int
+fio_fallocate(int fd, off_t size);
+
 /**
  * A helper wrapper around writev() to do batched
  * writes.
@@ -63,6 +63,71 @@ bitset_destroy(struct bitset *bitset)
 	memset(&bitset->pages, 0, sizeof(bitset->pages));
 }
 
+/**
+ * Allocate a page for bits [first_pos, first_pos + page size):
+ * an array page of the given capacity, or a bitmap page if
+ * \a capacity is 0.
+ */
+static struct bitset_page *
+bitset_page_new(struct bitset *bitset, size_t first_pos, uint32_t capacity)
+{
+	struct bitset_page *page;
+	if (capacity > 0) {
+		page = bitset->realloc(NULL,
+				       bitset_page_array_alloc_size(capacity));
+		if (page == NULL)
+			return NULL;
+		bitset_page_array_create(page, capacity);
+	} else {
+		page = bitset->realloc(NULL,
+				       bitset_page_alloc_size(bitset->realloc));
+		if (page == NULL)
+			return NULL;
+		bitset_page_create(page);
+	}
+	page->first_pos = first_pos;
+	return page;
+}
+
+/**
+ * Replace \a page in the pages tree with a page of another
+ * capacity (0 - a bitmap page) holding the same bits.
+ * @retval the new page on success
+ * @retval NULL on memory error, \a page is left intact
+ */
+static struct bitset_page *
+bitset_page_convert(struct bitset *bitset, struct bitset_page *page,
+		    uint32_t capacity)
+{
+	assert(capacity == 0 || capacity >= page->cardinality);
+	struct bitset_page *new_page =
+		bitset_page_new(bitset, page->first_pos, capacity);
+	if (new_page == NULL)
+		return NULL;
+
+	new_page->cardinality = page->cardinality;
+	if (bitset_page_is_array(new_page) && bitset_page_is_array(page)) {
+		memcpy(bitset_page_array(new_page), bitset_page_array(page),
+		       page->cardinality * sizeof(uint16_t));
+	} else if (bitset_page_is_array(new_page)) {
+		uint16_t *array = bitset_page_array(new_page);
+		struct bit_iterator it;
+		bit_iterator_init(&it, bitset_page_data(page),
+				  BITSET_PAGE_DATA_SIZE, true);
+		size_t pos;
+		while ((pos = bit_iterator_next(&it)) != SIZE_MAX)
+			*array++ = pos;
+	} else {
+		bitset_page_or(new_page, page);
+	}
+
+	bitset_pages_remove(&bitset->pages, page);
+	bitset_pages_insert(&bitset->pages, new_page);
+	bitset_page_destroy(page);
+	bitset->realloc(page, 0);
+	return new_page;
+}
+
 bool
 bitset_test(struct bitset *bitset, size_t pos)
 {
@@ -76,7 +141,7 @@ bitset_test(struct bitset *bitset, size_t pos)
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
 	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	return bit_test(bitset_page_data(page), pos - page->first_pos);
+	return bitset_page_test(page, pos - page->first_pos);
 }
 
 int
@@ -88,25 +153,48 @@ bitset_set(struct bitset *bitset, size_t pos)
 	/* Find a page in pages tree */
 	struct bitset_page *page = bitset_pages_search(&bitset->pages, &key);
 	if (page == NULL) {
-		/* Allocate a new page */
-		size_t size = bitset_page_alloc_size(bitset->realloc);
-		page = bitset->realloc(NULL, size);
+		/* Allocate a new page, it is sparse for now */
+		page = bitset_page_new(bitset, key.first_pos,
+				       BITSET_PAGE_ARRAY_MIN);
 		if (page == NULL)
 			return -1;
 
-		bitset_page_create(page);
-		page->first_pos = key.first_pos;
-
 		/* Insert the page into pages tree */
 		bitset_pages_insert(&bitset->pages, page);
 	}
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
 	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	bool prev = bit_set(bitset_page_data(page), pos - page->first_pos);
-	if (prev) {
-		/* Value has not changed */
-		return 1;
+	pos -= page->first_pos;
+	if (bitset_page_is_array(page)) {
+		uint32_t i = bitset_page_array_lower_bound(page, pos);
+		if (i < page->cardinality && bitset_page_array(page)[i] == pos) {
+			/* Value has not changed */
+			return 1;
+		}
+		if (page->cardinality == page->capacity) {
+			/* Grow the array or turn the page into a bitmap */
+			uint32_t capacity = 0;
+			if (page->capacity < BITSET_PAGE_ARRAY_MAX)
+				capacity = page->capacity * 2;
+			page = bitset_page_convert(bitset, page, capacity);
+			if (page == NULL)
+				return -1;
+		}
+		if (bitset_page_is_array(page)) {
+			uint16_t *array = bitset_page_array(page);
+			memmove(array + i + 1, array + i,
+				(page->cardinality - i) * sizeof(*array));
+			array[i] = pos;
+		} else {
+			bit_set(bitset_page_data(page), pos);
+		}
+	} else {
+		bool prev = bit_set(bitset_page_data(page), pos);
+		if (prev) {
+			/* Value has not changed */
+			return 1;
+		}
 	}
 
 	bitset->cardinality++;
@@ -128,9 +216,19 @@ bitset_clear(struct bitset *bitset, size_t pos)
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
 	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	bool prev = bit_clear(bitset_page_data(page), pos - page->first_pos);
-	if (!prev) {
-		return 0;
+	pos -= page->first_pos;
+	if (bitset_page_is_array(page)) {
+		uint16_t *array = bitset_page_array(page);
+		uint32_t i = bitset_page_array_lower_bound(page, pos);
+		if (i == page->cardinality || array[i] != pos)
+			return 0;
+		memmove(array + i, array + i + 1,
+			(page->cardinality - i - 1) * sizeof(*array));
+	} else {
+		bool prev = bit_clear(bitset_page_data(page), pos);
+		if (!prev) {
+			return 0;
+		}
 	}
 
 	assert(bitset->cardinality > 0);
@@ -144,6 +242,15 @@ bitset_clear(struct bitset *bitset, size_t pos)
 		/* Free the page */
 		bitset_page_destroy(page);
 		bitset->realloc(page, 0);
+	} else if (!bitset_page_is_array(page) &&
+		   page->cardinality <= BITSET_PAGE_ARRAY_MAX / 2) {
+		/*
+		 * The bitmap has become sparse. Turn it into an array
+		 * with room for new bits so that a page near the limit
+		 * isn't converted back and forth. On memory error the
+		 * page just stays a bitmap.
+		 */
+		bitset_page_convert(bitset, page, BITSET_PAGE_ARRAY_MAX);
 	}
 
 	return 1;
@@ -164,6 +271,13 @@ bitset_info(struct bitset *bitset, struct bitset_info *info)
 	struct bitset_page *page = bitset_pages_first(&bitset->pages);
 	while (page != NULL) {
 		info->pages++;
+		if (bitset_page_is_array(page)) {
+			info->array_pages++;
+			info->mem_total +=
+				bitset_page_array_alloc_size(page->capacity);
+		} else {
+			info->mem_total += info->page_total_size;
+		}
 		cardinality_check += page->cardinality;
 		page = bitset_pages_next(&bitset->pages, page);
 	}
@@ -186,6 +300,7 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 		info.page_data_size, info.page_total_size);
 	fprintf(stream, "    " "page_bit    = %zu\n", PAGE_BIT);
 	fprintf(stream, "    " "pages       = %zu\n", info.pages);
+	fprintf(stream, "    " "array_pages = %zu\n", info.array_pages);
 
 
 	size_t cardinality = bitset_cardinality(bitset);
@@ -204,10 +319,8 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 		fprintf(stream, "    "
 			"utilization = undefined\n");
 	}
-	size_t mem_data  = info.page_data_size * info.pages;
-	size_t mem_total = info.page_total_size * info.pages;
+	size_t mem_total = info.mem_total;
 
-	fprintf(stream, "    " "mem_data    = %zu bytes\n", mem_data);
 	fprintf(stream, "    " "mem_total   = %zu bytes "
 		"/* data + padding + tree */\n", mem_total);
 	if (cardinality > 0) {
@@ -236,7 +349,7 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 
 		fprintf(stream, "utilization = %8.4f%% (%zu/%zu)",
 			(float) page->cardinality * 1e2 / PAGE_BIT,
-			page->cardinality, PAGE_BIT);
+			(size_t) page->cardinality, PAGE_BIT);
 
 		if (verbose < 2) {
 			fprintf(stream, "\n");
@@ -246,6 +359,15 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 
 		fprintf(stream, "vals = {");
 
+		if (bitset_page_is_array(page)) {
+			uint16_t *array = bitset_page_array(page);
+			for (uint32_t i = 0; i < page->cardinality; i++) {
+				fprintf(stream, "%zu, ",
+					page->first_pos + array[i]);
+			}
+			fprintf(stream, "}\n");
+			continue;
+		}
 		size_t pos = 0;
 		struct bit_iterator it;
 		bit_iterator_init(&it, bitset_page_data(page),
@@ -69,7 +69,13 @@ extern "C" {
 struct bitset_page {
 	size_t first_pos;
 	rb_node(struct bitset_page) node;
-	size_t cardinality;
+	uint32_t cardinality;
+	/**
+	 * 0 if the page data is a bitmap, otherwise the page is
+	 * sparse and its data is a sorted array of the positions
+	 * of bits set, which has room for that many positions.
+	 */
+	uint32_t capacity;
 	uint8_t data[0];
 };
 
@@ -157,6 +163,10 @@ struct bitset_info {
 	size_t page_total_size;
 	/** A multiplier by which an address of page data is aligned **/
 	size_t page_data_alignment;
+	/** Number of pages stored as arrays of positions */
+	size_t array_pages;
+	/** Memory used by all pages (in bytes) */
+	size_t mem_total;
 };
 
 /**
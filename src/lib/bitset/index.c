@@ -360,6 +360,91 @@ bitset_index_expr_all_not_set(struct bitset_expr *expr, const void *key,
 	return 0;
 }
 
+/**
+ * Add the bits of \a key starting from bit \a pos to the last
+ * conjunction of \a expr, so that it only matches keys that
+ * have the same bits there.
+ */
+static int
+bitset_index_expr_add_bits(struct bitset_expr *expr, const void *key,
+			   size_t key_size, size_t pos)
+{
+	for (; pos < key_size * CHAR_BIT; pos++) {
+		size_t b = pos + 1;
+		bool bit_exist = bit_test(key, pos);
+		if (bitset_expr_add_param(expr, b, !bit_exist) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+int
+bitset_index_expr_less(struct bitset_expr *expr, const void *key,
+		       size_t key_size, bool or_equals)
+{
+	bitset_expr_clear(expr);
+
+	/*
+	 * pair.key < key if both have the same higher bits down
+	 * to some bit, which is set in key and is not in pair.key.
+	 * The 'flag' bitset is needed as all bits of a conjunction
+	 * may be negated.
+	 */
+	for (size_t pos = 0; pos < key_size * CHAR_BIT; pos++) {
+		if (!bit_test(key, pos))
+			continue;
+		size_t b = pos + 1;
+		if (bitset_expr_add_conj(expr) != 0 ||
+		    bitset_expr_add_param(expr, b, true) != 0 ||
+		    bitset_index_expr_add_bits(expr, key, key_size,
+					       pos + 1) != 0 ||
+		    bitset_expr_add_param(expr, 0, false) != 0)
+			return -1;
+	}
+
+	if (!or_equals)
+		return 0;
+
+	if (bitset_expr_add_conj(expr) != 0 ||
+	    bitset_index_expr_add_bits(expr, key, key_size, 0) != 0 ||
+	    bitset_expr_add_param(expr, 0, false) != 0)
+		return -1;
+
+	return 0;
+}
+
+int
+bitset_index_expr_greater(struct bitset_expr *expr, const void *key,
+			  size_t key_size, bool or_equals)
+{
+	bitset_expr_clear(expr);
+
+	/*
+	 * pair.key > key if both have the same higher bits down
+	 * to some bit, which is set in pair.key and is not in key.
+	 */
+	for (size_t pos = 0; pos < key_size * CHAR_BIT; pos++) {
+		if (bit_test(key, pos))
+			continue;
+		size_t b = pos + 1;
+		if (bitset_expr_add_conj(expr) != 0 ||
+		    bitset_expr_add_param(expr, b, false) != 0 ||
+		    bitset_index_expr_add_bits(expr, key, key_size,
+					       pos + 1) != 0)
+			return -1;
+	}
+
+	if (!or_equals)
+		return 0;
+
+	if (bitset_expr_add_conj(expr) != 0 ||
+	    bitset_index_expr_add_bits(expr, key, key_size, 0) != 0 ||
+	    bitset_expr_add_param(expr, 0, false) != 0)
+		return -1;
+
+	return 0;
+}
+
 int
 bitset_index_init_iterator(struct bitset_index *index,
 			   struct bitset_iterator *it, struct bitset_expr *expr)
@@ -393,7 +478,7 @@ bitset_index_bsize(const struct bitset_index *index)
 			continue;
 		struct bitset_info info;
 		bitset_info(index->bitsets[b], &info);
-		result += info.page_total_size * info.pages;
+		result += info.mem_total;
 	}
 	return result;
 }
@@ -44,7 +44,10 @@
  * to queries like 'return all (key, value) pairs where the key
  * has bit i and bit j set'. The implementation supports
  * evaluation of arbitrary logical expressions represented in
- * Disjunctive Normal Form.
+ * Disjunctive Normal Form. Since every bitset holds a slice of
+ * one bit of all keys, integer keys can be searched by range
+ * too: a range is a disjunction of at most one conjunction per
+ * bit of the bound.
  *
  * To search over keys in a bitset_index, a logical expression
  * needs to be constructed.
@@ -264,6 +267,45 @@ int
 bitset_index_expr_all_not_set(struct bitset_expr *expr, const void *key,
 			      size_t key_size);
 
+/**
+ * @brief Initialize \a expr to iterate over a bitset index.
+ * The \a expr can be then passed to @link bitset_index_init_iterator @endlink.
+ * 'Less' algorithm. Matches all pairs where pair.key < \a key
+ * (or pair.key <= \a key if \a or_equals is set). Keys are compared
+ * as unsigned little-endian integers of \a key_size bytes, so no key
+ * in the index may have a bit set beyond \a key_size bytes.
+ * @param expr bitset expression
+ * @param key key
+ * @param key_size of \a key (in char, as sizeof returns)
+ * @param or_equals whether to match pairs with pair.key == \a key
+ * @retval 0 on success
+ * @retval -1 on memory error
+ * @see @link bitset_index_init_iterator @endlink
+ * @see expr.h
+ */
+int
+bitset_index_expr_less(struct bitset_expr *expr, const void *key,
+		       size_t key_size, bool or_equals);
+
+/**
+ * @brief Initialize \a expr to iterate over a bitset index.
+ * The \a expr can be then passed to @link bitset_index_init_iterator @endlink.
+ * 'Greater' algorithm. Matches all pairs where pair.key > \a key
+ * (or pair.key >= \a key if \a or_equals is set). Keys are compared
+ * like in @link bitset_index_expr_less @endlink.
+ * @param expr bitset expression
+ * @param key key
+ * @param key_size of \a key (in char, as sizeof returns)
+ * @param or_equals whether to match pairs with pair.key == \a key
+ * @retval 0 on success
+ * @retval -1 on memory error
+ * @see @link bitset_index_init_iterator @endlink
+ * @see expr.h
+ */
+int
+bitset_index_expr_greater(struct bitset_expr *expr, const void *key,
+			  size_t key_size, bool or_equals);
+
 /**
  * @brief Initialize \a it using \a expr and bitsets used in \a index.
  *
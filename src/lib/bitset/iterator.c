@@ -248,8 +248,16 @@ bitset_iterator_conj_rewind(struct bitset_iterator_conj *conj, size_t pos)
 
 	restart:
 	for (size_t b = 0; b < conj->size; b++) {
-		conj->pages[b] = bitset_pages_nsearch(&conj->bitsets[b]->pages,
-						      &key);
+		/*
+		 * Conjunctions are only rewound forward, so a page
+		 * found before is still the first one not less than
+		 * pos unless it is behind pos.
+		 */
+		if (conj->pages[b] == NULL ||
+		    conj->pages[b]->first_pos < key.first_pos) {
+			conj->pages[b] = bitset_pages_nsearch(
+				&conj->bitsets[b]->pages, &key);
+		}
 #if 0
 		if (conj->pages[b] != NULL) {
 			fprintf(stderr, "rewind [%zu] => %zu (%p)\n", b,
@@ -296,6 +304,27 @@ bitset_iterator_conj_cmp(const void *p1, const void *p2)
 	}
 }
 
+/**
+ * Test bit \a pos (relative to the page start) of the result of
+ * a conjunction rewound to a page.
+ */
+static bool
+bitset_iterator_conj_test(struct bitset_iterator_conj *conj, size_t pos)
+{
+	for (size_t b = 0; b < conj->size; b++) {
+		struct bitset_page *page = conj->pages[b];
+		if (!conj->pre_nots[b]) {
+			if (!bitset_page_test(page, pos))
+				return false;
+		} else if (page != NULL &&
+			   page->first_pos == conj->page_first_pos &&
+			   bitset_page_test(page, pos)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 static void
 bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
 				  struct bitset_page *dst)
@@ -305,6 +334,30 @@ bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
 	assert(conj->size > 0);
 	assert(conj->page_first_pos != SIZE_MAX);
 
+	/*
+	 * If the conjunction has a sparse page, the result has
+	 * no more bits than the page, so only these bits are
+	 * tested in the rest of the pages.
+	 */
+	struct bitset_page *sparse = NULL;
+	for (size_t b = 0; b < conj->size; b++) {
+		if (!conj->pre_nots[b] &&
+		    bitset_page_is_array(conj->pages[b]) &&
+		    (sparse == NULL ||
+		     conj->pages[b]->cardinality < sparse->cardinality))
+			sparse = conj->pages[b];
+	}
+	if (sparse != NULL) {
+		bitset_page_set_zeros(dst);
+		void *data = bitset_page_data(dst);
+		const uint16_t *array = bitset_page_array(sparse);
+		for (uint32_t i = 0; i < sparse->cardinality; i++) {
+			if (bitset_iterator_conj_test(conj, array[i]))
+				bit_set(data, array[i]);
+		}
+		return;
+	}
+
 	bitset_page_set_ones(dst);
 	for (size_t b = 0; b < conj->size; b++) {
 		if (!conj->pre_nots[b]) {
@@ -369,7 +422,11 @@ bitset_iterator_first_page(struct bitset_iterator *it)
 
 	/* Rewind all conjunctions to first positions */
 	for (size_t c = 0; c < it->size; c++) {
-		bitset_iterator_conj_rewind(&it->conjs[c], 0);
+		struct bitset_iterator_conj *conj = &it->conjs[c];
+		conj->page_first_pos = 0;
+		for (size_t b = 0; b < conj->size; b++)
+			conj->pages[b] = NULL;
+		bitset_iterator_conj_rewind(conj, 0);
 	}
 
 	/* Prepare the result page */
@@ -44,6 +44,24 @@ bitset_page_create(struct bitset_page *page);
 extern inline void
 bitset_page_destroy(struct bitset_page *page);
 
+extern inline bool
+bitset_page_is_array(const struct bitset_page *page);
+
+extern inline uint16_t *
+bitset_page_array(struct bitset_page *page);
+
+extern inline size_t
+bitset_page_array_alloc_size(uint32_t capacity);
+
+extern inline void
+bitset_page_array_create(struct bitset_page *page, uint32_t capacity);
+
+extern inline uint32_t
+bitset_page_array_lower_bound(struct bitset_page *page, size_t pos);
+
+extern inline bool
+bitset_page_test(struct bitset_page *page, size_t pos);
+
 extern inline size_t
 bitset_page_first_pos(size_t pos);
 
@@ -67,6 +85,13 @@ void
 bitset_page_dump(struct bitset_page *page, FILE *stream)
 {
 	fprintf(stream, "Page %zu:\n", page->first_pos);
+	if (bitset_page_is_array(page)) {
+		uint16_t *array = bitset_page_array(page);
+		for (uint32_t i = 0; i < page->cardinality; i++)
+			fprintf(stream, "%u ", (unsigned) array[i]);
+		fprintf(stream, "\n--\n");
+		return;
+	}
 	char *d = bitset_page_data(page);
 	for (int i = 0; i < BITSET_PAGE_DATA_SIZE; i++) {
 		fprintf(stream, "%x ", *d);
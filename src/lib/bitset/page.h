@@ -55,7 +55,14 @@ extern "C" {
 
 enum {
 	/** How many bytes to store in one page */
-	BITSET_PAGE_DATA_SIZE = 160
+	BITSET_PAGE_DATA_SIZE = 160,
+	/** Initial capacity of an array page */
+	BITSET_PAGE_ARRAY_MIN = 4,
+	/**
+	 * Max capacity of an array page. A page with more bits set
+	 * is a bitmap, since 16-bit positions would take more room.
+	 */
+	BITSET_PAGE_ARRAY_MAX = 64
 };
 
 #if defined(ENABLE_AVX)
@@ -128,6 +135,70 @@ bitset_page_destroy(struct bitset_page *page)
 	/* nothing */
 }
 
+/**
+ * Sparse pages store positions of the bits set instead of a bitmap,
+ * like array containers of roaring bitmaps do.
+ */
+inline bool
+bitset_page_is_array(const struct bitset_page *page)
+{
+	return page->capacity > 0;
+}
+
+inline uint16_t *
+bitset_page_array(struct bitset_page *page)
+{
+	assert(bitset_page_is_array(page));
+	return (uint16_t *) page->data;
+}
+
+inline size_t
+bitset_page_array_alloc_size(uint32_t capacity)
+{
+	assert(capacity <= BITSET_PAGE_ARRAY_MAX);
+	return sizeof(struct bitset_page) + capacity * sizeof(uint16_t);
+}
+
+inline void
+bitset_page_array_create(struct bitset_page *page, uint32_t capacity)
+{
+	assert(capacity > 0);
+	memset(page, 0, sizeof(*page));
+	page->capacity = capacity;
+}
+
+/**
+ * @brief Find the first position in array \a page which is not
+ * less than \a pos
+ * @return index of the position in the array
+ */
+inline uint32_t
+bitset_page_array_lower_bound(struct bitset_page *page, size_t pos)
+{
+	const uint16_t *array = bitset_page_array(page);
+	uint32_t begin = 0, end = page->cardinality;
+	while (begin < end) {
+		uint32_t mid = (begin + end) / 2;
+		if (array[mid] < pos)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	return begin;
+}
+
+/**
+ * @brief Test bit \a pos (relative to the page start) of a page
+ */
+inline bool
+bitset_page_test(struct bitset_page *page, size_t pos)
+{
+	if (!bitset_page_is_array(page))
+		return bit_test(bitset_page_data(page), pos);
+	uint32_t i = bitset_page_array_lower_bound(page, pos);
+	return i < page->cardinality && bitset_page_array(page)[i] == pos;
+}
+
 inline size_t
 bitset_page_first_pos(size_t pos) {
 	return pos - (pos % (BITSET_PAGE_DATA_SIZE * CHAR_BIT));
@@ -147,9 +218,30 @@ bitset_page_set_ones(struct bitset_page *page)
 	memset(data, -1, BITSET_PAGE_DATA_SIZE);
 }
 
+/*
+ * Set operations below store the result into \a dst, which must
+ * be a bitmap page. \a src may be a page of any kind.
+ */
+
 inline void
 bitset_page_and(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(!bitset_page_is_array(dst));
+	if (bitset_page_is_array(src)) {
+		void *data = bitset_page_data(dst);
+		const uint16_t *array = bitset_page_array(src);
+		uint16_t keep[BITSET_PAGE_ARRAY_MAX];
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < src->cardinality; i++) {
+			if (bit_test(data, array[i]))
+				keep[count++] = array[i];
+		}
+		memset(data, 0, BITSET_PAGE_DATA_SIZE);
+		for (uint32_t i = 0; i < count; i++)
+			bit_set(data, keep[i]);
+		return;
+	}
+
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
 
@@ -163,6 +255,15 @@ bitset_page_and(struct bitset_page *dst, struct bitset_page *src)
 inline void
 bitset_page_nand(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(!bitset_page_is_array(dst));
+	if (bitset_page_is_array(src)) {
+		void *data = bitset_page_data(dst);
+		const uint16_t *array = bitset_page_array(src);
+		for (uint32_t i = 0; i < src->cardinality; i++)
+			bit_clear(data, array[i]);
+		return;
+	}
+
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
 
@@ -176,6 +277,15 @@ bitset_page_nand(struct bitset_page *dst, struct bitset_page *src)
 inline void
 bitset_page_or(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(!bitset_page_is_array(dst));
+	if (bitset_page_is_array(src)) {
+		void *data = bitset_page_data(dst);
+		const uint16_t *array = bitset_page_array(src);
+		for (uint32_t i = 0; i < src->cardinality; i++)
+			bit_set(data, array[i]);
+		return;
+	}
+
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
 
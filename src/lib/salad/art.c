@@ -0,0 +1,921 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "art.h"
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <limits.h>
+
+/*------------------------------------------------------------------------- */
+/* ART internal structures definition */
+/*------------------------------------------------------------------------- */
+enum {
+	/* Max number of prefix bytes stored in a node. A longer
+	 * prefix is compared with the key of a leaf of the node. */
+	ART_PREFIX_MAX = 8
+};
+
+struct art_node {
+	/* enum art_node_type */
+	uint8_t type;
+	/* number of children */
+	uint16_t count;
+	/* length of the compressed path above the children */
+	uint32_t prefix_len;
+	/* first bytes of the compressed path */
+	uint8_t prefix[ART_PREFIX_MAX];
+};
+
+/* children are sorted by key byte */
+struct art_node4 {
+	struct art_node base;
+	uint8_t keys[4];
+	void *children[4];
+};
+
+struct art_node16 {
+	struct art_node base;
+	uint8_t keys[16];
+	void *children[16];
+};
+
+struct art_node48 {
+	struct art_node base;
+	/* position of a child plus one for each key byte, 0 if none */
+	uint8_t index[256];
+	void *children[48];
+};
+
+struct art_node256 {
+	struct art_node base;
+	void *children[256];
+};
+
+static const uint32_t art_node_capacity[] = { 4, 16, 48, 256 };
+
+static const uint32_t art_node_size[] = {
+	sizeof(struct art_node4), sizeof(struct art_node16),
+	sizeof(struct art_node48), sizeof(struct art_node256)
+};
+
+/* A node is replaced with a smaller one if it has so few children */
+static const uint32_t art_node_shrink_count[] = { 0, 3, 12, 40 };
+
+static inline uint32_t
+art_min(uint32_t a, uint32_t b)
+{
+	return a < b ? a : b;
+}
+
+/*------------------------------------------------------------------------- */
+/* ART leaf methods */
+/*------------------------------------------------------------------------- */
+
+/* A leaf is a record pointer with the lowest bit set */
+static inline bool
+art_is_leaf(const void *ptr)
+{
+	return ((uintptr_t)ptr & 1) != 0;
+}
+
+static inline void *
+art_leaf_make(void *record)
+{
+	assert(((uintptr_t)record & 1) == 0);
+	return (void *)((uintptr_t)record | 1);
+}
+
+static inline void *
+art_leaf_record(const void *leaf)
+{
+	return (void *)((uintptr_t)leaf & ~(uintptr_t)1);
+}
+
+static inline const uint8_t *
+art_leaf_key(const struct art *tree, const void *leaf, uint32_t *size)
+{
+	return (const uint8_t *)
+		tree->key_f(art_leaf_record(leaf), tree->key_arg, size);
+}
+
+static bool
+art_leaf_matches(const struct art *tree, const void *leaf,
+		 const uint8_t *key, uint32_t size)
+{
+	uint32_t leaf_size;
+	const uint8_t *leaf_key = art_leaf_key(tree, leaf, &leaf_size);
+	return leaf_size == size && memcmp(leaf_key, key, size) == 0;
+}
+
+/*
+ * Compare two keys: -1 if a < b, 1 if a > b, 0 if a starts with b.
+ */
+static int
+art_key_cmp(const uint8_t *a, uint32_t a_size,
+	    const uint8_t *b, uint32_t b_size)
+{
+	int r = memcmp(a, b, art_min(a_size, b_size));
+	if (r != 0)
+		return r < 0 ? -1 : 1;
+	return a_size >= b_size ? 0 : -1;
+}
+
+/*------------------------------------------------------------------------- */
+/* ART node methods */
+/*------------------------------------------------------------------------- */
+
+static struct art_node *
+art_node_new(struct art *tree, enum art_node_type type)
+{
+	struct art_node *node;
+	if (tree->free_nodes[type] != NULL) {
+		node = (struct art_node *)tree->free_nodes[type];
+		tree->free_nodes[type] = *(void **)node;
+	} else {
+		matras_id_t unused_id;
+		node = (struct art_node *)
+			matras_alloc(&tree->mtab[type], &unused_id);
+		if (node == NULL)
+			return NULL;
+	}
+	node->type = type;
+	node->count = 0;
+	node->prefix_len = 0;
+	if (type == ART_NODE48) {
+		struct art_node48 *n = (struct art_node48 *)node;
+		memset(n->index, 0, sizeof(n->index));
+		memset(n->children, 0, sizeof(n->children));
+	} else if (type == ART_NODE256) {
+		struct art_node256 *n = (struct art_node256 *)node;
+		memset(n->children, 0, sizeof(n->children));
+	}
+	return node;
+}
+
+static void
+art_node_free(struct art *tree, struct art_node *node)
+{
+	enum art_node_type type = (enum art_node_type)node->type;
+	*(void **)node = tree->free_nodes[type];
+	tree->free_nodes[type] = node;
+}
+
+static void
+art_node_set_prefix(struct art_node *node, const uint8_t *prefix,
+		    uint32_t len)
+{
+	node->prefix_len = len;
+	memcpy(node->prefix, prefix, art_min(len, ART_PREFIX_MAX));
+}
+
+/* Keys and children of sorted (4 and 16) nodes */
+static inline uint8_t *
+art_node_keys(const struct art_node *node)
+{
+	if (node->type == ART_NODE4)
+		return ((struct art_node4 *)node)->keys;
+	assert(node->type == ART_NODE16);
+	return ((struct art_node16 *)node)->keys;
+}
+
+static inline void **
+art_node_children(const struct art_node *node)
+{
+	if (node->type == ART_NODE4)
+		return ((struct art_node4 *)node)->children;
+	assert(node->type == ART_NODE16);
+	return ((struct art_node16 *)node)->children;
+}
+
+/*
+ * Position of the child with the least key byte not less than c
+ * (the greatest one not greater than c if reverse) or -1 if none.
+ * A position is an index of a child in 4 and 16 nodes and a key
+ * byte in 48 and 256 nodes.
+ */
+static int
+art_node_seek(const struct art_node *node, int c, bool reverse)
+{
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16: {
+		const uint8_t *keys = art_node_keys(node);
+		int n = node->count;
+		if (!reverse) {
+			for (int i = 0; i < n; i++)
+				if (keys[i] >= c)
+					return i;
+		} else {
+			for (int i = n - 1; i >= 0; i--)
+				if (keys[i] <= c)
+					return i;
+		}
+		return -1;
+	}
+	case ART_NODE48: {
+		const struct art_node48 *n = (const struct art_node48 *)node;
+		for (; c >= 0 && c < 256; c += reverse ? -1 : 1)
+			if (n->index[c] != 0)
+				return c;
+		return -1;
+	}
+	default: {
+		assert(node->type == ART_NODE256);
+		const struct art_node256 *n = (const struct art_node256 *)node;
+		for (; c >= 0 && c < 256; c += reverse ? -1 : 1)
+			if (n->children[c] != NULL)
+				return c;
+		return -1;
+	}
+	}
+}
+
+/* Position of the child following the one at pos or -1 */
+static int
+art_node_next(const struct art_node *node, int pos, bool reverse)
+{
+	pos += reverse ? -1 : 1;
+	if (node->type == ART_NODE4 || node->type == ART_NODE16)
+		return pos >= 0 && pos < node->count ? pos : -1;
+	if (pos < 0 || pos > UINT8_MAX)
+		return -1;
+	return art_node_seek(node, pos, reverse);
+}
+
+static uint8_t
+art_node_key(const struct art_node *node, int pos)
+{
+	if (node->type == ART_NODE4 || node->type == ART_NODE16)
+		return art_node_keys(node)[pos];
+	return (uint8_t)pos;
+}
+
+static void *
+art_node_child(const struct art_node *node, int pos)
+{
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16:
+		return art_node_children(node)[pos];
+	case ART_NODE48: {
+		const struct art_node48 *n = (const struct art_node48 *)node;
+		return n->children[n->index[pos] - 1];
+	}
+	default:
+		return ((const struct art_node256 *)node)->children[pos];
+	}
+}
+
+/* Pointer to the child with key byte c or NULL if none */
+static void **
+art_node_find_child(const struct art_node *node, uint8_t c)
+{
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16: {
+		const uint8_t *keys = art_node_keys(node);
+		for (int i = 0, n = node->count; i < n && keys[i] <= c; i++)
+			if (keys[i] == c)
+				return &art_node_children(node)[i];
+		return NULL;
+	}
+	case ART_NODE48: {
+		struct art_node48 *n = (struct art_node48 *)node;
+		return n->index[c] != 0 ? &n->children[n->index[c] - 1] : NULL;
+	}
+	default: {
+		struct art_node256 *n = (struct art_node256 *)node;
+		return n->children[c] != NULL ? &n->children[c] : NULL;
+	}
+	}
+}
+
+/* Add a child to a node that is not full */
+static void
+art_node_add_child(struct art_node *node, uint8_t c, void *child)
+{
+	assert(node->count < art_node_capacity[node->type]);
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16: {
+		uint8_t *keys = art_node_keys(node);
+		void **children = art_node_children(node);
+		int i = node->count;
+		for (; i > 0 && keys[i - 1] > c; i--) {
+			keys[i] = keys[i - 1];
+			children[i] = children[i - 1];
+		}
+		keys[i] = c;
+		children[i] = child;
+		break;
+	}
+	case ART_NODE48: {
+		struct art_node48 *n = (struct art_node48 *)node;
+		int slot = 0;
+		while (n->children[slot] != NULL)
+			slot++;
+		n->children[slot] = child;
+		n->index[c] = slot + 1;
+		break;
+	}
+	default:
+		((struct art_node256 *)node)->children[c] = child;
+		break;
+	}
+	node->count++;
+}
+
+static void
+art_node_remove_child_at(struct art_node *node, uint8_t c)
+{
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16: {
+		uint8_t *keys = art_node_keys(node);
+		void **children = art_node_children(node);
+		int i = 0;
+		while (keys[i] != c)
+			i++;
+		for (; i + 1 < node->count; i++) {
+			keys[i] = keys[i + 1];
+			children[i] = children[i + 1];
+		}
+		break;
+	}
+	case ART_NODE48: {
+		struct art_node48 *n = (struct art_node48 *)node;
+		n->children[n->index[c] - 1] = NULL;
+		n->index[c] = 0;
+		break;
+	}
+	default:
+		((struct art_node256 *)node)->children[c] = NULL;
+		break;
+	}
+	node->count--;
+}
+
+/* Copy the prefix and the children of a node to another one */
+static void
+art_node_copy(struct art_node *to, const struct art_node *from)
+{
+	to->prefix_len = from->prefix_len;
+	memcpy(to->prefix, from->prefix, sizeof(to->prefix));
+	for (int pos = art_node_seek(from, 0, false); pos >= 0;
+	     pos = art_node_next(from, pos, false))
+		art_node_add_child(to, art_node_key(from, pos),
+				   art_node_child(from, pos));
+}
+
+/* The leaf with the least key in a subtree */
+static const void *
+art_minimum(const void *node)
+{
+	while (!art_is_leaf(node)) {
+		const struct art_node *n = (const struct art_node *)node;
+		node = art_node_child(n, art_node_seek(n, 0, false));
+	}
+	return node;
+}
+
+/*
+ * The compressed path of a node at depth. A path that is longer
+ * than ART_PREFIX_MAX is taken from the key of a leaf of the node,
+ * so it is valid until the next call of key_f.
+ */
+static const uint8_t *
+art_node_prefix(const struct art *tree, const struct art_node *node,
+		uint32_t depth)
+{
+	if (node->prefix_len <= ART_PREFIX_MAX)
+		return node->prefix;
+	uint32_t size;
+	const uint8_t *key = art_leaf_key(tree, art_minimum(node), &size);
+	assert(size > depth + node->prefix_len);
+	(void) size;
+	return key + depth;
+}
+
+/*
+ * Replace a node having a single child with the child, merging
+ * the compressed paths.
+ */
+static void
+art_node_collapse(struct art *tree, void **ref, struct art_node *node)
+{
+	assert(node->type == ART_NODE4 && node->count == 1);
+	struct art_node4 *n = (struct art_node4 *)node;
+	void *child = n->children[0];
+	if (!art_is_leaf(child)) {
+		struct art_node *c = (struct art_node *)child;
+		uint8_t prefix[ART_PREFIX_MAX];
+		uint32_t len = art_min(node->prefix_len, ART_PREFIX_MAX);
+		memcpy(prefix, node->prefix, len);
+		if (len < ART_PREFIX_MAX)
+			prefix[len++] = n->keys[0];
+		memcpy(prefix + len, c->prefix,
+		       art_min(c->prefix_len, ART_PREFIX_MAX - len));
+		c->prefix_len += node->prefix_len + 1;
+		memcpy(c->prefix, prefix, art_min(c->prefix_len,
+						  ART_PREFIX_MAX));
+	}
+	*ref = child;
+	art_node_free(tree, node);
+}
+
+/*
+ * Remove a child from a node referenced by ref, shrinking the
+ * node if it becomes too sparse.
+ */
+static void
+art_node_remove_child(struct art *tree, void **ref, struct art_node *node,
+		      uint8_t c)
+{
+	/* Allocate first, so that the tree is intact on error */
+	struct art_node *smaller = NULL;
+	if (node->type != ART_NODE4 &&
+	    node->count - 1u <= art_node_shrink_count[node->type])
+		smaller = art_node_new(tree, (enum art_node_type)
+				       (node->type - 1));
+	art_node_remove_child_at(node, c);
+	if (smaller != NULL) {
+		art_node_copy(smaller, node);
+		art_node_free(tree, node);
+		*ref = smaller;
+	} else if (node->type == ART_NODE4 && node->count == 1) {
+		art_node_collapse(tree, ref, node);
+	}
+}
+
+/*------------------------------------------------------------------------- */
+/* ART methods */
+/*------------------------------------------------------------------------- */
+
+void
+art_init(struct art *tree, uint32_t extent_size,
+	 art_extent_alloc_t extent_alloc, art_extent_free_t extent_free,
+	 art_key_f key_f, void *key_arg)
+{
+	tree->root = NULL;
+	tree->size = 0;
+	tree->version = 0;
+	tree->key_f = key_f;
+	tree->key_arg = key_arg;
+	tree->extent_size = extent_size;
+	for (int type = 0; type < art_node_type_MAX; type++) {
+		/* round up to closest power of 2 */
+		int lz = __builtin_clz(art_node_size[type] - 1);
+		uint32_t block_size = 1u << (sizeof(int) * CHAR_BIT - lz);
+		matras_create(&tree->mtab[type], extent_size, block_size,
+			      extent_alloc, extent_free);
+		tree->free_nodes[type] = NULL;
+	}
+}
+
+void
+art_destroy(struct art *tree)
+{
+	for (int type = 0; type < art_node_type_MAX; type++)
+		matras_destroy(&tree->mtab[type]);
+	tree->root = NULL;
+	tree->size = 0;
+}
+
+void *
+art_find(const struct art *tree, const char *key_str, uint32_t size)
+{
+	const uint8_t *key = (const uint8_t *)key_str;
+	const void *node = tree->root;
+	uint32_t depth = 0;
+	while (node != NULL) {
+		if (art_is_leaf(node)) {
+			if (!art_leaf_matches(tree, node, key, size))
+				return NULL;
+			return art_leaf_record(node);
+		}
+		const struct art_node *n = (const struct art_node *)node;
+		if (size - depth <= n->prefix_len)
+			return NULL;
+		/* The rest of a long path is checked at the leaf */
+		if (memcmp(n->prefix, key + depth,
+			   art_min(n->prefix_len, ART_PREFIX_MAX)) != 0)
+			return NULL;
+		depth += n->prefix_len;
+		void **child = art_node_find_child(n, key[depth]);
+		if (child == NULL)
+			return NULL;
+		node = *child;
+		depth++;
+	}
+	return NULL;
+}
+
+int
+art_insert(struct art *tree, const char *key_str, uint32_t size,
+	   void *record, void **replaced)
+{
+	const uint8_t *key = (const uint8_t *)key_str;
+	*replaced = NULL;
+	void **ref = &tree->root;
+	uint32_t depth = 0;
+	while (true) {
+		void *node = *ref;
+		if (node == NULL) {
+			*ref = art_leaf_make(record);
+			break;
+		}
+		if (art_is_leaf(node)) {
+			uint32_t leaf_size;
+			const uint8_t *leaf_key =
+				art_leaf_key(tree, node, &leaf_size);
+			uint32_t limit = art_min(size, leaf_size);
+			uint32_t i = depth;
+			while (i < limit && key[i] == leaf_key[i])
+				i++;
+			if (i == size && i == leaf_size) {
+				*replaced = art_leaf_record(node);
+				*ref = art_leaf_make(record);
+				tree->version++;
+				return 0;
+			}
+			/* Keys are prefix-free */
+			assert(i < limit);
+			uint8_t leaf_c = leaf_key[i];
+			struct art_node *n = art_node_new(tree, ART_NODE4);
+			if (n == NULL)
+				return -1;
+			art_node_set_prefix(n, key + depth, i - depth);
+			art_node_add_child(n, leaf_c, node);
+			art_node_add_child(n, key[i], art_leaf_make(record));
+			*ref = n;
+			break;
+		}
+		struct art_node *n = (struct art_node *)node;
+		if (n->prefix_len > 0) {
+			const uint8_t *prefix = art_node_prefix(tree, n, depth);
+			uint32_t limit = art_min(n->prefix_len, size - depth);
+			uint32_t i = 0;
+			while (i < limit && prefix[i] == key[depth + i])
+				i++;
+			if (i < n->prefix_len) {
+				/* Split the path at the first mismatch */
+				assert(i < limit);
+				struct art_node *parent =
+					art_node_new(tree, ART_NODE4);
+				if (parent == NULL)
+					return -1;
+				art_node_set_prefix(parent, prefix, i);
+				uint8_t c = prefix[i];
+				n->prefix_len -= i + 1;
+				memmove(n->prefix, prefix + i + 1,
+					art_min(n->prefix_len, ART_PREFIX_MAX));
+				art_node_add_child(parent, c, n);
+				art_node_add_child(parent, key[depth + i],
+						   art_leaf_make(record));
+				*ref = parent;
+				break;
+			}
+			depth += n->prefix_len;
+		}
+		assert(depth < size);
+		void **child = art_node_find_child(n, key[depth]);
+		if (child != NULL) {
+			ref = child;
+			depth++;
+			continue;
+		}
+		if (n->count == art_node_capacity[n->type]) {
+			struct art_node *grown = art_node_new(tree,
+				(enum art_node_type)(n->type + 1));
+			if (grown == NULL)
+				return -1;
+			art_node_copy(grown, n);
+			art_node_free(tree, n);
+			*ref = grown;
+			n = grown;
+		}
+		art_node_add_child(n, key[depth], art_leaf_make(record));
+		break;
+	}
+	tree->size++;
+	tree->version++;
+	return 0;
+}
+
+void *
+art_delete(struct art *tree, const char *key_str, uint32_t size)
+{
+	const uint8_t *key = (const uint8_t *)key_str;
+	void **ref = &tree->root;
+	uint32_t depth = 0;
+	void *record;
+	if (*ref == NULL)
+		return NULL;
+	if (art_is_leaf(*ref)) {
+		if (!art_leaf_matches(tree, *ref, key, size))
+			return NULL;
+		record = art_leaf_record(*ref);
+		*ref = NULL;
+	} else {
+		while (true) {
+			struct art_node *n = (struct art_node *)*ref;
+			if (size - depth <= n->prefix_len)
+				return NULL;
+			if (memcmp(n->prefix, key + depth,
+				   art_min(n->prefix_len, ART_PREFIX_MAX)) != 0)
+				return NULL;
+			depth += n->prefix_len;
+			void **child = art_node_find_child(n, key[depth]);
+			if (child == NULL)
+				return NULL;
+			if (!art_is_leaf(*child)) {
+				ref = child;
+				depth++;
+				continue;
+			}
+			if (!art_leaf_matches(tree, *child, key, size))
+				return NULL;
+			record = art_leaf_record(*child);
+			art_node_remove_child(tree, ref, n, key[depth]);
+			break;
+		}
+	}
+	tree->size--;
+	tree->version++;
+	return record;
+}
+
+size_t
+art_size(const struct art *tree)
+{
+	return tree->size;
+}
+
+size_t
+art_mem_used(const struct art *tree)
+{
+	size_t result = 0;
+	for (int type = 0; type < art_node_type_MAX; type++)
+		result += matras_extent_count(&tree->mtab[type]);
+	return result * tree->extent_size;
+}
+
+/*------------------------------------------------------------------------- */
+/* ART iterator methods */
+/*------------------------------------------------------------------------- */
+
+static int
+art_buf_reserve(char **buf, uint32_t *capacity, uint32_t size)
+{
+	if (size <= *capacity && *buf != NULL)
+		return 0;
+	uint32_t new_capacity = *capacity > 0 ? *capacity : 64;
+	while (new_capacity < size)
+		new_capacity *= 2;
+	char *new_buf = (char *)realloc(*buf, new_capacity);
+	if (new_buf == NULL)
+		return -1;
+	*buf = new_buf;
+	*capacity = new_capacity;
+	return 0;
+}
+
+static int
+art_iterator_push(struct art_iterator *itr, struct art_node *node, int pos)
+{
+	if (itr->stack_size == itr->stack_capacity) {
+		uint32_t capacity = itr->stack_capacity > 0 ?
+				    itr->stack_capacity * 2 : 16;
+		struct art_iterator_frame *stack = (struct art_iterator_frame *)
+			realloc(itr->stack, capacity * sizeof(*stack));
+		if (stack == NULL)
+			return -1;
+		itr->stack = stack;
+		itr->stack_capacity = capacity;
+	}
+	itr->stack[itr->stack_size].node = node;
+	itr->stack[itr->stack_size].pos = pos;
+	itr->stack_size++;
+	return 0;
+}
+
+/* Go to the first (last if reverse) leaf of a subtree */
+static int
+art_iterator_descend(struct art_iterator *itr, void *node)
+{
+	while (!art_is_leaf(node)) {
+		struct art_node *n = (struct art_node *)node;
+		int pos = art_node_seek(n, itr->reverse ? UINT8_MAX : 0,
+					itr->reverse);
+		assert(pos >= 0);
+		if (art_iterator_push(itr, n, pos) != 0)
+			return -1;
+		node = art_node_child(n, pos);
+	}
+	itr->leaf = node;
+	return 0;
+}
+
+/* Go to the leaf following the current one */
+static int
+art_iterator_advance(struct art_iterator *itr)
+{
+	itr->leaf = NULL;
+	while (itr->stack_size > 0) {
+		struct art_iterator_frame *top =
+			&itr->stack[itr->stack_size - 1];
+		int pos = art_node_next(top->node, top->pos, itr->reverse);
+		if (pos < 0) {
+			itr->stack_size--;
+			continue;
+		}
+		top->pos = pos;
+		return art_iterator_descend(itr, art_node_child(top->node,
+								pos));
+	}
+	return 0;
+}
+
+/*
+ * Find the first leaf accepted by the iterator key: the first
+ * one greater than the key (the last one less than the key if
+ * reverse), or starting with it if include is set.
+ */
+static int
+art_iterator_seek(struct art_iterator *itr)
+{
+	const struct art *tree = itr->tree;
+	const uint8_t *key = (const uint8_t *)itr->key;
+	uint32_t size = itr->key_size;
+	itr->stack_size = 0;
+	itr->leaf = NULL;
+	void *node = tree->root;
+	uint32_t depth = 0;
+	if (node == NULL)
+		return 0;
+	while (true) {
+		/*
+		 * How the keys of the subtree relate to the key:
+		 * less, greater or starting with it.
+		 */
+		int cmp;
+		if (art_is_leaf(node)) {
+			uint32_t leaf_size;
+			const uint8_t *leaf_key =
+				art_leaf_key(tree, node, &leaf_size);
+			cmp = art_key_cmp(leaf_key, leaf_size, key, size);
+		} else {
+			struct art_node *n = (struct art_node *)node;
+			uint32_t limit = art_min(n->prefix_len, size - depth);
+			uint32_t i = 0;
+			const uint8_t *prefix = NULL;
+			if (limit > 0) {
+				prefix = art_node_prefix(tree, n, depth);
+				while (i < limit && prefix[i] == key[depth + i])
+					i++;
+			}
+			if (i < limit) {
+				cmp = prefix[i] < key[depth + i] ? -1 : 1;
+			} else if (size - depth <= n->prefix_len) {
+				cmp = 0;
+			} else {
+				depth += n->prefix_len;
+				uint8_t c = key[depth];
+				int pos = art_node_seek(n, c, itr->reverse);
+				if (pos >= 0) {
+					if (art_iterator_push(itr, n, pos) != 0)
+						return -1;
+					void *child = art_node_child(n, pos);
+					if (art_node_key(n, pos) == c) {
+						node = child;
+						depth++;
+						continue;
+					}
+					return art_iterator_descend(itr, child);
+				}
+				cmp = itr->reverse ? 1 : -1;
+			}
+		}
+		bool accept = cmp == 0 ? itr->include :
+			      (cmp > 0) != itr->reverse;
+		if (accept)
+			return art_iterator_descend(itr, node);
+		return art_iterator_advance(itr);
+	}
+}
+
+void
+art_iterator_init(struct art_iterator *itr)
+{
+	memset(itr, 0, sizeof(*itr));
+	itr->eof = true;
+}
+
+void
+art_iterator_destroy(struct art_iterator *itr)
+{
+	free(itr->key);
+	free(itr->prefix);
+	free(itr->stack);
+	art_iterator_init(itr);
+}
+
+int
+art_iterator_start(struct art_iterator *itr, const struct art *tree,
+		   enum art_iterator_type type,
+		   const char *key, uint32_t key_size)
+{
+	itr->tree = tree;
+	itr->version = tree->version;
+	itr->reverse = type == ART_ITER_RPREFIX || type == ART_ITER_LE ||
+		       type == ART_ITER_LT;
+	itr->include = type != ART_ITER_GT && type != ART_ITER_LT;
+	itr->has_prefix = type == ART_ITER_PREFIX || type == ART_ITER_RPREFIX;
+	itr->need_seek = true;
+	itr->eof = true;
+	itr->stack_size = 0;
+	itr->leaf = NULL;
+	if (art_buf_reserve(&itr->key, &itr->key_capacity, key_size) != 0)
+		return -1;
+	memcpy(itr->key, key, key_size);
+	itr->key_size = key_size;
+	if (itr->has_prefix) {
+		if (art_buf_reserve(&itr->prefix, &itr->prefix_capacity,
+				    key_size) != 0)
+			return -1;
+		memcpy(itr->prefix, key, key_size);
+		itr->prefix_size = key_size;
+	}
+	itr->eof = false;
+	return 0;
+}
+
+int
+art_iterator_next(struct art_iterator *itr, void **record)
+{
+	*record = NULL;
+	if (itr->eof)
+		return 0;
+	int rc;
+	if (itr->need_seek || itr->version != itr->tree->version) {
+		/* The tree was changed, find the place again */
+		rc = art_iterator_seek(itr);
+		itr->version = itr->tree->version;
+	} else {
+		rc = art_iterator_advance(itr);
+	}
+	if (rc != 0) {
+		itr->need_seek = true;
+		return -1;
+	}
+	itr->need_seek = false;
+	if (itr->leaf == NULL) {
+		itr->eof = true;
+		return 0;
+	}
+	uint32_t size;
+	const uint8_t *key = art_leaf_key(itr->tree, itr->leaf, &size);
+	if (itr->has_prefix &&
+	    (size < itr->prefix_size ||
+	     memcmp(key, itr->prefix, itr->prefix_size) != 0)) {
+		itr->eof = true;
+		return 0;
+	}
+	if (art_buf_reserve(&itr->key, &itr->key_capacity, size) != 0) {
+		itr->need_seek = true;
+		return -1;
+	}
+	memcpy(itr->key, key, size);
+	itr->key_size = size;
+	itr->include = false;
+	*record = art_leaf_record(itr->leaf);
+	return 0;
+}
@@ -0,0 +1,258 @@
+#ifndef INCLUDES_TARANTOOL_SALAD_ART_H
+#define INCLUDES_TARANTOOL_SALAD_ART_H
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "small/matras.h"
+
+/**
+ * In-memory adaptive radix tree (Leis et al., "The Adaptive Radix
+ * Tree: ARTful Indexing for Main-Memory Databases").
+ *
+ * The tree maps byte string keys to records and keeps them in
+ * memcmp() order. Inner nodes grow from 4 to 16, 48 and 256
+ * children as needed, and chains of single-child nodes are
+ * collapsed into a prefix of the next node.
+ *
+ * Leaves are the records themselves: a record pointer must be
+ * at least 2-byte aligned, and its key is fetched with a callback
+ * when the tree needs to compare it. Keys must be prefix-free,
+ * i.e. no key may be a prefix of another key, e.g. by ending each
+ * key with a terminator or by making all keys of the same length.
+ */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/* pointers to node allocation and deallocations functions */
+typedef void *(*art_extent_alloc_t)();
+typedef void (*art_extent_free_t)(void *);
+
+/**
+ * Get the key of a record. The returned pointer must stay valid
+ * until the next call of the function.
+ */
+typedef const char *(*art_key_f)(void *record, void *arg,
+				  uint32_t *key_size);
+
+enum art_node_type {
+	ART_NODE4,
+	ART_NODE16,
+	ART_NODE48,
+	ART_NODE256,
+	art_node_type_MAX
+};
+
+/* Main art struct */
+struct art
+{
+	/* Root node, a tagged leaf or NULL */
+	void *root;
+	/* Number of records in the tree */
+	size_t size;
+	/* Unique version that increments on every tree modification */
+	unsigned version;
+	/* Key of a record */
+	art_key_f key_f;
+	void *key_arg;
+	/* Size of an extent of matras */
+	uint32_t extent_size;
+	/* A matras and a list of free nodes of each node type */
+	struct matras mtab[art_node_type_MAX];
+	void *free_nodes[art_node_type_MAX];
+};
+
+/** Iteration types, see art_iterator_start() */
+enum art_iterator_type {
+	/* Keys starting with the key, ascending */
+	ART_ITER_PREFIX,
+	/* Keys starting with the key, descending */
+	ART_ITER_RPREFIX,
+	/* Keys greater than the key or starting with it, ascending */
+	ART_ITER_GE,
+	/* Keys greater than the key, except ones starting with it, ascending */
+	ART_ITER_GT,
+	/* Keys less than the key or starting with it, descending */
+	ART_ITER_LE,
+	/* Keys less than the key, descending */
+	ART_ITER_LT
+};
+
+struct art_iterator_frame {
+	struct art_node *node;
+	int pos;
+};
+
+/**
+ * Struct for iteration over a tree. The iterator keeps a copy of
+ * the key of the last record returned, so if the tree is changed,
+ * it finds its place again with the key on the next step.
+ */
+struct art_iterator
+{
+	/* Pointer to the tree */
+	const struct art *tree;
+	/* A version of the tree at the last step */
+	unsigned version;
+	/* Descending order */
+	bool reverse;
+	/* Records whose keys start with key are accepted */
+	bool include;
+	/* The position is to be found with key on the next step */
+	bool need_seek;
+	/* Flag that means that no more records left */
+	bool eof;
+	/* Only records whose keys start with prefix are returned */
+	bool has_prefix;
+	/* The search key or the key of the last record returned */
+	char *key;
+	uint32_t key_size;
+	uint32_t key_capacity;
+	char *prefix;
+	uint32_t prefix_size;
+	uint32_t prefix_capacity;
+	/* Current path in the tree, with the current leaf at the top */
+	struct art_iterator_frame *stack;
+	uint32_t stack_size;
+	uint32_t stack_capacity;
+	/* Current leaf, NULL if none */
+	void *leaf;
+};
+
+/**
+ * @brief Initialize a tree
+ * @param tree - pointer to a tree
+ * @param extent_size - size of extents allocated by extent_alloc
+ * @param extent_alloc - extent allocation function
+ * @param extent_free - extent deallocation function
+ * @param key_f - function returning the key of a record
+ * @param key_arg - argument of key_f
+ */
+void
+art_init(struct art *tree, uint32_t extent_size,
+	 art_extent_alloc_t extent_alloc, art_extent_free_t extent_free,
+	 art_key_f key_f, void *key_arg);
+
+/**
+ * @brief Destroy a tree
+ * @param tree - pointer to a tree
+ */
+void
+art_destroy(struct art *tree);
+
+/**
+ * @brief Find a record by its key
+ * @param tree - pointer to a tree
+ * @param key, key_size - the key
+ * @return the record or NULL if not found
+ */
+void *
+art_find(const struct art *tree, const char *key, uint32_t key_size);
+
+/**
+ * @brief Insert a record to the tree, replacing a record with
+ * the same key if there is one.
+ * @param tree - pointer to a tree
+ * @param key, key_size - the key of the record
+ * @param record - record to insert
+ * @param replaced - set to the replaced record or NULL
+ * @return 0 on success, -1 on memory error (the tree is unchanged)
+ */
+int
+art_insert(struct art *tree, const char *key, uint32_t key_size,
+	   void *record, void **replaced);
+
+/**
+ * @brief Delete a record from the tree
+ * @param tree - pointer to a tree
+ * @param key, key_size - the key of the record
+ * @return the deleted record or NULL if not found
+ */
+void *
+art_delete(struct art *tree, const char *key, uint32_t key_size);
+
+/**
+ * @brief Number of records in the tree
+ */
+size_t
+art_size(const struct art *tree);
+
+/**
+ * @brief Size of memory used by the tree
+ */
+size_t
+art_mem_used(const struct art *tree);
+
+/**
+ * @brief Initialize an iterator
+ * @param itr - pointer to an iterator
+ */
+void
+art_iterator_init(struct art_iterator *itr);
+
+/**
+ * @brief Free memory used by an iterator
+ * @param itr - pointer to an iterator
+ */
+void
+art_iterator_destroy(struct art_iterator *itr);
+
+/**
+ * @brief Start iteration over a tree. An empty key with
+ * ART_ITER_GE or ART_ITER_LE iterates over all records.
+ * @param itr - pointer to an initialized iterator
+ * @param tree - pointer to a tree
+ * @param type - iteration type, see enum art_iterator_type
+ * @param key, key_size - the key
+ * @return 0 on success, -1 on memory error
+ */
+int
+art_iterator_start(struct art_iterator *itr, const struct art *tree,
+		   enum art_iterator_type type,
+		   const char *key, uint32_t key_size);
+
+/**
+ * @brief Get the next record of an iteration
+ * @param itr - pointer to an iterator
+ * @param record - set to the next record or NULL at the end
+ * @return 0 on success, -1 on memory error
+ */
+int
+art_iterator_next(struct art_iterator *itr, void **record);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* INCLUDES_TARANTOOL_SALAD_ART_H */
@@ -136,6 +136,7 @@
  * void bps_tree_destroy(tree);
  * int bps_tree_build(tree, sorted_array, array_size);
  * bps_tree_elem_t *bps_tree_find(tree, key);
+ * void bps_tree_find_batch(tree, keys, count, results);
  * int bps_tree_insert(tree, new_elem, replaced_elem);
  * int bps_tree_delete(tree, elem);
  * size_t bps_tree_size(tree);
@@ -157,6 +158,11 @@
  * bool bps_tree_itr_prev(tree, itr);
  * void bps_tree_itr_freeze(tree, itr);
  * void bps_tree_itr_destroy(tree, itr);
+ * // order statistics (BPS_INNER_CHILD_COUNTS only):
+ * struct bps_tree_iterator bps_tree_itr_at(tree, offset);
+ * size_t bps_tree_itr_offset(tree, itr);
+ * size_t bps_tree_lower_bound_offset(tree, key, exact);
+ * size_t bps_tree_upper_bound_offset(tree, key, exact);
  */
 /* }}} */
 
@@ -268,6 +274,17 @@
 #error "BPS_TREE_COMPARE_KEY must be defined"
 #endif
 
+/**
+ * Function to check that two elements are the same element,
+ * not just equal ones. Must be defined if elements can't be
+ * compared with !=, for example if they are plain structures.
+ * Example:
+ * #define BPS_TREE_IS_IDENTICAL(a, b) ((a).ptr == (b).ptr)
+ */
+#ifndef BPS_TREE_IS_IDENTICAL
+#define BPS_TREE_IS_IDENTICAL(a, b) (!((a) != (b)))
+#endif
+
 /**
  * A switch to define the type of search in an array elements.
  * By default, bps_tree uses binary search to find a particular
@@ -277,6 +294,18 @@
  * #define BPS_BLOCK_LINEAR_SEARCH
  */
 
+/**
+ * A switch that makes every inner block keep the number of
+ * elements in the subtree of each of its children. It costs a
+ * size_t per child (so a smaller fanout of inner blocks) and an
+ * update of the counts along the path on every insertion and
+ * deletion, and in exchange the tree can find an element by its
+ * ordinal number and the number of elements less than a key in
+ * logarithmic time (see the "order statistics" functions below).
+ * To turn it on,
+ * #define BPS_INNER_CHILD_COUNTS
+ */
+
 /**
  * A switch that enables collection of executions of different
  * branches of code. Used only for debug purposes, I hope you
@@ -340,6 +369,7 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_build _bps_tree(build)
 #define bps_tree_destroy _bps_tree(destroy)
 #define bps_tree_find _bps_tree(find)
+#define bps_tree_find_batch _bps_tree(find_batch)
 #define bps_tree_insert _bps_tree(insert)
 #define bps_tree_delete _bps_tree(delete)
 #define bps_tree_size _bps_tree(size)
@@ -357,6 +387,10 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_itr_prev _bps_tree(itr_prev)
 #define bps_tree_itr_freeze _bps_tree(itr_freeze)
 #define bps_tree_itr_destroy _bps_tree(itr_destroy)
+#define bps_tree_itr_at _bps_tree(itr_at)
+#define bps_tree_itr_offset _bps_tree(itr_offset)
+#define bps_tree_lower_bound_offset _bps_tree(lower_bound_offset)
+#define bps_tree_upper_bound_offset _bps_tree(upper_bound_offset)
 #define bps_tree_debug_check _bps_tree(debug_check)
 #define bps_tree_print _bps_tree(print)
 #define bps_tree_debug_check_internal_functions \
@@ -374,6 +408,7 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_restore_block _bps_tree(restore_block)
 #define bps_tree_restore_block_ver _bps_tree(restore_block_ver)
 #define bps_tree_root _bps_tree(root)
+#define bps_tree_prefetch_block _bps_tree(prefetch_block)
 #define bps_tree_touch_block _bps_tree(touch_block)
 #define bps_tree_find_ins_point_key _bps_tree(find_ins_point_key)
 #define bps_tree_find_ins_point_elem _bps_tree(find_ins_point_elem)
@@ -391,6 +426,11 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_touch_leaf_path_max_elem _bps_tree(touch_leaf_path_max_elem)
 #define bps_tree_touch_path _bps_tree(touch_path_max_elem)
 #define bps_tree_process_replace _bps_tree(process_replace)
+#define bps_tree_subtree_count _bps_tree(subtree_count)
+#define bps_tree_set_child _bps_tree(set_child)
+#define bps_tree_add_path_count _bps_tree(add_path_count)
+#define bps_tree_update_counts_leaf _bps_tree(update_counts_leaf)
+#define bps_tree_update_counts_inner _bps_tree(update_counts_inner)
 #define bps_tree_debug_memmove _bps_tree(debug_memmove)
 #define bps_tree_insert_into_leaf _bps_tree(insert_into_leaf)
 #define bps_tree_insert_into_inner _bps_tree(insert_into_inner)
@@ -583,6 +623,21 @@ bps_tree_destroy(struct bps_tree *tree);
 bps_tree_elem_t *
 bps_tree_find(const struct bps_tree *tree, bps_tree_key_t key);
 
+/**
+ * @brief Find the first element equal to each of several keys.
+ *  Lookups go down the tree side by side, a level at a time,
+ *  so that a block needed by one of them is fetched from memory
+ *  while the others are searched.
+ * @param tree - pointer to a tree
+ * @param keys - keys that will be compared with elements
+ * @param count - number of keys
+ * @param results - filled with a pointer to the first equal
+ *  element or NULL for each key
+ */
+void
+bps_tree_find_batch(const struct bps_tree *tree, bps_tree_key_t *keys,
+		    size_t count, bps_tree_elem_t **results);
+
 /**
  * @brief Insert an element to the tree or replace an element in the tree
  * In case of replacing, if 'replaced' argument is not null,
@@ -761,6 +816,56 @@ bps_tree_itr_freeze(struct bps_tree *tree, struct bps_tree_iterator *itr);
 void
 bps_tree_itr_destroy(struct bps_tree *tree, struct bps_tree_iterator *itr);
 
+#ifdef BPS_INNER_CHILD_COUNTS
+/**
+ * @brief Get an iterator to the element with the given ordinal
+ *  number (the first element has offset 0). Logarithmic.
+ * @param tree - pointer to a tree
+ * @param offset - ordinal number of the element
+ * @return - Iterator to the element. Invalid if offset >= tree size.
+ */
+struct bps_tree_iterator
+bps_tree_itr_at(const struct bps_tree *tree, size_t offset);
+
+/**
+ * @brief Get the ordinal number of the element pointed by an
+ *  iterator, i.e. the number of elements less than it. Logarithmic.
+ *  The number is calculated in the current state of the tree,
+ *  even if the iterator is frozen.
+ * @param tree - pointer to a tree
+ * @param itr - pointer to tree iterator
+ * @return - Offset of the element. Size of the tree for invalid iterator.
+ */
+size_t
+bps_tree_itr_offset(const struct bps_tree *tree,
+		    struct bps_tree_iterator *itr);
+
+/**
+ * @brief Get the offset of the lower bound of the key, i.e. the
+ *  number of elements that are less than the key. Logarithmic.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - see bps_tree_lower_bound
+ * @return - Offset of the element bps_tree_lower_bound would point to.
+ */
+size_t
+bps_tree_lower_bound_offset(const struct bps_tree *tree, bps_tree_key_t key,
+			    bool *exact);
+
+/**
+ * @brief Get the offset of the upper bound of the key, i.e. the
+ *  number of elements that are less than or equal to the key.
+ *  Logarithmic.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - see bps_tree_upper_bound
+ * @return - Offset of the element bps_tree_upper_bound would point to.
+ */
+size_t
+bps_tree_upper_bound_offset(const struct bps_tree *tree, bps_tree_key_t key,
+			    bool *exact);
+#endif
+
 /**
  * @brief Debug self-checking. Returns bitmask of found errors (0
  * on success).
@@ -807,6 +912,20 @@ bps_tree_debug_check_internal_functions(bool assertme);
 /* Same as BPS_TREE_MEMMOVE but takes count of values instead of memory size */
 #define BPS_TREE_DATAMOVE(dst, src, num, dst_bck, src_bck) \
 	BPS_TREE_MEMMOVE(dst, src, (num) * sizeof((dst)[0]), dst_bck, src_bck)
+/* Same as BPS_TREE_DATAMOVE for child IDs, moves their counts too */
+#ifdef BPS_INNER_CHILD_COUNTS
+#define BPS_TREE_CHILDMOVE(dst, src, num, dst_bck, src_bck) do { \
+	BPS_TREE_DATAMOVE(dst, src, num, dst_bck, src_bck); \
+	BPS_TREE_DATAMOVE((dst_bck)->child_counts + \
+			  ((dst) - (dst_bck)->child_ids), \
+			  (src_bck)->child_counts + \
+			  ((src) - (src_bck)->child_ids), \
+			  num, dst_bck, src_bck); \
+} while (0)
+#else
+#define BPS_TREE_CHILDMOVE(dst, src, num, dst_bck, src_bck) \
+	BPS_TREE_DATAMOVE(dst, src, num, dst_bck, src_bck)
+#endif
 
 /**
  * Types of a block
@@ -835,9 +954,16 @@ enum bps_tree_max_sizes {
 		(BPS_TREE_BLOCK_SIZE - sizeof(struct bps_block)
 		 - 2 * sizeof(bps_tree_block_id_t) )
 		/ sizeof(bps_tree_elem_t),
+#ifdef BPS_INNER_CHILD_COUNTS
+	BPS_TREE_MAX_COUNT_IN_INNER =
+		(BPS_TREE_BLOCK_SIZE - sizeof(struct bps_block))
+		/ (sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t)
+		   + sizeof(size_t)),
+#else
 	BPS_TREE_MAX_COUNT_IN_INNER =
 		(BPS_TREE_BLOCK_SIZE - sizeof(struct bps_block))
 		/ (sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t)),
+#endif
 	BPS_TREE_MAX_DEPTH = 16
 };
 
@@ -881,6 +1007,10 @@ struct bps_inner {
 	struct bps_block header;
 	/* Ordered array of elements. Note -1 in size. See struct descr. */
 	bps_tree_elem_t elems[BPS_TREE_MAX_COUNT_IN_INNER - 1];
+#ifdef BPS_INNER_CHILD_COUNTS
+	/* Count of elements in the subtree of each child */
+	size_t child_counts[BPS_TREE_MAX_COUNT_IN_INNER];
+#endif
 	/* Corresponding child IDs */
 	bps_tree_block_id_t child_ids[BPS_TREE_MAX_COUNT_IN_INNER];
 };
@@ -1090,6 +1220,9 @@ bps_tree_build(struct bps_tree *tree, bps_tree_elem_t *sorted_array,
 			}
 			parents[i]->child_ids[parents[i]->header.size] =
 				insert_id;
+#ifdef BPS_INNER_CHILD_COUNTS
+			parents[i]->child_counts[parents[i]->header.size] = 0;
+#endif
 			if (new_id == (bps_tree_block_id_t)-1)
 				break;
 			if (i == depth - 2) {
@@ -1099,6 +1232,11 @@ bps_tree_build(struct bps_tree *tree, bps_tree_elem_t *sorted_array,
 			}
 		}
 
+#ifdef BPS_INNER_CHILD_COUNTS
+		for (bps_tree_block_id_t i = 0; i < depth - 1; i++)
+			parents[i]->child_counts[parents[i]->header.size] +=
+				leaf->header.size;
+#endif
 		bps_tree_elem_t insert_value = current[leaf->header.size - 1];
 		for (bps_tree_block_id_t i = 0; i < depth - 1; i++) {
 			parents[i]->header.size++;
@@ -1206,6 +1344,17 @@ bps_tree_root(const struct bps_tree *tree)
 	return (struct bps_block *)matras_get(&tree->matras, tree->root_id);
 }
 
+/**
+ * @brief Start loading a block into the cache.
+ */
+static inline void
+bps_tree_prefetch_block(const struct bps_block *block)
+{
+	const char *data = (const char *)block;
+	for (size_t i = 0; i < BPS_TREE_BLOCK_SIZE; i += 64)
+		__builtin_prefetch(data + i);
+}
+
 /**
  * @brief Get a pointer to block by it's ID.
  */
@@ -1738,6 +1887,166 @@ bps_tree_itr_destroy(struct bps_tree *tree, struct bps_tree_iterator *itr)
 	matras_destroy_read_view(&tree->matras, &itr->view);
 }
 
+#ifdef BPS_INNER_CHILD_COUNTS
+/**
+ * @brief Get an iterator to the element with the given ordinal
+ *  number (the first element has offset 0). Logarithmic.
+ * @param tree - pointer to a tree
+ * @param offset - ordinal number of the element
+ * @return - Iterator to the element. Invalid if offset >= tree size.
+ */
+inline struct bps_tree_iterator
+bps_tree_itr_at(const struct bps_tree *tree, size_t offset)
+{
+	struct bps_tree_iterator res;
+	matras_head_read_view(&res.view);
+	if (offset >= tree->size) {
+		res.block_id = (bps_tree_block_id_t)(-1);
+		res.pos = 0;
+		return res;
+	}
+	struct bps_block *block = bps_tree_root(tree);
+	bps_tree_block_id_t block_id = tree->root_id;
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos = 0;
+		while (offset >= inner->child_counts[pos]) {
+			offset -= inner->child_counts[pos];
+			pos++;
+			assert(pos < inner->header.size);
+		}
+		block_id = inner->child_ids[pos];
+		block = bps_tree_restore_block(tree, block_id);
+	}
+	assert(offset < (size_t)block->size);
+	res.block_id = block_id;
+	res.pos = (bps_tree_pos_t)offset;
+	return res;
+}
+
+/**
+ * @brief Get the ordinal number of the element pointed by an
+ *  iterator, i.e. the number of elements less than it. Logarithmic.
+ *  The number is calculated in the current state of the tree,
+ *  even if the iterator is frozen.
+ * @param tree - pointer to a tree
+ * @param itr - pointer to tree iterator
+ * @return - Offset of the element. Size of the tree for invalid iterator.
+ */
+inline size_t
+bps_tree_itr_offset(const struct bps_tree *tree,
+		    struct bps_tree_iterator *itr)
+{
+	bps_tree_elem_t *elem_ptr = bps_tree_itr_get_elem(tree, itr);
+	if (!elem_ptr)
+		return tree->size;
+	if (tree->root_id == (bps_tree_block_id_t)(-1))
+		return 0;
+	bps_tree_elem_t elem = *elem_ptr;
+	size_t offset = 0;
+	bool exact = false;
+	struct bps_block *block = bps_tree_root(tree);
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		if (exact)
+			pos = inner->header.size - 1;
+		else
+			pos = bps_tree_find_ins_point_elem(tree, inner->elems,
+							   inner->header.size - 1,
+							   elem, &exact);
+		for (bps_tree_pos_t j = 0; j < pos; j++)
+			offset += inner->child_counts[j];
+		block = bps_tree_restore_block(tree, inner->child_ids[pos]);
+	}
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	if (exact)
+		return offset + leaf->header.size - 1;
+	return offset + bps_tree_find_ins_point_elem(tree, leaf->elems,
+						     leaf->header.size,
+						     elem, &exact);
+}
+
+/**
+ * @brief Get the offset of the lower bound of the key, i.e. the
+ *  number of elements that are less than the key. Logarithmic.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - see bps_tree_lower_bound
+ * @return - Offset of the element bps_tree_lower_bound would point to.
+ */
+inline size_t
+bps_tree_lower_bound_offset(const struct bps_tree *tree, bps_tree_key_t key,
+			    bool *exact)
+{
+	bool local_result;
+	if (!exact)
+		exact = &local_result;
+	*exact = false;
+	if (tree->root_id == (bps_tree_block_id_t)(-1))
+		return 0;
+	size_t offset = 0;
+	struct bps_block *block = bps_tree_root(tree);
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_ins_point_key(tree, inner->elems,
+						  inner->header.size - 1,
+						  key, exact);
+		for (bps_tree_pos_t j = 0; j < pos; j++)
+			offset += inner->child_counts[j];
+		block = bps_tree_restore_block(tree, inner->child_ids[pos]);
+	}
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	return offset + bps_tree_find_ins_point_key(tree, leaf->elems,
+						    leaf->header.size,
+						    key, exact);
+}
+
+/**
+ * @brief Get the offset of the upper bound of the key, i.e. the
+ *  number of elements that are less than or equal to the key.
+ *  Logarithmic.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - see bps_tree_upper_bound
+ * @return - Offset of the element bps_tree_upper_bound would point to.
+ */
+inline size_t
+bps_tree_upper_bound_offset(const struct bps_tree *tree, bps_tree_key_t key,
+			    bool *exact)
+{
+	bool local_result;
+	if (!exact)
+		exact = &local_result;
+	*exact = false;
+	bool exact_test;
+	if (tree->root_id == (bps_tree_block_id_t)(-1))
+		return 0;
+	size_t offset = 0;
+	struct bps_block *block = bps_tree_root(tree);
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_after_ins_point_key(tree, inner->elems,
+							inner->header.size - 1,
+							key, &exact_test);
+		if (exact_test)
+			*exact = true;
+		for (bps_tree_pos_t j = 0; j < pos; j++)
+			offset += inner->child_counts[j];
+		block = bps_tree_restore_block(tree, inner->child_ids[pos]);
+	}
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	offset += bps_tree_find_after_ins_point_key(tree, leaf->elems,
+						    leaf->header.size,
+						    key, &exact_test);
+	if (exact_test)
+		*exact = true;
+	return offset;
+}
+#endif
+
 /**
  * @brief Find the first element that is equal to the key (comparator returns 0)
  * @param tree - pointer to a tree
@@ -1770,6 +2079,61 @@ bps_tree_find(const struct bps_tree *tree, bps_tree_key_t key)
 		return 0;
 }
 
+/**
+ * @brief Find the first element equal to each of several keys.
+ *  Lookups go down the tree side by side, a level at a time,
+ *  so that a block needed by one of them is fetched from memory
+ *  while the others are searched.
+ * @param tree - pointer to a tree
+ * @param keys - keys that will be compared with elements
+ * @param count - number of keys
+ * @param results - filled with a pointer to the first equal
+ *  element or NULL for each key
+ */
+inline void
+bps_tree_find_batch(const struct bps_tree *tree, bps_tree_key_t *keys,
+		    size_t count, bps_tree_elem_t **results)
+{
+	enum { BATCH = 8 };
+	if (tree->root_id == (bps_tree_block_id_t)(-1)) {
+		for (size_t k = 0; k < count; k++)
+			results[k] = 0;
+		return;
+	}
+	struct bps_block *blocks[BATCH];
+	for (size_t first = 0; first < count; first += BATCH) {
+		size_t n = count - first < (size_t) BATCH ?
+			   count - first : (size_t) BATCH;
+		bps_tree_key_t *batch_keys = keys + first;
+		for (size_t k = 0; k < n; k++)
+			blocks[k] = bps_tree_root(tree);
+		for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+			for (size_t k = 0; k < n; k++) {
+				struct bps_inner *inner =
+					(struct bps_inner *)blocks[k];
+				bool exact = false;
+				bps_tree_pos_t pos;
+				pos = bps_tree_find_ins_point_key(tree,
+						inner->elems,
+						inner->header.size - 1,
+						batch_keys[k], &exact);
+				blocks[k] = bps_tree_restore_block(tree,
+						inner->child_ids[pos]);
+				bps_tree_prefetch_block(blocks[k]);
+			}
+		}
+		for (size_t k = 0; k < n; k++) {
+			struct bps_leaf *leaf = (struct bps_leaf *)blocks[k];
+			bool exact = false;
+			bps_tree_pos_t pos;
+			pos = bps_tree_find_ins_point_key(tree, leaf->elems,
+							  leaf->header.size,
+							  batch_keys[k], &exact);
+			results[first + k] = exact ? leaf->elems + pos : 0;
+		}
+	}
+}
+
 /**
  * @brief Add a block to the garbage for future reuse
  */
@@ -2093,6 +2457,16 @@ bps_tree_debug_memmove(void *dst_arg, void *src_arg, size_t num,
 				assert(src < ((char *)src_inner->elems) +
 				       (BPS_TREE_MAX_COUNT_IN_INNER - 1) *
 				       sizeof(bps_tree_elem_t));
+#ifdef BPS_INNER_CHILD_COUNTS
+			} else if (dst >= ((char *)dst_inner->child_counts) &&
+				   dst < ((char *)dst_inner->child_counts) +
+				   BPS_TREE_MAX_COUNT_IN_INNER *
+				   sizeof(size_t)) {
+				assert(src >= (char *)src_inner->child_counts);
+				assert(src < ((char *)src_inner->child_counts) +
+				       BPS_TREE_MAX_COUNT_IN_INNER *
+				       sizeof(size_t));
+#endif
 			} else {
 				assert(dst >= ((char *)dst_inner->child_ids));
 				assert(dst < ((char *)dst_inner->child_ids) +
@@ -2113,6 +2487,15 @@ bps_tree_debug_memmove(void *dst_arg, void *src_arg, size_t num,
 					(BPS_TREE_MAX_COUNT_IN_INNER - 1) *
 					sizeof(bps_tree_elem_t)) {
 				/* nothing to do due to if condition */
+#ifdef BPS_INNER_CHILD_COUNTS
+			} else if (dst >= ((char *)dst_inner->child_counts)
+				   && dst <= ((char *)dst_inner->child_counts) +
+				   BPS_TREE_MAX_COUNT_IN_INNER * sizeof(size_t)
+				   && src >= (char *)src_inner->child_counts
+				   && src <= ((char *)src_inner->child_counts) +
+				   BPS_TREE_MAX_COUNT_IN_INNER * sizeof(size_t)) {
+				/* nothing to do due to if condition */
+#endif
 			} else {
 				assert(dst >= ((char *)dst_inner->child_ids));
 				assert(dst <= ((char *)dst_inner->child_ids) +
@@ -2130,6 +2513,150 @@ bps_tree_debug_memmove(void *dst_arg, void *src_arg, size_t num,
 }
 #endif
 
+/**
+ * @brief Count of elements in the subtree of a block.
+ */
+static inline size_t
+bps_tree_subtree_count(struct bps_block *block)
+{
+	if (block->type == BPS_TREE_BT_LEAF)
+		return block->size;
+	assert(block->type == BPS_TREE_BT_INNER);
+	size_t count = 0;
+#ifdef BPS_INNER_CHILD_COUNTS
+	struct bps_inner *inner = (struct bps_inner *)block;
+	for (bps_tree_pos_t i = 0; i < inner->header.size; i++)
+		count += inner->child_counts[i];
+#endif
+	return count;
+}
+
+/**
+ * @brief Set a child of an inner block (and its count if counts
+ *  are on).
+ */
+static inline void
+bps_tree_set_child(struct bps_tree *tree, struct bps_inner *inner,
+		   bps_tree_pos_t pos, bps_tree_block_id_t block_id)
+{
+	inner->child_ids[pos] = block_id;
+#ifdef BPS_INNER_CHILD_COUNTS
+	inner->child_counts[pos] = 0;
+	/* exclusive behaviuor for debug checks */
+	if (tree->root_id != (bps_tree_block_id_t) -1)
+		inner->child_counts[pos] = bps_tree_subtree_count(
+			bps_tree_restore_block(tree, block_id));
+#else
+	(void)tree;
+#endif
+}
+
+/**
+ * @brief Add delta to the counts of the path element and all
+ *  its ancestors in their parents.
+ */
+static inline void
+bps_tree_add_path_count(struct bps_tree *tree, bps_inner_path_elem *path,
+			int delta)
+{
+#ifdef BPS_INNER_CHILD_COUNTS
+	if (delta == 0)
+		return;
+	for (; path->parent; path = path->parent) {
+		bps_inner_path_elem *parent = path->parent;
+		parent->block = (struct bps_inner *)
+			bps_tree_touch_block(tree, parent->block_id);
+		parent->block->child_counts[path->pos_in_parent] += delta;
+	}
+#else
+	(void)tree;
+	(void)path;
+	(void)delta;
+#endif
+}
+
+/**
+ * @brief Fix the counts in the parent block after elements were
+ *  moved between the leaf and its siblings, and add delta (the
+ *  change of the tree size) to the counts of upper levels.
+ *  Siblings that were not collected (NULL or with NULL block)
+ *  are skipped.
+ */
+static inline void
+bps_tree_update_counts_leaf(struct bps_tree *tree,
+			    struct bps_leaf_path_elem *leaf_path_elem,
+			    struct bps_leaf_path_elem *ext1,
+			    struct bps_leaf_path_elem *ext2,
+			    struct bps_leaf_path_elem *ext3,
+			    struct bps_leaf_path_elem *ext4, int delta)
+{
+#ifdef BPS_INNER_CHILD_COUNTS
+	bps_inner_path_elem *parent = leaf_path_elem->parent;
+	if (!parent)
+		return;
+	parent->block = (struct bps_inner *)
+		bps_tree_touch_block(tree, parent->block_id);
+	struct bps_leaf_path_elem *elems[] = {
+		leaf_path_elem, ext1, ext2, ext3, ext4
+	};
+	for (size_t i = 0; i < sizeof(elems) / sizeof(elems[0]); i++) {
+		if (!elems[i] || !elems[i]->block)
+			continue;
+		assert(elems[i]->parent == parent);
+		parent->block->child_counts[elems[i]->pos_in_parent] =
+			elems[i]->block->header.size;
+	}
+	bps_tree_add_path_count(tree, parent, delta);
+#else
+	(void)tree;
+	(void)leaf_path_elem;
+	(void)ext1;
+	(void)ext2;
+	(void)ext3;
+	(void)ext4;
+	(void)delta;
+#endif
+}
+
+/**
+ * @brief Same as bps_tree_update_counts_leaf for an inner block.
+ */
+static inline void
+bps_tree_update_counts_inner(struct bps_tree *tree,
+			     bps_inner_path_elem *inner_path_elem,
+			     bps_inner_path_elem *ext1,
+			     bps_inner_path_elem *ext2,
+			     bps_inner_path_elem *ext3,
+			     bps_inner_path_elem *ext4, int delta)
+{
+#ifdef BPS_INNER_CHILD_COUNTS
+	bps_inner_path_elem *parent = inner_path_elem->parent;
+	if (!parent)
+		return;
+	parent->block = (struct bps_inner *)
+		bps_tree_touch_block(tree, parent->block_id);
+	bps_inner_path_elem *elems[] = {
+		inner_path_elem, ext1, ext2, ext3, ext4
+	};
+	for (size_t i = 0; i < sizeof(elems) / sizeof(elems[0]); i++) {
+		if (!elems[i] || !elems[i]->block)
+			continue;
+		assert(elems[i]->parent == parent);
+		parent->block->child_counts[elems[i]->pos_in_parent] =
+			bps_tree_subtree_count(&elems[i]->block->header);
+	}
+	bps_tree_add_path_count(tree, parent, delta);
+#else
+	(void)tree;
+	(void)inner_path_elem;
+	(void)ext1;
+	(void)ext2;
+	(void)ext3;
+	(void)ext4;
+	(void)delta;
+#endif
+}
+
 /**
  * @breif Insert an element into leaf block. There must be enough space.
  */
@@ -2184,15 +2711,15 @@ bps_tree_insert_into_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(inner->elems + pos + 1, inner->elems + pos,
 				  inner->header.size - pos - 1, inner, inner);
 		inner->elems[pos] = max_elem;
-		BPS_TREE_DATAMOVE(inner->child_ids + pos + 1,
-				  inner->child_ids + pos,
-				  inner->header.size - pos, inner, inner);
+		BPS_TREE_CHILDMOVE(inner->child_ids + pos + 1,
+				   inner->child_ids + pos,
+				   inner->header.size - pos, inner, inner);
 	} else {
 		if (pos > 0)
 			inner->elems[pos - 1] = *inner_path_elem->max_elem_copy;
 		*inner_path_elem->max_elem_copy = max_elem;
 	}
-	inner->child_ids[pos] = block_id;
+	bps_tree_set_child(tree, inner, pos, block_id);
 
 	inner->header.size++;
 }
@@ -2248,9 +2775,9 @@ bps_tree_delete_from_inner(struct bps_tree *tree,
 	if (pos < inner->header.size - 1) {
 		BPS_TREE_DATAMOVE(inner->elems + pos, inner->elems + pos + 1,
 				  inner->header.size - 2 - pos, inner, inner);
-		BPS_TREE_DATAMOVE(inner->child_ids + pos,
-				  inner->child_ids + pos + 1,
-				  inner->header.size - 1 - pos, inner, inner);
+		BPS_TREE_CHILDMOVE(inner->child_ids + pos,
+				   inner->child_ids + pos + 1,
+				   inner->header.size - 1 - pos, inner, inner);
 	} else if (pos > 0) {
 		*inner_path_elem->max_elem_copy = inner->elems[pos - 1];
 	}
@@ -2320,10 +2847,10 @@ bps_tree_move_elems_to_right_inner(struct bps_tree *tree,
 	assert(a->header.size >= num);
 	assert(b->header.size + num <= BPS_TREE_MAX_COUNT_IN_INNER);
 
-	BPS_TREE_DATAMOVE(b->child_ids + num, b->child_ids,
-			  b->header.size, b, b);
-	BPS_TREE_DATAMOVE(b->child_ids, a->child_ids + a->header.size - num,
-			  num, b, a);
+	BPS_TREE_CHILDMOVE(b->child_ids + num, b->child_ids,
+			   b->header.size, b, b);
+	BPS_TREE_CHILDMOVE(b->child_ids, a->child_ids + a->header.size - num,
+			   num, b, a);
 
 	if (!move_to_empty)
 		BPS_TREE_DATAMOVE(b->elems + num, b->elems,
@@ -2400,10 +2927,10 @@ bps_tree_move_elems_to_left_inner(struct bps_tree *tree,
 	assert(b->header.size >= num);
 	assert(a->header.size + num <= BPS_TREE_MAX_COUNT_IN_INNER);
 
-	BPS_TREE_DATAMOVE(a->child_ids + a->header.size, b->child_ids,
-			  num, a, b);
-	BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num,
-			  b->header.size - num, b, b);
+	BPS_TREE_CHILDMOVE(a->child_ids + a->header.size, b->child_ids,
+			   num, a, b);
+	BPS_TREE_CHILDMOVE(b->child_ids, b->child_ids + num,
+			   b->header.size - num, b, b);
 
 	if (!move_to_empty)
 		a->elems[a->header.size - 1] =
@@ -2519,8 +3046,8 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 	assert(pos >= 0);
 
 	if (!move_to_empty) {
-		BPS_TREE_DATAMOVE(b->child_ids + num, b->child_ids,
-				  b->header.size, b, b);
+		BPS_TREE_CHILDMOVE(b->child_ids + num, b->child_ids,
+				   b->header.size, b, b);
 		BPS_TREE_DATAMOVE(b->elems + num, b->elems,
 				  b->header.size - 1, b, b);
 	}
@@ -2528,12 +3055,12 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 	bps_tree_pos_t mid_part_size = a->header.size - pos;
 	if (mid_part_size > num) {
 		/* In fact insert to 'a' block, to the internal position */
-		BPS_TREE_DATAMOVE(b->child_ids,
-				  a->child_ids + a->header.size - num,
-				  num, b, a);
-		BPS_TREE_DATAMOVE(a->child_ids + pos + 1, a->child_ids + pos,
-				  mid_part_size - num, a, a);
-		a->child_ids[pos] = block_id;
+		BPS_TREE_CHILDMOVE(b->child_ids,
+				   a->child_ids + a->header.size - num,
+				   num, b, a);
+		BPS_TREE_CHILDMOVE(a->child_ids + pos + 1, a->child_ids + pos,
+				   mid_part_size - num, a, a);
+		bps_tree_set_child(tree, a, pos, block_id);
 
 		BPS_TREE_DATAMOVE(b->elems, a->elems + a->header.size - num,
 				  num - 1, b, a);
@@ -2550,12 +3077,12 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		a->elems[pos] = max_elem;
 	} else if (mid_part_size == num) {
 		/* In fact insert to 'a' block, to the last position */
-		BPS_TREE_DATAMOVE(b->child_ids,
-				  a->child_ids + a->header.size - num,
-				  num, b, a);
-		BPS_TREE_DATAMOVE(a->child_ids + pos + 1, a->child_ids + pos,
-				  mid_part_size - num, a, a);
-		a->child_ids[pos] = block_id;
+		BPS_TREE_CHILDMOVE(b->child_ids,
+				   a->child_ids + a->header.size - num,
+				   num, b, a);
+		BPS_TREE_CHILDMOVE(a->child_ids + pos + 1, a->child_ids + pos,
+				   mid_part_size - num, a, a);
+		bps_tree_set_child(tree, a, pos, block_id);
 
 		BPS_TREE_DATAMOVE(b->elems, a->elems + a->header.size - num,
 				  num - 1, b, a);
@@ -2569,12 +3096,12 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 	} else {
 		/* In fact insert to 'b' block */
 		bps_tree_pos_t new_pos = num - mid_part_size - 1;/* Can be 0 */
-		BPS_TREE_DATAMOVE(b->child_ids,
-				  a->child_ids + a->header.size - num + 1,
-				  new_pos, b, a);
-		b->child_ids[new_pos] = block_id;
-		BPS_TREE_DATAMOVE(b->child_ids + new_pos + 1,
-				  a->child_ids + pos, mid_part_size, b, a);
+		BPS_TREE_CHILDMOVE(b->child_ids,
+				   a->child_ids + a->header.size - num + 1,
+				   new_pos, b, a);
+		bps_tree_set_child(tree, b, new_pos, block_id);
+		BPS_TREE_CHILDMOVE(b->child_ids + new_pos + 1,
+				   a->child_ids + pos, mid_part_size, b, a);
 
 		if (pos == a->header.size) {
 			/* +1 */
@@ -2719,14 +3246,14 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 	if (pos >= num) {
 		/* In fact insert to 'b' block */
 		bps_tree_pos_t new_pos = pos - num; /* Can be 0 */
-		BPS_TREE_DATAMOVE(a->child_ids + a->header.size, b->child_ids,
-				  num, a, b);
-		BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num,
-				  new_pos, b, b);
-		b->child_ids[new_pos] = block_id;
-		BPS_TREE_DATAMOVE(b->child_ids + new_pos + 1,
-				  b->child_ids + pos,
-				  b->header.size - pos, b, b);
+		BPS_TREE_CHILDMOVE(a->child_ids + a->header.size, b->child_ids,
+				   num, a, b);
+		BPS_TREE_CHILDMOVE(b->child_ids, b->child_ids + num,
+				   new_pos, b, b);
+		bps_tree_set_child(tree, b, new_pos, block_id);
+		BPS_TREE_CHILDMOVE(b->child_ids + new_pos + 1,
+				   b->child_ids + pos,
+				   b->header.size - pos, b, b);
 
 		if (!move_to_empty)
 			a->elems[a->header.size - 1] =
@@ -2760,14 +3287,14 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 	} else {
 		/* In fact insert to 'a' block */
 		bps_tree_pos_t new_pos = a->header.size + pos; /* Can be 0 */
-		BPS_TREE_DATAMOVE(a->child_ids + a->header.size,
-				  b->child_ids, pos, a, b);
-		a->child_ids[new_pos] = block_id;
-		BPS_TREE_DATAMOVE(a->child_ids + new_pos + 1,
-				  b->child_ids + pos, num - 1 - pos, a, b);
+		BPS_TREE_CHILDMOVE(a->child_ids + a->header.size,
+				   b->child_ids, pos, a, b);
+		bps_tree_set_child(tree, a, new_pos, block_id);
+		BPS_TREE_CHILDMOVE(a->child_ids + new_pos + 1,
+				   b->child_ids + pos, num - 1 - pos, a, b);
 		if (!move_all)
-			BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num - 1,
-					  b->header.size - num + 1, b, b);
+			BPS_TREE_CHILDMOVE(b->child_ids, b->child_ids + num - 1,
+					   b->header.size - num + 1, b, b);
 
 		if (!move_to_empty)
 			a->elems[a->header.size - 1] =
@@ -3018,6 +3545,8 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 {
 	if (bps_tree_leaf_free_size(leaf_path_elem->block)) {
 		bps_tree_insert_into_leaf(tree, leaf_path_elem, new_elem);
+		bps_tree_update_counts_leaf(tree, leaf_path_elem,
+				0, 0, 0, 0, 1);
 		BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x0);
 		return 0;
 	}
@@ -3043,6 +3572,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_left_leaf(tree,
 					&left_ext, leaf_path_elem,
 					move_count, new_elem);
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x1);
 			return 0;
 		} else if (bps_tree_leaf_free_size(right_ext.block) > 0) {
@@ -3051,6 +3583,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_right_leaf(tree,
 					leaf_path_elem, &right_ext,
 					move_count, new_elem);
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x2);
 			return 0;
 		}
@@ -3061,6 +3596,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_left_leaf(tree,
 					&left_ext, leaf_path_elem,
 					move_count, new_elem);
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x3);
 			return 0;
 		}
@@ -3077,6 +3615,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_left_leaf(tree,
 					&left_ext, leaf_path_elem,
 					move_count, new_elem);
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x4);
 			return 0;
 		}
@@ -3087,6 +3628,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_right_leaf(tree,
 					leaf_path_elem, &right_ext,
 					move_count, new_elem);
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x5);
 			return 0;
 		}
@@ -3103,6 +3647,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_right_leaf(tree,
 					leaf_path_elem, &right_ext,
 					move_count, new_elem);
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x6);
 			return 0;
 		}
@@ -3318,8 +3865,8 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 		struct bps_inner *new_root = bps_tree_create_inner(tree,
 				&new_root_id);
 		new_root->header.size = 2;
-		new_root->child_ids[0] = tree->root_id;
-		new_root->child_ids[1] = new_block_id;
+		bps_tree_set_child(tree, new_root, 0, tree->root_id);
+		bps_tree_set_child(tree, new_root, 1, new_block_id);
 		new_root->elems[0] = tree->max_elem;
 		tree->root_id = new_root_id;
 		tree->max_elem = new_max_elem;
@@ -3329,6 +3876,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 		return 0;
 	}
 	assert(leaf_path_elem->parent);
+	bps_tree_update_counts_leaf(tree, leaf_path_elem,
+			&left_ext, &right_ext, &left_left_ext,
+			&right_right_ext, 0);
 	BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0xD);
 	return bps_tree_process_insert_inner(tree, leaf_path_elem->parent,
 			new_block_id, new_path_elem.pos_in_parent,
@@ -3348,6 +3898,8 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 	if (bps_tree_inner_free_size(inner_path_elem->block)) {
 		bps_tree_insert_into_inner(tree, inner_path_elem,
 					   block_id, pos, max_elem);
+		bps_tree_update_counts_inner(tree, inner_path_elem,
+				0, 0, 0, 0, 1);
 		BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x0);
 		return 0;
 	}
@@ -3371,6 +3923,9 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_left_inner(tree,
 					&left_ext, inner_path_elem, move_count,
 					block_id, pos, max_elem);
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x1);
 			return 0;
 		} else if (bps_tree_inner_free_size(right_ext.block) > 0) {
@@ -3379,6 +3934,9 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_right_inner(tree,
 					inner_path_elem, &right_ext,
 					move_count, block_id, pos, max_elem);
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x2);
 			return 0;
 		}
@@ -3389,6 +3947,9 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_left_inner(tree,
 					&left_ext, inner_path_elem,
 					move_count, block_id, pos, max_elem);
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x3);
 			return 0;
 		}
@@ -3405,6 +3966,9 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_left_inner(tree,
 					&left_ext, inner_path_elem, move_count,
 					block_id, pos, max_elem);
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x4);
 			return 0;
 		}
@@ -3415,6 +3979,9 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_right_inner(tree,
 					inner_path_elem, &right_ext,
 					move_count, block_id, pos, max_elem);
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x5);
 			return 0;
 		}
@@ -3431,6 +3998,9 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_right_inner(tree,
 					inner_path_elem, &right_ext,
 					move_count, block_id, pos, max_elem);
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x6);
 			return 0;
 		}
@@ -3634,8 +4204,8 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 		struct bps_inner *new_root =
 			bps_tree_create_inner(tree, &new_root_id);
 		new_root->header.size = 2;
-		new_root->child_ids[0] = tree->root_id;
-		new_root->child_ids[1] = new_block_id;
+		bps_tree_set_child(tree, new_root, 0, tree->root_id);
+		bps_tree_set_child(tree, new_root, 1, new_block_id);
 		new_root->elems[0] = tree->max_elem;
 		tree->root_id = new_root_id;
 		tree->max_elem = new_max_elem;
@@ -3644,6 +4214,9 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 		return 0;
 	}
 	assert(inner_path_elem->parent);
+	bps_tree_update_counts_inner(tree, inner_path_elem,
+			&left_ext, &right_ext, &left_left_ext,
+			&right_right_ext, 0);
 	BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0xD);
 	return bps_tree_process_insert_inner(tree, inner_path_elem->parent,
 			new_block_id, new_path_elem.pos_in_parent,
@@ -3669,6 +4242,8 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 
 	if (leaf_path_elem->block->header.size >=
 	    BPS_TREE_MAX_COUNT_IN_LEAF * 2 / 3) {
+		bps_tree_update_counts_leaf(tree, leaf_path_elem,
+				0, 0, 0, 0, -1);
 		BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x0);
 		return;
 	}
@@ -3694,6 +4269,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 				bps_tree_leaf_overmin_size(left_ext.block) / 2;
 			bps_tree_move_elems_to_right_leaf(tree, &left_ext,
 					leaf_path_elem, move_count);
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x1);
 			return;
 		} else if (bps_tree_leaf_overmin_size(right_ext.block) > 0) {
@@ -3701,6 +4279,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 				bps_tree_leaf_overmin_size(right_ext.block) / 2;
 			bps_tree_move_elems_to_left_leaf(tree, leaf_path_elem,
 					&right_ext, move_count);
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x2);
 			return;
 		}
@@ -3710,6 +4291,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 				bps_tree_leaf_overmin_size(left_ext.block) / 2;
 			bps_tree_move_elems_to_right_leaf(tree, &left_ext,
 					leaf_path_elem, move_count);
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x3);
 			return;
 		}
@@ -3725,6 +4309,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 					leaf_path_elem, move_count1);
 			bps_tree_move_elems_to_right_leaf(tree, &left_left_ext,
 					&left_ext, move_count2);
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x4);
 			return;
 		}
@@ -3735,6 +4322,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 				/ 2;
 			bps_tree_move_elems_to_left_leaf(tree, leaf_path_elem,
 					&right_ext, move_count);
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x5);
 			return;
 		}
@@ -3750,6 +4340,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 					&right_ext, move_count1);
 			bps_tree_move_elems_to_left_leaf(tree, &right_ext,
 					&right_right_ext, move_count2);
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x6);
 			return;
 		}
@@ -3785,6 +4378,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 	} else if (has_left_ext) {
 		if (leaf_path_elem->block->header.size +
 		    left_ext.block->header.size > BPS_TREE_MAX_COUNT_IN_LEAF) {
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0xA);
 			return;
 		}
@@ -3795,6 +4391,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 	} else if (has_right_ext) {
 		if (leaf_path_elem->block->header.size +
 		    right_ext.block->header.size > BPS_TREE_MAX_COUNT_IN_LEAF) {
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0xC);
 			return;
 		}
@@ -3804,6 +4403,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 		BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0xD);
 	} else {
 		if (leaf_path_elem->block->header.size > 0) {
+			bps_tree_update_counts_leaf(tree, leaf_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0xE);
 			return;
 		}
@@ -3821,6 +4423,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 	}
 
 	assert(leaf_path_elem->block->header.size == 0);
+	bps_tree_update_counts_leaf(tree, leaf_path_elem,
+			&left_ext, &right_ext, &left_left_ext,
+			&right_right_ext, 0);
 
 	struct bps_leaf *leaf = (struct bps_leaf*)leaf_path_elem->block;
 	if (leaf->prev_id == (bps_tree_block_id_t)(-1)) {
@@ -3857,6 +4462,8 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 
 	if (inner_path_elem->block->header.size >=
 	    BPS_TREE_MAX_COUNT_IN_INNER * 2 / 3) {
+		bps_tree_update_counts_inner(tree, inner_path_elem,
+				0, 0, 0, 0, -1);
 		BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x0);
 		return;
 	}
@@ -3881,6 +4488,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 				/ 2;
 			bps_tree_move_elems_to_right_inner(tree, &left_ext,
 					inner_path_elem, move_count);
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x1);
 			return;
 		} else if (bps_tree_inner_overmin_size(right_ext.block) > 0) {
@@ -3890,6 +4500,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 			bps_tree_move_elems_to_left_inner(tree,
 					inner_path_elem, &right_ext,
 					move_count);
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x2);
 			return;
 		}
@@ -3900,6 +4513,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 				/ 2;
 			bps_tree_move_elems_to_right_inner(tree, &left_ext,
 					inner_path_elem, move_count);
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x3);
 			return;
 		}
@@ -3916,6 +4532,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 					inner_path_elem, move_count1);
 			bps_tree_move_elems_to_right_inner(tree,
 					&left_left_ext, &left_ext, move_count2);
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x4);
 			return;
 		}
@@ -3927,6 +4546,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 			bps_tree_move_elems_to_left_inner(tree,
 					inner_path_elem, &right_ext,
 					move_count);
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x5);
 			return;
 		}
@@ -3943,6 +4565,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 					&right_ext, move_count1);
 			bps_tree_move_elems_to_left_inner(tree, &right_ext,
 					&right_right_ext, move_count2);
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x6);
 			return;
 		}
@@ -3978,6 +4603,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 	} else if (has_left_ext) {
 		if (inner_path_elem->block->header.size +
 		    left_ext.block->header.size > BPS_TREE_MAX_COUNT_IN_INNER) {
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0xA);
 			//throw 1;
 			return;
@@ -3990,6 +4618,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 		if (inner_path_elem->block->header.size +
 		    right_ext.block->header.size >
 		    BPS_TREE_MAX_COUNT_IN_INNER) {
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0xC);
 			//throw 2;
 			return;
@@ -4000,6 +4631,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 		BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0xD);
 	} else {
 		if (inner_path_elem->block->header.size > 1) {
+			bps_tree_update_counts_inner(tree, inner_path_elem,
+					&left_ext, &right_ext, &left_left_ext,
+					&right_right_ext, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0xE);
 			return;
 		}
@@ -4013,6 +4647,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 		return;
 	}
 	assert(inner_path_elem->block->header.size == 0);
+	bps_tree_update_counts_inner(tree, inner_path_elem,
+			&left_ext, &right_ext, &left_left_ext,
+			&right_right_ext, 0);
 
 	bps_tree_dispose_inner(tree, inner_path_elem->block,
 			inner_path_elem->block_id);
@@ -4161,7 +4798,8 @@ bps_tree_debug_check_block(const struct bps_tree *tree, struct bps_block *block,
 						       inner->child_ids[i]);
 			bps_tree_elem_t calc_max_elem =
 				bps_tree_debug_find_max_elem(tree, block);
-			if (inner->elems[i] != calc_max_elem)
+			if (!BPS_TREE_IS_IDENTICAL(inner->elems[i],
+						   calc_max_elem))
 				result |= 0x4000;
 		}
 		if (block->size > 1) {
@@ -4188,13 +4826,21 @@ bps_tree_debug_check_block(const struct bps_tree *tree, struct bps_block *block,
 				result |= 0x4000000;
 		}
 
-		for (bps_tree_pos_t i = 0; i < block->size; i++)
+		for (bps_tree_pos_t i = 0; i < block->size; i++) {
+			size_t count_before = *calc_count;
 			result |= bps_tree_debug_check_block(tree,
 				bps_tree_restore_block(tree,
 						       inner->child_ids[i]),
 				inner->child_ids[i], level - 1, calc_count,
 				expected_prev_id, expected_this_id,
 				check_fullness_next);
+#ifdef BPS_INNER_CHILD_COUNTS
+			if (inner->child_counts[i] != *calc_count - count_before)
+				result |= 0x8000000;
+#else
+			(void)count_before;
+#endif
+		}
 		return result;
 	}
 }
@@ -4220,7 +4866,8 @@ bps_tree_debug_check(const struct bps_tree *tree)
 		return result;
 	}
 	struct bps_block *root = bps_tree_root(tree);
-	if (tree->max_elem != bps_tree_debug_find_max_elem(tree, root))
+	if (!BPS_TREE_IS_IDENTICAL(tree->max_elem,
+				   bps_tree_debug_find_max_elem(tree, root)))
 		result |= 0x8;
 	size_t calc_count = 0;
 	bps_tree_block_id_t expected_prev_id = (bps_tree_block_id_t)(-1);
@@ -4586,12 +5233,14 @@ bps_tree_debug_check_move_to_right_leaf(struct bps_tree *tree, bool assertme)
 				}
 
 				if (a.header.size)
-					if (ma != a.elems[a.header.size - 1]) {
+					if (!BPS_TREE_IS_IDENTICAL(ma,
+						a.elems[a.header.size - 1])) {
 						result |= (1 << 5);
 						assert(!assertme);
 					}
 				if (b.header.size)
-					if (mb != b.elems[b.header.size - 1]) {
+					if (!BPS_TREE_IS_IDENTICAL(mb,
+						b.elems[b.header.size - 1])) {
 						result |= (1 << 5);
 						assert(!assertme);
 					}
@@ -4683,12 +5332,14 @@ bps_tree_debug_check_move_to_left_leaf(struct bps_tree *tree, bool assertme)
 				}
 
 				if (a.header.size)
-					if (ma != a.elems[a.header.size - 1]) {
+					if (!BPS_TREE_IS_IDENTICAL(ma,
+						a.elems[a.header.size - 1])) {
 						result |= (1 << 7);
 						assert(!assertme);
 					}
 				if (b.header.size)
-					if (mb != b.elems[b.header.size - 1]) {
+					if (!BPS_TREE_IS_IDENTICAL(mb,
+						b.elems[b.header.size - 1])) {
 						result |= (1 << 7);
 						assert(!assertme);
 					}
@@ -4794,16 +5445,16 @@ bps_tree_debug_check_insert_and_move_to_right_leaf(struct bps_tree *tree,
 					}
 
 					if (i - u + 1)
-						if (ma
-							!= a.elems[a.header.size
-								- 1]) {
+						if (!BPS_TREE_IS_IDENTICAL(ma,
+							a.elems[a.header.size
+								- 1])) {
 							result |= (1 << 9);
 							assert(!assertme);
 						}
 					if (j + u)
-						if (mb
-							!= b.elems[b.header.size
-								- 1]) {
+						if (!BPS_TREE_IS_IDENTICAL(mb,
+							b.elems[b.header.size
+								- 1])) {
 							result |= (1 << 9);
 							assert(!assertme);
 						}
@@ -4910,16 +5561,16 @@ bps_tree_debug_check_insert_and_move_to_left_leaf(struct bps_tree *tree,
 					}
 
 					if (i + u)
-						if (ma
-							!= a.elems[a.header.size
-								- 1]) {
+						if (!BPS_TREE_IS_IDENTICAL(ma,
+							a.elems[a.header.size
+								- 1])) {
 							result |= (1 << 11);
 							assert(!assertme);
 						}
 					if (j - u + 1)
-						if (mb
-							!= b.elems[b.header.size
-								- 1]) {
+						if (!BPS_TREE_IS_IDENTICAL(mb,
+							b.elems[b.header.size
+								- 1])) {
 							result |= (1 << 11);
 							assert(!assertme);
 						}
@@ -5569,6 +6220,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 
 #undef BPS_TREE_MEMMOVE
 #undef BPS_TREE_DATAMOVE
+#undef BPS_TREE_CHILDMOVE
 #undef BPS_TREE_BRANCH_TRACE
 
 /* {{{ Macros for custom naming of structs and functions */
@@ -5591,6 +6243,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_build
 #undef bps_tree_destroy
 #undef bps_tree_find
+#undef bps_tree_find_batch
 #undef bps_tree_insert
 #undef bps_tree_delete
 #undef bps_tree_size
@@ -5608,6 +6261,10 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_itr_prev
 #undef bps_tree_itr_freeze
 #undef bps_tree_itr_destroy
+#undef bps_tree_itr_at
+#undef bps_tree_itr_offset
+#undef bps_tree_lower_bound_offset
+#undef bps_tree_upper_bound_offset
 #undef bps_tree_debug_check
 #undef bps_tree_print
 #undef bps_tree_debug_check_internal_functions
@@ -5622,6 +6279,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef BPS_TREE_BT_LEAF
 
 #undef bps_tree_restore_block
+#undef bps_tree_prefetch_block
 #undef bps_tree_restore_block_ver
 #undef bps_tree_root
 #undef bps_tree_touch_block
@@ -5641,6 +6299,11 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_touch_leaf_path_max_elem
 #undef bps_tree_touch_path
 #undef bps_tree_process_replace
+#undef bps_tree_subtree_count
+#undef bps_tree_set_child
+#undef bps_tree_add_path_count
+#undef bps_tree_update_counts_leaf
+#undef bps_tree_update_counts_inner
 #undef bps_tree_debug_memmove
 #undef bps_tree_insert_into_leaf
 #undef bps_tree_insert_into_inner
@@ -5690,4 +6353,5 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_debug_check_move_to_left_inner
 #undef bps_tree_debug_check_insert_and_move_to_right_inner
 #undef bps_tree_debug_check_insert_and_move_to_left_inner
+#undef BPS_TREE_IS_IDENTICAL
 /* }}} */
@@ -215,6 +215,16 @@ LIGHT(find)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_DATA_TYPE data);
 uint32_t
 LIGHT(find_key)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_KEY_TYPE data);
 
+/**
+ * @brief Start loading the record where a search by the hash
+ * begins into the cache, to overlap the memory latency of
+ * several searches
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to find
+ */
+void
+LIGHT(prefetch)(const struct LIGHT(core) *ht, uint32_t hash);
+
 /**
  * @brief Insert a record with given hash and value
  * @param ht - pointer to a hash table struct
@@ -438,6 +448,22 @@ LIGHT(find_key)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_KEY_TYPE key)
 	return LIGHT(end);
 }
 
+/**
+ * @brief Start loading the record where a search by the hash
+ * begins into the cache, to overlap the memory latency of
+ * several searches
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to find
+ */
+inline void
+LIGHT(prefetch)(const struct LIGHT(core) *ht, uint32_t hash)
+{
+	if (ht->count == 0)
+		return;
+	uint32_t slot = LIGHT(slot)(ht, hash);
+	__builtin_prefetch(matras_get(&ht->mtable, slot));
+}
+
 /**
  * @brief Replace a record with given hash and value
  * @param ht - pointer to a hash table struct
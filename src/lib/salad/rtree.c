@@ -29,11 +29,15 @@
  * SUCH DAMAGE.
  */
 #include "rtree.h"
+#include "third_party/qsort_arg.h"
 #include <string.h>
 #include <assert.h>
 #include <limits.h>
 #include <stddef.h>
 #include <sys/types.h>
+#if defined(ENABLE_AVX) || defined(ENABLE_SSE2)
+#include <immintrin.h>
+#endif
 
 /*------------------------------------------------------------------------- */
 /* R-tree internal structures definition */
@@ -132,12 +136,105 @@ rtree_set2dp(struct rtree_rect *rect, coord_t x, coord_t y)
 	rect->coords[3] = y;
 }
 
+#if defined(ENABLE_AVX) || defined(ENABLE_SSE2)
+/*
+ * SIMD kernels. A dimension of a rectangle is a { low, high } pair
+ * of coords, so an SSE2 register holds one dimension and an AVX
+ * register holds two. Negating the upper bound turns a comparison
+ * of two rectangles into a single lane-wise "less than": e.g. rt1
+ * is in rt2 unless { low1, -high1 } < { low2, -high2 } in a lane.
+ */
+
+/* { low, -high } of a dimension */
+static inline __m128d
+rtree_load_pd(const coord_t *coords)
+{
+	return _mm_xor_pd(_mm_loadu_pd(coords), _mm_set_pd(-0.0, 0.0));
+}
+
+/* { high, -low } of a dimension */
+static inline __m128d
+rtree_load_swap_pd(const coord_t *coords)
+{
+	__m128d v = _mm_loadu_pd(coords);
+	return _mm_xor_pd(_mm_shuffle_pd(v, v, 1), _mm_set_pd(-0.0, 0.0));
+}
+
+/* { low - point, point - high } of a dimension, clipped at zero */
+static inline __m128d
+rtree_gap_pd(const coord_t *coords, coord_t point)
+{
+	__m128d v = _mm_sub_pd(_mm_loadu_pd(coords), _mm_set1_pd(point));
+	v = _mm_xor_pd(v, _mm_set_pd(-0.0, 0.0));
+	/* maxpd returns the second operand if the first one is NaN */
+	return _mm_max_pd(v, _mm_setzero_pd());
+}
+
+static inline sq_coord_t
+rtree_sum_pd(__m128d v)
+{
+	return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+#endif /* defined(ENABLE_AVX) || defined(ENABLE_SSE2) */
+
+#if defined(ENABLE_AVX)
+/* Same as above for two dimensions at once */
+static inline __m256d
+rtree_load2_pd(const coord_t *coords)
+{
+	return _mm256_xor_pd(_mm256_loadu_pd(coords),
+			     _mm256_set_pd(-0.0, 0.0, -0.0, 0.0));
+}
+
+static inline __m256d
+rtree_load2_swap_pd(const coord_t *coords)
+{
+	return _mm256_xor_pd(_mm256_permute_pd(_mm256_loadu_pd(coords), 5),
+			     _mm256_set_pd(-0.0, 0.0, -0.0, 0.0));
+}
+
+/* point is the coords of a point rectangle: { x, x, y, y } */
+static inline __m256d
+rtree_gap2_pd(const coord_t *coords, const coord_t *point)
+{
+	__m256d v = _mm256_sub_pd(_mm256_loadu_pd(coords),
+				  _mm256_set_pd(point[2], point[2],
+						point[0], point[0]));
+	v = _mm256_xor_pd(v, _mm256_set_pd(-0.0, 0.0, -0.0, 0.0));
+	return _mm256_max_pd(v, _mm256_setzero_pd());
+}
+
+static inline __m128d
+rtree_fold2_pd(__m256d v)
+{
+	return _mm_add_pd(_mm256_castpd256_pd128(v),
+			  _mm256_extractf128_pd(v, 1));
+}
+#endif /* defined(ENABLE_AVX) */
+
 /* Manhattan distance */
 static sq_coord_t
 rtree_rect_neigh_distance(const struct rtree_rect *rect,
 			   const struct rtree_rect *neigh_rect,
 			   unsigned dimension)
 {
+#if defined(ENABLE_AVX) || defined(ENABLE_SSE2)
+	const coord_t *coords = rect->coords;
+	const coord_t *point = neigh_rect->coords;
+	__m128d sum = _mm_setzero_pd();
+	unsigned i = 0;
+#if defined(ENABLE_AVX)
+	__m256d sum2 = _mm256_setzero_pd();
+	for (; i + 2 <= dimension; i += 2)
+		sum2 = _mm256_add_pd(sum2, rtree_gap2_pd(&coords[2 * i],
+							 &point[2 * i]));
+	sum = rtree_fold2_pd(sum2);
+#endif
+	for (; i < dimension; i++)
+		sum = _mm_add_pd(sum, rtree_gap_pd(&coords[2 * i],
+						   point[2 * i]));
+	return rtree_sum_pd(sum);
+#else
 	sq_coord_t result = 0;
 	for (int i = dimension; --i >= 0; ) {
 		const coord_t *coords = &rect->coords[2 * i];
@@ -151,6 +248,7 @@ rtree_rect_neigh_distance(const struct rtree_rect *rect,
 		}
 	}
 	return result;
+#endif
 }
 
 /* Euclid distance, squared */
@@ -159,6 +257,25 @@ rtree_rect_neigh_distance2(const struct rtree_rect *rect,
 			   const struct rtree_rect *neigh_rect,
 			   unsigned dimension)
 {
+#if defined(ENABLE_AVX) || defined(ENABLE_SSE2)
+	const coord_t *coords = rect->coords;
+	const coord_t *point = neigh_rect->coords;
+	__m128d sum = _mm_setzero_pd();
+	unsigned i = 0;
+#if defined(ENABLE_AVX)
+	__m256d sum2 = _mm256_setzero_pd();
+	for (; i + 2 <= dimension; i += 2) {
+		__m256d gap = rtree_gap2_pd(&coords[2 * i], &point[2 * i]);
+		sum2 = _mm256_add_pd(sum2, _mm256_mul_pd(gap, gap));
+	}
+	sum = rtree_fold2_pd(sum2);
+#endif
+	for (; i < dimension; i++) {
+		__m128d gap = rtree_gap_pd(&coords[2 * i], point[2 * i]);
+		sum = _mm_add_pd(sum, _mm_mul_pd(gap, gap));
+	}
+	return rtree_sum_pd(sum);
+#else
 	sq_coord_t result = 0;
 	for (int i = dimension; --i >= 0; ) {
 		const coord_t *coords = &rect->coords[2 * i];
@@ -172,6 +289,7 @@ rtree_rect_neigh_distance2(const struct rtree_rect *rect,
 		}
 	}
 	return result;
+#endif
 }
 
 static area_t
@@ -261,12 +379,33 @@ rtree_rect_intersects_rect(const struct rtree_rect *rt1,
 			   const struct rtree_rect *rt2,
 			   unsigned dimension)
 {
-	for (int i = dimension; --i >= 0; ) {
-		const coord_t *coords1 = &rt1->coords[2 * i];
-		const coord_t *coords2 = &rt2->coords[2 * i];
-		if (coords1[0] > coords2[1] || coords1[1] < coords2[0])
+	const coord_t *coords1 = rt1->coords;
+	const coord_t *coords2 = rt2->coords;
+	unsigned i = 0;
+#if defined(ENABLE_AVX)
+	for (; i + 2 <= dimension; i += 2) {
+		/* high2 < low1 || -low2 < -high1 */
+		__m256d lt = _mm256_cmp_pd(rtree_load2_swap_pd(coords2 + 2 * i),
+					   rtree_load2_pd(coords1 + 2 * i),
+					   _CMP_LT_OQ);
+		if (_mm256_movemask_pd(lt) != 0)
 			return false;
 	}
+#endif
+#if defined(ENABLE_AVX) || defined(ENABLE_SSE2)
+	for (; i < dimension; i++) {
+		__m128d lt = _mm_cmplt_pd(rtree_load_swap_pd(coords2 + 2 * i),
+					  rtree_load_pd(coords1 + 2 * i));
+		if (_mm_movemask_pd(lt) != 0)
+			return false;
+	}
+#else
+	for (; i < dimension; i++) {
+		if (coords1[2 * i] > coords2[2 * i + 1] ||
+		    coords1[2 * i + 1] < coords2[2 * i])
+			return false;
+	}
+#endif
 	return true;
 }
 
@@ -275,12 +414,33 @@ rtree_rect_in_rect(const struct rtree_rect *rt1,
 		   const struct rtree_rect *rt2,
 		   unsigned dimension)
 {
-	for (int i = dimension; --i >= 0; ) {
-		const coord_t *coords1 = &rt1->coords[2 * i];
-		const coord_t *coords2 = &rt2->coords[2 * i];
-		if (coords1[0] < coords2[0] || coords1[1] > coords2[1])
+	const coord_t *coords1 = rt1->coords;
+	const coord_t *coords2 = rt2->coords;
+	unsigned i = 0;
+#if defined(ENABLE_AVX)
+	for (; i + 2 <= dimension; i += 2) {
+		/* low1 < low2 || -high1 < -high2 */
+		__m256d lt = _mm256_cmp_pd(rtree_load2_pd(coords1 + 2 * i),
+					   rtree_load2_pd(coords2 + 2 * i),
+					   _CMP_LT_OQ);
+		if (_mm256_movemask_pd(lt) != 0)
 			return false;
 	}
+#endif
+#if defined(ENABLE_AVX) || defined(ENABLE_SSE2)
+	for (; i < dimension; i++) {
+		__m128d lt = _mm_cmplt_pd(rtree_load_pd(coords1 + 2 * i),
+					  rtree_load_pd(coords2 + 2 * i));
+		if (_mm_movemask_pd(lt) != 0)
+			return false;
+	}
+#else
+	for (; i < dimension; i++) {
+		if (coords1[2 * i] < coords2[2 * i] ||
+		    coords1[2 * i + 1] > coords2[2 * i + 1])
+			return false;
+	}
+#endif
 	return true;
 }
 
@@ -289,12 +449,33 @@ rtree_rect_strict_in_rect(const struct rtree_rect *rt1,
 			  const struct rtree_rect *rt2,
 			  unsigned dimension)
 {
-	for (int i = dimension; --i >= 0; ) {
-		const coord_t *coords1 = &rt1->coords[2 * i];
-		const coord_t *coords2 = &rt2->coords[2 * i];
-		if (coords1[0] <= coords2[0] || coords1[1] >= coords2[1])
+	const coord_t *coords1 = rt1->coords;
+	const coord_t *coords2 = rt2->coords;
+	unsigned i = 0;
+#if defined(ENABLE_AVX)
+	for (; i + 2 <= dimension; i += 2) {
+		/* low1 <= low2 || -high1 <= -high2 */
+		__m256d le = _mm256_cmp_pd(rtree_load2_pd(coords1 + 2 * i),
+					   rtree_load2_pd(coords2 + 2 * i),
+					   _CMP_LE_OQ);
+		if (_mm256_movemask_pd(le) != 0)
 			return false;
 	}
+#endif
+#if defined(ENABLE_AVX) || defined(ENABLE_SSE2)
+	for (; i < dimension; i++) {
+		__m128d le = _mm_cmple_pd(rtree_load_pd(coords1 + 2 * i),
+					  rtree_load_pd(coords2 + 2 * i));
+		if (_mm_movemask_pd(le) != 0)
+			return false;
+	}
+#else
+	for (; i < dimension; i++) {
+		if (coords1[2 * i] <= coords2[2 * i] ||
+		    coords1[2 * i + 1] >= coords2[2 * i + 1])
+			return false;
+	}
+#endif
 	return true;
 }
 
@@ -795,6 +976,12 @@ rtree_iterator_destroy(struct rtree_iterator *itr)
 	}
 	itr->page_list = NULL;
 	itr->page_pos = INT_MAX;
+	if (itr->limit_heap != NULL) {
+		rtree_page_free((struct rtree *) itr->tree,
+				(struct rtree_page *) itr->limit_heap);
+		itr->limit_heap = NULL;
+	}
+	itr->limit_heap_max = 0;
 }
 
 struct rtree_neighbor *
@@ -859,27 +1046,99 @@ rtree_iterator_init(struct rtree_iterator *itr)
 	itr->neigh_free_list = NULL;
 	itr->page_list = NULL;
 	itr->page_pos = INT_MAX;
+	itr->limit = UINT_MAX;
+	itr->limit_heap = NULL;
+	itr->limit_heap_size = 0;
+	itr->limit_heap_max = 0;
+}
+
+/*
+ * Distances from the point of the iterator to all branches
+ * of a page.
+ */
+static void
+rtree_page_neigh_distances(const struct rtree *tree,
+			   const struct rtree_page *pg,
+			   const struct rtree_rect *point,
+			   sq_coord_t *distances)
+{
+	unsigned d = tree->dimension;
+	if (tree->distance_type == RTREE_EUCLID) {
+		for (unsigned i = 0, n = pg->n; i < n; i++) {
+			struct rtree_page_branch *b;
+			b = rtree_branch_get(tree, pg, i);
+			distances[i] = rtree_rect_neigh_distance2(&b->rect,
+								  point, d);
+		}
+	} else {
+		for (unsigned i = 0, n = pg->n; i < n; i++) {
+			struct rtree_page_branch *b;
+			b = rtree_branch_get(tree, pg, i);
+			distances[i] = rtree_rect_neigh_distance(&b->rect,
+								 point, d);
+		}
+	}
+}
+
+/*
+ * Add the distance of a record to the max-heap of the closest
+ * records found so far. If the heap is full, the farthest one is
+ * replaced, so the caller must check that the record is closer.
+ */
+static void
+rtree_iterator_limit_push(struct rtree_iterator *itr, sq_coord_t distance)
+{
+	sq_coord_t *heap = itr->limit_heap;
+	unsigned i;
+	if (itr->limit_heap_size < itr->limit_heap_max) {
+		i = itr->limit_heap_size++;
+		while (i > 0 && heap[(i - 1) / 2] < distance) {
+			heap[i] = heap[(i - 1) / 2];
+			i = (i - 1) / 2;
+		}
+	} else {
+		unsigned n = itr->limit_heap_size;
+		i = 0;
+		while (2 * i + 1 < n) {
+			unsigned child = 2 * i + 1;
+			if (child + 1 < n && heap[child + 1] > heap[child])
+				child++;
+			if (heap[child] <= distance)
+				break;
+			heap[i] = heap[child];
+			i = child;
+		}
+	}
+	heap[i] = distance;
 }
 
 static void
 rtree_iterator_process_neigh(struct rtree_iterator *itr,
 			     struct rtree_neighbor *neighbor)
 {
-	unsigned d = itr->tree->dimension;
 	void *child = neighbor->child;
 	struct rtree_page *pg = (struct rtree_page *)child;
 	int level = neighbor->level;
 	rtree_iterator_free_neighbor(itr, neighbor);
+	sq_coord_t distances[RTREE_MAXIMUM_BRANCHES_IN_PAGE];
+	assert(pg->n <= RTREE_MAXIMUM_BRANCHES_IN_PAGE);
+	rtree_page_neigh_distances(itr->tree, pg, &itr->rect, distances);
+	bool use_heap = itr->limit_heap_max > 0;
 	for (int i = 0, n = pg->n; i < n; i++) {
+		sq_coord_t distance = distances[i];
+		if (use_heap) {
+			/*
+			 * Nothing farther than limit records found so
+			 * far can be returned by the iterator.
+			 */
+			if (itr->limit_heap_size == itr->limit_heap_max &&
+			    distance > itr->limit_heap[0])
+				continue;
+			if (level == 1)
+				rtree_iterator_limit_push(itr, distance);
+		}
 		struct rtree_page_branch *b;
 		b = rtree_branch_get(itr->tree, pg, i);
-		coord_t distance;
-		if (itr->tree->distance_type == RTREE_EUCLID)
-			distance = rtree_rect_neigh_distance2(&b->rect,
-							      &itr->rect, d);
-		else
-			distance = rtree_rect_neigh_distance(&b->rect,
-							     &itr->rect, d);
 		struct rtree_neighbor *neigh =
 			rtree_iterator_new_neighbor(itr, b->data.page,
 						    distance, level - 1);
@@ -887,6 +1146,19 @@ rtree_iterator_process_neigh(struct rtree_iterator *itr,
 	}
 }
 
+void
+rtree_iterator_set_limit(struct rtree_iterator *itr, unsigned limit)
+{
+	itr->limit = limit;
+	if (itr->op != SOP_NEIGHBOR || limit == 0 ||
+	    limit > itr->tree->page_size / sizeof(sq_coord_t))
+		return;
+	if (itr->limit_heap == NULL)
+		itr->limit_heap = (sq_coord_t *)
+			rtree_page_alloc((struct rtree *)itr->tree);
+	itr->limit_heap_max = limit;
+	itr->limit_heap_size = 0;
+}
 
 record_t
 rtree_iterator_next(struct rtree_iterator *itr)
@@ -895,6 +1167,8 @@ rtree_iterator_next(struct rtree_iterator *itr)
 		/* Index was updated since cursor initialziation */
 		return NULL;
 	}
+	if (itr->limit == 0)
+		return NULL;
 	if (itr->op == SOP_NEIGHBOR) {
 		/* To return element in order of increasing distance from
 		 * specified point, we build sorted list of R-Tree items
@@ -919,6 +1193,7 @@ rtree_iterator_next(struct rtree_iterator *itr)
 			if (neighbor->level == 0) {
 				void *child = neighbor->child;
 				rtree_iterator_free_neighbor(itr, neighbor);
+				itr->limit--;
 				return (record_t)child;
 			} else {
 				rtree_iterator_process_neigh(itr, neighbor);
@@ -930,6 +1205,7 @@ rtree_iterator_next(struct rtree_iterator *itr)
 		struct rtree_page_branch *b;
 		b = rtree_branch_get(itr->tree,
 				     itr->stack[sp].page, itr->stack[sp].pos);
+		itr->limit--;
 		return b->data.record;
 	}
 	itr->eof = true;
@@ -1066,6 +1342,9 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 	itr->version = tree->version;
 	rtree_rect_copy(&itr->rect, rect, tree->dimension);
 	itr->op = op;
+	itr->limit = UINT_MAX;
+	itr->limit_heap_size = 0;
+	itr->limit_heap_max = 0;
 	assert(tree->height <= RTREE_MAX_HEIGHT);
 	switch (op) {
 	case SOP_ALL:
@@ -1126,6 +1405,133 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 	}
 }
 
+/*------------------------------------------------------------------------- */
+/* R-tree bulk load */
+/*------------------------------------------------------------------------- */
+
+size_t
+rtree_build_item_size(const struct rtree *tree)
+{
+	return tree->page_branch_size;
+}
+
+void
+rtree_build_item_set(const struct rtree *tree, void *item,
+		     const struct rtree_rect *rect, record_t obj)
+{
+	struct rtree_page_branch *b = (struct rtree_page_branch *)item;
+	b->data.record = obj;
+	rtree_rect_copy(&b->rect, rect, tree->dimension);
+}
+
+/* Compare centers of branch rectangles along the given axis */
+static int
+rtree_build_cmp(const void *a, const void *b, void *arg)
+{
+	unsigned axis = *(unsigned *)arg;
+	const coord_t *ca =
+		&((const struct rtree_page_branch *)a)->rect.coords[2 * axis];
+	const coord_t *cb =
+		&((const struct rtree_page_branch *)b)->rect.coords[2 * axis];
+	coord_t sa = ca[0] + ca[1];
+	coord_t sb = cb[0] + cb[1];
+	return sa < sb ? -1 : sa > sb ? 1 : 0;
+}
+
+/* The least s such that s ^ power >= n */
+static size_t
+rtree_build_root(size_t n, unsigned power)
+{
+	size_t s = 1;
+	while (true) {
+		size_t p = 1;
+		for (unsigned i = 0; i < power && p < n; i++)
+			p *= s;
+		if (p >= n)
+			return s;
+		s++;
+	}
+}
+
+/*
+ * Sort-Tile-Recursive ordering of branches: sort them by centers
+ * along the axis, cut into slabs of whole pages and order every
+ * slab by the rest of axes in the same way. Then each run of
+ * fill consecutive branches is a compact tile of the space.
+ */
+static void
+rtree_build_tile(const struct rtree *tree, char *items, size_t count,
+		 unsigned axis, unsigned fill)
+{
+	size_t item_size = tree->page_branch_size;
+	qsort_arg(items, count, item_size, rtree_build_cmp, &axis);
+	if (axis + 1 == tree->dimension)
+		return;
+	size_t n_pages = (count + fill - 1) / fill;
+	size_t n_slabs = rtree_build_root(n_pages, tree->dimension - axis);
+	size_t slab_size = (n_pages + n_slabs - 1) / n_slabs * fill;
+	for (size_t i = 0; i < count; i += slab_size) {
+		size_t n = count - i < slab_size ? count - i : slab_size;
+		rtree_build_tile(tree, items + i * item_size, n,
+				 axis + 1, fill);
+	}
+}
+
+/*
+ * Put runs of fill consecutive branches into new pages and
+ * replace the branches with the branches of the new pages, in
+ * place. Return the number of pages.
+ */
+static size_t
+rtree_build_level(struct rtree *tree, char *items, size_t count,
+		  unsigned fill)
+{
+	size_t item_size = tree->page_branch_size;
+	size_t n_pages = (count + fill - 1) / fill;
+	size_t pos = 0;
+	for (size_t i = 0; i < n_pages; i++) {
+		size_t n = count - pos;
+		if (n > fill) {
+			n = fill;
+			/* Don't leave less than min fill to the last page */
+			if (i + 2 == n_pages &&
+			    count - pos - fill < tree->page_min_fill)
+				n = (count - pos) / 2;
+		}
+		struct rtree_page *page = rtree_page_alloc(tree);
+		tree->n_pages++;
+		page->n = n;
+		memcpy(page->data, items + pos * item_size, n * item_size);
+		pos += n;
+		/* The branch i is already copied since i < pos */
+		struct rtree_page_branch *b =
+			(struct rtree_page_branch *)(items + i * item_size);
+		rtree_page_cover(tree, page, &b->rect);
+		b->data.page = page;
+	}
+	assert(pos == count);
+	return n_pages;
+}
+
+void
+rtree_build(struct rtree *tree, void *items, size_t count)
+{
+	assert(tree->root == NULL);
+	if (count == 0)
+		return;
+	unsigned fill = tree->page_max_fill;
+	tree->n_records = count;
+	tree->height = 0;
+	do {
+		rtree_build_tile(tree, (char *)items, count, 0, fill);
+		count = rtree_build_level(tree, (char *)items, count, fill);
+		tree->height++;
+	} while (count > 1);
+	assert(tree->height <= RTREE_MAX_HEIGHT);
+	tree->root = ((struct rtree_page_branch *)items)->data.page;
+	tree->version++;
+}
+
 void
 rtree_purge(struct rtree *tree)
 {
@@ -181,6 +181,18 @@ struct rtree_iterator
 	struct rtree_neighbor_page *page_list;
 	/* Position of ready-to-use list entry in allocated page */
 	unsigned page_pos;
+	/* Number of records the iterator may still return */
+	unsigned limit;
+	/* Max-heap of distances of the closest records found so far,
+	 * at most limit_heap_max of them. Used only for iteration with
+	 * op = SOP_NEIGHBOR and a limit set, to skip tree nodes that are
+	 * farther than all of them. Allocated with page allocator of
+	 * tree, so a limit that doesn't fit into a page isn't used for
+	 * skipping nodes.
+	 */
+	sq_coord_t *limit_heap;
+	unsigned limit_heap_size;
+	unsigned limit_heap_max;
 
 	/* Comparators for comparison rectagnle of the iterator with
 	 * rectangles of tree nodes. If the comparator returns true,
@@ -265,6 +277,17 @@ bool
 rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 	     enum spatial_search_op op, struct rtree_iterator *itr);
 
+/**
+ * @brief Limit the number of records returned by an iterator.
+ * Must be called after rtree_search() and before the first
+ * rtree_iterator_next(). For op = SOP_NEIGHBOR the search skips
+ * tree nodes that can't hold one of the limit nearest records.
+ * @param itr - pointer to iterator
+ * @param limit - max number of records to return
+ */
+void
+rtree_iterator_set_limit(struct rtree_iterator *itr, unsigned limit);
+
 /**
  * @brief Insert a record to the tree
  * @param tree - pointer to a tree
@@ -274,6 +297,38 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 void
 rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj);
 
+/**
+ * @brief Size of an element of the array passed to rtree_build()
+ * @param tree - pointer to a tree
+ */
+size_t
+rtree_build_item_size(const struct rtree *tree);
+
+/**
+ * @brief Fill an element of the array passed to rtree_build()
+ * @param tree - pointer to a tree
+ * @param item - pointer to the element
+ * @param rect - rectangle of the record
+ * @param obj - record
+ */
+void
+rtree_build_item_set(const struct rtree *tree, void *item,
+		     const struct rtree_rect *rect, record_t obj);
+
+/**
+ * @brief Fill an empty tree with records at once by the
+ * Sort-Tile-Recursive algorithm. Much faster than insertion of
+ * the records one by one, and pages of the tree are full and
+ * overlap little.
+ * @param tree - pointer to an empty tree
+ * @param items - array of rtree_build_item_size(tree) sized
+ *  elements, filled by rtree_build_item_set(). The array is
+ *  used as a scratch space and is garbage on return.
+ * @param count - number of elements in the array
+ */
+void
+rtree_build(struct rtree *tree, void *items, size_t count);
+
 /**
  * @brief Remove the record from a tree
  * @return true if the record deleted (false otherwise)
@@ -87,6 +87,22 @@
 	#define fdatasync fsync
 #endif
 
+/*
+ * Defined if posix_fallocate(3) call is present.
+ */
+#cmakedefine HAVE_POSIX_FALLOCATE 1
+
+/*
+ * Defined if libzstd is available for snapshot compression.
+ */
+#cmakedefine HAVE_ZSTD 1
+
+/*
+ * Max number of key parts with comparators and hash functions
+ * specialized for the part types, see tuple_compare.cc.
+ */
+#define TUPLE_COMPARE_PART_MAX @TUPLE_COMPARE_PART_MAX@
+
 /*
  * Defined if this platform has BSD specific funopen()
  */
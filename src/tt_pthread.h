@@ -148,7 +148,7 @@
 
 #define tt_pthread_cond_timedwait(cond, mutex, timeout)	\
 ({	int e = pthread_cond_timedwait(cond, mutex, timeout);\
-	if (ETIMEDOUT != e)                           \
+	if (e != 0 && e != ETIMEDOUT)                 \
 		say_error("%s error %d", __func__, e);\
 	assert(e == 0 || e == ETIMEDOUT);             \
 	e;                                             \
@@ -4,7 +4,7 @@ local tap = require('tap')
 local test = tap.test('cfg')
 local socket = require('socket')
 local fio = require('fio')
-test:plan(46)
+test:plan(54)
 
 --------------------------------------------------------------------------------
 -- Invalid values
@@ -25,6 +25,14 @@ invalid('slab_alloc_minimal', 1000000000)
 invalid('replication_source', '//guest@localhost:3301')
 invalid('wal_mode', 'invalid')
 invalid('rows_per_wal', -1)
+invalid('wal_commit_delay', -1)
+invalid('wal_commit_max_rows', 0)
+invalid('wal_max_size', -1)
+invalid('wal_prealloc_size', -1)
+invalid('snap_compression', 'invalid')
+invalid('snap_threads', 0)
+invalid('snap_io_rate_burst', 0)
+invalid('snap_delta_max', -1)
 invalid('listen', '//!')
 invalid('logger', ':')
 invalid('logger', 'syslog:xxx=')
@@ -72,7 +72,7 @@ end;
 function test_box_slab_info()
     local tmp = box.slab.info()
     local tmp_slabs = box.slab.stats()
-    local cdata = {'arena_size', 'arena_used'}
+    local cdata = {'arena_size', 'arena_used', 'delayed_free_size'}
     local failed = {}
     if type(tmp_slabs) == 'table' then
         for name, tbl in ipairs(tmp_slabs) do
@@ -0,0 +1,99 @@
+env = require('test_run')
+test_run = env.new()
+--
+-- ART: an adaptive radix tree, secondary keys only
+--
+s = box.schema.space.create('art')
+_ = s:create_index('pk')
+_ = s:create_index('name', {type = 'art', parts = {2, 'str'}})
+_ = s:create_index('pair', {type = 'art', parts = {3, 'str', 4, 'num'}, unique = false})
+s.index.name.type
+s.index.pair.unique
+test_run:cmd("setopt delimiter ';'")
+function ids(tuples)
+    local r = {}
+    for _, t in ipairs(tuples) do table.insert(r, t[1]) end
+    return table.concat(r, ' ')
+end;
+test_run:cmd("setopt delimiter ''");
+-- keys of different length, with common prefixes and zero bytes
+s:insert{1, 'a', 'x', 1}
+s:insert{2, 'ab', 'x', 2}
+s:insert{3, 'abc', 'y', 1}
+s:insert{4, 'b', 'x', 10}
+s:insert{5, 'ba', 'y', 2}
+s:insert{6, '', 'x', 20}
+_ = s:insert{7, 'a\0b', 'y', 300}
+_ = s:insert{8, 'a\0', 'x', 3}
+s:insert{9, 'abcdefghijklmnop', 'y', 400}
+s.index.name:len()
+-- the order is the one of a TREE index
+ids(s.index.name:select{})
+ids(s.index.name:select({}, {iterator = 'LT'}))
+s.index.name:min()
+s.index.name:max()
+-- unique key
+s.index.name:get{'a'}
+s.index.name:get{'a\0'}[1]
+s.index.name:get{'a\0b'}[1]
+s.index.name:get{'abcdefghijklmnop'}[1]
+s.index.name:get{'abcdefghijklmno'}
+ids(s.index.name:select({'a'}, {iterator = 'EQ'}))
+ids(s.index.name:select({'a'}, {iterator = 'REQ'}))
+ids(s.index.name:select({'ab'}, {iterator = 'GE'}))
+ids(s.index.name:select({'ab'}, {iterator = 'GT'}))
+ids(s.index.name:select({'ab'}, {iterator = 'LE'}))
+ids(s.index.name:select({'ab'}, {iterator = 'LT'}))
+ids(s.index.name:select({'abcd'}, {iterator = 'GT'}))
+ids(s.index.name:select({'abcd'}, {iterator = 'LT'}))
+-- PREFIX: the key starts with the given string
+ids(s.index.name:select({'a'}, {iterator = 'PREFIX'}))
+ids(s.index.name:select({'abc'}, {iterator = 'PREFIX'}))
+ids(s.index.name:select({'a\0'}, {iterator = 'PREFIX'}))
+ids(s.index.name:select({''}, {iterator = 'PREFIX'}))
+ids(s.index.name:select({'c'}, {iterator = 'prefix'}))
+ids(s.index.name:select({'a'}, {iterator = box.index.PREFIX, limit = 2}))
+s.index.name:count('a', {iterator = 'PREFIX'})
+r = {}
+for _, t in s.index.name:pairs('ab', {iterator = 'PREFIX'}) do table.insert(r, t[1]) end
+r
+-- partial keys of a multipart non-unique key
+ids(s.index.pair:select{})
+ids(s.index.pair:select{'x'})
+ids(s.index.pair:select({'x'}, {iterator = 'REQ'}))
+ids(s.index.pair:select({'x', 3}, {iterator = 'GE'}))
+ids(s.index.pair:select({'x', 3}, {iterator = 'GT'}))
+ids(s.index.pair:select({'x'}, {iterator = 'GT'}))
+ids(s.index.pair:select({'y'}, {iterator = 'LT'}))
+ids(s.index.pair:select({'y', 2}, {iterator = 'LE'}))
+ids(s.index.pair:select({'x', 10}, {iterator = 'LT'}))
+ids(s.index.pair:select({'x'}, {iterator = 'PREFIX'}))
+ids(s.index.pair:select({'x', 3}, {iterator = 'PREFIX'}))
+s.index.pair:min{'y'}
+s.index.pair:max{'x'}
+-- equal keys
+s:insert{10, 'c', 'z', 5}
+s:insert{11, 'ca', 'z', 5}
+s.index.pair:count{'z', 5}
+s:delete{10}
+ids(s.index.pair:select{'z', 5})
+-- changes
+s:insert{12, 'ab', 'z', 1}
+s:update(2, {{'=', 2, 'abd'}})
+ids(s.index.name:select({'ab'}, {iterator = 'PREFIX'}))
+s:delete{3}
+ids(s.index.name:select({'ab'}, {iterator = 'PREFIX'}))
+s.index.name:get{'ab'}
+s.index.name:count()
+ids(s.index.pair:select{'y'})
+-- errors
+s.index.name:select{1}
+s.index.name:select{'a', 'b'}
+s.index.pk:select({1}, {iterator = 'PREFIX'})
+e = box.schema.space.create('art_errors')
+e:create_index('pk', {type = 'art'})
+_ = e:create_index('pk')
+e:create_index('sk', {type = 'art', parts = {2, 'number'}})
+e:create_index('sk', {type = 'art', parts = {2, 'array'}})
+e:drop()
+s:drop()
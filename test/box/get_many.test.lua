@@ -0,0 +1,67 @@
+test_run = require('test_run').new()
+remote = require 'net.box'
+
+s = box.schema.space.create('tweedledum')
+i1 = s:create_index('primary', { type = 'hash' })
+i2 = s:create_index('secondary', { type = 'tree', parts = {2, 'str'} })
+i3 = s:create_index('third', { type = 'tree', parts = {3, 'num'}, unique = false })
+for i = 1, 1000 do s:insert{i, 'k' .. i, i % 10} end
+
+s.index[0].get_many == s.index[0].get_many_ffi or s.index[0].get_many == s.index[0].get_many_luac
+
+-- a missing key leaves a hole in the result
+t = i1:get_many({1, 500, 1001, 1000})
+t[1], t[2], t[3], t[4]
+t = i2:get_many({'k7', 'x', {'k999'}})
+t[1], t[2], t[3]
+t = s:get_many({{2}, 3})
+t[1], t[2]
+i1:get_many({})
+t = i1:get_many_luac({1, 1001, 3})
+t[1], t[2], t[3]
+
+test_run:cmd("setopt delimiter ';'")
+function check(idx, keys)
+    local t = idx:get_many(keys)
+    for i, key in ipairs(keys) do
+        local tuple = idx:get(key)
+        if (tuple == nil) ~= (t[i] == nil) or
+           (tuple ~= nil and tuple[1] ~= t[i][1]) then
+            return false, key
+        end
+    end
+    return true
+end;
+keys1 = {};
+keys2 = {};
+for i = 1, 300 do
+    keys1[i] = math.random(1200)
+    keys2[i] = 'k' .. math.random(1200)
+end;
+test_run:cmd("setopt delimiter ''");
+check(i1, keys1)
+check(i2, keys2)
+
+-- each key is counted in the statistics
+total = box.stat.GET_MULTI.total
+_ = i1:get_many({1, 2, 3})
+box.stat.GET_MULTI.total - total
+
+-- errors
+i3:get_many({1})
+i1:get_many(1)
+i1:get_many({{}})
+i2:get_many({'k1', 2})
+
+-- binary protocol
+box.schema.user.grant('guest', 'read', 'space', 'tweedledum')
+cn = remote:new(box.cfg.listen)
+t = cn.space.tweedledum:get_many({1, 1001, {3}})
+t[1], t[2], t[3]
+t = cn.space.tweedledum.index.secondary:get_many({'x', 'k5'})
+t[1], t[2]
+cn.space.tweedledum.index.third:get_many({1})
+cn:close()
+box.schema.user.revoke('guest', 'read', 'space', 'tweedledum')
+
+s:drop()
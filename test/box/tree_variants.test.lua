@@ -60,3 +60,65 @@ space:insert{1, 'xxxxxxxxxxx', 2, '', '', '', '', '', 0}
 space:drop()
 sort = nil
 sort_cmp = nil
+
+-- Key hints: strings sharing the first 8 bytes, short strings
+-- and an index with hints disabled
+space = box.schema.space.create('tweedledum')
+i0 = space:create_index('primary', { type = 'tree', parts = {1, 'str'}})
+i1 = space:create_index('i1', { type = 'tree', parts = {2, 'num'}, unique = false, hint = false})
+box.space._index:get{space.id, 1}[5].hint
+space:insert{'abcdefgh2', 2}
+space:insert{'abcdefgh1', 1}
+space:insert{'abcdefgh', 3}
+space:insert{'abc', 18446744073709551615ULL}
+space:insert{'abc\0', 0}
+space:insert{'', 5}
+i0:select{}
+i0:select({'abcdefgh'}, {iterator = 'GT'})
+i0:select({'abcdefgh1'}, {iterator = 'LE'})
+i0:get{'abc'}
+i1:select{}
+i1:select({3}, {iterator = 'GE'})
+i1:alter{hint = true}
+i1:select({3}, {iterator = 'GE'})
+space:drop()
+
+-- NUMBER parts and keys with parts out of field order
+space = box.schema.space.create('tweedledum')
+i0 = space:create_index('primary', { type = 'tree', parts = {1, 'num'}})
+i1 = space:create_index('i1', { type = 'tree', parts = {3, 'str', 2, 'number'}, unique = false})
+space:insert{1, 2.5, 'a'}
+space:insert{2, -1, 'a'}
+space:insert{3, 2, 'a'}
+space:insert{4, 18446744073709551615ULL, 'a'}
+space:insert{5, 0, 'b'}
+space:insert{6, 'x', 'b'}
+i1:select{}
+i1:select({'a', 2}, {iterator = 'GT'})
+i1:select({'a', 2.5})
+i1:select({'a', -5}, {iterator = 'LT'})
+space:drop()
+
+-- NaN and integers which don't fit in a double in NUMBER parts
+ffi = require('ffi')
+space = box.schema.space.create('tweedledum')
+i0 = space:create_index('primary', { type = 'tree', parts = {1, 'num'}})
+i1 = space:create_index('i1', { type = 'tree', parts = {2, 'number'}})
+_ = space:insert{1, 0/0}
+_ = space:insert{2, 0/0}
+_ = space:insert{3, -1/0}
+_ = space:insert{4, ffi.new('double', 2^53)}
+_ = space:insert{5, 9007199254740993ULL}
+_ = space:insert{6, 9007199254740992ULL}
+_ = space:insert{7, -9007199254740993LL}
+_ = space:insert{8, ffi.new('double', -2^53)}
+_ = space:insert{9, 18446744073709551615ULL}
+_ = space:insert{10, ffi.new('double', 2^64)}
+_ = space:insert{11, 1.5}
+function ids(tuples) local r = {} for _, t in ipairs(tuples) do table.insert(r, t[1]) end return r end
+ids(i1:select{})
+ids(i1:select(0/0))
+ids(i1:select(ffi.new('double', 2^53), {iterator = 'GT'}))
+ids(i1:select(9007199254740992ULL, {iterator = 'LE'}))
+ids(i1:select(-9007199254740992LL, {iterator = 'LT'}))
+space:drop()
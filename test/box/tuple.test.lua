@@ -316,4 +316,29 @@ ffi.typeof('struct tuple')
 box.tuple.new(string.rep('x', 100 * 1024 * 1024)) == nil
 collectgarbage('collect') -- collect huge string
 
+-- field_map_count: offsets of unindexed fields
+space = box.schema.space.create('tweedledum', { field_map_count = 4 })
+index = space:create_index('primary')
+t = space:insert{1, 2, 3, 4, 5}
+t[2], t[4], t[5]
+t = space:insert{2}
+t[2], t[4]
+space:update(1, {{'=', 3, 'x'}})
+space:get(1)[3]
+space:drop()
+box.schema.space.create('tweedledee', { field_map_count = 100000 })
+-- would be 4 if wrapped to 32 bits
+box.schema.space.create('tweedledee', { field_map_count = 2^32 + 4 })
+
+-- tuples around the length stored in the tuple header
+space = box.schema.space.create('tweedledum')
+index = space:create_index('primary')
+index2 = space:create_index('secondary', { parts = {3, 'num'} })
+for i = 65520, 65540 do space:insert{i, string.rep('x', i), i} end
+msgpack = require('msgpack')
+bad = {}
+for i = 65520, 65540 do local t = index2:get{i} if #t[2] ~= i or t:bsize() ~= #msgpack.encode(t:totable()) then table.insert(bad, i) end end
+bad
+space:drop()
+
 test_run:cmd("clear filter")
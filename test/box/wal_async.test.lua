@@ -0,0 +1,24 @@
+-- async commit: don't wait for the WAL write
+box.session.async_commit()
+box.session.async_commit(true)
+space = box.schema.space.create('test')
+index = space:create_index('primary')
+for i = 1, 100 do space:insert{i} end
+space:count()
+lsn = box.info.server.lsn
+box.wal.wait_lsn(lsn, 10)
+box.info.wal.durable_lsn >= lsn
+box.session.async_commit(false)
+space:insert{101}
+box.info.wal.durable_lsn == box.info.server.lsn
+-- nothing to wait for
+box.wal.wait_lsn(box.info.server.lsn, 0)
+box.wal.wait_lsn()
+-- rows committed asynchronously are written at shutdown
+test_run = require('test_run').new()
+box.session.async_commit(true)
+for i = 102, 200 do space:insert{i} end
+test_run:cmd('restart server default')
+space = box.space.test
+space:count()
+space:drop()
@@ -0,0 +1,41 @@
+-- group commit: wait for more requests before a WAL write
+fiber = require('fiber')
+space = box.schema.space.create('test')
+index = space:create_index('primary')
+test_run = require('test_run').new()
+test_run:cmd("setopt delimiter ';'")
+function insert_many(first, last)
+    local ch = fiber.channel(last - first + 1)
+    for i = first, last do
+        fiber.create(function() space:insert{i} ch:put(true) end)
+    end
+    for i = first, last do ch:get() end
+end;
+test_run:cmd("setopt delimiter ''");
+
+-- a single commit waits for the delay
+box.cfg{wal_commit_delay = 0.1, wal_commit_max_rows = 1000}
+t = fiber.time()
+space:insert{0}
+fiber.time() - t >= 0.09
+
+-- concurrent commits share a batch
+stat = box.info.wal
+insert_many(1, 100)
+new = box.info.wal
+new.rows - stat.rows
+new.batch_count - stat.batch_count < 10
+new.batch_wait > 0
+
+-- a full batch cuts the wait short
+box.cfg{wal_commit_delay = 10, wal_commit_max_rows = 10}
+t = fiber.time()
+insert_many(101, 110)
+fiber.time() - t < 5
+
+box.cfg{wal_commit_delay = 0, wal_commit_max_rows = 1000}
+t = fiber.time()
+space:insert{111}
+fiber.time() - t < 5
+space:count()
+space:drop()
@@ -0,0 +1,18 @@
+-- box.info.wal: WAL writer statistics
+keys = {} for k in pairs(box.info.wal) do table.insert(keys, k) end table.sort(keys)
+keys
+old = box.info.wal
+space = box.schema.space.create('test')
+index = space:create_index('primary')
+for i = 1, 10 do space:insert{i} end
+new = box.info.wal
+-- 12 rows written one at a time
+new.rows - old.rows >= 12
+new.batch_count - old.batch_count >= 12
+new.bytes > old.bytes
+new.durable_lsn > old.durable_lsn
+#new.batch_rows_hist > 0
+new.batch_rows >= 1
+-- the average is over the batches which were written
+new.write_time > 0 and new.write_time <= new.write_max
+space:drop()
@@ -0,0 +1,382 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <map>
+#include <string>
+
+#include "unit.h"
+#include "salad/art.h"
+
+static int page_count = 0;
+
+const uint32_t extent_size = 1024 * 8;
+
+static void *
+extent_alloc()
+{
+	page_count++;
+	return malloc(extent_size);
+}
+
+static void
+extent_free(void *page)
+{
+	page_count--;
+	free(page);
+}
+
+struct test_record {
+	uint32_t size;
+	char key[64];
+};
+
+static const char *
+test_record_key(void *record, void *arg, uint32_t *key_size)
+{
+	(void) arg;
+	struct test_record *r = (struct test_record *)record;
+	*key_size = r->size;
+	return r->key;
+}
+
+/* Keys end with '\0', so no key is a prefix of another one */
+static void
+test_record_set(struct test_record *r, const char *prefix, unsigned i)
+{
+	r->size = snprintf(r->key, sizeof(r->key), "%s%u", prefix, i) + 1;
+}
+
+typedef std::map<std::string, struct test_record *> model_t;
+
+static std::string
+model_key(const struct test_record *r)
+{
+	return std::string(r->key, r->size);
+}
+
+static bool
+has_prefix(const std::string &key, const std::string &prefix)
+{
+	return key.compare(0, prefix.size(), prefix) == 0;
+}
+
+/* Check an iteration against the model */
+static void
+check_iteration(struct art *tree, const model_t &model,
+		enum art_iterator_type type, const std::string &key)
+{
+	struct art_iterator itr;
+	art_iterator_init(&itr);
+	if (art_iterator_start(&itr, tree, type, key.data(), key.size()) != 0)
+		fail("iterator start", "-1");
+	model_t::const_iterator fwd = model.end();
+	model_t::const_reverse_iterator rev = model.rend();
+	switch (type) {
+	case ART_ITER_PREFIX:
+	case ART_ITER_GE:
+		fwd = model.lower_bound(key);
+		break;
+	case ART_ITER_GT:
+		fwd = model.lower_bound(key);
+		while (fwd != model.end() && has_prefix(fwd->first, key))
+			++fwd;
+		break;
+	case ART_ITER_RPREFIX:
+	case ART_ITER_LE:
+		rev = model_t::const_reverse_iterator(model.lower_bound(key));
+		while (rev != model.rbegin()) {
+			model_t::const_reverse_iterator prev = rev;
+			--prev;
+			if (!has_prefix(prev->first, key))
+				break;
+			rev = prev;
+		}
+		break;
+	case ART_ITER_LT:
+		rev = model_t::const_reverse_iterator(model.lower_bound(key));
+		break;
+	}
+	bool reverse = type == ART_ITER_RPREFIX || type == ART_ITER_LE ||
+		       type == ART_ITER_LT;
+	bool prefix = type == ART_ITER_PREFIX || type == ART_ITER_RPREFIX;
+	while (true) {
+		struct test_record *expected = NULL;
+		if (!reverse && fwd != model.end())
+			expected = (fwd++)->second;
+		else if (reverse && rev != model.rend())
+			expected = (rev++)->second;
+		if (expected != NULL && prefix &&
+		    !has_prefix(model_key(expected), key))
+			expected = NULL;
+		void *record;
+		if (art_iterator_next(&itr, &record) != 0)
+			fail("iterator next", "-1");
+		if (record != expected)
+			fail("iteration result", "wrong");
+		if (record == NULL)
+			break;
+	}
+	art_iterator_destroy(&itr);
+}
+
+static void
+simple_check()
+{
+	header();
+
+	const unsigned count = 10000;
+	struct test_record *records = (struct test_record *)
+		calloc(count, sizeof(*records));
+	struct art tree;
+	art_init(&tree, extent_size, extent_alloc, extent_free,
+		 test_record_key, NULL);
+
+	for (unsigned i = 0; i < count; i++) {
+		test_record_set(&records[i], "", i * 7919 % count);
+		void *replaced;
+		if (art_insert(&tree, records[i].key, records[i].size,
+			       &records[i], &replaced) != 0)
+			fail("insert", "-1");
+		if (replaced != NULL)
+			fail("replaced record", "not NULL");
+	}
+	if (art_size(&tree) != count)
+		fail("tree size", "wrong");
+	for (unsigned i = 0; i < count; i++) {
+		if (art_find(&tree, records[i].key, records[i].size) !=
+		    &records[i])
+			fail("find", "wrong");
+	}
+	if (art_find(&tree, "1", 1) != NULL)
+		fail("find a key prefix", "not NULL");
+	if (art_find(&tree, "12345678", 9) != NULL)
+		fail("find a missing key", "not NULL");
+
+	/* The same key replaces the record */
+	struct test_record twin = records[0];
+	void *replaced;
+	if (art_insert(&tree, twin.key, twin.size, &twin, &replaced) != 0)
+		fail("insert", "-1");
+	if (replaced != &records[0] || art_size(&tree) != count)
+		fail("replaced record", "wrong");
+	if (art_insert(&tree, twin.key, twin.size, &records[0],
+		       &replaced) != 0 || replaced != &twin)
+		fail("replaced record", "wrong");
+
+	for (unsigned i = 0; i < count; i += 2) {
+		if (art_delete(&tree, records[i].key, records[i].size) !=
+		    &records[i])
+			fail("delete", "wrong");
+		if (art_delete(&tree, records[i].key, records[i].size) != NULL)
+			fail("delete twice", "not NULL");
+	}
+	if (art_size(&tree) != count / 2)
+		fail("tree size", "wrong");
+	for (unsigned i = 0; i < count; i++) {
+		void *expected = i % 2 == 0 ? NULL : &records[i];
+		if (art_find(&tree, records[i].key, records[i].size) !=
+		    expected)
+			fail("find after delete", "wrong");
+	}
+	for (unsigned i = 1; i < count; i += 2)
+		art_delete(&tree, records[i].key, records[i].size);
+	if (art_size(&tree) != 0 || tree.root != NULL)
+		fail("tree is empty", "false");
+
+	art_destroy(&tree);
+	free(records);
+
+	footer();
+}
+
+static void
+iterator_check()
+{
+	header();
+
+	/* Long common prefixes are not stored in nodes completely */
+	static const char *prefixes[] = {
+		"", "a", "ab", "abc", "http://tarantool.org/doc/",
+		"http://tarantool.org/download/", "\x01\x02", "\xff\xfe\xfd"
+	};
+	const unsigned n_prefixes = sizeof(prefixes) / sizeof(prefixes[0]);
+	const unsigned count = 4000;
+	struct test_record *records = (struct test_record *)
+		calloc(count, sizeof(*records));
+	struct art tree;
+	art_init(&tree, extent_size, extent_alloc, extent_free,
+		 test_record_key, NULL);
+	model_t model;
+
+	srand(1);
+	for (unsigned i = 0; i < count; i++) {
+		test_record_set(&records[i], prefixes[rand() % n_prefixes],
+				rand() % 100000);
+		void *replaced;
+		if (art_insert(&tree, records[i].key, records[i].size,
+			       &records[i], &replaced) != 0)
+			fail("insert", "-1");
+		model[model_key(&records[i])] = &records[i];
+	}
+	if (art_size(&tree) != model.size())
+		fail("tree size", "wrong");
+
+	static const char *keys[] = {
+		"", "1", "12", "a", "ab", "abc1", "abd", "b", "http://",
+		"http://tarantool.org/", "http://tarantool.org/doc/1",
+		"http://tarantool.org/doc/2\0", "\x01", "\xff", "\xff\xff"
+	};
+	static const size_t key_sizes[] = {
+		0, 1, 2, 1, 2, 4, 3, 1, 7, 21, 26, 27, 1, 1, 2
+	};
+	for (unsigned k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) {
+		std::string key(keys[k], key_sizes[k]);
+		for (int type = ART_ITER_PREFIX; type <= ART_ITER_LT; type++)
+			check_iteration(&tree, model,
+					(enum art_iterator_type)type, key);
+	}
+	for (unsigned i = 0; i < 200; i++) {
+		std::string key = model_key(&records[rand() % count]);
+		key.resize(rand() % key.size() + 1);
+		for (int type = ART_ITER_PREFIX; type <= ART_ITER_LT; type++)
+			check_iteration(&tree, model,
+					(enum art_iterator_type)type, key);
+	}
+
+	art_destroy(&tree);
+	free(records);
+
+	footer();
+}
+
+static void
+modification_check()
+{
+	header();
+
+	const unsigned count = 3000;
+	struct test_record *records = (struct test_record *)
+		calloc(2 * count, sizeof(*records));
+	struct art tree;
+	art_init(&tree, extent_size, extent_alloc, extent_free,
+		 test_record_key, NULL);
+	model_t model;
+	for (unsigned i = 0; i < count; i++) {
+		test_record_set(&records[i], "key", i);
+		void *replaced;
+		art_insert(&tree, records[i].key, records[i].size,
+			   &records[i], &replaced);
+		model[model_key(&records[i])] = &records[i];
+	}
+
+	/*
+	 * Delete each record returned and insert a record that
+	 * goes after it: the iterator must see the new records
+	 * and no deleted ones.
+	 */
+	struct art_iterator itr;
+	art_iterator_init(&itr);
+	art_iterator_start(&itr, &tree, ART_ITER_GE, "", 0);
+	model_t::iterator it = model.begin();
+	unsigned added = 0;
+	void *record;
+	while (art_iterator_next(&itr, &record) == 0 && record != NULL) {
+		if (it == model.end() || record != it->second)
+			fail("iteration result", "wrong");
+		struct test_record *r = (struct test_record *)record;
+		if (art_delete(&tree, r->key, r->size) != record)
+			fail("delete", "wrong");
+		if (added < count && rand() % 2 == 0) {
+			struct test_record *n = &records[count + added++];
+			n->size = r->size + 1;
+			memcpy(n->key, r->key, r->size - 1);
+			n->key[r->size - 1] = 'x';
+			n->key[r->size] = '\0';
+			void *replaced;
+			art_insert(&tree, n->key, n->size, n, &replaced);
+			model[model_key(n)] = n;
+		}
+		model_t::iterator next = it;
+		++next;
+		model.erase(it);
+		it = next;
+	}
+	if (it != model.end() || art_size(&tree) != 0)
+		fail("all records are visited", "false");
+	art_iterator_destroy(&itr);
+
+	art_destroy(&tree);
+	free(records);
+
+	footer();
+}
+
+static void
+wide_node_check()
+{
+	header();
+
+	/* Keys of the same size with all byte values */
+	const unsigned count = 20000;
+	struct test_record *records = (struct test_record *)
+		calloc(count, sizeof(*records));
+	struct art tree;
+	art_init(&tree, extent_size, extent_alloc, extent_free,
+		 test_record_key, NULL);
+	model_t model;
+	srand(2);
+	for (unsigned i = 0; i < count; i++) {
+		unsigned j = rand() % (i + 1);
+		records[i] = records[j];
+		records[j].size = 4;
+		records[j].key[0] = 0;
+		records[j].key[1] = (char)(i >> 16);
+		records[j].key[2] = (char)(i >> 8);
+		records[j].key[3] = (char)i;
+	}
+	for (unsigned i = 0; i < count; i++) {
+		void *replaced;
+		if (art_insert(&tree, records[i].key, records[i].size,
+			       &records[i], &replaced) != 0)
+			fail("insert", "-1");
+		model[model_key(&records[i])] = &records[i];
+	}
+	for (unsigned i = 0; i < count; i++) {
+		if (i % 1000 == 0) {
+			std::string key = model_key(&records[i]);
+			check_iteration(&tree, model, ART_ITER_GE, key);
+			check_iteration(&tree, model, ART_ITER_LT, key);
+			key.resize(3);
+			check_iteration(&tree, model, ART_ITER_PREFIX, key);
+			check_iteration(&tree, model, ART_ITER_RPREFIX, key);
+		}
+		if (art_delete(&tree, records[i].key, records[i].size) !=
+		    &records[i])
+			fail("delete", "wrong");
+		model.erase(model_key(&records[i]));
+		if (art_find(&tree, records[(i + 1) % count].key, 4) !=
+		    (i + 1 < count ? &records[i + 1] : NULL))
+			fail("find after delete", "wrong");
+	}
+	if (art_size(&tree) != 0 || tree.root != NULL)
+		fail("tree is empty", "false");
+
+	art_destroy(&tree);
+	free(records);
+
+	footer();
+}
+
+int
+main(void)
+{
+	simple_check();
+	wide_node_check();
+	iterator_check();
+	modification_check();
+	if (page_count != 0) {
+		fail("memory leak!", "true");
+	}
+}
@@ -198,12 +198,51 @@ void test_get_set()
 	footer();
 }
 
+static
+void test_sparse_page()
+{
+	header();
+
+	struct bitset bm;
+	bitset_create(&bm, realloc);
+	struct bitset_info info;
+
+	/* Every 8th bit of one page: sparse at first, dense then */
+	const size_t STEP = 8;
+	const size_t NUM_SIZE = 1024 / STEP;
+	for (size_t i = 0; i < NUM_SIZE; i++) {
+		fail_if(bitset_set(&bm, i * STEP) != 0);
+		fail_if(bitset_set(&bm, i * STEP) != 1);
+		bitset_info(&bm, &info);
+		fail_unless(info.pages == 1);
+		fail_unless(info.array_pages == (i < 64 ? 1 : 0));
+	}
+	for (size_t i = 0; i < NUM_SIZE * STEP; i++)
+		fail_unless(bitset_test(&bm, i) == (i % STEP == 0));
+
+	/* Clear back until the page is sparse again */
+	for (size_t i = NUM_SIZE; i-- > 16;) {
+		fail_if(bitset_clear(&bm, i * STEP) != 1);
+		fail_if(bitset_clear(&bm, i * STEP) != 0);
+	}
+	bitset_info(&bm, &info);
+	fail_unless(info.pages == 1 && info.array_pages == 1);
+	fail_unless(bitset_cardinality(&bm) == 16);
+	for (size_t i = 0; i < NUM_SIZE * STEP; i++)
+		fail_unless(bitset_test(&bm, i) == (i % STEP == 0 && i < 128));
+
+	bitset_destroy(&bm);
+
+	footer();
+}
+
 int main(int argc, char *argv[])
 {
 	setbuf(stdout, NULL);
 	srand(time(NULL));
 	test_cardinality();
 	test_get_set();
+	test_sparse_page();
 
 	return 0;
 }
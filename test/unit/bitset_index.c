@@ -283,6 +283,66 @@ void test_equals_simple(void)
 	footer();
 }
 
+static void
+check_range(struct bitset_index *index, size_t size, size_t key, int cmp,
+	    bool or_equals)
+{
+	struct bitset_iterator it;
+	bitset_iterator_create(&it, realloc);
+	struct bitset_expr expr;
+	bitset_expr_create(&expr, realloc);
+
+	if (cmp < 0) {
+		fail_unless(bitset_index_expr_less(&expr, &key, sizeof(key),
+						   or_equals) == 0);
+	} else {
+		fail_unless(bitset_index_expr_greater(&expr, &key, sizeof(key),
+						      or_equals) == 0);
+	}
+	fail_unless(bitset_index_init_iterator(index, &it, &expr) == 0);
+
+	/* Pair (i * 3, i) is in the index */
+	for (size_t i = 0; i < size; i++) {
+		size_t k = i * 3;
+		if ((cmp < 0 && k < key) || (cmp > 0 && k > key) ||
+		    (or_equals && k == key))
+			fail_unless(bitset_iterator_next(&it) == i);
+	}
+	fail_unless(bitset_iterator_next(&it) == SIZE_MAX);
+
+	bitset_expr_destroy(&expr);
+	bitset_iterator_destroy(&it);
+}
+
+static
+void test_range_simple(void)
+{
+	header();
+
+	struct bitset_index index;
+	fail_unless(bitset_index_create(&index, realloc) == 0);
+
+	enum { SIZE = 1000 };
+	for (size_t i = 0; i < SIZE; i++) {
+		size_t key = i * 3;
+		fail_unless(bitset_index_insert(&index, &key, sizeof(key),
+						i) == 0);
+	}
+
+	size_t keys[] = { 0, 1, 2, 3, 255, 256, 1500, 2997, 2998, 3000,
+			  SIZE_MAX };
+	for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) {
+		check_range(&index, SIZE, keys[k], -1, false);
+		check_range(&index, SIZE, keys[k], -1, true);
+		check_range(&index, SIZE, keys[k], 1, false);
+		check_range(&index, SIZE, keys[k], 1, true);
+	}
+
+	bitset_index_destroy(&index);
+
+	footer();
+}
+
 int main(void)
 {
 	setbuf(stdout, NULL);
@@ -295,6 +355,7 @@ int main(void)
 	test_all_set_simple();
 	test_any_set_simple();
 	test_equals_simple();
+	test_range_simple();
 
 	return 0;
 }
@@ -39,6 +39,27 @@ compare(type_t a, type_t b);
 #undef bps_tree_key_t
 #undef bps_tree_arg_t
 
+/* tree with subtree counts in inner blocks */
+#define BPS_TREE_NAME _count
+#define BPS_TREE_BLOCK_SIZE 128 /* value is to low specially for tests */
+#define BPS_TREE_EXTENT_SIZE 2048 /* value is to low specially for tests */
+#define BPS_TREE_COMPARE(a, b, arg) compare(a, b)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) compare(a, b)
+#define bps_tree_elem_t type_t
+#define bps_tree_key_t type_t
+#define bps_tree_arg_t int
+#define BPS_INNER_CHILD_COUNTS
+#include "salad/bps_tree.h"
+#undef BPS_TREE_NAME
+#undef BPS_TREE_BLOCK_SIZE
+#undef BPS_TREE_EXTENT_SIZE
+#undef BPS_TREE_COMPARE
+#undef BPS_TREE_COMPARE_KEY
+#undef bps_tree_elem_t
+#undef bps_tree_key_t
+#undef bps_tree_arg_t
+#undef BPS_INNER_CHILD_COUNTS
+
 /* true tree with true settings */
 #define BPS_TREE_NAME _test
 #define BPS_TREE_BLOCK_SIZE 128 /* value is to low specially for tests */
@@ -629,6 +650,130 @@ white_box_test()
 	footer();
 }
 
+static void
+find_batch_test()
+{
+	header();
+
+	bps_tree_test tree;
+	bps_tree_test_create(&tree, 0, extent_alloc, extent_free);
+	const type_t count = 1000;
+	for (type_t i = 0; i < count; i++)
+		bps_tree_test_insert(&tree, i * 2, 0);
+
+	/* Both present and absent keys, more than a batch. */
+	type_t keys[count];
+	type_t *res[count];
+	for (type_t i = 0; i < count; i++)
+		keys[i] = rand() % (count * 2 + 10);
+	bps_tree_test_find_batch(&tree, keys, count, res);
+	for (type_t i = 0; i < count; i++) {
+		if (res[i] != bps_tree_test_find(&tree, keys[i]))
+			fail("find_batch result mismatch", "true");
+	}
+
+	bps_tree_test_destroy(&tree);
+
+	footer();
+}
+
+static void
+check_offsets(bps_tree_count *tree, type_t *arr, size_t size)
+{
+	if (bps_tree_count_debug_check(tree)) {
+		bps_tree_count_print(tree, TYPE_F);
+		fail("debug check nonzero", "true");
+	}
+	if (bps_tree_count_size(tree) != size)
+		fail("tree size mismatch", "true");
+	for (size_t i = 0; i < size; i++) {
+		bps_tree_count_iterator itr = bps_tree_count_itr_at(tree, i);
+		type_t *elem = bps_tree_count_itr_get_elem(tree, &itr);
+		if (elem == NULL || *elem != arr[i])
+			fail("element by offset mismatch", "true");
+		if (bps_tree_count_itr_offset(tree, &itr) != i)
+			fail("iterator offset mismatch", "true");
+		bool exact;
+		if (bps_tree_count_lower_bound_offset(tree, arr[i],
+						      &exact) != i || !exact)
+			fail("lower bound offset mismatch", "true");
+		if (bps_tree_count_upper_bound_offset(tree, arr[i],
+						      &exact) != i + 1 || !exact)
+			fail("upper bound offset mismatch", "true");
+		/* All elements are even, so odd keys are absent. */
+		if (bps_tree_count_lower_bound_offset(tree, arr[i] + 1,
+						      &exact) != i + 1 || exact)
+			fail("absent key offset mismatch", "true");
+	}
+	bps_tree_count_iterator itr = bps_tree_count_itr_at(tree, size);
+	if (!bps_tree_count_itr_is_invalid(&itr))
+		fail("iterator past the end is valid", "true");
+	if (bps_tree_count_itr_offset(tree, &itr) != size)
+		fail("invalid iterator offset mismatch", "true");
+	if (bps_tree_count_lower_bound_offset(tree, -1, NULL) != 0)
+		fail("lower bound offset of the min key", "true");
+}
+
+static void
+order_statistics_test()
+{
+	header();
+
+	const size_t count = 2000;
+	type_t arr[count];
+	type_t perm[count];
+	for (size_t i = 0; i < count; i++)
+		perm[i] = i * 2;
+	for (size_t i = 0; i < count; i++) {
+		size_t j = rand() % (count - i);
+		type_t tmp = perm[i];
+		perm[i] = perm[i + j];
+		perm[i + j] = tmp;
+	}
+
+	bps_tree_count tree;
+	bps_tree_count_create(&tree, 0, extent_alloc, extent_free);
+	for (size_t i = 0; i < count; i++) {
+		bps_tree_count_insert(&tree, perm[i], 0);
+		if (i % 100 == 0) {
+			size_t size = 0;
+			for (type_t v = 0; v < (type_t)count * 2; v += 2)
+				if (bps_tree_count_find(&tree, v) != NULL)
+					arr[size++] = v;
+			check_offsets(&tree, arr, size);
+		}
+	}
+	for (size_t i = 0; i < count; i++)
+		arr[i] = i * 2;
+	check_offsets(&tree, arr, count);
+
+	/* Replacement does not change the counts. */
+	bps_tree_count_insert(&tree, arr[count / 2], 0);
+	check_offsets(&tree, arr, count);
+
+	for (size_t i = 0; i < count; i++) {
+		bps_tree_count_delete(&tree, perm[i]);
+		if (i % 100 == 0) {
+			size_t size = 0;
+			for (type_t v = 0; v < (type_t)count * 2; v += 2)
+				if (bps_tree_count_find(&tree, v) != NULL)
+					arr[size++] = v;
+			check_offsets(&tree, arr, size);
+		}
+	}
+	check_offsets(&tree, arr, 0);
+	bps_tree_count_destroy(&tree);
+
+	for (size_t i = 0; i < count; i++)
+		arr[i] = i * 2;
+	bps_tree_count_create(&tree, 0, extent_alloc, extent_free);
+	bps_tree_count_build(&tree, arr, count);
+	check_offsets(&tree, arr, count);
+	bps_tree_count_destroy(&tree);
+
+	footer();
+}
+
 int
 main(void)
 {
@@ -639,6 +784,8 @@ main(void)
 	loading_test();
 	printing_test();
 	white_box_test();
+	find_batch_test();
+	order_statistics_test();
 	if (extents_count != 0)
 		fail("memory leak!", "true");
 }
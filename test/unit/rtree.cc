@@ -255,11 +255,85 @@ neighbor_test()
 }
 
 
+static void
+bulk_load_test()
+{
+	header();
+
+	const size_t counts[] = { 0, 1, 2, 30, 31, 1000, 10007 };
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		size_t count = counts[c];
+		struct rtree tree;
+		rtree_init(&tree, 2, extent_size, extent_alloc, extent_free,
+			   RTREE_EUCLID);
+
+		struct rtree_rect *rects = (struct rtree_rect *)
+			malloc((count + 1) * sizeof(*rects));
+		size_t item_size = rtree_build_item_size(&tree);
+		char *items = (char *) malloc((count + 1) * item_size);
+		for (size_t i = 0; i < count; i++) {
+			coord_t x = rand() % 1000, y = rand() % 1000;
+			rtree_set2d(&rects[i], x, y, x + rand() % 10,
+				    y + rand() % 10);
+			rtree_build_item_set(&tree, items + i * item_size,
+					     &rects[i], (record_t)(i + 1));
+		}
+		rtree_build(&tree, items, count);
+		free(items);
+
+		if (rtree_number_of_records(&tree) != count)
+			fail("Tree count mismatch", "true");
+
+		struct rtree_iterator iterator;
+		rtree_iterator_init(&iterator);
+		for (size_t k = 0; k < 100; k++) {
+			struct rtree_rect rect;
+			coord_t x = rand() % 1000, y = rand() % 1000;
+			rtree_set2d(&rect, x, y, x + 50, y + 50);
+			size_t expected = 0;
+			for (size_t i = 0; i < count; i++) {
+				if (rects[i].coords[0] <= rect.coords[1] &&
+				    rects[i].coords[1] >= rect.coords[0] &&
+				    rects[i].coords[2] <= rect.coords[3] &&
+				    rects[i].coords[3] >= rect.coords[2])
+					expected++;
+			}
+			size_t found = 0;
+			if (rtree_search(&tree, &rect, SOP_OVERLAPS,
+					 &iterator)) {
+				while (rtree_iterator_next(&iterator) != NULL)
+					found++;
+			}
+			if (found != expected)
+				fail("overlaps search result", "wrong");
+		}
+		rtree_iterator_destroy(&iterator);
+
+		/* The tree is modifiable as usual after the build */
+		struct rtree_rect rect;
+		rtree_set2d(&rect, 2000, 2000, 2001, 2001);
+		rtree_insert(&tree, &rect, (record_t)(count + 1));
+		rects[count] = rect;
+		for (size_t i = 0; i <= count; i++) {
+			if (!rtree_remove(&tree, &rects[i], (record_t)(i + 1)))
+				fail("delete element in tree", "false");
+		}
+		if (rtree_number_of_records(&tree) != 0)
+			fail("Tree count mismatch", "true");
+
+		free(rects);
+		rtree_destroy(&tree);
+	}
+
+	footer();
+}
+
 int
 main(void)
 {
 	simple_check();
 	neighbor_test();
+	bulk_load_test();
 	if (page_count != 0) {
 		fail("memory leak!", "true");
 	}
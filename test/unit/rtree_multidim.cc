@@ -362,6 +362,45 @@ test_select_neigh(const CBoxSet<DIMENSION> &set, const struct rtree *tree)
 
 }
 
+template<unsigned DIMENSION>
+static void
+test_select_neigh_limit(const CBoxSet<DIMENSION> &set,
+			const struct rtree *tree)
+{
+	CBox<DIMENSION> box;
+	box.RandomizeBig();
+	vector<CBoxSetEntry<DIMENSION> > res1;
+	set.SelectNeigh(box, res1);
+
+	struct rtree_rect rt;
+	box.FillRTreeRect(&rt);
+	struct rtree_iterator iterator;
+	rtree_iterator_init(&iterator);
+	vector<CBoxSetEntry<DIMENSION> > res2;
+	if (rtree_search(tree, &rt, SOP_NEIGHBOR, &iterator)) {
+		rtree_iterator_set_limit(&iterator, NEIGH_COUNT);
+		void *record;
+		while((record = rtree_iterator_next(&iterator))) {
+			CBoxSetEntry<DIMENSION> entry;
+			entry.id = ((unsigned)(uintptr_t)record) - 1;
+			entry.box = set.entries[entry.id].box;
+			res2.push_back(entry);
+		}
+	}
+	if (res1.size() != res2.size()) {
+		printf("%s result size differ %d %d\n", __func__,
+		       (int)res1.size(), (int)res2.size());
+	} else {
+		for (size_t i = 0; i < res1.size(); i++)
+			if (res1[i].id != res2[i].id &&
+			    res1[i].box.Distance2(box) !=
+			    res2[i].box.Distance2(box))
+				printf("%s result differ!\n", __func__);
+	}
+	rtree_iterator_destroy(&iterator);
+
+}
+
 template<unsigned DIMENSION>
 static void
 test_select_neigh_man(const CBoxSet<DIMENSION> &set, struct rtree *tree)
@@ -517,6 +556,7 @@ rand_test()
 		}
 		assert(set.boxCount == tree.n_records);
 		test_select_neigh<DIMENSION>(set, &tree);
+		test_select_neigh_limit<DIMENSION>(set, &tree);
 		test_select_neigh_man<DIMENSION>(set, &tree);
 		test_select_in<DIMENSION>(set, &tree);
 		test_select_strict_in<DIMENSION>(set, &tree);
@@ -37,6 +37,21 @@ errinj.set('ERRINJ_WAL_WRITE', true)
 c.space.test:insert({box.cfg.rows_per_wal + 1,1,2,3})
 errinj.set('ERRINJ_WAL_WRITE', false)
 
+-- a failed async commit can't be rolled back, so memory no
+-- longer matches the WAL and the server stops accepting writes
+fiber = require('fiber')
+box.session.async_commit(true)
+errinj.set('ERRINJ_WAL_WRITE', true)
+test:insert{box.cfg.rows_per_wal + 2}
+while not box.info.server.ro do fiber.sleep(0.01) end
+errinj.set('ERRINJ_WAL_WRITE', false)
+box.session.async_commit(false)
+test:insert{box.cfg.rows_per_wal + 3}
+box.cfg{read_only = true}
+box.cfg{read_only = false}
+box.info.server.ro
+test:insert{box.cfg.rows_per_wal + 3}
+
 -- Cleanup
 test:drop()
 errinj = nil
@@ -0,0 +1,12 @@
+#!/usr/bin/env tarantool
+os = require('os')
+
+box.cfg{
+    listen              = os.getenv("LISTEN"),
+    slab_alloc_arena    = 0.1,
+    pid_file            = "tarantool.pid",
+    wal_mode            = "fsync",
+    rows_per_wal        = 10
+}
+
+require('console').listen(os.getenv('ADMIN'))
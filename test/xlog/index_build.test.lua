@@ -0,0 +1,30 @@
+env = require('test_run')
+test_run = env.new()
+
+--
+-- Secondary keys of a space loaded from a snapshot without
+-- index images are built after recovery, TREE keys by worker
+-- threads, the rest in tx meanwhile.
+--
+s = box.schema.space.create('build')
+_ = s:create_index('pk')
+_ = s:create_index('uk', {parts = {2, 'str'}})
+_ = s:create_index('sk', {parts = {3, 'num', 4, 'num'}, unique = false})
+_ = s:create_index('nk', {parts = {7, 'number'}, unique = false})
+_ = s:create_index('hash', {type = 'hash', parts = {2, 'str'}})
+_ = s:create_index('rt', {type = 'rtree', parts = {5, 'array'}, unique = false})
+_ = s:create_index('bs', {type = 'bitset', parts = {6, 'num'}, unique = false})
+box.begin() for i = 1, 5000 do s:insert{i, 'k' .. i, i % 10, i % 3, {i % 100, i % 50}, i % 16, i % 2 == 0 and -i or i / 2} end box.commit()
+box.snapshot()
+test_run:cmd('restart server default')
+test_run:grep_log('default', "Building secondary indexes in space 'build'") ~= nil
+s = box.space.build
+for _, i in pairs({'uk', 'sk', 'nk', 'hash', 'rt', 'bs'}) do assert(s.index[i]:count() == 5000) end
+s.index.uk:get{'k777'}[1]
+s.index.sk:count{3, 1}
+s.index.nk:min()[1]
+s.index.nk:max()[1]
+s.index.hash:get{'k4999'}[1]
+#s.index.rt:select({1, 1}, {iterator = 'EQ'})
+#s.index.bs:select(5, {iterator = 'EQ'})
+s:drop()
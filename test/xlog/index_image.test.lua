@@ -0,0 +1,59 @@
+env = require('test_run')
+test_run = env.new()
+
+--
+-- Secondary TREE keys are loaded from images saved in the
+-- snapshot, other secondary keys of the space are built as
+-- usual. A space without images is built after recovery.
+--
+box.cfg{snap_index_image = true}
+s = box.schema.space.create('image')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'str'}, unique = false})
+_ = s:create_index('hash', {type = 'hash', parts = {3, 'num'}})
+for i = 1, 20 do s:insert{i, tostring(i % 4), 100 - i} end
+-- no images for a space with a HASH primary key
+n = box.schema.space.create('noimage')
+_ = n:create_index('pk', {type = 'hash'})
+_ = n:create_index('sk', {parts = {2, 'num'}})
+for i = 1, 10 do n:insert{i, 100 - i} end
+box.snapshot()
+-- these changes are replayed from the WAL with all keys enabled
+s:delete{1}
+s:replace{2, 'x', 2000}
+n:delete{1}
+test_run:cmd('restart server default')
+test_run:grep_log('default', "Loading secondary indexes of space 'image'") ~= nil
+test_run:grep_log('default', "Loading secondary indexes of space 'noimage'") == nil
+s = box.space.image
+n = box.space.noimage
+s:count()
+s.index.sk:select{'1'}
+s.index.sk:select{'x'}
+s.index.sk:min()
+s.index.sk:max()
+s.index.hash:get{90}
+s.index.hash:get{98}
+n.index.sk:select({}, {limit = 3})
+n:count()
+
+--
+-- A snapshot without images: all keys are built after
+-- recovery.
+--
+box.cfg.snap_index_image
+box.snapshot()
+test_run:cmd('restart server default')
+s = box.space.image
+n = box.space.noimage
+s:count()
+s.index.sk:select{'1'}
+s.index.sk:select{'x'}
+s.index.sk:min()
+s.index.sk:max()
+s.index.hash:get{90}
+s.index.hash:get{98}
+n.index.sk:select({}, {limit = 3})
+n:count()
+s:drop()
+n:drop()
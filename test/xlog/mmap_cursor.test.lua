@@ -0,0 +1,44 @@
+env = require('test_run')
+test_run = env.new()
+box.schema.user.grant('guest', 'replication')
+
+--
+-- Files which end with the EOF marker, snapshots and closed
+-- WALs, are read through mmap. The current WAL is read with
+-- stdio.
+--
+s = box.schema.space.create('mmap')
+_ = s:create_index('pk')
+-- over 8MB, so read pages are dropped on the way
+box.begin() for i = 1, 10000 do s:insert{i, string.rep('x', 1000)} end box.commit()
+box.snapshot()
+-- several closed WALs and the current one
+for i = 1, 35 do s:replace{i, 'after snapshot'} end
+n = 0 for _, t in s:pairs() do n = n + #t[2] end
+n
+test_run:cmd('restart server default')
+s = box.space.mmap
+s:count()
+s:get{35}
+s:get{36}[2] == string.rep('x', 1000)
+n = 0 for _, t in s:pairs() do n = n + #t[2] end
+n
+
+--
+-- A replica gets the same files from a relay.
+--
+test_run:cmd("create server replica with rpl_master=default, script='xlog/replica.lua'")
+test_run:cmd("start server replica")
+test_run:cmd("switch replica")
+fiber = require('fiber')
+s = box.space.mmap
+while s:get{35}[2] ~= 'after snapshot' do fiber.sleep(0.001) end
+s:count()
+n = 0 for _, t in s:pairs() do n = n + #t[2] end
+n
+test_run:cmd("switch default")
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+
+s:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -0,0 +1,31 @@
+env = require('test_run')
+test_run = env.new()
+fio = require('fio')
+
+--
+-- A compressed snapshot is written in blocks and read back at
+-- start. zstd is optional at build time: without it the
+-- snapshot is written and read uncompressed.
+--
+has_zstd = pcall(box.cfg, {snap_compression = 'zstd'})
+s = box.schema.space.create('compressed')
+_ = s:create_index('pk')
+-- rows for several blocks
+box.begin() for i = 1, 10000 do s:insert{i, string.rep('x', i % 100)} end box.commit()
+box.snapshot()
+snaps = fio.glob(fio.pathjoin(box.cfg.snap_dir, '*.snap'))
+table.sort(snaps)
+fh = fio.open(snaps[#snaps], {'O_RDONLY'})
+header = string.match(fh:read(4096), '^(.-)\n\n') .. '\n'
+fh:close()
+(string.match(header, '\nCompression: (%w+)\n') == 'zstd') == has_zstd
+not has_zstd or string.match(header, '^SNAP\n0.13\n') ~= nil
+-- the WAL is not compressed
+s:replace{1, 'after snapshot'}
+test_run:cmd('restart server default')
+s = box.space.compressed
+s:count()
+s:get{1}
+s:get{100}
+s:get{9999}[2] == string.rep('x', 99)
+s:drop()
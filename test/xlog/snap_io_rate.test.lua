@@ -0,0 +1,30 @@
+fiber = require('fiber')
+
+--
+-- snap_io_rate_limit spreads snapshot writes over time,
+-- snap_io_rate_burst lets that many megabytes go at once.
+--
+s = box.schema.space.create('rate')
+_ = s:create_index('pk')
+-- about 3MB of rows
+box.begin() for i = 1, 3000 do s:insert{i, string.rep('x', 1000)} end box.commit()
+
+box.cfg{snap_io_rate_limit = 1, snap_io_rate_burst = 1}
+t = fiber.time()
+box.snapshot()
+fiber.time() - t > 1
+
+box.cfg{snap_io_rate_burst = 10}
+t = fiber.time()
+box.snapshot()
+fiber.time() - t < 1.5
+
+box.cfg{snap_io_rate_burst = 0}
+
+-- 0 removes the limit
+box.cfg{snap_io_rate_limit = 0, snap_io_rate_burst = 1}
+t = fiber.time()
+box.snapshot()
+fiber.time() - t < 1.5
+
+s:drop()
@@ -0,0 +1,60 @@
+env = require('test_run')
+test_run = env.new()
+fio = require('fio')
+fiber = require('fiber')
+box.schema.user.grant('guest', 'replication')
+
+--
+-- A snapshot written by four threads: the system spaces go
+-- to <lsn>.snap, the user spaces to <lsn>.snap.1 ... .snap.4.
+--
+box.cfg{snap_threads = 4}
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 6 do
+    local s = box.schema.space.create('part' .. i)
+    s:create_index('pk')
+    s:create_index('sk', {parts = {2, 'str'}})
+    for j = 1, i * 10 do s:insert{j, 'key' .. j} end
+end;
+test_run:cmd("setopt delimiter ''");
+box.snapshot()
+snaps = fio.glob(fio.pathjoin(box.cfg.snap_dir, '*.snap'))
+table.sort(snaps)
+#fio.glob(snaps[#snaps] .. '.*')
+-- these changes go to the WAL only
+box.space.part1:delete{1}
+box.space.part6:replace{1, 'updated'}
+
+--
+-- All parts are read at start.
+--
+test_run:cmd('restart server default')
+fiber = require('fiber')
+box.cfg.snap_threads
+counts = {} for i = 1, 6 do counts[i] = box.space['part' .. i]:count() end
+counts
+box.space.part1:get{1}
+box.space.part3.index.sk:count()
+box.space.part6.index.sk:get{'updated'}
+
+--
+-- A replica joins from the parts.
+--
+test_run:cmd("create server replica with rpl_master=default, script='xlog/replica.lua'")
+test_run:cmd("start server replica")
+test_run:cmd("switch replica")
+fiber = require('fiber')
+while box.space.part6:get{1}[2] ~= 'updated' do fiber.sleep(0.001) end
+counts = {} for i = 1, 6 do counts[i] = box.space['part' .. i]:count() end
+counts
+box.space.part1:get{1}
+box.space.part3.index.sk:count()
+box.space.part6.index.sk:get{'updated'}
+test_run:cmd("switch default")
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+
+--
+-- cleanup
+for i = 1, 6 do box.space['part' .. i]:drop() end
+box.schema.user.revoke('guest', 'replication')
@@ -0,0 +1,28 @@
+env = require('test_run')
+test_run = env.new()
+
+--
+-- At startup the snapshot is read and decoded by a separate
+-- thread, tx applies the rows in batches.
+--
+s = box.schema.space.create('reader')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'str'}, unique = false})
+-- many batches of small rows
+box.begin() for i = 1, 10000 do s:insert{i, tostring(i % 7), i * 2} end box.commit()
+-- rows which fill a batch by size
+for i = 1, 3 do s:replace{i, 'big', string.rep('y', 600 * 1024)} end
+-- many spaces, each of them takes a part of a batch
+for i = 1, 50 do box.schema.space.create('reader' .. i):create_index('pk') box.space['reader' .. i]:insert{i} end
+box.snapshot()
+test_run:cmd('restart server default')
+s = box.space.reader
+s:count()
+s:get{10000}
+s.index.sk:count('0')
+s.index.sk:count('big')
+#s:get{3}[3]
+n = 0 for i = 1, 50 do n = n + box.space['reader' .. i]:get{i}[1] end
+n
+for i = 1, 50 do box.space['reader' .. i]:drop() end
+s:drop()
@@ -0,0 +1,30 @@
+--
+-- In fsync mode rows are synced by a separate thread and
+-- acknowledged only after the sync.
+--
+test_run = require('test_run').new()
+test_run:cmd("create server fsync with script='xlog/fsync.lua'")
+test_run:cmd("start server fsync")
+test_run:cmd("switch fsync")
+fiber = require('fiber')
+box.cfg.wal_mode
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+stat = box.info.wal
+-- every row is synced by the time it's acknowledged
+synced = 0
+for i = 1, 10 do s:insert{i} if box.info.wal.durable_lsn == box.info.server.lsn then synced = synced + 1 end end
+synced
+box.info.wal.sync_count - stat.sync_count >= 10
+-- concurrent writers, some of them still wait for a sync
+for i = 11, 110 do fiber.create(function() s:insert{i} end) end
+test_run:cmd("switch default")
+-- shutdown writes and syncs everything queued
+test_run:cmd("stop server fsync")
+test_run:cmd("start server fsync")
+test_run:cmd("switch fsync")
+box.space.test:count()
+box.space.test:drop()
+test_run:cmd("switch default")
+test_run:cmd("stop server fsync")
+test_run:cmd("cleanup server fsync")
@@ -0,0 +1,81 @@
+--
+-- WAL files written with wal_prealloc_size and wal_direct_io
+-- have zeros past the last row. Check that recovery after a
+-- crash stops there. The server is run as a separate process
+-- and killed while the WAL is open.
+--
+fio = require('fio')
+tarantool_bin_path = arg[-1]
+test_run = require('test_run').new()
+test_run:cmd("setopt delimiter ';'")
+script = [[
+mode = arg[1]
+box.cfg{
+    slab_alloc_arena = 0.1,
+    wal_prealloc_size = mode == 'prealloc' and 1024 * 1024 or 0,
+    wal_direct_io = mode == 'direct_io'
+}
+if box.space.test ~= nil then
+    io.write(box.space.test:count())
+    os.exit(0)
+end
+s = box.schema.space.create('test')
+s:create_index('pk')
+for i = 1, 100 do s:insert{i, string.rep('x', i)} end
+os.execute('kill -9 ' .. box.info.pid)
+]];
+function run(mode)
+    local dir = fio.pathjoin(fio.cwd(), 'wal_' .. mode)
+    local cmd = [[/bin/sh -c 'cd "%s" && "%s" ./script.lua %s 2>>tarantool.log']]
+    local f = io.popen(string.format(cmd, dir, tarantool_bin_path, mode))
+    local output = f:read('*a')
+    f:close()
+    return output
+end;
+function prepare(mode)
+    local dir = fio.pathjoin(fio.cwd(), 'wal_' .. mode)
+    fio.mkdir(dir, tonumber('0755', 8))
+    local fh = fio.open(fio.pathjoin(dir, 'script.lua'),
+                        {'O_CREAT', 'O_WRONLY', 'O_TRUNC'},
+                        tonumber('0644', 8))
+    fh:write(script)
+    fh:close()
+end;
+function last_xlog(mode)
+    local dir = fio.pathjoin(fio.cwd(), 'wal_' .. mode)
+    local list = fio.glob(fio.pathjoin(dir, '*.xlog'))
+    table.sort(list)
+    return list[#list]
+end;
+function log_has(mode, pattern)
+    local dir = fio.pathjoin(fio.cwd(), 'wal_' .. mode)
+    local path = fio.pathjoin(dir, 'tarantool.log')
+    local fh = fio.open(path, {'O_RDONLY'})
+    local log = fh:read(fio.stat(path).size)
+    fh:close()
+    return string.find(log, pattern) ~= nil
+end;
+function cleanup(mode)
+    local dir = fio.pathjoin(fio.cwd(), 'wal_' .. mode)
+    for _, file in pairs(fio.glob(fio.pathjoin(dir, '*'))) do
+        fio.unlink(file)
+    end
+    fio.rmdir(dir)
+end;
+test_run:cmd("setopt delimiter ''");
+
+-- a preallocated WAL
+prepare('prealloc')
+run('prealloc')
+xlog = last_xlog('prealloc')
+fio.stat(xlog).size >= 1024 * 1024
+tonumber(run('prealloc'))
+log_has('prealloc', 'corrupt')
+cleanup('prealloc')
+
+-- O_DIRECT, the last block is padded with zeros
+prepare('direct_io')
+run('direct_io')
+tonumber(run('direct_io'))
+log_has('direct_io', 'corrupt')
+cleanup('direct_io')